@@ -18,10 +18,68 @@
 
 namespace sptk {
 
+/**
+ * Message headers.
+ *
+ * Messages have just a few headers, so headers are kept in a flat vector in insertion order,
+ * rather than in a map: lookup is a short linear scan, and a message costs a single allocation for its headers.
+ * The interface follows std::map, so headers can be used the same way.
+ */
+class SP_EXPORT MessageHeaders
+{
+public:
+    typedef std::pair<String, String>           Header;
+    typedef std::vector<Header>::iterator       iterator;
+    typedef std::vector<Header>::const_iterator const_iterator;
+
+private:
+    std::vector<Header>     m_headers;
+
+public:
+    /**
+     * Get header value, adding header if it doesn't exist
+     * @param name              Header name
+     * @return header value
+     */
+    String& operator[](const String& name);
+
+    /**
+     * Add header without checking if it already exists
+     * @param name              Header name
+     * @param value             Header value
+     */
+    void add(String&& name, String&& value)
+    {
+        m_headers.emplace_back(std::move(name), std::move(value));
+    }
+
+    iterator find(const String& name);
+    const_iterator find(const String& name) const;
+
+    /**
+     * Remove header
+     * @param name              Header name
+     * @return number of removed headers
+     */
+    size_t erase(const String& name);
+
+    iterator erase(const_iterator position)     { return m_headers.erase(position); }
+
+    iterator begin()                            { return m_headers.begin(); }
+    iterator end()                              { return m_headers.end(); }
+    const_iterator begin() const                { return m_headers.begin(); }
+    const_iterator end() const                  { return m_headers.end(); }
+
+    size_t size() const                         { return m_headers.size(); }
+    bool empty() const                          { return m_headers.empty(); }
+    void clear()                                { m_headers.clear(); }
+    void reserve(size_t size)                   { m_headers.reserve(size); }
+};
+
 class SP_EXPORT Message : public Buffer
 {
 public:
-    typedef std::map<String, String> Headers;
+    typedef MessageHeaders Headers;
 
     enum Type : uint8_t {
         UNDEFINED       = 0,
@@ -36,6 +36,7 @@
 #include <smq/protocols/MQProtocol.h>
 #include <sptk5/net/SocketEvents.h>
 #include <sptk5/cthreads>
+#include <future>
 
 namespace sptk {
 
@@ -100,6 +101,18 @@ protected:
 
 public:
 
+    /**
+     * Message and its destination
+     */
+    typedef std::pair<String, SMessage> OutgoingMessage;
+
+    /**
+     * Completion callback of asynchronously sent message
+     * @param message           Sent message
+     * @param error             Nullptr if message is sent, or send error
+     */
+    typedef std::function<void(const SMessage& message, const std::exception_ptr& error)> SendCallback;
+
     /**
      * Constructor
      * @param protocolType      MQ protocol type
@@ -150,6 +163,33 @@ public:
      */
     virtual void send(const String& destination, SMessage& message, std::chrono::milliseconds timeout) = 0;
 
+    /**
+     * Send several messages.
+     * Default implementation sends messages one by one.
+     * @param messages          Messages and their destinations
+     * @param timeout           Operation timeout
+     */
+    virtual void sendBatch(const std::vector<OutgoingMessage>& messages, std::chrono::milliseconds timeout);
+
+    /**
+     * Send message asynchronously.
+     * Message must not be modified until the callback is called.
+     * Default implementation sends message synchronously, and calls the callback before returning.
+     * @param destination       Queue or topic name
+     * @param message           Message
+     * @param callback          Completion callback, may be empty
+     */
+    virtual void sendAsync(const String& destination, const SMessage& message, const SendCallback& callback);
+
+    /**
+     * Send message asynchronously.
+     * Message must not be modified until the returned future is ready.
+     * @param destination       Queue or topic name
+     * @param message           Message
+     * @return future that is ready when message is sent, or holds send error
+     */
+    std::future<void> sendAsync(const String& destination, const SMessage& message);
+
     /**
      * Receive a message
      * @param timeout           Operation timeout
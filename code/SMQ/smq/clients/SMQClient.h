@@ -35,6 +35,10 @@
 #include <smq/clients/TCPMQClient.h>
 #include <smq/clients/BaseMQClient.h>
 #include <smq/protocols/MQLastWillMessage.h>
+#include <smq/protocols/MQDeliveryWindow.h>
+#include <smq/protocols/MQSharedMemorySocket.h>
+#include <sptk5/threads/Timer.h>
+#include <deque>
 
 namespace sptk {
 
@@ -45,11 +49,103 @@ class SP_EXPORT SMQClient : public TCPMQClient
     String                                  m_username;         ///< Connection user name
     String                                  m_password;         ///< Connection password
     std::unique_ptr<MQLastWillMessage>      m_lastWillMessage;  ///< Optional last will message
+    std::mutex                              m_sendMutex;        ///< Serializes writes to the connection
+    std::atomic<QOS>                        m_qos {QOS_0};      ///< QoS of sent messages
+    MQDeliveryWindow                        m_deliveryWindow;   ///< Sent QoS 1 messages, waiting for acknowledgement
+    Timer                                   m_redeliveryTimer;  ///< Checks for QoS 1 messages to redeliver
+    Timer::Event                            m_redeliveryEvent;  ///< Redelivery check event
+
+    /**
+     * Asynchronously sent message
+     */
+    struct PendingMessage
+    {
+        String          destination;        ///< Message destination
+        SMessage        message;            ///< Message
+        SendCallback    callback;           ///< Completion callback
+        QOS             qos {QOS_0};        ///< Delivery QoS
+        uint16_t        packetId {0};       ///< Packet id, assigned when message is taken from pending queue
+    };
+
+    mutable std::mutex                      m_pendingMutex;     ///< Mutex that protects pending messages
+    std::condition_variable                 m_pendingEmpty;     ///< Signals that all the pending messages are sent
+    std::condition_variable                 m_pendingSpace;     ///< Signals that pending messages size decreased
+    std::deque<PendingMessage>              m_pending;          ///< Asynchronously sent messages, waiting to be sent
+    size_t                                  m_pendingBytes {0}; ///< Total size of pending messages
+    size_t                                  m_batchBytes {DefaultBatchBytes};   ///< Pending size that triggers send
+    std::chrono::milliseconds               m_linger {0};       ///< Max time a message stays pending
+    size_t                                  m_maxPendingBytes {DefaultMaxPendingBytes};     ///< Max total size of pending messages
+    std::chrono::milliseconds               m_maxBlock {DefaultMaxBlock};   ///< Max time sendAsync() waits for pending size to decrease
+    bool                                    m_sendScheduled {false};        ///< Immediate send is scheduled on linger timer
+    std::mutex                              m_flushMutex;       ///< Keeps pending messages in order
+    Timer                                   m_lingerTimer;      ///< Sends pending messages after linger time
+    std::mutex                              m_completionMutex;  ///< Mutex that protects completions
+    std::map<uint16_t, PendingMessage>      m_completions;      ///< Sent QoS 1 messages, waiting for acknowledgement, by packet id
+
+    std::mutex                              m_connectMutex;     ///< Mutex that protects connection acknowledgement
+    std::condition_variable                 m_connectAcknowledged;  ///< Signals received CONNECT_ACK
+    bool                                    m_connectAckReceived {false};   ///< True if CONNECT_ACK is received
+
+    static void redeliveryTimerCallback(void* eventData);
+    static void lingerTimerCallback(void* eventData);
+    void redeliver();
+    void sendFrame(const Buffer& frame);
+
+    /**
+     * Switch to shared memory transport if the server accepted it, or release shared memory otherwise
+     * @param connectAck        Received CONNECT_ACK message
+     */
+    void acceptSharedMemory(Message& connectAck);
+
+    /**
+     * Send CONNECT message
+     * @param username          Connection user name
+     * @param password          Connection password
+     * @param sharedMemory      Request shared memory transport
+     * @param timeout           Operation timeout
+     */
+    void sendConnect(const String& username, const String& password, bool sharedMemory,
+                     std::chrono::milliseconds timeout);
+
+    /**
+     * Send pending messages that fit into delivery window, with a single write
+     */
+    void sendPending();
+
+    /**
+     * Call completion callback of acknowledged message
+     * @param packetId          Acknowledged packet id
+     */
+    void complete(uint16_t packetId);
+
+    /**
+     * Fail all the pending messages, and messages waiting for acknowledgement
+     * @param reason            Error message
+     */
+    void failPending(const String& reason);
+
 protected:
     void socketEvent(SocketEventType eventType) override;
 
 public:
 
+    /**
+     * Default pending messages size that triggers send
+     */
+    static constexpr size_t DefaultBatchBytes = 16384;
+
+    /**
+     * Default max total size of pending messages
+     */
+    static constexpr size_t DefaultMaxPendingBytes = 32 * 1024 * 1024;
+
+    /**
+     * Default max time sendAsync() waits for pending messages size to decrease
+     */
+    static constexpr std::chrono::milliseconds DefaultMaxBlock = std::chrono::seconds(10);
+
+    using BaseMQClient::sendAsync;
+
     /**
      * Constructor
      * @param clientId          Unique client id
@@ -59,7 +155,7 @@ public:
     /**
      * Destructor
      */
-    ~SMQClient() override = default;
+    ~SMQClient() override;
 
     /**
      * Set last will message
@@ -81,6 +177,28 @@ public:
     void connect(const Host& server, const String& username, const String& password, bool encrypted,
                  std::chrono::milliseconds timeout) override;
 
+#ifndef _WIN32
+    /**
+     * Connect to MQ server on the same host, through Unix domain socket.
+     *
+     * With SMQ protocol, the client may also request shared memory transport. If the server accepts it,
+     * messages are passed through shared memory rings instead of the socket.
+     * This method then waits for the server connection acknowledgement.
+     * @param socketPath        MQ server socket file path
+     * @param username          MQ server username
+     * @param password          MQ server password
+     * @param timeout           Operation timeout
+     * @param sharedMemory      Request shared memory transport
+     */
+    void connectLocal(const String& socketPath, const String& username, const String& password,
+                      std::chrono::milliseconds timeout, bool sharedMemory = true);
+
+    /**
+     * @return true if the connection uses shared memory transport
+     */
+    bool sharedMemoryActive();
+#endif
+
     /**
      * Disconnect from server
      * @param immediate         If false then disconnect as defined by server protocol. Otherwise, just terminate connection.
@@ -106,6 +224,85 @@ public:
      * @param timeout           Operation timeout
      */
     void send(const String& destination, SMessage& message, std::chrono::milliseconds timeout) override;
+
+    /**
+     * Send several messages with a single write.
+     * With QoS 1, waits for free slots in the delivery window, but not for the acknowledgements.
+     * @param messages          Messages and their destinations
+     * @param timeout           Operation timeout
+     */
+    void sendBatch(const std::vector<OutgoingMessage>& messages, std::chrono::milliseconds timeout) override;
+
+    /**
+     * Send message asynchronously.
+     *
+     * Message is added to pending messages, and the method returns without writing to the connection.
+     * Pending messages are sent from the linger timer thread with a single write, when their size
+     * reaches batch size, or when the first of them waits for linger time. With QoS 1, only the messages
+     * that fit into delivery window are sent, and the rest are sent when the server acknowledges
+     * the previous messages.
+     * If pending messages size reaches max pending size, the method blocks until the pending messages
+     * are sent, for up to max block time, and then throws TimeoutException. Message isn't sent then,
+     * and the callback isn't called.
+     * The callback is called when QoS 0 message is written to the connection, or when QoS 1 message
+     * is acknowledged by the server. It may be called from the timer thread, connection thread,
+     * or a thread that calls flush() or disconnect().
+     * Message must not be modified until the callback is called.
+     * @param destination       Queue or topic name
+     * @param message           Message
+     * @param callback          Completion callback, may be empty
+     */
+    void sendAsync(const String& destination, const SMessage& message, const SendCallback& callback) override;
+
+    /**
+     * Set thresholds of asynchronously sent messages, similar to Kafka producer batch.size, linger.ms,
+     * buffer.memory and max.block.ms
+     * @param batchBytes        Pending messages size that triggers send
+     * @param linger            Max time a message waits for other messages, 0 sends every message immediately
+     * @param maxPendingBytes   Max total size of pending messages
+     * @param maxBlock          Max time sendAsync() waits when pending messages size reaches max pending size
+     */
+    void setBatching(size_t batchBytes, std::chrono::milliseconds linger,
+                     size_t maxPendingBytes = DefaultMaxPendingBytes,
+                     std::chrono::milliseconds maxBlock = DefaultMaxBlock);
+
+    /**
+     * Send all the pending messages
+     * @param timeout           Max time to wait
+     * @return true if all the pending messages are sent
+     */
+    bool flush(std::chrono::milliseconds timeout);
+
+    /**
+     * @return number of asynchronously sent messages, waiting to be sent
+     */
+    size_t pending() const;
+
+    /**
+     * Set QoS of sent messages.
+     *
+     * With QoS 1, every sent message waits in the delivery window until the server acknowledges it,
+     * and is sent again if it isn't acknowledged within redelivery timeout. Up to window size messages
+     * are sent without waiting for acknowledgements. When the window is full, send() waits for a free slot.
+     * QoS 2 isn't supported, and is handled as QoS 1.
+     * @param qos               QoS of sent messages
+     * @param windowSize        Max number of messages waiting for acknowledgement
+     * @param redeliveryTimeout Time to wait for acknowledgement before message is sent again
+     */
+    void setDeliveryQOS(QOS qos, size_t windowSize = MQDeliveryWindow::DefaultWindowSize,
+                        std::chrono::milliseconds redeliveryTimeout = MQDeliveryWindow::DefaultRedeliveryTimeout);
+
+    /**
+     * @return number of sent QoS 1 messages, waiting for acknowledgement
+     */
+    size_t inFlight() const;
+
+    /**
+     * Wait until the server acknowledges all the sent QoS 1 messages
+     * @param timeout           Max time to wait
+     * @return true if all the messages are acknowledged
+     */
+    bool waitForAcknowledgements(std::chrono::milliseconds timeout);
 };
 
 }
@@ -87,6 +87,16 @@ protected:
 
     void createConnection(const Host& server, bool encrypted, std::chrono::milliseconds timeout);
 
+#ifndef _WIN32
+    /**
+     * Connect to server Unix domain socket.
+     * Connection socket supports shared memory transport, see MQSharedMemorySocket.
+     * @param socketPath        Server socket file path
+     * @param timeout           Connection timeout
+     */
+    void createConnection(const String& socketPath, std::chrono::milliseconds timeout);
+#endif
+
     void destroyConnection();
 };
 
@@ -0,0 +1,171 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       MQDeliveryWindow.h - description                       ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __MQ_DELIVERY_WINDOW_H__
+#define __MQ_DELIVERY_WINDOW_H__
+
+#include <smq/Message.h>
+#include <sptk5/cthreads>
+
+namespace sptk {
+
+/**
+ * In-flight window of QoS 1 messages.
+ *
+ * Every message sent with QoS 1 gets a packet id, and stays in the window
+ * until the peer acknowledges that packet id. Up to window size messages
+ * may be in flight at once, so the sender pipelines messages instead of
+ * waiting for a round trip per message. Messages that aren't acknowledged
+ * within redelivery timeout are returned by expired(), to be sent again.
+ */
+class SP_EXPORT MQDeliveryWindow
+{
+public:
+    /**
+     * Default max number of in-flight messages
+     */
+    static constexpr size_t DefaultWindowSize = 64;
+
+    /**
+     * Default redelivery timeout
+     */
+    static constexpr std::chrono::milliseconds DefaultRedeliveryTimeout = std::chrono::seconds(5);
+
+    /**
+     * Message waiting for acknowledgement
+     */
+    struct Delivery
+    {
+        uint16_t                                packetId;   ///< Packet id
+        String                                  destination;///< Message destination
+        SMessage                                message;    ///< Message
+        std::chrono::steady_clock::time_point   sent;       ///< Time of the last send attempt
+        unsigned                                attempts;   ///< Number of send attempts
+    };
+
+private:
+    mutable std::mutex                  m_mutex;
+    std::condition_variable             m_condition;        ///< Signals acknowledgements
+    size_t                              m_windowSize;       ///< Max number of in-flight messages
+    std::chrono::milliseconds           m_redeliveryTimeout;///< Redelivery timeout
+    uint16_t                            m_lastPacketId {0}; ///< Last assigned packet id
+    std::map<uint16_t, Delivery>        m_inFlight;         ///< Messages waiting for acknowledgement, by packet id
+
+    uint16_t addUnlocked(const String& destination, const SMessage& message);
+
+public:
+    /**
+     * Constructor
+     * @param windowSize        Max number of in-flight messages
+     * @param redeliveryTimeout Redelivery timeout
+     */
+    explicit MQDeliveryWindow(size_t windowSize = DefaultWindowSize,
+                              std::chrono::milliseconds redeliveryTimeout = DefaultRedeliveryTimeout);
+
+    /**
+     * Add message to the window, waiting for a free slot if the window is full
+     * @param destination       Message destination
+     * @param message           Message
+     * @param timeout           Max time to wait for a free slot
+     * @return packet id assigned to the message
+     */
+    uint16_t add(const String& destination, const SMessage& message, std::chrono::milliseconds timeout);
+
+    /**
+     * Add message to the window if there is a free slot
+     * @param destination       Message destination
+     * @param message           Message
+     * @param packetId          Packet id assigned to the message (output)
+     * @return false if the window is full
+     */
+    bool tryAdd(const String& destination, const SMessage& message, uint16_t& packetId);
+
+    /**
+     * Remove acknowledged message from the window
+     * @param packetId          Acknowledged packet id
+     * @return false if packet id isn't in flight
+     */
+    bool acknowledge(uint16_t packetId);
+
+    /**
+     * Get messages that weren't acknowledged within redelivery timeout.
+     * Returned messages are considered sent again, and their redelivery timeout restarts.
+     * @param deliveries        Expired messages (output)
+     */
+    void expired(std::vector<Delivery>& deliveries);
+
+    /**
+     * Wait until all the messages in the window are acknowledged
+     * @param timeout           Max time to wait
+     * @return true if window is empty
+     */
+    bool waitEmpty(std::chrono::milliseconds timeout);
+
+    /**
+     * @return number of messages waiting for acknowledgement
+     */
+    size_t inFlight() const;
+
+    /**
+     * @return max number of in-flight messages
+     */
+    size_t windowSize() const;
+
+    /**
+     * Set max number of in-flight messages
+     * @param windowSize        Max number of in-flight messages, at least 1
+     */
+    void windowSize(size_t windowSize);
+
+    /**
+     * @return redelivery timeout
+     */
+    std::chrono::milliseconds redeliveryTimeout() const;
+
+    /**
+     * Set redelivery timeout
+     * @param timeout           Redelivery timeout
+     */
+    void redeliveryTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * Remove all messages from the window
+     */
+    void clear();
+};
+
+/**
+ * Parse comma-separated list of message ids, as used in acknowledgements
+ * @param messageIds        Comma-separated message ids
+ * @param packetIds         Packet ids (output)
+ */
+SP_EXPORT void parseMessageIds(const String& messageIds, std::vector<uint16_t>& packetIds);
+
+} // namespace sptk
+
+#endif
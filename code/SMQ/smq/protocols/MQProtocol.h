@@ -53,6 +53,14 @@ enum QOS : uint8_t
     QOS_2
 };
 
+/**
+ * Encoded protocol frame.
+ *
+ * Frame is immutable once encoded, so the same frame may be shared
+ * between all the connections that receive the same message.
+ */
+typedef std::shared_ptr<const Buffer> SharedMQFrame;
+
 class SP_EXPORT MQProtocol
 {
     TCPSocket&  m_socket;
@@ -82,11 +90,102 @@ public:
         return m_socket.write((const char*)&data, sizeof(data));
     }
     size_t write(String& str);
-    size_t write(Buffer& data);
+    size_t write(const Buffer& data);
+
+    /**
+     * Send acknowledgement
+     * @param sourceMessageType Type of acknowledged message
+     * @param messageId         Acknowledged message id, or empty string
+     */
+    virtual void ack(Message::Type sourceMessageType, const String& messageId);
 
-    virtual void ack(Message::Type sourceMessageType, const String& messageId) = 0;
     virtual bool readMessage(SMessage& message) = 0;
-    virtual bool sendMessage(const String& destination, SMessage& message) = 0;
+    virtual bool sendMessage(const String& destination, SMessage& message);
+
+    /**
+     * Encode and send message.
+     * Unlike frames returned by encodeMessage(), the encoding may depend on the messages
+     * previously sent to this connection, so sent messages should only use this method.
+     * @param destination       Message destination
+     * @param message           Message to send
+     * @param qos               Delivery QoS
+     * @param packetId          Packet id, only used with QoS above 0
+     * @param duplicate         True if message is re-delivered
+     */
+    virtual void sendMessage(const String& destination, const Message& message, QOS qos, uint16_t packetId,
+                             bool duplicate);
+
+    /**
+     * Encode message, and append it to the frames that are sent later with a single write.
+     * Like sendMessage(), the encoding may depend on the messages previously sent to this connection,
+     * so the frames must be sent in the order they are appended, before any other message.
+     * @param frames            Encoded frames (output)
+     * @param destination       Message destination
+     * @param message           Message to encode
+     * @param qos               Delivery QoS
+     * @param packetId          Packet id, only used with QoS above 0
+     * @param duplicate         True if message is re-delivered
+     */
+    virtual void appendMessage(Buffer& frames, const String& destination, const Message& message, QOS qos,
+                               uint16_t packetId, bool duplicate);
+
+    /**
+     * @return wire format version, used for the messages encoded by this protocol
+     */
+    virtual uint8_t version() const
+    {
+        return 1;
+    }
+
+    /**
+     * Negotiate wire format version.
+     * Server calls it with received CONNECT message, and client calls it with received CONNECT_ACK.
+     * @param message           CONNECT or CONNECT_ACK message
+     */
+    virtual void negotiate(const Message& message)
+    {
+    }
+
+    /**
+     * Encode message into protocol frame, ready to be sent to socket, with QoS 0.
+     * Message isn't modified, so the same message may be encoded for many connections concurrently.
+     * @param destination       Message destination
+     * @param message           Message to encode
+     * @return encoded frame
+     */
+    SharedMQFrame encodeMessage(const String& destination, const Message& message) const
+    {
+        return encodeMessage(destination, message, QOS_0, 0, false);
+    }
+
+    /**
+     * Encode message into protocol frame, ready to be sent to socket.
+     * Message isn't modified, so the same message may be encoded for many connections concurrently.
+     * @param destination       Message destination
+     * @param message           Message to encode
+     * @param qos               Delivery QoS
+     * @param packetId          Packet id, only used with QoS above 0
+     * @param duplicate         True if message is re-delivered
+     * @return encoded frame
+     */
+    virtual SharedMQFrame encodeMessage(const String& destination, const Message& message, QOS qos,
+                                        uint16_t packetId, bool duplicate) const = 0;
+
+    /**
+     * Encode acknowledgements of several messages into a single frame,
+     * that is sent with a single write.
+     * @param sourceMessageType Type of acknowledged messages
+     * @param messageIds        Acknowledged message ids, may be empty for message types without ids
+     * @return encoded frame, or nullptr if message type isn't acknowledged
+     */
+    virtual SharedMQFrame encodeAck(Message::Type sourceMessageType, const std::vector<uint16_t>& messageIds) const = 0;
+
+    /**
+     * Send previously encoded protocol frame
+     * @param frame             Encoded frame
+     * @return true if frame is sent
+     */
+    virtual bool sendFrame(const Buffer& frame);
 
     static std::shared_ptr<MQProtocol> factory(MQProtocolType protocolType, TCPSocket& socket);
 };
@@ -0,0 +1,110 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       MQSharedMemoryRing.h - description                     ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __MQ_SHARED_MEMORY_RING_H__
+#define __MQ_SHARED_MEMORY_RING_H__
+
+#include <sptk5/sptk.h>
+#include <atomic>
+
+namespace sptk {
+
+/**
+ * Single producer, single consumer byte ring in shared memory.
+ *
+ * Ring doesn't own its memory: the same memory is mapped by a producer process and a consumer process,
+ * and each of them creates a ring object over it. Read and write positions are kept in the shared memory,
+ * and only grow, so the ring is empty when they are equal.
+ *
+ * Positions may be modified by the peer process, so they are verified on every access:
+ * if the peer has moved them outside of the ring, the ring throws an exception,
+ * and the connection should be closed.
+ */
+class SP_EXPORT MQSharedMemoryRing
+{
+    struct Header;
+
+    Header*     m_header {nullptr};     ///< Ring positions, in shared memory
+    char*       m_data {nullptr};       ///< Ring data, in shared memory
+    size_t      m_capacity {0};         ///< Ring data size
+
+    /**
+     * Verify ring positions
+     * @param head              Read position
+     * @param tail              Write position
+     * @return number of bytes written but not read yet
+     */
+    size_t usedBytes(uint64_t head, uint64_t tail) const;
+
+public:
+    /**
+     * Constructor
+     * @param memory            Shared memory
+     * @param memorySize        Shared memory size, including the ring header
+     * @param initialize        If true then ring is created empty, otherwise it is already initialized by peer
+     */
+    MQSharedMemoryRing(void* memory, size_t memorySize, bool initialize);
+
+    /**
+     * @param capacity          Ring data size
+     * @return shared memory size required for ring with capacity
+     */
+    static size_t memorySize(size_t capacity);
+
+    /**
+     * @return ring data size
+     */
+    size_t capacity() const;
+
+    /**
+     * @return number of bytes available for reading
+     */
+    size_t available() const;
+
+    /**
+     * Write as much data as fits into ring. Only called by producer.
+     * @param data              Data to write
+     * @param size              Data size
+     * @param wakeup            True if consumer has read all the data written before (output),
+     *                          so it may be waiting and should be woken up
+     * @return number of bytes written
+     */
+    size_t write(const char* data, size_t size, bool& wakeup);
+
+    /**
+     * Read available data. Only called by consumer.
+     * @param data              Output buffer
+     * @param size              Output buffer size
+     * @return number of bytes read
+     */
+    size_t read(char* data, size_t size);
+};
+
+} // namespace sptk
+
+#endif
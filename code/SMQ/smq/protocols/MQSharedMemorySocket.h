@@ -0,0 +1,185 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       MQSharedMemorySocket.h - description                   ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __MQ_SHARED_MEMORY_SOCKET_H__
+#define __MQ_SHARED_MEMORY_SOCKET_H__
+
+#include <sptk5/net/TCPSocket.h>
+#include <smq/protocols/MQSharedMemoryRing.h>
+#include <memory>
+
+namespace sptk {
+
+/**
+ * Unix domain socket, that may switch to shared memory transport.
+ *
+ * Client requests shared memory transport in CONNECT message. Server creates sealed anonymous shared memory
+ * segment with two rings, one for each direction, and passes its file descriptor to the client together with
+ * CONNECT_ACK. The segment can't be resized by either side, and isn't visible to other processes.
+ * After that both sides exchange data through the rings. Data is written directly into the memory
+ * the peer reads from, rather than copied through kernel socket buffers. The socket only carries
+ * one byte wakeups, sent when the reader may be waiting for data, and reports connection close.
+ *
+ * Until shared memory transport is activated, the socket works as a regular socket.
+ */
+class SP_EXPORT MQSharedMemorySocket : public TCPSocket
+{
+    void*                               m_memory {nullptr};     ///< Mapped shared memory segment
+    size_t                              m_memorySize {0};       ///< Mapped shared memory segment size
+    int                                 m_segmentFD {-1};       ///< Segment descriptor, to pass to the client or received from the server
+    bool                                m_requested {false};    ///< True if the client requested shared memory, and expects segment descriptor
+    std::unique_ptr<MQSharedMemoryRing> m_inbound;              ///< Ring of received data
+    std::unique_ptr<MQSharedMemoryRing> m_outbound;             ///< Ring of sent data
+    std::atomic<bool>                   m_active {false};       ///< True if shared memory transport is active
+    std::chrono::milliseconds           m_writeTimeout {0};     ///< Max time to wait for free space in outbound ring, 0 is unlimited
+
+    /**
+     * Map shared memory segment, and create rings over it
+     * @param memorySize        Shared memory segment size
+     * @param serverSide        If true then the segment is created by this side, and rings are initialized empty
+     */
+    void mapSegment(size_t memorySize, bool serverSide);
+
+    /**
+     * Close segment descriptor, if it isn't passed or mapped yet
+     */
+    void closeSegmentFD();
+
+    /**
+     * Receive data from the socket, keeping the segment descriptor if it arrives with the data
+     * @param buffer            Output buffer
+     * @param size              Output buffer size
+     * @return number of bytes received, same as recv()
+     */
+    size_t receiveWithSegment(void* buffer, size_t size);
+
+    /**
+     * Send data to the socket, passing the segment descriptor with it
+     * @param buffer            Data to send
+     * @param size              Data size
+     * @return number of bytes sent, same as send()
+     */
+    size_t sendWithSegment(const void* buffer, size_t size);
+
+    /**
+     * Read and discard wakeup bytes, received from the socket
+     */
+    void readWakeups();
+
+    /**
+     * Send wakeup byte to the peer
+     */
+    void sendWakeup();
+
+    /**
+     * Wait until the peer reads or writes ring data
+     * @param timeout           Max time to wait
+     */
+    void waitForPeer(std::chrono::milliseconds timeout);
+
+    /**
+     * @return true if peer has closed the connection
+     */
+    bool peerClosed();
+
+public:
+    /**
+     * Default capacity of every ring
+     */
+    static constexpr size_t DefaultRingCapacity = 1024 * 1024;
+
+    /**
+     * Constructor
+     */
+    MQSharedMemorySocket() = default;
+
+    /**
+     * Destructor
+     */
+    ~MQSharedMemorySocket() override;
+
+    /**
+     * Request shared memory transport. Client side only.
+     * Must be called before CONNECT message is sent, so the segment descriptor,
+     * passed with CONNECT_ACK, is received.
+     */
+    void requestSharedMemory();
+
+    /**
+     * Create shared memory segment. Server side only.
+     * Only allowed for Unix domain socket connections, since peer must run on the same host.
+     * The segment descriptor is passed to the client with the next data sent through the socket.
+     * @param ringCapacity      Capacity of every ring
+     */
+    void createSharedMemory(size_t ringCapacity = DefaultRingCapacity);
+
+    /**
+     * Map shared memory segment, received from the server. Client side only.
+     */
+    void attachSharedMemory();
+
+    /**
+     * Switch the connection to shared memory transport.
+     * Must be called by the thread that reads the socket, right after the last message
+     * sent through the socket is read, so any bytes buffered after it are wakeups.
+     */
+    void activateSharedMemory();
+
+    /**
+     * Unmap shared memory segment, if it isn't activated, and cancel shared memory request
+     */
+    void releaseSharedMemory();
+
+    /**
+     * @return true if shared memory transport is active
+     */
+    bool sharedMemoryActive() const;
+
+    /**
+     * Set max time send() waits for the peer to read from full outbound ring.
+     * The time is counted from the last time the peer has read anything, so a slow reader isn't affected.
+     * When the timeout expires, send() throws TimeoutException, with the data partially sent.
+     * @param timeout           Write timeout, 0 is unlimited
+     */
+    void writeTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * @return number of received bytes, buffered by the socket reader or in shared memory ring,
+     *         that can be read without reading the socket
+     */
+    size_t bufferedBytes();
+
+    size_t recv(void* buffer, size_t size) override;
+    size_t send(const void* buffer, size_t size) override;
+    size_t socketBytes() override;
+    bool readyToRead(std::chrono::milliseconds timeout) override;
+};
+
+} // namespace sptk
+
+#endif
@@ -88,6 +88,7 @@ class SP_EXPORT MQTTFrame : public Buffer
     MQTTFrameType           m_type;     ///< Frame type
     uint16_t                m_id;       ///< Frame id
     QOS                     m_qos;      ///< QOS (Quality Of Service)
+    bool                    m_retain {false};   ///< PUBLISH retain flag
 
     /**
      * Next packet id generator
@@ -224,6 +225,14 @@ public:
         return m_qos;
     }
 
+    /**
+     * @return true if received PUBLISH frame has retain flag
+     */
+    bool retain() const
+    {
+        return m_retain;
+    }
+
     /**
      * Set frame to ACK
      * @param messageId         Message id
@@ -254,9 +263,11 @@ public:
      * @param qos               QOS - Quality of Service
      * @param dup               Duplicate packet flag
      * @param retain            Retain message flag
+     * @param packetId          Packet id for QOS above 0. If 0, then next packet id is generated.
      * @return this object reference
      */
-    const Buffer& setPUBLISH(const String& topic, const Buffer& data, QOS qos=QOS_0, bool dup=false, bool retain=false);
+    const Buffer& setPUBLISH(const String& topic, const Buffer& data, QOS qos=QOS_0, bool dup=false, bool retain=false,
+                             uint16_t packetId=0);
 
     /**
      * Generate MQTT SUBSCRIBE frame
@@ -43,9 +43,12 @@ public:
     static Message::Type mqMessageType(MQTTFrameType nativeMessageType);
     static MQTTFrameType nativeMessageType(Message::Type mqMessageType);
 
-    void ack(Message::Type sourceMessageType, const String& messageId) override;
+    using MQProtocol::encodeMessage;
+
     bool readMessage(SMessage& message) override;
-    bool sendMessage(const String& destination, SMessage& message) override;
+    SharedMQFrame encodeMessage(const String& destination, const Message& message, QOS qos,
+                                uint16_t packetId, bool duplicate) const override;
+    SharedMQFrame encodeAck(Message::Type sourceMessageType, const std::vector<uint16_t>& messageIds) const override;
 };
 
 }
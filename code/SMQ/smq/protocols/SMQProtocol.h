@@ -35,13 +35,86 @@
 
 namespace sptk {
 
+/**
+ * SMQ protocol.
+ *
+ * Version 1 wire format has text headers, "name: value\n", and the destination is one of the headers.
+ * Version 2 wire format is binary: every frame is length-prefixed, and headers are TLV-encoded,
+ * with single byte tags for the well-known header names. Messages, sent by a client, refer to
+ * a destination by id after the destination is used for the first time.
+ *
+ * Both sides always read both formats. A client requests version 2 in CONNECT message,
+ * and switches to it when CONNECT_ACK confirms it. So the clients and servers that only know version 1
+ * continue to work.
+ */
 class SP_EXPORT SMQProtocol : public MQProtocol
 {
+    std::atomic<uint8_t>                m_version {1};          ///< Wire format version, used for sending
+    mutable std::mutex                  m_sendMutex;            ///< Keeps destination definitions in send order
+    bool                                m_internDestinations {false};   ///< Send destination ids instead of names
+    std::map<String, uint16_t>          m_outgoingDestinations; ///< Interned destinations of sent messages
+    std::vector<String>                 m_incomingDestinations; ///< Interned destinations of received messages
+
+    /**
+     * Read text (version 1) message, after the first byte of its signature
+     * @param message           Message to read
+     */
+    void readTextMessage(SMessage& message);
+
+    /**
+     * Read binary (version 2) message, after its signature
+     * @param message           Message to read
+     */
+    void readBinaryMessage(SMessage& message);
+
+    /**
+     * Encode message using interned destinations, and append it to frames
+     */
+    void appendMessageUnlocked(Buffer& frames, const String& destination, const Message& message, QOS qos,
+                               uint16_t packetId, bool duplicate);
+
+    /**
+     * Encode text (version 1) message
+     */
+    SharedMQFrame encodeTextMessage(const String& destination, const Message& message, QOS qos,
+                                    uint16_t packetId, bool duplicate) const;
+
+    /**
+     * Encode binary (version 2) message
+     * @param destinationId     Interned destination id, or 0 to send destination name
+     * @param defineDestination If true then the frame defines destination id, otherwise refers to it
+     */
+    SharedMQFrame encodeBinaryMessage(const String& destination, const Message& message, QOS qos,
+                                      uint16_t packetId, bool duplicate,
+                                      uint16_t destinationId, bool defineDestination) const;
+
 public:
+    /**
+     * The latest supported wire format version
+     */
+    static constexpr uint8_t LatestVersion = 2;
+
+    /**
+     * Max number of interned destinations per connection
+     */
+    static constexpr size_t MaxInternedDestinations = 4096;
+
     explicit SMQProtocol(TCPSocket& socket) : MQProtocol(socket) {}
-    void ack(Message::Type sourceMessageType, const String& messageId) override;
+    using MQProtocol::encodeMessage;
+    using MQProtocol::sendMessage;
+
     bool readMessage(SMessage& message) override;
     bool sendMessage(const String& destination, SMessage& message) override;
+    void sendMessage(const String& destination, const Message& message, QOS qos, uint16_t packetId,
+                     bool duplicate) override;
+    void appendMessage(Buffer& frames, const String& destination, const Message& message, QOS qos,
+                       uint16_t packetId, bool duplicate) override;
+    SharedMQFrame encodeMessage(const String& destination, const Message& message, QOS qos,
+                                uint16_t packetId, bool duplicate) const override;
+    SharedMQFrame encodeAck(Message::Type sourceMessageType, const std::vector<uint16_t>& messageIds) const override;
+
+    uint8_t version() const override;
+    void negotiate(const Message& message) override;
 };
 
 } // namespace sptk
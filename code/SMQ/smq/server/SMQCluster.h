@@ -0,0 +1,255 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQCluster.h - description                             ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SMQ_CLUSTER_H__
+#define __SMQ_CLUSTER_H__
+
+#include <smq/clients/SMQClient.h>
+#include <smq/server/SMQHashRing.h>
+#include <sptk5/threads/Timer.h>
+
+namespace sptk {
+
+class SMQServer;
+class SMQCluster;
+
+/**
+ * Connection from this cluster node to a peer node.
+ *
+ * This node forwards subscriptions of its local clients over the link,
+ * so the peer node delivers matching messages to the link. These messages
+ * are delivered to the local subscribers only, and never forwarded again.
+ *
+ * Everything sent over the link goes through its pending queue, and is written by the timer thread,
+ * so a slow peer never blocks the caller. Messages are sent with QoS 1, and are complete
+ * when the peer acknowledges them.
+ */
+class SP_EXPORT SMQClusterLink : public SMQClient
+{
+    SMQCluster&     m_cluster;          ///< Cluster
+    String          m_peerNode;         ///< Peer node name
+
+protected:
+    bool previewMessage(SMessage& message) override;
+
+public:
+    /**
+     * Constructor
+     * @param protocolType      Protocol of the cluster servers
+     * @param cluster           Cluster
+     * @param peerNode          Peer node name
+     */
+    SMQClusterLink(MQProtocolType protocolType, SMQCluster& cluster, const String& peerNode);
+
+    /**
+     * Queue subscription or unsubscription, without waiting for it to be sent
+     * @param destination       Destination
+     * @param subscribe         True to subscribe, false to unsubscribe
+     */
+    void forwardInterest(const String& destination, bool subscribe);
+
+    /**
+     * @return peer node name
+     */
+    const String& peerNode() const { return m_peerNode; }
+};
+
+typedef std::shared_ptr<SMQClusterLink> SharedSMQClusterLink;
+
+/**
+ * SMQ server cluster.
+ *
+ * Every node connects to every peer node, and forwards subscription interest
+ * of its local clients to the peers. So a published message only travels to the nodes
+ * that have matching subscribers, over a single hop:
+ *
+ * - topic subscriptions are forwarded to all the peers;
+ * - every queue (/queue/ destination) is owned by a single node, selected by consistent hashing
+ *   of the queue name over the connected nodes. Messages, published to the queue on other nodes,
+ *   are forwarded to the owner, and queue subscriptions are forwarded to the owner only.
+ *
+ * When a node joins or leaves, queue subscriptions are moved to the new owners,
+ * and durable queue messages, stored on a node that no longer owns the queue, are handed off
+ * to the new owner.
+ * Node name is its host and port, as peers know it, for instance "localhost:4000".
+ */
+class SP_EXPORT SMQCluster
+{
+    mutable std::mutex                      m_mutex;
+    SMQServer&                              m_server;           ///< Server of this node
+    String                                  m_nodeName;         ///< Name of this node
+    String                                  m_username;         ///< Peer connection user name
+    String                                  m_password;         ///< Cluster key, peer connection password
+    std::map<String, Host>                  m_peers;            ///< Configured peer nodes, by name
+    std::map<String, SharedSMQClusterLink>  m_links;            ///< Connected peer links, by peer node name
+    SMQHashRing                             m_ring;             ///< Connected nodes, used to select queue owners
+    std::set<String>                        m_interest;         ///< Destinations with local subscribers
+    std::atomic<size_t>                     m_forwardedMessages {0};   ///< Queue messages forwarded to owners
+    std::atomic<size_t>                     m_receivedMessages {0};    ///< Messages received from peers
+    Timer                                   m_maintenanceTimer; ///< Connects peers and tracks membership
+    Timer::Event                            m_maintenanceEvent; ///< Maintenance timer event
+
+    static void maintenanceTimerCallback(void* eventData);
+
+    /**
+     * Forward subscription to peer(s) that should deliver destination messages to this node
+     * @param destination       Destination
+     * @param subscribe         True to subscribe, false to unsubscribe
+     */
+    void forwardInterestUnlocked(const String& destination, bool subscribe);
+
+    /**
+     * Get connected link to peer node
+     * @param node              Peer node name
+     * @return link, or nullptr if the node isn't connected
+     */
+    SharedSMQClusterLink linkUnlocked(const String& node) const;
+
+    /**
+     * Rebuild ring after node(s) joined or left, and move queue subscriptions to new owners
+     * @param joined            Nodes that joined
+     */
+    void rebalanceUnlocked(const std::set<String>& joined);
+
+    /**
+     * Hand off stored durable queue messages to the queue owners.
+     * Stored message is consumed only after the owner acknowledges it.
+     */
+    void handoff();
+
+public:
+    /**
+     * Client id prefix of peer node connections
+     */
+    static const String NodeClientIdPrefix;
+
+    /**
+     * Constructor
+     * @param server            Server of this node
+     * @param node              This node host and port, as peers know it
+     * @param peers             Peer nodes
+     * @param username          Peer connection user name
+     * @param clusterKey        Secret shared by the cluster nodes, peer connection password
+     */
+    SMQCluster(SMQServer& server, const Host& node, const std::vector<Host>& peers,
+               const String& username, const String& clusterKey);
+
+    /**
+     * Destructor
+     */
+    ~SMQCluster();
+
+    /**
+     * Start connecting to peers
+     * @param interval          Interval of peer connection and membership checks
+     */
+    void start(std::chrono::milliseconds interval);
+
+    /**
+     * Disconnect from peers
+     */
+    void stop();
+
+    /**
+     * Check if destination is a queue, that has a single owner node
+     * @param destination       Destination
+     * @return true if destination is a queue
+     */
+    static bool isQueue(const String& destination);
+
+    /**
+     * Forward message published by a local client to the queue owner, if it's another node.
+     * Message is queued to the owner link, and isn't sent yet when the method returns.
+     * If the owner link can't accept or send the message, the message is delivered by this node.
+     * @param message           Message
+     * @return true if message is forwarded, and shouldn't be delivered by this node
+     */
+    bool route(SMessage& message);
+
+    /**
+     * Deliver message received from a peer to local subscribers
+     * @param message           Message
+     */
+    void deliverFromPeer(SMessage& message);
+
+    /**
+     * Forward subscriptions of a local client to peers
+     * @param destinations      Destinations
+     */
+    void subscribe(const std::map<String, QOS>& destinations);
+
+    /**
+     * Stop forwarding destination to peers, if there are no local subscribers left
+     * @param destination       Destination
+     */
+    void unsubscribe(const String& destination);
+
+    /**
+     * Connect peers that aren't connected, and update membership
+     */
+    void maintain();
+
+    /**
+     * Check credentials of a connection that uses peer node client id
+     * @param username          User name
+     * @param password          Password
+     * @return true if the connection is made by a peer node
+     */
+    bool authenticatePeer(const String& username, const String& password) const;
+
+    /**
+     * @return name of this node
+     */
+    const String& nodeName() const { return m_nodeName; }
+
+    /**
+     * @return names of the connected nodes, including this node
+     */
+    std::set<String> members() const;
+
+    /**
+     * Get queue owner node
+     * @param queueName         Queue name
+     * @return owner node name
+     */
+    String owner(const String& queueName) const;
+
+    /**
+     * @return number of queue messages forwarded to the owners
+     */
+    size_t forwardedMessages() const { return m_forwardedMessages; }
+
+    /**
+     * @return number of messages received from peers and delivered to local subscribers
+     */
+    size_t receivedMessages() const { return m_receivedMessages; }
+};
+
+} // namespace sptk
+
+#endif
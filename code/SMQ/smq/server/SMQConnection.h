@@ -31,6 +31,8 @@
 
 #include <smq/protocols/SMQProtocol.h>
 #include <smq/protocols/MQLastWillMessage.h>
+#include <smq/protocols/MQDeliveryWindow.h>
+#include <smq/protocols/MQSharedMemorySocket.h>
 #include <sptk5/net/TCPServer.h>
 #include <sptk5/net/TCPServerConnection.h>
 #include <sptk5/net/SocketEvents.h>
@@ -60,6 +62,7 @@ public:
 private:
     std::shared_ptr<MQProtocol>             m_protocol;
     String                                  m_clientId;
+    std::atomic<bool>                       m_peer {false};         ///< Connection from a peer cluster node
     std::set<SMQSubscription*>              m_subscriptions;
     std::shared_ptr<MQLastWillMessage>      m_lastWillMessage;
     sptk::LogEngine&                        m_logEngine;
@@ -67,6 +70,13 @@ private:
 
     SMQSendQueue                            m_sendQueue;
 
+    std::mutex                              m_deliveryMutex;        ///< Protects QoS 1 deliveries
+    MQDeliveryWindow                        m_deliveryWindow;       ///< QoS 1 messages waiting for acknowledgement
+    std::deque<std::pair<SMessage,SMQDeliveryCompletion>>  m_pendingDeliveries;   ///< QoS 1 messages waiting for a free slot in the window, held by the send queue
+    std::map<uint16_t,SMQDeliveryCompletion>    m_deliveryCompletions;  ///< Completions of QoS 1 messages in the window, by packet id
+
+    void sendPendingDeliveries();
+
 public:
     SMQConnection(TCPServer& server, ThreadPool& sendThreadPool, SOCKET connectionSocket, sockaddr_in* peer, sptk::LogEngine& logEngine, uint8_t debugLogFilter);
     ~SMQConnection() override;
@@ -77,12 +87,108 @@ public:
     MQProtocol& protocol();
 
     String clientId() const;
-    void setupClient(const String& id, const String& lastWillDestination, const String& lastWillMessage);
+
+    /**
+     * @return true if connection is made by a peer cluster node
+     */
+    bool isPeer() const { return m_peer; }
+
+    /**
+     * Set up authenticated client
+     * @param id                    Client id
+     * @param peer                  True if the client has authenticated as a peer cluster node
+     * @param lastWillDestination   Optional last will message destination
+     * @param lastWillMessage       Optional last will message
+     */
+    void setupClient(const String& id, bool peer, const String& lastWillDestination, const String& lastWillMessage);
+
+    /**
+     * Create shared memory segment, requested by the client in CONNECT message.
+     * Segment descriptor is passed to the client with CONNECT_ACK.
+     * @return true if shared memory transport may be used
+     */
+    bool createSharedMemory();
+
+    /**
+     * Switch to shared memory transport, after CONNECT_ACK is sent through the socket
+     */
+    void activateSharedMemory();
 
     void subscribe(const sptk::String& destination, SMQSubscription* subscription);
     void unsubscribe(const sptk::String& destination, SMQSubscription* subscription);
 
-    void sendMessage(SMessage& message);
+    /**
+     * Send message with QoS 0
+     * @param message           Message to send
+     * @param completion        Optional completion, called when the message is written to the connection, or lost
+     * @return false if the message is dropped by send queue overflow policy
+     */
+    bool sendMessage(SMessage& message, const SMQDeliveryCompletion& completion = nullptr);
+
+    void sendFrame(const SharedMQFrame& frame);
+
+    /**
+     * Send acknowledgement or other control frame.
+     * Control frames bypass send queue limits.
+     * @param frame             Encoded frame
+     */
+    void sendControlFrame(const SharedMQFrame& frame);
+
+    /**
+     * Shut down the connection socket, without closing it.
+     * The server then receives connection closed event, and removes the connection.
+     * Used to disconnect slow consumers.
+     */
+    void shutdown();
+
+    /**
+     * Resume reading from the publishers, paused while the send queue was full
+     */
+    void resumePublishers();
+
+    /**
+     * @return true if the send queue is full, and its publishers are paused
+     */
+    bool sendQueueCongested() const;
+
+    /**
+     * Disconnect the slow consumer, if its send queue stays full longer than block timeout
+     */
+    void checkSendQueue();
+
+    /**
+     * @return number of received bytes, that can be read without reading the socket
+     */
+    size_t bufferedBytes();
+
+    /**
+     * Send message with QoS 1.
+     * Message is sent when there is a free slot in the delivery window,
+     * and stays in the window until the client acknowledges it.
+     * Messages waiting for a free slot count against the send queue limits,
+     * and the message is dropped if the overflow policy drops it.
+     * @param message           Message to send
+     * @param completion        Optional completion, called when the client acknowledges the message,
+     *                          or when the message is lost with the connection
+     * @return false if the message is dropped by send queue overflow policy
+     */
+    bool sendReliableMessage(const SMessage& message, const SMQDeliveryCompletion& completion = nullptr);
+
+    /**
+     * Process client acknowledgement of QoS 1 message
+     * @param packetId          Acknowledged packet id
+     */
+    void acknowledge(uint16_t packetId);
+
+    /**
+     * Send again QoS 1 messages that weren't acknowledged within redelivery timeout
+     */
+    void redeliver();
+
+    /**
+     * @return number of QoS 1 messages waiting for acknowledgement
+     */
+    size_t inFlight() const;
 
     // Low-level operations
     void ack(Message::Type sourceMessageType, const String& messageId);
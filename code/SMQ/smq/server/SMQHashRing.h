@@ -0,0 +1,102 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQHashRing.h - description                            ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SMQ_HASH_RING_H__
+#define __SMQ_HASH_RING_H__
+
+#include <sptk5/cutils>
+
+namespace sptk {
+
+/**
+ * Consistent hash ring.
+ *
+ * Every node is placed on the ring at several points (virtual nodes), and a key
+ * is owned by the node at the first point that follows the key hash.
+ * When a node joins or leaves, only the keys of that node change their owner.
+ * Hash doesn't depend on platform or process, so all the nodes that have the same
+ * members compute the same owners.
+ */
+class SP_EXPORT SMQHashRing
+{
+    std::map<uint64_t, String>  m_points;       ///< Ring points, hash to node
+    std::set<String>            m_nodes;        ///< Ring members
+    size_t                      m_virtualNodes; ///< Number of ring points per node
+
+public:
+    /**
+     * Default number of ring points per node
+     */
+    static constexpr size_t DefaultVirtualNodes = 64;
+
+    /**
+     * Constructor
+     * @param virtualNodes      Number of ring points per node
+     */
+    explicit SMQHashRing(size_t virtualNodes = DefaultVirtualNodes);
+
+    /**
+     * 64-bit FNV-1a hash
+     * @param data              Data to hash
+     * @return hash value
+     */
+    static uint64_t hash(const String& data);
+
+    /**
+     * Add node to the ring
+     * @param node              Node name
+     */
+    void add(const String& node);
+
+    /**
+     * Remove node from the ring
+     * @param node              Node name
+     */
+    void remove(const String& node);
+
+    /**
+     * Get key owner
+     * @param key               Key, such as queue name
+     * @return owner node name, or empty string if ring is empty
+     */
+    String owner(const String& key) const;
+
+    /**
+     * @return ring members
+     */
+    const std::set<String>& nodes() const { return m_nodes; }
+
+    /**
+     * @return true if ring has no members
+     */
+    bool empty() const { return m_nodes.empty(); }
+};
+
+} // namespace sptk
+
+#endif
@@ -0,0 +1,173 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQMessageStore.h - description                        ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SMQ_MESSAGE_STORE_H__
+#define __SMQ_MESSAGE_STORE_H__
+
+#include <smq/server/SMQSegmentLog.h>
+#include <sptk5/threads/Timer.h>
+
+namespace sptk {
+
+/**
+ * Durable message storage for SMQ queues.
+ *
+ * Every durable destination (/queue/...) has its own segment log in a sub-directory
+ * of the storage directory. Messages published to a durable destination are appended
+ * to its log before delivery, and stay there until a consumer gets them: QoS 1 consumer acknowledges
+ * the message, or QoS 0 message is written to the consumer connection. So a message that is
+ * lost in the send queue, or with a disconnected consumer, is delivered again, and a message
+ * that isn't delivered before a crash is delivered after restart. A QoS 0 message that is written
+ * to the connection, but isn't processed by the consumer, is lost.
+ * Messages published while there are no consumers are delivered when a consumer subscribes,
+ * including after server restart.
+ */
+class SP_EXPORT SMQMessageStore
+{
+    mutable SharedMutex                         m_mutex;
+    String                                      m_directory;        ///< Storage directory
+    SMQSyncPolicy                               m_syncPolicy;       ///< Sync policy
+    std::chrono::milliseconds                   m_syncInterval;     ///< Sync interval for SYNC_PERIODIC policy, and delivery completions interval
+    size_t                                      m_maxSegmentBytes;  ///< Max segment size
+    std::map<String, SharedSMQSegmentLog>       m_logs;             ///< Segment logs, by destination
+    Timer                                       m_syncTimer;        ///< Applies delivery completions, and group sync for SYNC_PERIODIC policy
+    Timer::Event                                m_syncEvent;        ///< Group sync timer event
+
+    static void syncTimerCallback(void* eventData);
+
+    /**
+     * Get existing segment log, or create a new one
+     * @param destination       Durable destination
+     * @return segment log
+     */
+    SharedSMQSegmentLog log(const String& destination);
+
+public:
+    /**
+     * Constructor
+     *
+     * Opens all the segment logs that exist in the storage directory, recovering them if necessary.
+     * @param directory         Storage directory
+     * @param syncPolicy        Sync policy
+     * @param syncInterval      Sync interval for SYNC_PERIODIC policy, and delivery completions interval
+     * @param maxSegmentBytes   Max segment size, bytes
+     */
+    explicit SMQMessageStore(const String& directory, SMQSyncPolicy syncPolicy = SYNC_PERIODIC,
+                             std::chrono::milliseconds syncInterval = std::chrono::milliseconds(100),
+                             size_t maxSegmentBytes = 64 * 1024 * 1024);
+
+    /**
+     * Destructor
+     */
+    ~SMQMessageStore();
+
+    /**
+     * Check if destination is durable
+     * @param destination       Destination
+     * @return true if messages to the destination are stored
+     */
+    static bool isDurable(const String& destination);
+
+    /**
+     * Store message, and deliver it together with any older undelivered messages of the same destination
+     * @param destination       Durable destination
+     * @param message           Message
+     * @param deliver           Delivery callback
+     * @return number of delivered messages
+     */
+    size_t store(const String& destination, const SMessage& message, const SMQDeliveryCallback& deliver);
+
+    /**
+     * Store message, and dispatch it together with any older undelivered messages of the same destination.
+     * Messages stay stored until their delivery is complete.
+     * @param destination       Durable destination
+     * @param message           Message
+     * @param deliver           Delivery callback
+     * @return number of dispatched messages
+     */
+    size_t store(const String& destination, const SMessage& message, const SMQAcknowledgedDeliveryCallback& deliver);
+
+    /**
+     * Store message without delivering it
+     * @param destination       Destination
+     * @param message           Message
+     */
+    void append(const String& destination, const SMessage& message);
+
+    /**
+     * Deliver undelivered messages of the destination
+     * @param destination       Durable destination
+     * @param deliver           Delivery callback
+     * @return number of delivered messages
+     */
+    size_t replay(const String& destination, const SMQDeliveryCallback& deliver);
+
+    /**
+     * Dispatch undelivered messages of the destination.
+     * Messages stay stored until their delivery is complete.
+     * @param destination       Durable destination
+     * @param deliver           Delivery callback
+     * @return number of dispatched messages
+     */
+    size_t replay(const String& destination, const SMQAcknowledgedDeliveryCallback& deliver);
+
+    /**
+     * Check if consumers reported lost messages of the destination, that aren't dispatched again yet
+     * @param destination       Durable destination
+     * @return true if lost messages wait to be dispatched
+     */
+    bool hasLostMessages(const String& destination) const;
+
+    /**
+     * Number of undelivered messages of the destination
+     * @param destination       Durable destination
+     * @return number of undelivered messages
+     */
+    size_t pending(const String& destination) const;
+
+    /**
+     * Apply reported delivery completions, and sync all logs that have changes older than sync interval
+     */
+    void flush();
+
+    /**
+     * Sync all logs unconditionally
+     */
+    void sync();
+
+    /**
+     * @return list of stored destinations
+     */
+    Strings destinations() const;
+};
+
+typedef std::shared_ptr<SMQMessageStore> SharedSMQMessageStore;
+
+} // namespace sptk
+
+#endif
@@ -0,0 +1,164 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQRetainedMessages.h - description                    ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SMQ_RETAINED_MESSAGES_H__
+#define __SMQ_RETAINED_MESSAGES_H__
+
+#include <smq/server/SMQMessageStore.h>
+#include <list>
+
+namespace sptk {
+
+/**
+ * Retained messages limits
+ */
+struct SMQRetainedLimits
+{
+    size_t      maxBytes {64 * 1024 * 1024};    ///< Max total size of retained messages, 0 is unlimited
+    size_t      maxMessages {0};                ///< Max number of retained messages, 0 is unlimited
+    bool        evictLRU {true};                ///< If true, least recently used messages are evicted to fit new ones,
+                                                ///< otherwise messages for new topics are rejected when the limits are reached
+};
+
+/**
+ * Last-value cache of topics.
+ *
+ * A message, published with retain flag (MQTT RETAIN, or SMQ "retain: 1" header), replaces
+ * the retained message of its topic, and is delivered to every new subscriber of the topic.
+ * Retained message with empty payload removes the retained message of the topic.
+ *
+ * If durable storage is enabled, retained messages are also stored in a dedicated log of the message store,
+ * and restored after server restart. The log is compacted when it holds too many replaced messages.
+ */
+class SP_EXPORT SMQRetainedMessages
+{
+    /**
+     * Retained message
+     */
+    struct Entry
+    {
+        SMessage                        message;    ///< Retained message
+        size_t                          bytes;      ///< Accounted size
+        std::list<String>::iterator     lru;        ///< Position in LRU list
+    };
+
+    mutable std::mutex                  m_mutex;
+    std::map<String, Entry>             m_messages;         ///< Retained messages, by topic
+    std::list<String>                   m_lru;              ///< Topics, most recently used first
+    size_t                              m_bytes {0};        ///< Total size of retained messages
+    SMQRetainedLimits                   m_limits;           ///< Limits
+    size_t                              m_evicted {0};      ///< Number of evicted messages
+    size_t                              m_rejected {0};     ///< Number of rejected messages
+    SharedSMQMessageStore               m_messageStore;     ///< Optional durable storage
+
+    static size_t messageBytes(const String& topic, const Message& message);
+    void removeUnlocked(std::map<String, Entry>::iterator itor);
+    bool storeUnlocked(const String& topic, const SMessage& message);
+    void persistUnlocked(const String& topic, const SMessage& message);
+    void compactUnlocked();
+
+public:
+    /**
+     * Destination of the message store log, that keeps retained messages
+     */
+    static const String StoreDestination;
+
+    /**
+     * Check if message should be retained
+     * @param message           Message
+     * @return true if message has retain flag
+     */
+    static bool isRetained(const Message& message);
+
+    /**
+     * Constructor
+     * @param limits            Limits
+     */
+    explicit SMQRetainedMessages(const SMQRetainedLimits& limits = SMQRetainedLimits());
+
+    /**
+     * @return limits
+     */
+    SMQRetainedLimits limits() const;
+
+    /**
+     * Set limits. If current messages exceed new limits, least recently used messages are evicted.
+     * @param limits            Limits
+     */
+    void limits(const SMQRetainedLimits& limits);
+
+    /**
+     * Replace retained message of the message topic, or remove it if message payload is empty
+     * @param message           Message with retain flag
+     * @return false if message is rejected because of limits
+     */
+    bool retain(const SMessage& message);
+
+    /**
+     * Find retained messages with topics matching the topic filter.
+     * Found messages become most recently used.
+     * @param topicFilter       Topic filter, may contain wildcards
+     * @param messages          Retained messages (output)
+     */
+    void match(const String& topicFilter, std::vector<SMessage>& messages);
+
+    /**
+     * Set durable storage, and load retained messages stored there
+     * @param messageStore      Message store, or nullptr to disable storage
+     */
+    void messageStore(const SharedSMQMessageStore& messageStore);
+
+    /**
+     * Remove all retained messages from memory
+     */
+    void clear();
+
+    /**
+     * @return number of retained messages
+     */
+    size_t size() const;
+
+    /**
+     * @return total size of retained messages
+     */
+    size_t bytes() const;
+
+    /**
+     * @return number of messages evicted to fit the limits
+     */
+    size_t evicted() const;
+
+    /**
+     * @return number of messages rejected because of the limits
+     */
+    size_t rejected() const;
+};
+
+} // namespace sptk
+
+#endif
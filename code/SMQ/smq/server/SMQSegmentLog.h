@@ -0,0 +1,248 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQSegmentLog.h - description                          ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SMQ_SEGMENT_LOG_H__
+#define __SMQ_SEGMENT_LOG_H__
+
+#include <smq/Message.h>
+#include <sptk5/cthreads>
+#include <functional>
+#include <set>
+
+namespace sptk {
+
+/**
+ * Durable storage sync policy
+ */
+enum SMQSyncPolicy : uint8_t
+{
+    SYNC_NEVER,         ///< Never sync explicitly, OS flushes the data when it decides to
+    SYNC_PERIODIC,      ///< Group sync: all the appends within sync interval share a single sync
+    SYNC_ALWAYS         ///< Sync after every append
+};
+
+/**
+ * Callback that delivers a stored message.
+ * Returns false if the message can't be delivered now, and should stay in the log.
+ */
+typedef std::function<bool(const SMessage&)> SMQDeliveryCallback;
+
+/**
+ * Completion of a stored message delivery.
+ * Called with true when the consumer has got the message, so it may be removed from the log,
+ * or with false if the message is lost, and should be delivered again.
+ * May be called from any thread.
+ */
+typedef std::function<void(bool delivered)> SMQDeliveryCompletion;
+
+/**
+ * Callback that passes a stored message to a consumer.
+ * Returns false if the message can't be delivered now, and should stay in the log.
+ * If it returns true, the completion must be called, now or later.
+ */
+typedef std::function<bool(const SMessage&, const SMQDeliveryCompletion&)> SMQAcknowledgedDeliveryCallback;
+
+/**
+ * Append-only message log of a single durable destination.
+ *
+ * The log is stored in its own directory, as a sequence of segment files.
+ * Every segment file is named after the offset of its first message.
+ * Messages are appended to the last segment, and a new segment is started when the last one
+ * grows over the max segment size. Segments are read through memory mapping.
+ *
+ * Messages are dispatched to consumers in order, but a message is consumed only when
+ * its delivery is complete. Consumer offset (the offset of the first message that isn't consumed yet)
+ * is stored in a separate file, and synced according to the same policy as the segments.
+ * Messages that are dispatched but not consumed are delivered again after a restart,
+ * and a message reported lost is dispatched again by the next delivery.
+ * Segments that are completely consumed are deleted.
+ *
+ * When the log is opened, the last segment is verified, and a torn or corrupted
+ * tail, left after a crash, is truncated.
+ */
+class SP_EXPORT SMQSegmentLog
+{
+    /**
+     * Segment file information
+     */
+    struct Segment
+    {
+        uint64_t    firstOffset;    ///< Offset of the first message in the segment
+        String      fileName;       ///< Segment file name
+        size_t      bytes;          ///< Segment file size
+    };
+
+    /**
+     * Delivery completions, reported by consumers and not applied yet.
+     * Completions have their own lock, so they may be called from any thread,
+     * including from delivery callback.
+     */
+    struct Completions
+    {
+        std::mutex                  mutex;
+        std::vector<uint64_t>       delivered;      ///< Offsets of delivered messages
+        std::vector<uint64_t>       lost;           ///< Offsets of lost messages
+    };
+
+    mutable std::mutex                          m_mutex;
+    String                                      m_directory;            ///< Log directory
+    String                                      m_destination;          ///< Destination of the stored messages
+    size_t                                      m_maxSegmentBytes;      ///< Max segment size
+    SMQSyncPolicy                               m_syncPolicy;           ///< Sync policy
+    std::chrono::milliseconds                   m_syncInterval;         ///< Sync interval for SYNC_PERIODIC policy
+    std::vector<Segment>                        m_segments;             ///< Segments, ordered by first offset
+    int                                         m_segmentFile {-1};     ///< Last segment file descriptor
+    int                                         m_offsetFile {-1};      ///< Consumer offset file descriptor
+    uint64_t                                    m_nextOffset {0};       ///< Offset of the next appended message
+    uint64_t                                    m_consumerOffset {0};   ///< Offset of the first message that isn't consumed
+    uint64_t                                    m_dispatchOffset {0};   ///< Offset of the next message to dispatch
+    size_t                                      m_readSegment {0};      ///< Segment of the next message to dispatch
+    size_t                                      m_readPosition {0};     ///< Position of the next message to dispatch
+    std::set<uint64_t>                          m_inFlight;             ///< Dispatched messages, waiting for completion
+    std::set<uint64_t>                          m_acknowledged;         ///< Delivered messages past consumer offset
+    bool                                        m_lost {false};         ///< Lost messages wait to be dispatched again
+    std::shared_ptr<Completions>                m_completions;          ///< Completions, reported by consumers
+    bool                                        m_dirty {false};        ///< Log has changes that aren't synced yet
+    std::chrono::steady_clock::time_point       m_lastSync;             ///< Time of the last sync
+    SMessage                                    m_lastMessage;          ///< Last appended message, to avoid reading it back
+    Buffer                                      m_record;               ///< Record encoding buffer
+
+    void open();
+    void recoverSegment(Segment& segment);
+    void locateDispatchOffset();
+    void startSegment();
+    void syncUnlocked(bool force);
+    void storeConsumerOffset();
+    void compact();
+    void normalizeReadPosition();
+    void advance(size_t recordBytes);
+    size_t readRecords(size_t maxMessages, std::vector<std::pair<SMessage,size_t>>& records);
+
+    /**
+     * Apply completions reported by consumers: advance consumer offset over delivered messages,
+     * and move dispatch offset back to the first lost message. Must be called under lock.
+     */
+    void applyCompletions();
+
+public:
+    /**
+     * Constructor
+     *
+     * Opens existing log, or creates a new one.
+     * @param directory         Log directory
+     * @param destination       Destination of the stored messages
+     * @param maxSegmentBytes   Max segment size, bytes
+     * @param syncPolicy        Sync policy
+     * @param syncInterval      Sync interval for SYNC_PERIODIC policy
+     */
+    SMQSegmentLog(const String& directory, const String& destination, size_t maxSegmentBytes, SMQSyncPolicy syncPolicy,
+                  std::chrono::milliseconds syncInterval);
+
+    /**
+     * Destructor
+     *
+     * Syncs and closes the log.
+     */
+    ~SMQSegmentLog();
+
+    SMQSegmentLog(const SMQSegmentLog&) = delete;
+    SMQSegmentLog& operator = (const SMQSegmentLog&) = delete;
+
+    /**
+     * Create directory, if it doesn't exist
+     * @param directory         Directory name
+     */
+    static void createDirectory(const String& directory);
+
+    /**
+     * Append message to the log
+     * @param message           Message to append
+     * @return message offset
+     */
+    uint64_t append(const SMessage& message);
+
+    /**
+     * Deliver undelivered messages, in order, until the log is exhausted or delivery fails.
+     * Every message accepted by the callback is consumed.
+     * @param deliver           Delivery callback
+     * @return number of delivered messages
+     */
+    size_t deliver(const SMQDeliveryCallback& deliver);
+
+    /**
+     * Dispatch undelivered messages, in order, until the log is exhausted or delivery fails.
+     * Messages that wait for completion aren't dispatched again. Message is consumed
+     * when its completion reports it's delivered.
+     * @param deliver           Delivery callback
+     * @return number of dispatched messages
+     */
+    size_t deliver(const SMQAcknowledgedDeliveryCallback& deliver);
+
+    /**
+     * Check if consumers reported lost messages, that aren't dispatched again yet
+     * @return true if lost messages wait to be dispatched
+     */
+    bool hasLostMessages();
+
+    /**
+     * Apply reported completions, and sync the log if required by sync policy.
+     * Should be called periodically to bound the time unsynced data stays in memory.
+     */
+    void flush();
+
+    /**
+     * Sync the log unconditionally
+     */
+    void sync();
+
+    /**
+     * @return offset of the first message that isn't consumed
+     */
+    uint64_t consumerOffset() const;
+
+    /**
+     * @return offset of the next appended message
+     */
+    uint64_t nextOffset() const;
+
+    /**
+     * @return number of messages that aren't consumed, including dispatched messages waiting for completion
+     */
+    size_t pending() const;
+
+    /**
+     * @return number of segment files
+     */
+    size_t segmentCount() const;
+};
+
+typedef std::shared_ptr<SMQSegmentLog> SharedSMQSegmentLog;
+
+} // namespace sptk
+
+#endif
@@ -30,30 +30,296 @@
 #define __SMQ_CONNECTION_QUEUE_H__
 
 #include <smq/Message.h>
+#include <smq/protocols/MQProtocol.h>
+#include <smq/server/SMQSegmentLog.h>
 #include <sptk5/cthreads>
 
 namespace sptk {
 
 class SMQConnection;
 
+/**
+ * Action taken when a frame doesn't fit into a full send queue
+ */
+enum SMQOverflowPolicy : uint8_t
+{
+    OVERFLOW_BLOCK,         ///< The frame is queued, and publishers are not read until the queue drains
+    OVERFLOW_DROP_OLDEST,   ///< The oldest queued message frames are dropped to make space
+    OVERFLOW_DROP_NEWEST,   ///< The new frame is dropped
+    OVERFLOW_DISCONNECT     ///< The slow consumer is disconnected
+};
+
+/**
+ * Per-connection send queue limits.
+ * By default, the queue is unlimited and never drops messages, so the limits must be set explicitly
+ * to bound memory used by slow consumers.
+ */
+struct SMQSendQueueLimits
+{
+    size_t                      maxFrames {0};                      ///< Max number of queued frames, 0 is unlimited
+    size_t                      maxBytes {0};                       ///< Max size of queued frames, 0 is unlimited
+    SMQOverflowPolicy           policy {OVERFLOW_DROP_OLDEST};      ///< Overflow policy
+    std::chrono::milliseconds   blockTimeout {1000};                ///< Max time the queue may stay full with OVERFLOW_BLOCK policy,
+                                                                    ///< then the slow consumer is disconnected
+    std::chrono::milliseconds   writeTimeout {30000};               ///< Max time a write to shared memory transport may wait
+                                                                    ///< for the consumer to read, then the consumer is disconnected
+};
+
+/**
+ * Memory accounting and overflow counters, shared by all the send queues of a server
+ */
+struct SMQSendQueueStats
+{
+    std::atomic<size_t>         queuedFrames {0};       ///< Frames in all send queues
+    std::atomic<size_t>         queuedBytes {0};        ///< Size of frames in all send queues
+    std::atomic<size_t>         maxQueuedBytes {0};     ///< Server-wide limit of queued bytes, 0 is unlimited
+    std::atomic<size_t>         congested {0};          ///< Send queues that keep their publishers paused
+    std::atomic<uint64_t>       blocked {0};            ///< Number of times a send queue paused its publishers
+    std::atomic<uint64_t>       droppedOldest {0};      ///< Number of oldest frames dropped
+    std::atomic<uint64_t>       droppedNewest {0};      ///< Number of new frames dropped, including block timeouts
+    std::atomic<uint64_t>       disconnected {0};       ///< Number of slow consumers disconnected
+};
+
+/**
+ * Backpressure scope of the thread that delivers messages of a single publisher.
+ *
+ * If a message frame, delivered within the scope, doesn't fit into a send queue with OVERFLOW_BLOCK policy,
+ * the frame is queued anyway, and the scope is marked as blocked. The delivering thread then stops reading
+ * from the publisher until the queue drains. Frames delivered outside of any scope can't pause their source,
+ * so they are dropped instead.
+ */
+class SMQBackpressure
+{
+    static thread_local SMQBackpressure*    m_current;              ///< Innermost scope of the current thread
+    SMQBackpressure*                        m_previous;             ///< Enclosing scope of the current thread
+    bool                                    m_blocked {false};      ///< True if a send queue is full
+
+public:
+    /**
+     * Constructor, starts the scope in the current thread
+     */
+    SMQBackpressure();
+
+    /**
+     * Destructor, ends the scope in the current thread
+     */
+    ~SMQBackpressure();
+
+    SMQBackpressure(const SMQBackpressure&) = delete;
+    SMQBackpressure& operator=(const SMQBackpressure&) = delete;
+
+    /**
+     * @return true if the publisher should be paused
+     */
+    bool blocked() const;
+
+    /**
+     * Mark the publisher as blocked by a full send queue
+     */
+    void block();
+
+    /**
+     * @return current thread scope, or nullptr if the thread has no scope
+     */
+    static SMQBackpressure* current();
+};
+
+/**
+ * Per-connection queue of encoded frames, waiting to be sent.
+ *
+ * Pending frames are coalesced into batches, and each batch is sent
+ * with a single socket write. The queue never waits for a batch to fill up:
+ * whatever is pending when the send thread picks the queue is flushed immediately,
+ * so a single message is sent without delay. The batch size limit bounds
+ * the time of a single write, and the latency of the frames queued behind it.
+ *
+ * The number and size of queued message frames are limited, so a slow consumer
+ * can't grow server memory without bounds. When a message frame doesn't fit,
+ * the overflow policy decides what happens. Control frames, such as acknowledgements,
+ * bypass the limits and are never dropped.
+ *
+ * Messages that the connection holds outside of the queue, such as QoS 1 messages waiting
+ * for a free delivery window slot, count against the same limits. The overflow policy
+ * applies to them when they are held, but OVERFLOW_DROP_OLDEST never drops a held message:
+ * if only held messages fill the queue, the new message is dropped.
+ */
 class SMQSendQueue : public Runable
 {
+    /**
+     * Queued frame
+     */
+    struct Frame
+    {
+        SharedMQFrame           frame;              ///< Encoded frame
+        bool                    control;            ///< True for control frames, that are never dropped
+        SMQDeliveryCompletion   completion;         ///< Optional completion, called when the frame is sent or dropped
+    };
+
     mutable std::mutex          m_mutex;
     SMQConnection&              m_connection;
-    std::queue<SMessage>        m_messages;
+    std::deque<Frame>           m_frames;
     ThreadPool&                 m_threadPool;
     std::atomic<bool>           m_processing {false};
+    size_t                      m_maxBatchBytes {DefaultMaxBatchBytes};
+    std::vector<SharedMQFrame>  m_batch;            ///< Frames of the batch being sent
+    std::vector<SMQDeliveryCompletion> m_batchCompletions; ///< Completions of the batch being sent
+    Buffer                      m_batchBuffer;      ///< Coalesced frames of the batch being sent
+    SMQSendQueueLimits          m_limits;           ///< Queue limits
+    SMQSendQueueStats*          m_stats {nullptr};  ///< Optional server-wide accounting
+    size_t                      m_queuedBytes {0};  ///< Size of queued frames
+    size_t                      m_heldFrames {0};   ///< Number of messages held outside of the queue
+    size_t                      m_heldBytes {0};    ///< Size of messages held outside of the queue
+    bool                        m_disconnected {false}; ///< True after the slow consumer is disconnected
+    bool                        m_congested {false};    ///< True if the queue is full, and its publishers are paused
+    std::chrono::steady_clock::time_point m_congestedSince; ///< Time when the queue became full
 
     void setProcessing(bool processing);
 
+    /**
+     * Check if a message frame fits into the queue. Must be called under lock.
+     * @param bytes             Frame size
+     */
+    bool hasSpace(size_t bytes) const;
+
+    /**
+     * Check if the full queue has drained enough to resume its publishers. Must be called under lock.
+     */
+    bool drained() const;
+
+    /**
+     * Apply overflow policy to a message frame that doesn't fit. Must be called under lock.
+     * @param bytes             Frame size
+     * @return true if the frame should be queued
+     */
+    bool overflow(size_t bytes);
+
+    /**
+     * Set or clear congested state, and update server-wide accounting. Must be called under lock.
+     * @param congested         True if the queue is full, and its publishers are paused
+     */
+    void setCongested(bool congested);
+
+    /**
+     * Drop the oldest queued message frame. Must be called under lock.
+     * @return false if there is no message frame to drop
+     */
+    bool dropOldest();
+
+    /**
+     * Drop all queued frames, and stop accepting new ones. Must be called under lock.
+     */
+    void dropAll();
+
+    /**
+     * Report that the batch being sent is lost
+     */
+    void dropBatch();
+
+    /**
+     * Update server-wide accounting
+     */
+    void account(int64_t frames, int64_t bytes);
+
 protected:
     void run() override;
-    SMessage getMessage();
+
+    /**
+     * Move pending frames to the batch, up to max batch size
+     * @return false if there are no pending frames
+     */
+    bool getBatch();
+
+    /**
+     * Send the batch with a single socket write
+     */
+    void sendBatch();
 
 public:
+    /**
+     * Default max batch size, bytes
+     */
+    static constexpr size_t DefaultMaxBatchBytes = 65536;
+
     SMQSendQueue(ThreadPool& threadPool, SMQConnection& connection);
 
-    void push(SMessage& message);
+    ~SMQSendQueue() override;
+
+    /**
+     * Queue frame for sending
+     * @param frame             Encoded frame
+     * @param control           If true, the frame bypasses queue limits
+     * @param completion        Optional completion, called with true when the frame is written to the connection,
+     *                          or with false if the queued frame is dropped
+     * @return false if the frame is dropped by overflow policy, and the completion isn't called
+     */
+    bool push(const SharedMQFrame& frame, bool control=false, const SMQDeliveryCompletion& completion=nullptr);
+
+    /**
+     * Account a message held outside of the queue against queue limits, applying overflow policy if it doesn't fit
+     * @param bytes             Message size
+     * @return true if the message may be held, false if it's dropped
+     */
+    bool hold(size_t bytes);
+
+    /**
+     * Queue frame of a held message. The frame isn't checked against the limits again.
+     * @param frame             Encoded frame
+     * @param heldBytes         Message size, passed to hold()
+     */
+    void pushHeld(const SharedMQFrame& frame, size_t heldBytes);
+
+    /**
+     * Get max batch size
+     * @return max batch size, bytes
+     */
+    size_t maxBatchBytes() const;
+
+    /**
+     * Set max batch size.
+     * A frame larger than max batch size is always sent alone.
+     * @param maxBatchBytes     Max batch size, bytes. If 0 then frames are sent one by one.
+     */
+    void maxBatchBytes(size_t maxBatchBytes);
+
+    /**
+     * Get queue limits
+     * @return queue limits
+     */
+    SMQSendQueueLimits limits() const;
+
+    /**
+     * Set queue limits
+     * @param limits            Queue limits
+     */
+    void limits(const SMQSendQueueLimits& limits);
+
+    /**
+     * Set server-wide accounting, updated by this queue
+     * @param stats             Server-wide accounting, or nullptr
+     */
+    void stats(SMQSendQueueStats* stats);
+
+    /**
+     * @return number of queued frames
+     */
+    size_t size() const;
+
+    /**
+     * @return size of queued frames, bytes
+     */
+    size_t bytes() const;
+
+    /**
+     * @return true if the queue is full, and its publishers are paused
+     */
+    bool congested() const;
+
+    /**
+     * Check if the queue stays full longer than block timeout.
+     * If it does, queued frames are dropped, and the slow consumer should be disconnected.
+     * @return true if the slow consumer should be disconnected
+     */
+    bool congestionExpired();
 };
 
 }
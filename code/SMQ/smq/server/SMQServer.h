@@ -32,7 +32,9 @@
 #include <smq/server/SMQSubscriptions.h>
 #include <smq/server/SMQConnection.h>
 #include <smq/server/SMQSendThreadPool.h>
+#include <smq/server/SMQCluster.h>
 #include <smq/protocols/MQProtocol.h>
+#include <sptk5/threads/Timer.h>
 
 namespace sptk {
 
@@ -56,6 +58,36 @@ private:
     uint8_t                         m_debugLogFilter;
 
     SMQSendThreadPool               m_sendThreadPool;
+    size_t                          m_maxSendBatchBytes {SMQSendQueue::DefaultMaxBatchBytes};
+    SMQSendQueueLimits              m_sendQueueLimits;      ///< Limits of new connection send queues
+    SMQSendQueueStats               m_sendQueueStats;       ///< Memory accounting and overflow counters of all send queues
+    std::set<SMQConnection*>        m_pausedPublishers;     ///< Publishers that aren't read until full send queues drain
+    size_t                          m_deliveryWindowSize {MQDeliveryWindow::DefaultWindowSize};
+    std::chrono::milliseconds       m_redeliveryTimeout {MQDeliveryWindow::DefaultRedeliveryTimeout};
+    Timer                           m_redeliveryTimer;      ///< Checks connections for QoS 1 messages to redeliver
+    Timer::Event                    m_redeliveryEvent;      ///< Redelivery check event
+    std::unique_ptr<SMQCluster>     m_cluster;              ///< Optional cluster of this server and peer servers
+
+    static void redeliveryTimerCallback(void* eventData);
+    void redeliver();
+
+    /**
+     * Stop reading from the publisher, until full send queues drain.
+     * Called from socket events thread only.
+     * @param connection        Publisher connection
+     * @return true if the publisher is paused, false if send queues have drained already
+     */
+    bool pausePublisher(SMQConnection* connection);
+
+    /**
+     * Resume reading from all paused publishers. Must be called under lock.
+     */
+    void resumePublishersUnlocked();
+
+    /**
+     * Resume reading from all paused publishers, after a full send queue drains
+     */
+    void resumePublishers();
 
 protected:
     static void socketEventCallback(void *userData, SocketEventType eventType);
@@ -78,10 +110,158 @@ public:
     void closeConnection(ServerConnection* connection, bool brokenConnection);
     bool authenticate(const String& clientId, const String& username, const String& password);
 
-    void distributeMessage(SMessage message);
+    /**
+     * Deliver message to subscribers.
+     * In cluster, queue messages published by local clients are forwarded to the queue owner node.
+     * @param message           Message
+     * @param fromPeer          True if message is forwarded by a peer cluster node, and shouldn't be routed again
+     */
+    void distributeMessage(SMessage message, bool fromPeer = false);
+
+    /**
+     * Deliver message, received from a peer cluster node, to local subscribers only
+     * @param message           Message
+     */
+    void deliverLocalMessage(SMessage message);
+
+    /**
+     * Check if destination has subscribers other than peer cluster nodes
+     * @param destination       Destination
+     * @return true if destination has local subscribers
+     */
+    bool hasLocalSubscribers(const String& destination) const;
+
+    /**
+     * Subscribe connection to destinations.
+     * Subscription with invalid topic filter is rejected as a whole, and the connection stays open.
+     * @param connection        Subscriber connection
+     * @param destinations      Destinations and their QoS
+     * @return false if subscription is rejected
+     */
+    bool subscribe(SMQConnection* connection, const std::map<String,QOS>& destinations);
+
+    /**
+     * Get max size of a batch of frames, sent to a connection with a single write
+     * @return max batch size, bytes
+     */
+    size_t maxSendBatchBytes() const;
+
+    /**
+     * Set max size of a batch of frames, sent to a connection with a single write.
+     * Only affects connections created after this call.
+     * @param maxBatchBytes     Max batch size, bytes. If 0 then frames are sent one by one.
+     */
+    void maxSendBatchBytes(size_t maxBatchBytes);
+
+    /**
+     * Get per-connection send queue limits
+     * @return send queue limits
+     */
+    SMQSendQueueLimits sendQueueLimits() const;
+
+    /**
+     * Set per-connection send queue limits and overflow policy.
+     * Only affects connections created after this call.
+     * Send queues are unlimited by default, and messages are dropped only after the limits are set.
+     * @param limits            Send queue limits
+     */
+    void sendQueueLimits(const SMQSendQueueLimits& limits);
 
-    void subscribe(SMQConnection* connection, const std::map<String,QOS>& destinations);
+    /**
+     * Get server-wide limit of bytes queued for sending to all connections
+     * @return max queued bytes, 0 is unlimited
+     */
+    size_t maxQueuedBytes() const;
+
+    /**
+     * Set server-wide limit of bytes queued for sending to all connections.
+     * When the limit is reached, message frames are handled with connection's overflow policy.
+     * @param maxBytes          Max queued bytes, 0 is unlimited
+     */
+    void maxQueuedBytes(size_t maxBytes);
+
+    /**
+     * Get memory accounting and overflow counters of all send queues
+     * @return send queue statistics
+     */
+    const SMQSendQueueStats& sendQueueStats() const;
+
+    /**
+     * Get max number of QoS 1 messages sent to a connection, and waiting for acknowledgement
+     * @return delivery window size
+     */
+    size_t deliveryWindowSize() const;
+
+    /**
+     * Set max number of QoS 1 messages sent to a connection, and waiting for acknowledgement.
+     * Messages above that number are queued until acknowledgements arrive.
+     * Only affects connections created after this call.
+     * @param windowSize        Delivery window size
+     */
+    void deliveryWindowSize(size_t windowSize);
+
+    /**
+     * Get time to wait for acknowledgement before QoS 1 message is sent again
+     * @return redelivery timeout
+     */
+    std::chrono::milliseconds redeliveryTimeout() const;
+
+    /**
+     * Set time to wait for acknowledgement before QoS 1 message is sent again.
+     * Only affects connections created after this call.
+     * @param timeout           Redelivery timeout
+     */
+    void redeliveryTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * Enable durable storage for queues.
+     *
+     * Messages published to /queue/ destinations are stored in append-only segment logs,
+     * until they are delivered to a consumer. Stored messages survive server restart.
+     * Should be called before the server starts listening.
+     * @param directory         Storage directory
+     * @param syncPolicy        Sync policy
+     * @param syncInterval      Sync interval for SYNC_PERIODIC policy
+     * @param maxSegmentBytes   Max segment file size, bytes
+     */
+    void enablePersistence(const String& directory, SMQSyncPolicy syncPolicy = SYNC_PERIODIC,
+                           std::chrono::milliseconds syncInterval = std::chrono::milliseconds(100),
+                           size_t maxSegmentBytes = 64 * 1024 * 1024);
     void unsubscribe(SMQConnection* connection, const String& destination);
+
+    /**
+     * @return durable message storage for queues, or nullptr if durable queues are disabled
+     */
+    SharedSMQMessageStore messageStore() const;
+
+    /**
+     * Retained messages: last values of topics, delivered to new subscribers.
+     * Use it to set the retained messages memory limits.
+     * @return retained messages
+     */
+    SMQRetainedMessages& retainedMessages();
+
+    /**
+     * Join this server to a cluster of servers.
+     *
+     * The server connects to every peer, forwards subscriptions of its clients to the peers,
+     * and routes queue messages to the queue owner nodes. Peers are connected with the username
+     * of this server and the cluster key as password, so all the cluster nodes should use the same
+     * username and cluster key. Peer node messages bypass queue routing and storage, so a client
+     * that uses peer node client id is rejected unless it knows the cluster key.
+     * Should be called before the server starts listening.
+     * @param node              This server host and port, as peers know it
+     * @param peers             Peer servers, may include this server
+     * @param clusterKey        Secret shared by the cluster nodes, must not be empty
+     * @param interval          Interval of peer connection and membership checks
+     */
+    void enableCluster(const Host& node, const std::vector<Host>& peers, const String& clusterKey,
+                       std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+
+    /**
+     * @return cluster of this server, or nullptr if the server isn't in cluster
+     */
+    SMQCluster* cluster() const;
 };
 
 }
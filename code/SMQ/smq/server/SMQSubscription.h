@@ -53,8 +53,8 @@ private:
     LogEngine&                              m_logEngine;
     uint8_t                                 m_debugLogFilter;
 
-    std::set<SMQConnection*>                m_connections;
-    std::set<SMQConnection*>::iterator      m_currentConnection;
+    std::map<SMQConnection*, QOS>           m_connections;          ///< Subscribed connections and their QoS
+    std::map<SMQConnection*, QOS>::iterator m_currentConnection;
 
 protected:
     Type typeUnlocked() const;
@@ -65,9 +65,27 @@ public:
 
     virtual ~SMQSubscription();
 
-    void addConnection(SMQConnection* connection);
+    /**
+     * Add subscribed connection
+     * @param connection        Connection
+     * @param qos               Max QoS of messages delivered to the connection
+     */
+    void addConnection(SMQConnection* connection, QOS qos);
     void removeConnection(SMQConnection* connection, bool updateConnection);
-    bool deliverMessage(SMessage message);
+    /**
+     * Deliver message to subscriber(s)
+     * @param message           Message to deliver
+     * @param localOnly         If true then message isn't delivered to peer cluster nodes
+     * @param completion        Optional completion of queue message delivery, called when the subscriber
+     *                          gets the message, or the message is lost
+     * @return false if queue subscription has no subscribers, or message can't be sent
+     */
+    bool deliverMessage(SMessage message, bool localOnly = false, const SMQDeliveryCompletion& completion = nullptr);
+
+    /**
+     * @return true if subscription has subscribers other than peer cluster nodes
+     */
+    bool hasLocalConnections() const;
 
     Type type() const;
     String typeName() const;
@@ -75,6 +93,8 @@ public:
     String destination() const { return m_destination; }
 };
 
+typedef std::shared_ptr<SMQSubscription> SharedSMQSubscription;
+
 } // namespace sptk
 
 #endif
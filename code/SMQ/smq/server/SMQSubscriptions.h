@@ -31,24 +31,72 @@
 
 #include <smq/server/SMQConnection.h>
 #include <smq/server/SMQSubscription.h>
+#include <smq/server/SMQMessageStore.h>
+#include <smq/server/SMQTopicTrie.h>
+#include <smq/server/SMQRetainedMessages.h>
 #include <sptk5/cthreads>
 
 namespace sptk {
 
-typedef std::shared_ptr<SMQSubscription> SharedSMQSubscription;
-
 class SP_EXPORT SMQSubscriptions
 {
     mutable SharedMutex                     m_mutex;
     std::map<String,SharedSMQSubscription>  m_subscriptions;
+    SMQTopicTrie                            m_topics;           ///< Subscriptions by topic filter, used to deliver messages
     LogEngine&                              m_logEngine;
     uint8_t                                 m_debugLogFilter;
+    SharedSMQMessageStore                   m_messageStore;     ///< Accessed atomically
+    SMQRetainedMessages                     m_retainedMessages; ///< Last value of topics, delivered to new subscribers
 public:
     SMQSubscriptions(sptk::LogEngine& logEngine, uint8_t debugLogFilter);
     void clear();
-    void deliverMessage(const String& queueName, const SMessage message);
-    void subscribe(SMQConnection* connection, const std::map<String,QOS>& queueNames);
+    /**
+     * Deliver message to matching subscriptions
+     * @param queueName         Message destination
+     * @param message           Message
+     * @param localOnly         If true then message is received from peer cluster node,
+     *                          and is only delivered to local subscribers
+     */
+    void deliverMessage(const String& queueName, const SMessage message, bool localOnly = false);
+
+    /**
+     * Subscribe connection to destinations.
+     * If any of destinations isn't a valid topic filter, nothing is subscribed.
+     * @param connection        Subscriber connection
+     * @param queueNames        Destinations and their QoS
+     * @return false if subscription is rejected
+     */
+    bool subscribe(SMQConnection* connection, const std::map<String,QOS>& queueNames);
+
     void unsubscribe(SMQConnection* connection, const String& queueName);
+
+    /**
+     * Deliver again stored durable queue messages, that subscribers reported lost
+     */
+    void redeliverStoredMessages();
+
+    /**
+     * Set durable message storage for queues
+     * @param messageStore      Message store, or nullptr to disable durable queues
+     */
+    void messageStore(const SharedSMQMessageStore& messageStore);
+
+    /**
+     * @return durable message storage for queues, or nullptr if durable queues are disabled
+     */
+    SharedSMQMessageStore messageStore() const;
+
+    /**
+     * Check if destination has subscribers other than peer cluster nodes
+     * @param queueName         Destination
+     * @return true if destination has local subscribers
+     */
+    bool hasLocalSubscribers(const String& queueName) const;
+
+    /**
+     * @return retained messages of topics
+     */
+    SMQRetainedMessages& retainedMessages();
 };
 
 } // namespace sptk
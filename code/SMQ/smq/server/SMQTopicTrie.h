@@ -0,0 +1,120 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQTopicTrie.h - description                           ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SMQ_TOPIC_TRIE_H__
+#define __SMQ_TOPIC_TRIE_H__
+
+#include <smq/server/SMQSubscription.h>
+#include <string_view>
+
+namespace sptk {
+
+/**
+ * Topic trie, matching topics against MQTT-style topic filters.
+ *
+ * Topic filter levels are separated with '/'. Level '+' matches exactly one topic level,
+ * and level '#' (allowed only as the last level) matches any number of levels, including
+ * the parent level. Wildcards don't match topics starting with '$'.
+ *
+ * The trie is copy-on-write: every change publishes a new immutable snapshot, sharing
+ * all the unchanged nodes with the previous one. Matching works with a snapshot,
+ * and never waits for the writers.
+ */
+class SP_EXPORT SMQTopicTrie
+{
+public:
+    class Node;
+    typedef std::shared_ptr<const Node> SharedNode;
+
+private:
+    mutable std::mutex      m_writeMutex;   ///< Serializes trie changes
+    SharedNode              m_root;         ///< Current snapshot, accessed atomically
+    size_t                  m_size {0};     ///< Number of topic filters
+
+public:
+    /**
+     * Constructor
+     */
+    SMQTopicTrie();
+
+    /**
+     * Add or replace subscription for topic filter
+     * @param topicFilter       Topic filter, may contain wildcards
+     * @param subscription      Subscription
+     */
+    void insert(const String& topicFilter, const SharedSMQSubscription& subscription);
+
+    /**
+     * Remove subscription for topic filter
+     * @param topicFilter       Topic filter
+     * @return true if topic filter was found
+     */
+    bool remove(const String& topicFilter);
+
+    /**
+     * Find subscription for topic filter, without wildcard matching
+     * @param topicFilter       Topic filter
+     * @return subscription, or nullptr if not found
+     */
+    SharedSMQSubscription find(const String& topicFilter) const;
+
+    /**
+     * Find subscriptions with topic filters matching the topic
+     * @param topic             Topic, can't contain wildcards
+     * @param subscriptions     Matching subscriptions (output)
+     */
+    void match(const String& topic, std::vector<SharedSMQSubscription>& subscriptions) const;
+
+    /**
+     * Remove all subscriptions
+     */
+    void clear();
+
+    /**
+     * @return number of topic filters
+     */
+    size_t size() const;
+
+    /**
+     * Check if topic filter is valid: wildcards occupy entire topic level, and '#' is the last level
+     * @param topicFilter       Topic filter
+     */
+    static bool isValidFilter(const String& topicFilter);
+
+    /**
+     * Check if topic matches topic filter, without using the trie.
+     * Used to match a single topic filter against a few topics.
+     * @param topicFilter       Topic filter, may contain wildcards
+     * @param topic             Topic, can't contain wildcards
+     */
+    static bool matches(const String& topicFilter, const String& topic);
+};
+
+} // namespace sptk
+
+#endif
@@ -0,0 +1,304 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       smq_bench.cpp - description                            ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQServer.h>
+#include <smq/clients/SMQClient.h>
+#include <sptk5/CommandLine.h>
+#include <sptk5/LatencyHistogram.h>
+#include <iomanip>
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+/**
+ * Every message payload starts with the time the message was scheduled to be sent.
+ * Publishers and subscribers run on the same host, so they share the monotonic clock.
+ */
+static constexpr size_t TimestampBytes = sizeof(int64_t);
+
+static int64_t timestampNanoseconds()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Subscriber that records message latency instead of queueing received messages
+ */
+class BenchSubscriber : public SMQClient
+{
+    LatencyHistogram&       m_latency;
+    atomic<size_t>&         m_received;
+
+protected:
+    bool previewMessage(SMessage& message) override
+    {
+        if (message->bytes() >= TimestampBytes) {
+            int64_t sent;
+            memcpy(&sent, message->data(), sizeof(sent));
+            int64_t latency = timestampNanoseconds() - sent;
+            m_latency.record(uint64_t(latency > 0 ? latency : 0));
+        }
+        m_received++;
+        return false;
+    }
+
+public:
+    BenchSubscriber(MQProtocolType protocolType, const String& clientId, LatencyHistogram& latency,
+                    atomic<size_t>& received)
+    : SMQClient(protocolType, clientId), m_latency(latency), m_received(received)
+    {}
+};
+
+/**
+ * Benchmark settings
+ */
+struct BenchSettings
+{
+    MQProtocolType  protocol {MP_SMQ};
+    Host            host;
+    bool            inProcessServer {true};
+    size_t          publishers {1};
+    size_t          subscribers {1};
+    size_t          messages {10000};       ///< Messages per publisher
+    size_t          messageSize {64};
+    bool            queue {false};
+    double          rate {0};               ///< Messages per second per publisher, 0 is unlimited
+    QOS             qos {QOS_0};
+    seconds         timeout {10};
+};
+
+/**
+ * Publish messages, either as fast as possible or at a fixed rate.
+ *
+ * With a fixed rate, the send schedule doesn't depend on how fast previous messages were sent (open loop),
+ * and the scheduled time is embedded in the message. If the publisher falls behind the schedule,
+ * the delay shows up in the latency, rather than being hidden by a slower send rate.
+ */
+static void publish(const BenchSettings& settings, SMQClient& publisher, const String& destination)
+{
+    auto started = steady_clock::now();
+    nanoseconds interval(settings.rate > 0 ? int64_t(1E9 / settings.rate) : 0);
+    size_t messageSize = max(settings.messageSize, TimestampBytes);
+
+    for (size_t m = 0; m < settings.messages; m++) {
+        int64_t timestamp;
+        if (settings.rate > 0) {
+            auto scheduled = started + interval * m;
+            this_thread::sleep_until(scheduled);
+            timestamp = duration_cast<nanoseconds>(scheduled.time_since_epoch()).count();
+        } else
+            timestamp = timestampNanoseconds();
+
+        // QoS 1 messages are kept for redelivery, so every message is a new object
+        Buffer payload(messageSize);
+        payload.bytes(messageSize);
+        memset(payload.data(), 'x', messageSize);
+        memcpy(payload.data(), &timestamp, sizeof(timestamp));
+        auto message = make_shared<Message>(Message::MESSAGE, move(payload));
+        publisher.send(destination, message, settings.timeout);
+    }
+}
+
+static String formatMicroseconds(uint64_t nanoseconds)
+{
+    stringstream output;
+    output << fixed << setprecision(1) << double(nanoseconds) / 1000;
+    return output.str();
+}
+
+static void printResults(const BenchSettings& settings, size_t expected, size_t received, double durationSeconds,
+                         const LatencyHistogram& latency)
+{
+    double messagesPerSecond = received / durationSeconds;
+    size_t messageSize = max(settings.messageSize, TimestampBytes);
+
+    COUT("Protocol:     " << (settings.protocol == MP_SMQ ? "SMQ" : "MQTT") << ", "
+                          << (settings.queue ? "queue" : "topic") << ", QoS " << int(settings.qos) << endl);
+    COUT("Clients:      " << settings.publishers << " publishers, " << settings.subscribers << " subscribers" << endl);
+    COUT("Messages:     " << received << " of " << expected << " received, "
+                          << messageSize << " bytes each" << endl);
+    COUT("Duration:     " << fixed << setprecision(3) << durationSeconds << " sec" << endl);
+    COUT("Throughput:   " << fixed << setprecision(0) << messagesPerSecond << " msg/sec, "
+                          << setprecision(2) << messagesPerSecond * messageSize / 1E6 << " MB/sec" << endl);
+    COUT("Latency, us:  min " << formatMicroseconds(latency.min())
+                          << ", mean " << formatMicroseconds(uint64_t(latency.mean()))
+                          << ", max " << formatMicroseconds(latency.max()) << endl);
+    for (double percentile: {50.0, 90.0, 99.0, 99.9, 99.99}) {
+        stringstream label;
+        label << "p" << percentile;
+        COUT("    " << left << setw(9) << label.str() << right
+                    << formatMicroseconds(latency.valueAtPercentile(percentile)) << endl);
+    }
+}
+
+static void runBenchmark(const BenchSettings& settings)
+{
+    String destination(settings.queue ? "/queue/smq_bench" : "smq_bench");
+
+    shared_ptr<FileLogEngine> logEngine;
+    shared_ptr<SMQServer> server;
+    if (settings.inProcessServer) {
+        logEngine = make_shared<FileLogEngine>("smq_bench.log");
+        server = make_shared<SMQServer>(settings.protocol, "user", "secret", *logEngine,
+                                        LOG_SERVER_OPS | LOG_CONNECTIONS);
+        server->listen(settings.host.port());
+    }
+
+    LatencyHistogram latency;
+    atomic<size_t> received {0};
+
+    vector<shared_ptr<BenchSubscriber>> subscribers;
+    for (size_t i = 0; i < settings.subscribers; i++) {
+        auto subscriber = make_shared<BenchSubscriber>(settings.protocol, "bench-subscriber-" + int2string(uint32_t(i)),
+                                                       latency, received);
+        subscriber->setDeliveryQOS(settings.qos);
+        subscriber->connect(settings.host, "user", "secret", false, settings.timeout);
+        subscriber->subscribe(destination, settings.timeout);
+        subscribers.push_back(subscriber);
+    }
+
+    vector<shared_ptr<SMQClient>> publishers;
+    for (size_t i = 0; i < settings.publishers; i++) {
+        auto publisher = make_shared<SMQClient>(settings.protocol, "bench-publisher-" + int2string(uint32_t(i)));
+        publisher->setDeliveryQOS(settings.qos);
+        publisher->connect(settings.host, "user", "secret", false, settings.timeout);
+        publishers.push_back(publisher);
+    }
+
+    // Wait until subscriptions are completed
+    this_thread::sleep_for(milliseconds(100));
+
+    size_t sent = settings.publishers * settings.messages;
+    size_t expected = settings.queue || settings.subscribers == 0 ? sent : sent * settings.subscribers;
+
+    auto started = steady_clock::now();
+
+    vector<thread> publisherThreads;
+    for (auto& publisher: publishers) {
+        publisherThreads.emplace_back([&settings, publisher, &destination]() {
+            try {
+                publish(settings, *publisher, destination);
+            }
+            catch (const Exception& e) {
+                CERR("Publisher error: " << e.what() << endl);
+            }
+        });
+    }
+    for (auto& publisherThread: publisherThreads)
+        publisherThread.join();
+
+    // Stop waiting when nothing arrives within timeout
+    size_t lastReceived = received;
+    auto lastProgress = steady_clock::now();
+    while (settings.subscribers > 0 && received < expected) {
+        this_thread::sleep_for(milliseconds(1));
+        if (received != lastReceived) {
+            lastReceived = received;
+            lastProgress = steady_clock::now();
+        } else if (steady_clock::now() - lastProgress > settings.timeout)
+            break;
+    }
+
+    double durationSeconds = duration_cast<microseconds>(steady_clock::now() - started).count() / 1E6;
+
+    for (auto& publisher: publishers)
+        publisher->disconnect(true);
+    for (auto& subscriber: subscribers)
+        subscriber->disconnect(true);
+    if (server)
+        server->stop();
+
+    printResults(settings, expected, received, durationSeconds, latency);
+}
+
+int main(int argc, const char* argv[])
+{
+    CommandLine commandLine("smq_bench 1.00", "SMQ server load generator and latency benchmark.", "smq_bench [options]");
+
+    BenchSettings settings;
+
+    try {
+        CommandLine::Visibility any("");
+        commandLine.defineOption("help", "h", any, "Prints this help.");
+        commandLine.defineParameter("protocol", "p", "protocol", "^(smq|mqtt)$", any, "smq", "Protocol, smq or mqtt.");
+        commandLine.defineParameter("host", "H", "host:port", "", any, "",
+                                    "Existing server to connect to. If not defined, the server runs in-process.");
+        commandLine.defineParameter("port", "P", "port", "^\\d+$", any, "4100", "Port of the in-process server.");
+        commandLine.defineParameter("publishers", "n", "count", "^\\d+$", any, "1", "Number of publishers.");
+        commandLine.defineParameter("subscribers", "s", "count", "^\\d+$", any, "1", "Number of subscribers.");
+        commandLine.defineParameter("messages", "m", "count", "^\\d+$", any, "10000", "Number of messages per publisher.");
+        commandLine.defineParameter("size", "b", "bytes", "^\\d+$", any, "64", "Message size, at least 8 bytes.");
+        commandLine.defineParameter("destination", "d", "type", "^(queue|topic)$", any, "topic",
+                                    "Destination type: queue delivers every message to one subscriber, "
+                                    "topic delivers it to all subscribers.");
+        commandLine.defineParameter("rate", "r", "msg/sec", "^[\\d\\.]+$", any, "0",
+                                    "Send rate per publisher, messages per second. 0 is as fast as possible.");
+        commandLine.defineParameter("qos", "q", "qos", "^[01]$", any, "0", "Delivery QoS, 0 or 1.");
+        commandLine.defineParameter("timeout", "t", "seconds", "^\\d+$", any, "10",
+                                    "Operation timeout, and max wait for the next message.");
+        commandLine.init(argc, argv);
+    }
+    catch (const Exception& e) {
+        CERR("Error in command line arguments: " << e.what() << endl);
+        commandLine.printHelp(80);
+        return 1;
+    }
+
+    if (commandLine.hasOption("help")) {
+        commandLine.printHelp(80);
+        return 0;
+    }
+
+    try {
+        settings.protocol = commandLine.getOptionValue("protocol") == "mqtt" ? MP_MQTT : MP_SMQ;
+        String host = commandLine.getOptionValue("host");
+        if (host.empty())
+            settings.host = Host("localhost", (uint16_t) string2int(commandLine.getOptionValue("port")));
+        else {
+            settings.host = Host(host);
+            settings.inProcessServer = false;
+        }
+        settings.publishers = (size_t) string2int(commandLine.getOptionValue("publishers"));
+        settings.subscribers = (size_t) string2int(commandLine.getOptionValue("subscribers"));
+        settings.messages = (size_t) string2int(commandLine.getOptionValue("messages"));
+        settings.messageSize = (size_t) string2int(commandLine.getOptionValue("size"));
+        settings.queue = commandLine.getOptionValue("destination") == "queue";
+        settings.rate = string2double(commandLine.getOptionValue("rate"));
+        settings.qos = commandLine.getOptionValue("qos") == "1" ? QOS_1 : QOS_0;
+        settings.timeout = seconds(string2int(commandLine.getOptionValue("timeout")));
+
+        runBenchmark(settings);
+    }
+    catch (const Exception& e) {
+        CERR(e.what() << endl);
+        return 1;
+    }
+
+    return 0;
+}
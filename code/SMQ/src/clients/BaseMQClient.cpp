@@ -77,6 +77,47 @@ void BaseMQClient::acceptMessage(SMessage& message)
     }
 }
 
+void BaseMQClient::sendBatch(const vector<OutgoingMessage>& messages, milliseconds timeout)
+{
+    for (auto& outgoing: messages) {
+        SMessage message(outgoing.second);
+        send(outgoing.first, message, timeout);
+    }
+}
+
+void BaseMQClient::sendAsync(const String& destination, const SMessage& message, const SendCallback& callback)
+{
+    static const seconds sendTimeout(10);
+
+    exception_ptr error;
+    try {
+        SMessage sentMessage(message);
+        send(destination, sentMessage, sendTimeout);
+    }
+    catch (...) {
+        error = current_exception();
+    }
+
+    if (callback)
+        callback(message, error);
+    else if (error)
+        rethrow_exception(error);
+}
+
+future<void> BaseMQClient::sendAsync(const String& destination, const SMessage& message)
+{
+    auto promise = make_shared<std::promise<void>>();
+    auto result = promise->get_future();
+    sendAsync(destination, message,
+              [promise](const SMessage&, const exception_ptr& error) {
+                  if (error)
+                      promise->set_exception(error);
+                  else
+                      promise->set_value();
+              });
+    return result;
+}
+
 MQProtocolType BaseMQClient::protocolType() const
 {
     SharedLock(m_mutex);
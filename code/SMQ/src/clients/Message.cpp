@@ -31,6 +31,42 @@ Message& Message::operator=(Message&& other) noexcept
     return *this;
 }
 
+String& MessageHeaders::operator[](const String& name)
+{
+    auto itor = find(name);
+    if (itor != m_headers.end())
+        return itor->second;
+    m_headers.emplace_back(name, "");
+    return m_headers.back().second;
+}
+
+MessageHeaders::iterator MessageHeaders::find(const String& name)
+{
+    for (auto itor = m_headers.begin(); itor != m_headers.end(); ++itor) {
+        if (itor->first == name)
+            return itor;
+    }
+    return m_headers.end();
+}
+
+MessageHeaders::const_iterator MessageHeaders::find(const String& name) const
+{
+    for (auto itor = m_headers.begin(); itor != m_headers.end(); ++itor) {
+        if (itor->first == name)
+            return itor;
+    }
+    return m_headers.end();
+}
+
+size_t MessageHeaders::erase(const String& name)
+{
+    auto itor = find(name);
+    if (itor == m_headers.end())
+        return 0;
+    m_headers.erase(itor);
+    return 1;
+}
+
 String& Message::operator[](const String& header)
 {
     return m_headers[header];
@@ -128,4 +164,22 @@ TEST(SPTK_Message, move_ctor)
 	EXPECT_STREQ("test data", message2.c_str());
 	EXPECT_STREQ("/test", message2["queue"].c_str());
 }
+TEST(SPTK_Message, headers)
+{
+    Message::Headers headers;
+
+    headers["subject"] = "test";
+    headers.add("client_id", "sender");
+    headers["subject"] = "test2";
+
+    EXPECT_EQ(size_t(2), headers.size());
+    EXPECT_STREQ("test2", headers["subject"].c_str());
+    EXPECT_STREQ("client_id", headers.begin()[1].first.c_str());
+
+    EXPECT_TRUE(headers.find("missing") == headers.end());
+    EXPECT_EQ(size_t(1), headers.erase("subject"));
+    EXPECT_EQ(size_t(0), headers.erase("subject"));
+    EXPECT_EQ(size_t(1), headers.size());
+}
+
 #endif
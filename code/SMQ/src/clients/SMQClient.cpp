@@ -27,7 +27,6 @@
 */
 
 #include <smq/clients/SMQClient.h>
-#include <smq/clients/SMQClient.h>
 
 
 using namespace std;
@@ -35,10 +34,18 @@ using namespace sptk;
 using namespace chrono;
 
 SMQClient::SMQClient(MQProtocolType protocolType, const String& clientId)
-: TCPMQClient(protocolType, clientId)
+: TCPMQClient(protocolType, clientId), m_redeliveryTimer(redeliveryTimerCallback),
+  m_lingerTimer(lingerTimerCallback)
 {
 }
 
+SMQClient::~SMQClient()
+{
+    m_redeliveryTimer.cancel();
+    m_lingerTimer.cancel();
+    failPending("Client is destroyed");
+}
+
 void SMQClient::connect(const Host& server, const String& username, const String& password, bool encrypted, milliseconds timeout)
 {
     UniqueLock(m_mutex);
@@ -49,6 +56,56 @@ void SMQClient::connect(const Host& server, const String& username, const String
     m_username = username;
     m_password = password;
 
+    sendConnect(username, password, false, timeout);
+}
+
+#ifndef _WIN32
+void SMQClient::connectLocal(const String& socketPath, const String& username, const String& password,
+                             milliseconds timeout, bool sharedMemory)
+{
+    UniqueLock(m_mutex);
+
+    createConnection(socketPath, timeout);
+
+    m_username = username;
+    m_password = password;
+
+    auto* sharedMemorySocket = dynamic_cast<MQSharedMemorySocket*>(&socket());
+    sharedMemory = sharedMemory && protocolType() == MP_SMQ && sharedMemorySocket != nullptr;
+    if (sharedMemory)
+        sharedMemorySocket->requestSharedMemory();
+
+    {
+        lock_guard<mutex> lock(m_connectMutex);
+        m_connectAckReceived = false;
+    }
+
+    sendConnect(username, password, sharedMemory, timeout);
+
+    if (!sharedMemory)
+        return;
+
+    // Nothing else is sent until the server confirms or declines shared memory transport
+    unique_lock<mutex> ackLock(m_connectMutex);
+    if (!m_connectAcknowledged.wait_for(ackLock, timeout, [this]() { return m_connectAckReceived; })) {
+        ackLock.unlock();
+        destroyConnection();
+        throw TimeoutException("Connection timeout");
+    }
+}
+
+bool SMQClient::sharedMemoryActive()
+{
+    if (!connected())
+        return false;
+    auto* sharedMemorySocket = dynamic_cast<MQSharedMemorySocket*>(&socket());
+    return sharedMemorySocket != nullptr && sharedMemorySocket->sharedMemoryActive();
+}
+#endif
+
+void SMQClient::sendConnect(const String& username, const String& password, bool sharedMemory,
+                            milliseconds timeout)
+{
     auto connectMessage = make_shared<Message>(Message::CONNECT);
     (*connectMessage)["client_id"] = getClientId();
     (*connectMessage)["username"] = username;
@@ -59,22 +116,290 @@ void SMQClient::connect(const Host& server, const String& username, const String
         (*connectMessage)["last_will_message"] = (String) m_lastWillMessage->message();
     }
 
+    // Request the latest wire format, server confirms it in CONNECT_ACK
+    if (protocolType() == MP_SMQ)
+        (*connectMessage)["protocol_version"] = int2string(SMQProtocol::LatestVersion);
+
+    if (sharedMemory)
+        (*connectMessage)["shared_memory"] = "1";
+
     send("", connectMessage, timeout);
 }
 
 void SMQClient::disconnect(bool)
 {
     destroyConnection();
+    failPending("Client is disconnected");
 }
 
-void SMQClient::send(const String& destination, SMessage& message, std::chrono::milliseconds)
+void SMQClient::send(const String& destination, SMessage& message, std::chrono::milliseconds timeout)
 {
+    QOS qos = m_qos;
+    if (qos != QOS_0 && message->type() == Message::MESSAGE) {
+        // Wait for a free slot in the delivery window, but not for the acknowledgement
+        uint16_t packetId = m_deliveryWindow.add(destination, message, timeout);
+        lock_guard<mutex> lock(m_sendMutex);
+        protocol().sendMessage(destination, *message, qos, packetId, false);
+        return;
+    }
+
+    lock_guard<mutex> lock(m_sendMutex);
     protocol().sendMessage(destination, message);
 }
 
+void SMQClient::sendBatch(const vector<OutgoingMessage>& messages, milliseconds timeout)
+{
+    QOS qos = m_qos;
+    Buffer frames;
+
+    // Encoded frames may define interned destinations, so nothing else is sent until they are written
+    unique_lock<mutex> lock(m_sendMutex);
+    for (auto& outgoing: messages) {
+        uint16_t packetId = 0;
+        if (qos != QOS_0 && outgoing.second->type() == Message::MESSAGE
+            && !m_deliveryWindow.tryAdd(outgoing.first, outgoing.second, packetId))
+        {
+            // Delivery window is full: send the messages encoded so far, so the server can acknowledge them
+            if (frames.bytes() > 0) {
+                protocol().sendFrame(frames);
+                frames.reset();
+            }
+            lock.unlock();
+            packetId = m_deliveryWindow.add(outgoing.first, outgoing.second, timeout);
+            lock.lock();
+        }
+        protocol().appendMessage(frames, outgoing.first, *outgoing.second, packetId ? qos : QOS_0, packetId, false);
+    }
+
+    if (frames.bytes() > 0)
+        protocol().sendFrame(frames);
+}
+
+void SMQClient::sendAsync(const String& destination, const SMessage& message, const SendCallback& callback)
+{
+    size_t messageBytes = message->bytes() + destination.length();
+
+    unique_lock<mutex> lock(m_pendingMutex);
+
+    // A message larger than max pending size is accepted when nothing else is pending
+    bool hasSpace = m_pendingSpace.wait_for(lock, m_maxBlock, [this, messageBytes]() {
+        return m_pending.empty() || m_pendingBytes + messageBytes <= m_maxPendingBytes;
+    });
+    if (!hasSpace)
+        throw TimeoutException("Can't send message: pending messages size exceeds " + int2string(m_maxPendingBytes) + " bytes");
+
+    bool wasEmpty = m_pending.empty();
+
+    PendingMessage pendingMessage;
+    pendingMessage.destination = destination;
+    pendingMessage.message = message;
+    pendingMessage.callback = callback;
+    m_pending.push_back(move(pendingMessage));
+    m_pendingBytes += messageBytes;
+
+    // Pending messages are written by the timer thread, so the caller never waits for the connection
+    if (m_linger.count() == 0 || m_pendingBytes >= m_batchBytes) {
+        if (!m_sendScheduled) {
+            m_sendScheduled = true;
+            m_lingerTimer.fireAt(DateTime::Now(), this);
+        }
+    }
+    else if (wasEmpty)
+        m_lingerTimer.fireAt(DateTime::Now() + m_linger, this);
+}
+
+void SMQClient::sendPending()
+{
+    lock_guard<mutex> flushLock(m_flushMutex);
+
+    QOS qos = m_qos;
+    vector<PendingMessage> batch;
+    {
+        lock_guard<mutex> lock(m_pendingMutex);
+        m_sendScheduled = false;
+        while (!m_pending.empty()) {
+            auto& pendingMessage = m_pending.front();
+            if (qos != QOS_0 && pendingMessage.message->type() == Message::MESSAGE) {
+                // Messages that don't fit into delivery window are sent when the window has free slots
+                if (!m_deliveryWindow.tryAdd(pendingMessage.destination, pendingMessage.message,
+                                             pendingMessage.packetId))
+                    break;
+                pendingMessage.qos = qos;
+            }
+            m_pendingBytes -= pendingMessage.message->bytes() + pendingMessage.destination.length();
+            batch.push_back(move(pendingMessage));
+            m_pending.pop_front();
+        }
+        if (!batch.empty())
+            m_pendingSpace.notify_all();
+        if (m_pending.empty())
+            m_pendingEmpty.notify_all();
+    }
+
+    if (batch.empty())
+        return;
+
+    // QoS 1 messages are completed by acknowledgements, that may arrive as soon as the batch is written
+    {
+        lock_guard<mutex> lock(m_completionMutex);
+        for (auto& pendingMessage: batch) {
+            if (pendingMessage.packetId != 0 && pendingMessage.callback)
+                m_completions[pendingMessage.packetId] = pendingMessage;
+        }
+    }
+
+    exception_ptr error;
+    try {
+        if (!connected())
+            throw Exception("Not connected");
+        lock_guard<mutex> lock(m_sendMutex);
+        Buffer frames;
+        for (auto& pendingMessage: batch)
+            protocol().appendMessage(frames, pendingMessage.destination, *pendingMessage.message,
+                                     pendingMessage.qos, pendingMessage.packetId, false);
+        protocol().sendFrame(frames);
+    }
+    catch (...) {
+        error = current_exception();
+    }
+
+    for (auto& pendingMessage: batch) {
+        if (pendingMessage.packetId != 0) {
+            if (!error)
+                continue;
+            m_deliveryWindow.acknowledge(pendingMessage.packetId);
+            lock_guard<mutex> lock(m_completionMutex);
+            m_completions.erase(pendingMessage.packetId);
+        }
+        if (pendingMessage.callback)
+            pendingMessage.callback(pendingMessage.message, error);
+    }
+}
+
+void SMQClient::complete(uint16_t packetId)
+{
+    PendingMessage pendingMessage;
+    {
+        lock_guard<mutex> lock(m_completionMutex);
+        auto itor = m_completions.find(packetId);
+        if (itor == m_completions.end())
+            return;
+        pendingMessage = move(itor->second);
+        m_completions.erase(itor);
+    }
+    pendingMessage.callback(pendingMessage.message, nullptr);
+}
+
+void SMQClient::failPending(const String& reason)
+{
+    deque<PendingMessage> pending;
+    {
+        lock_guard<mutex> lock(m_pendingMutex);
+        swap(pending, m_pending);
+        m_pendingBytes = 0;
+        m_pendingSpace.notify_all();
+        m_pendingEmpty.notify_all();
+    }
+
+    map<uint16_t, PendingMessage> completions;
+    {
+        lock_guard<mutex> lock(m_completionMutex);
+        swap(completions, m_completions);
+    }
+
+    auto error = make_exception_ptr(Exception(reason));
+    for (auto& pendingMessage: pending) {
+        if (pendingMessage.callback)
+            pendingMessage.callback(pendingMessage.message, error);
+    }
+    for (auto& itor: completions)
+        itor.second.callback(itor.second.message, error);
+}
+
+void SMQClient::setBatching(size_t batchBytes, milliseconds linger, size_t maxPendingBytes, milliseconds maxBlock)
+{
+    lock_guard<mutex> lock(m_pendingMutex);
+    m_batchBytes = batchBytes;
+    m_linger = linger;
+    m_maxPendingBytes = maxPendingBytes;
+    m_maxBlock = maxBlock;
+}
+
+bool SMQClient::flush(milliseconds timeout)
+{
+    sendPending();
+
+    unique_lock<mutex> lock(m_pendingMutex);
+    return m_pendingEmpty.wait_for(lock, timeout, [this]() { return m_pending.empty(); });
+}
+
+size_t SMQClient::pending() const
+{
+    lock_guard<mutex> lock(m_pendingMutex);
+    return m_pending.size();
+}
+
+void SMQClient::lingerTimerCallback(void* eventData)
+{
+    auto* client = (SMQClient*) eventData;
+    client->sendPending();
+}
+
+void SMQClient::sendFrame(const Buffer& frame)
+{
+    lock_guard<mutex> lock(m_sendMutex);
+    protocol().sendFrame(frame);
+}
+
+void SMQClient::setDeliveryQOS(QOS qos, size_t windowSize, milliseconds redeliveryTimeout)
+{
+    UniqueLock(m_mutex);
+
+    m_qos = qos == QOS_0 ? QOS_0 : QOS_1;
+    m_deliveryWindow.windowSize(windowSize);
+    m_deliveryWindow.redeliveryTimeout(redeliveryTimeout);
+
+    if (m_qos != QOS_0 && !m_redeliveryEvent)
+        m_redeliveryEvent = m_redeliveryTimer.repeat(min(redeliveryTimeout, milliseconds(100)), this);
+}
+
+size_t SMQClient::inFlight() const
+{
+    return m_deliveryWindow.inFlight();
+}
+
+bool SMQClient::waitForAcknowledgements(milliseconds timeout)
+{
+    return m_deliveryWindow.waitEmpty(timeout);
+}
+
+void SMQClient::redeliveryTimerCallback(void* eventData)
+{
+    auto* client = (SMQClient*) eventData;
+    client->redeliver();
+}
+
+void SMQClient::redeliver()
+{
+    vector<MQDeliveryWindow::Delivery> deliveries;
+    m_deliveryWindow.expired(deliveries);
+    if (deliveries.empty() || !connected())
+        return;
+
+    try {
+        lock_guard<mutex> lock(m_sendMutex);
+        for (auto& delivery: deliveries)
+            protocol().sendMessage(delivery.destination, *delivery.message, QOS_1, delivery.packetId, true);
+    }
+    catch (const Exception& e) {
+        CERR("Can't redeliver messages: " << e.what() << endl);
+    }
+}
+
 void SMQClient::subscribe(const String& destination, std::chrono::milliseconds timeout)
 {
     auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    (*subscribeMessage)["qos"] = int2string(m_qos.load());
     send(destination, subscribeMessage, timeout);
 }
 
@@ -92,12 +417,54 @@ void SMQClient::socketEvent(SocketEventType eventType)
     }
 
     SMessage msg;
+    vector<uint16_t> publishAcks;
+    bool sendWindowed = false;
     try {
         while (connected() && socket().socketBytes() > 0) {
-            if (protocol().readMessage(msg) && msg->type() == Message::MESSAGE) {
-                acceptMessage(msg);
+            if (!protocol().readMessage(msg))
+                continue;
+            switch (msg->type()) {
+                case Message::MESSAGE:
+                    if (string2int(msg->headers()["qos"]) != QOS_0)
+                        parseMessageIds(msg->headers()["message_id"], publishAcks);
+                    acceptMessage(msg);
+                    break;
+                case Message::PUBLISH_ACK:
+                    {
+                        vector<uint16_t> packetIds;
+                        parseMessageIds(msg->headers()["message_id"], packetIds);
+                        for (auto packetId: packetIds) {
+                            if (m_deliveryWindow.acknowledge(packetId))
+                                complete(packetId);
+                        }
+                        sendWindowed = true;
+                    }
+                    break;
+                case Message::SUBSCRIBE_ACK:
+                    if (!(*msg)["error"].empty())
+                        CERR("ERROR: " << (*msg)["error"] << endl);
+                    break;
+                case Message::CONNECT_ACK:
+                    protocol().negotiate(*msg);
+                    acceptSharedMemory(*msg);
+                    {
+                        lock_guard<mutex> lock(m_connectMutex);
+                        m_connectAckReceived = true;
+                    }
+                    m_connectAcknowledged.notify_all();
+                    break;
+                default:
+                    break;
             }
         }
+
+        // Acknowledgements of the messages received in this call are sent together
+        if (!publishAcks.empty() && connected())
+            sendFrame(*protocol().encodeAck(Message::MESSAGE, publishAcks));
+
+        // Acknowledgements free delivery window slots for pending messages
+        if (sendWindowed && pending() > 0)
+            sendPending();
     }
     catch (const Exception& e) {
         CERR("ERROR: " << e.what() << endl);
@@ -105,6 +472,20 @@ void SMQClient::socketEvent(SocketEventType eventType)
     }
 }
 
+void SMQClient::acceptSharedMemory(Message& connectAck)
+{
+    auto* sharedMemorySocket = dynamic_cast<MQSharedMemorySocket*>(&socket());
+    if (sharedMemorySocket == nullptr)
+        return;
+
+    if (connectAck.headers()["shared_memory"] == "1") {
+        sharedMemorySocket->attachSharedMemory();
+        sharedMemorySocket->activateSharedMemory();
+    }
+    else
+        sharedMemorySocket->releaseSharedMemory();
+}
+
 void SMQClient::setLastWillMessage(std::unique_ptr<MQLastWillMessage>& lastWillMessage)
 {
     UniqueLock(m_mutex);
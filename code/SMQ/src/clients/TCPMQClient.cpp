@@ -27,6 +27,7 @@
 */
 
 #include "smq/clients/TCPMQClient.h"
+#include <smq/protocols/MQSharedMemorySocket.h>
 
 using namespace std;
 using namespace sptk;
@@ -75,6 +76,21 @@ void TCPMQClient::createConnection(const Host& server, bool encrypted, std::chro
     m_protocol = MQProtocol::factory(protocolType(), *m_socket);
 }
 
+#ifndef _WIN32
+void TCPMQClient::createConnection(const String& socketPath, std::chrono::milliseconds timeout)
+{
+    UniqueLock(m_mutex);
+    if (m_socket && m_socket->active())
+        return;
+    auto socket = make_shared<MQSharedMemorySocket>();
+    socket->openUnix(socketPath, TCPSocket::SOM_CONNECT, true, timeout);
+    m_socket = socket;
+    smqSocketEvents->add(*m_socket, this);
+
+    m_protocol = MQProtocol::factory(protocolType(), *m_socket);
+}
+#endif
+
 void TCPMQClient::destroyConnection()
 {
     UniqueLock(m_mutex);
@@ -0,0 +1,218 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       MQDeliveryWindow.cpp - description                     ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/protocols/MQDeliveryWindow.h>
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+constexpr milliseconds MQDeliveryWindow::DefaultRedeliveryTimeout;
+
+MQDeliveryWindow::MQDeliveryWindow(size_t windowSize, milliseconds redeliveryTimeout)
+: m_windowSize(windowSize == 0 ? 1 : windowSize), m_redeliveryTimeout(redeliveryTimeout)
+{
+}
+
+uint16_t MQDeliveryWindow::addUnlocked(const String& destination, const SMessage& message)
+{
+    // Packet id 0 isn't allowed, and ids of in-flight messages can't be reused
+    do {
+        m_lastPacketId++;
+    } while (m_lastPacketId == 0 || m_inFlight.find(m_lastPacketId) != m_inFlight.end());
+
+    m_inFlight[m_lastPacketId] = Delivery{m_lastPacketId, destination, message, steady_clock::now(), 1};
+
+    return m_lastPacketId;
+}
+
+uint16_t MQDeliveryWindow::add(const String& destination, const SMessage& message, milliseconds timeout)
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    if (!m_condition.wait_for(lock, timeout, [this]() { return m_inFlight.size() < m_windowSize; }))
+        throw TimeoutException("Delivery window is full");
+
+    return addUnlocked(destination, message);
+}
+
+bool MQDeliveryWindow::tryAdd(const String& destination, const SMessage& message, uint16_t& packetId)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_inFlight.size() >= m_windowSize)
+        return false;
+
+    packetId = addUnlocked(destination, message);
+
+    return true;
+}
+
+bool MQDeliveryWindow::acknowledge(uint16_t packetId)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_inFlight.erase(packetId) == 0)
+        return false;
+
+    m_condition.notify_all();
+
+    return true;
+}
+
+void MQDeliveryWindow::expired(vector<Delivery>& deliveries)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto now = steady_clock::now();
+    for (auto& itor: m_inFlight) {
+        auto& delivery = itor.second;
+        if (now - delivery.sent >= m_redeliveryTimeout) {
+            delivery.sent = now;
+            delivery.attempts++;
+            deliveries.push_back(delivery);
+        }
+    }
+}
+
+bool MQDeliveryWindow::waitEmpty(milliseconds timeout)
+{
+    unique_lock<mutex> lock(m_mutex);
+    return m_condition.wait_for(lock, timeout, [this]() { return m_inFlight.empty(); });
+}
+
+size_t MQDeliveryWindow::inFlight() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_inFlight.size();
+}
+
+size_t MQDeliveryWindow::windowSize() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_windowSize;
+}
+
+void MQDeliveryWindow::windowSize(size_t windowSize)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_windowSize = windowSize == 0 ? 1 : windowSize;
+    m_condition.notify_all();
+}
+
+milliseconds MQDeliveryWindow::redeliveryTimeout() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_redeliveryTimeout;
+}
+
+void MQDeliveryWindow::redeliveryTimeout(milliseconds timeout)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_redeliveryTimeout = timeout;
+}
+
+void MQDeliveryWindow::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_inFlight.clear();
+    m_condition.notify_all();
+}
+
+void sptk::parseMessageIds(const String& messageIds, vector<uint16_t>& packetIds)
+{
+    if (messageIds.empty())
+        return;
+    for (auto& messageId: Strings(messageIds, ",")) {
+        if (!messageId.empty())
+            packetIds.push_back(uint16_t(string2int(messageId)));
+    }
+}
+
+#if USE_GTEST
+
+TEST(SPTK_MQDeliveryWindow, window)
+{
+    MQDeliveryWindow window(2, milliseconds(50));
+    auto message = make_shared<Message>(Message::MESSAGE, Buffer("test"));
+
+    uint16_t packetId1 = window.add("test", message, milliseconds(0));
+    uint16_t packetId2 = 0;
+    EXPECT_TRUE(window.tryAdd("test", message, packetId2));
+    EXPECT_NE(packetId1, packetId2);
+    EXPECT_EQ(size_t(2), window.inFlight());
+
+    // Window is full
+    uint16_t packetId3 = 0;
+    EXPECT_FALSE(window.tryAdd("test", message, packetId3));
+    EXPECT_THROW(window.add("test", message, milliseconds(10)), TimeoutException);
+
+    // Acknowledgement from another thread releases the slot
+    thread acknowledger([&window, packetId1]() {
+        this_thread::sleep_for(milliseconds(10));
+        window.acknowledge(packetId1);
+    });
+    EXPECT_NO_THROW(packetId3 = window.add("test", message, milliseconds(1000)));
+    acknowledger.join();
+
+    EXPECT_FALSE(window.acknowledge(packetId1));
+    EXPECT_TRUE(window.acknowledge(packetId2));
+    EXPECT_TRUE(window.acknowledge(packetId3));
+    EXPECT_TRUE(window.waitEmpty(milliseconds(0)));
+}
+
+TEST(SPTK_MQDeliveryWindow, redelivery)
+{
+    MQDeliveryWindow window(10, milliseconds(20));
+    auto message = make_shared<Message>(Message::MESSAGE, Buffer("test"));
+
+    uint16_t packetId = window.add("test", message, milliseconds(0));
+
+    vector<MQDeliveryWindow::Delivery> deliveries;
+    window.expired(deliveries);
+    EXPECT_EQ(size_t(0), deliveries.size());
+
+    this_thread::sleep_for(milliseconds(30));
+    window.expired(deliveries);
+    ASSERT_EQ(size_t(1), deliveries.size());
+    EXPECT_EQ(packetId, deliveries[0].packetId);
+    EXPECT_EQ(unsigned(2), deliveries[0].attempts);
+    EXPECT_STREQ("test", deliveries[0].message->c_str());
+
+    // Redelivery timeout restarts after redelivery
+    deliveries.clear();
+    window.expired(deliveries);
+    EXPECT_EQ(size_t(0), deliveries.size());
+
+    window.acknowledge(packetId);
+    this_thread::sleep_for(milliseconds(30));
+    window.expired(deliveries);
+    EXPECT_EQ(size_t(0), deliveries.size());
+}
+
+#endif
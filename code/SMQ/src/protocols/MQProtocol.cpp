@@ -28,6 +28,7 @@
 
 #include <smq/protocols/SMQProtocol.h>
 #include <smq/protocols/MQTTProtocol.h>
+#include <smq/protocols/MQDeliveryWindow.h>
 
 
 using namespace std;
@@ -65,11 +66,50 @@ size_t MQProtocol::write(String& str)
     return m_socket.write(str.c_str(), str.length());
 }
 
-size_t MQProtocol::write(Buffer& data)
+size_t MQProtocol::write(const Buffer& data)
 {
     return m_socket.write(data.c_str(), data.bytes());
 }
 
+void MQProtocol::ack(Message::Type sourceMessageType, const String& messageId)
+{
+    vector<uint16_t> messageIds;
+    if (!messageId.empty())
+        parseMessageIds(messageId, messageIds);
+
+    auto frame = encodeAck(sourceMessageType, messageIds);
+    if (frame)
+        sendFrame(*frame);
+}
+
+bool MQProtocol::sendMessage(const String& destination, SMessage& message)
+{
+    sendMessage(destination, *message, QOS_0, 0, false);
+    return true;
+}
+
+void MQProtocol::sendMessage(const String& destination, const Message& message, QOS qos, uint16_t packetId,
+                             bool duplicate)
+{
+    auto frame = encodeMessage(destination, message, qos, packetId, duplicate);
+    sendFrame(*frame);
+}
+
+void MQProtocol::appendMessage(Buffer& frames, const String& destination, const Message& message, QOS qos,
+                               uint16_t packetId, bool duplicate)
+{
+    auto frame = encodeMessage(destination, message, qos, packetId, duplicate);
+    frames.append(frame->c_str(), frame->bytes());
+}
+
+bool MQProtocol::sendFrame(const Buffer& frame)
+{
+    if (!m_socket.active())
+        throw Exception("Not connected");
+    m_socket.write(frame);
+    return true;
+}
+
 std::shared_ptr<MQProtocol> MQProtocol::factory(MQProtocolType protocolType, TCPSocket& socket)
 {
     switch (protocolType) {
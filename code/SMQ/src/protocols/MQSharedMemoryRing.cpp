@@ -0,0 +1,202 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       MQSharedMemoryRing.cpp - description                   ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/protocols/MQSharedMemoryRing.h>
+#include <sptk5/Buffer.h>
+#include <sptk5/Exception.h>
+#include <cstring>
+
+using namespace std;
+using namespace sptk;
+
+/**
+ * Positions are on separate cache lines, so producer and consumer don't invalidate each other's cache line
+ */
+struct MQSharedMemoryRing::Header
+{
+    alignas(64) atomic<uint64_t>    head;       ///< Total number of bytes read
+    alignas(64) atomic<uint64_t>    tail;       ///< Total number of bytes written
+    alignas(64) uint64_t            capacity;   ///< Ring data size
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory ring requires lock-free 64-bit atomics");
+
+MQSharedMemoryRing::MQSharedMemoryRing(void* memory, size_t memorySize, bool initialize)
+{
+    if (memorySize <= sizeof(Header))
+        throw Exception("Shared memory is too small for ring");
+
+    m_header = (Header*) memory;
+    m_data = (char*) memory + sizeof(Header);
+
+    if (initialize) {
+        new (m_header) Header;
+        m_header->head = 0;
+        m_header->tail = 0;
+        m_header->capacity = memorySize - sizeof(Header);
+    }
+    else if (m_header->capacity == 0 || m_header->capacity > memorySize - sizeof(Header))
+        throw Exception("Invalid shared memory ring");
+
+    m_capacity = m_header->capacity;
+}
+
+size_t MQSharedMemoryRing::memorySize(size_t capacity)
+{
+    return sizeof(Header) + capacity;
+}
+
+size_t MQSharedMemoryRing::capacity() const
+{
+    return m_capacity;
+}
+
+size_t MQSharedMemoryRing::usedBytes(uint64_t head, uint64_t tail) const
+{
+    // Positions are written by the peer process, so they can't be trusted
+    uint64_t bytes = tail - head;
+    if (bytes > m_capacity)
+        throw Exception("Shared memory ring is corrupted");
+    return size_t(bytes);
+}
+
+size_t MQSharedMemoryRing::available() const
+{
+    uint64_t head = m_header->head.load();
+    return usedBytes(head, m_header->tail.load());
+}
+
+size_t MQSharedMemoryRing::write(const char* data, size_t size, bool& wakeup)
+{
+    uint64_t tail = m_header->tail.load(memory_order_relaxed);
+    uint64_t head = m_header->head.load(memory_order_acquire);
+
+    size_t bytes = min(size, m_capacity - usedBytes(head, tail));
+    if (bytes == 0) {
+        wakeup = false;
+        return 0;
+    }
+
+    size_t offset = size_t(tail % m_capacity);
+    size_t firstPart = min(bytes, m_capacity - offset);
+    memcpy(m_data + offset, data, firstPart);
+    memcpy(m_data, data + firstPart, bytes - firstPart);
+
+    // Either the consumer sees the new tail, or the producer sees that the consumer has read everything before it.
+    // Both operations are sequentially consistent, so a wakeup can't be lost.
+    m_header->tail.store(tail + bytes);
+    wakeup = m_header->head.load() == tail;
+
+    return bytes;
+}
+
+size_t MQSharedMemoryRing::read(char* data, size_t size)
+{
+    uint64_t head = m_header->head.load(memory_order_relaxed);
+    uint64_t tail = m_header->tail.load(memory_order_acquire);
+
+    size_t bytes = min(size, usedBytes(head, tail));
+    if (bytes == 0)
+        return 0;
+
+    size_t offset = size_t(head % m_capacity);
+    size_t firstPart = min(bytes, m_capacity - offset);
+    memcpy(data, m_data + offset, firstPart);
+    memcpy(data + firstPart, m_data, bytes - firstPart);
+
+    m_header->head.store(head + bytes);
+
+    return bytes;
+}
+
+#if USE_GTEST
+
+TEST(SPTK_MQSharedMemoryRing, readWrite)
+{
+    Buffer memory(MQSharedMemoryRing::memorySize(100));
+    MQSharedMemoryRing producer(memory.data(), MQSharedMemoryRing::memorySize(100), true);
+    MQSharedMemoryRing consumer(memory.data(), MQSharedMemoryRing::memorySize(100), false);
+    EXPECT_EQ(size_t(100), consumer.capacity());
+
+    bool wakeup = false;
+    String data;
+    for (char c = 0; c < 100; c++)
+        data += char('A' + c % 26);
+
+    // Empty ring: consumer should be woken up
+    EXPECT_EQ(size_t(70), producer.write(data.c_str(), 70, wakeup));
+    EXPECT_TRUE(wakeup);
+
+    // Consumer didn't read yet: no wakeup, and only free space is written
+    EXPECT_EQ(size_t(30), producer.write(data.c_str(), 70, wakeup));
+    EXPECT_FALSE(wakeup);
+    EXPECT_EQ(size_t(0), producer.write(data.c_str(), 70, wakeup));
+    EXPECT_EQ(size_t(100), consumer.available());
+
+    char output[100];
+    EXPECT_EQ(size_t(70), consumer.read(output, 70));
+    EXPECT_EQ(data.substr(0, 70), String(output, size_t(70)));
+    EXPECT_EQ(size_t(30), consumer.read(output, 100));
+    EXPECT_EQ(data.substr(0, 30), String(output, size_t(30)));
+    EXPECT_EQ(size_t(0), consumer.read(output, 100));
+
+    // Data wraps around the ring end
+    EXPECT_EQ(size_t(80), producer.write(data.c_str(), 80, wakeup));
+    EXPECT_EQ(size_t(80), consumer.read(output, 100));
+    EXPECT_EQ(size_t(50), producer.write(data.c_str(), 50, wakeup));
+    EXPECT_TRUE(wakeup);
+    EXPECT_EQ(size_t(50), consumer.read(output, 100));
+    EXPECT_EQ(data.substr(0, 50), String(output, size_t(50)));
+}
+
+TEST(SPTK_MQSharedMemoryRing, corruptedPositions)
+{
+    Buffer memory(MQSharedMemoryRing::memorySize(100));
+    MQSharedMemoryRing producer(memory.data(), MQSharedMemoryRing::memorySize(100), true);
+    MQSharedMemoryRing consumer(memory.data(), MQSharedMemoryRing::memorySize(100), false);
+
+    bool wakeup = false;
+    char output[100];
+    EXPECT_EQ(size_t(10), producer.write("0123456789", 10, wakeup));
+
+    // Peer moved tail beyond ring capacity
+    auto* tail = (atomic<uint64_t>*) (memory.data() + 64);
+    *tail = 1000;
+    EXPECT_THROW(consumer.available(), Exception);
+    EXPECT_THROW(consumer.read(output, sizeof(output)), Exception);
+    EXPECT_THROW(producer.write("0123456789", 10, wakeup), Exception);
+
+    // Peer moved head beyond tail
+    auto* head = (atomic<uint64_t>*) memory.data();
+    *tail = 10;
+    *head = 20;
+    EXPECT_THROW(consumer.read(output, sizeof(output)), Exception);
+    EXPECT_THROW(producer.write("0123456789", 10, wakeup), Exception);
+}
+
+#endif
@@ -0,0 +1,433 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       MQSharedMemorySocket.cpp - description                 ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/protocols/MQSharedMemorySocket.h>
+#include <sptk5/SystemException.h>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#endif
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+#if (__FreeBSD__ | __OpenBSD__)
+#define PEER_CLOSED (POLLHUP|POLLERR|POLLNVAL)
+#else
+#define PEER_CLOSED (POLLRDHUP|POLLHUP|POLLERR|POLLNVAL)
+#endif
+
+MQSharedMemorySocket::~MQSharedMemorySocket()
+{
+    close();
+    m_active = false;
+    releaseSharedMemory();
+}
+
+#ifndef _WIN32
+
+void MQSharedMemorySocket::mapSegment(size_t memorySize, bool serverSide)
+{
+    void* memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, m_segmentFD, 0);
+    if (memory == MAP_FAILED)
+        throw SystemException("Can't map shared memory segment");
+
+    m_memory = memory;
+    m_memorySize = memorySize;
+
+    // The first ring carries data from client to server, and the second ring - from server to client
+    size_t ringSize = memorySize / 2;
+    auto clientRing = make_unique<MQSharedMemoryRing>(m_memory, ringSize, serverSide);
+    auto serverRing = make_unique<MQSharedMemoryRing>((char*) m_memory + ringSize, ringSize, serverSide);
+    if (serverSide) {
+        m_inbound = move(clientRing);
+        m_outbound = move(serverRing);
+    } else {
+        m_outbound = move(clientRing);
+        m_inbound = move(serverRing);
+    }
+}
+
+void MQSharedMemorySocket::closeSegmentFD()
+{
+    if (m_segmentFD >= 0) {
+        ::close(m_segmentFD);
+        m_segmentFD = -1;
+    }
+}
+
+void MQSharedMemorySocket::requestSharedMemory()
+{
+    releaseSharedMemory();
+    m_requested = true;
+}
+
+void MQSharedMemorySocket::createSharedMemory(size_t ringCapacity)
+{
+    sockaddr_storage address = {};
+    socklen_t addressLength = sizeof(address);
+    if (getsockname(socketFD(), (sockaddr*) &address, &addressLength) != 0 || address.ss_family != AF_UNIX)
+        throw Exception("Shared memory transport requires Unix domain socket connection");
+
+#ifdef MFD_ALLOW_SEALING
+    releaseSharedMemory();
+
+    // Ring size is rounded up to the page size, so the second ring starts at the page boundary
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t ringSize = (MQSharedMemoryRing::memorySize(ringCapacity) + pageSize - 1) / pageSize * pageSize;
+
+    // Anonymous segment is only accessible through the descriptor, passed to the client
+    m_segmentFD = memfd_create("smq", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_segmentFD < 0)
+        throw SystemException("Can't create shared memory segment");
+
+    // Sealed segment size can't be changed by the client, so the mapped memory stays valid
+    if (ftruncate(m_segmentFD, off_t(ringSize * 2)) != 0 ||
+        fcntl(m_segmentFD, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0)
+    {
+        closeSegmentFD();
+        throw SystemException("Can't allocate shared memory segment");
+    }
+
+    try {
+        mapSegment(ringSize * 2, true);
+    }
+    catch (const Exception&) {
+        closeSegmentFD();
+        throw;
+    }
+#else
+    throw Exception("Shared memory transport isn't supported on this platform");
+#endif
+}
+
+void MQSharedMemorySocket::attachSharedMemory()
+{
+    if (m_segmentFD < 0)
+        throw Exception("Shared memory segment isn't received");
+
+#ifdef F_GET_SEALS
+    // Segment that can shrink may be truncated while it is mapped, and then any access to it fails with SIGBUS
+    int seals = fcntl(m_segmentFD, F_GET_SEALS);
+    if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+        closeSegmentFD();
+        throw Exception("Shared memory segment isn't sealed");
+    }
+#endif
+
+    struct stat segmentInfo = {};
+    if (fstat(m_segmentFD, &segmentInfo) != 0 || segmentInfo.st_size <= 0) {
+        closeSegmentFD();
+        throw Exception("Invalid shared memory segment");
+    }
+
+    mapSegment(size_t(segmentInfo.st_size), false);
+}
+
+void MQSharedMemorySocket::activateSharedMemory()
+{
+    if (!m_memory)
+        throw Exception("Shared memory segment isn't mapped");
+
+    // Mapped segment doesn't need the descriptor, and the server has passed it already
+    closeSegmentFD();
+
+    // Everything the peer sent through the socket after the last message is a wakeup
+    reader().open();
+    m_requested = false;
+    m_active = true;
+}
+
+void MQSharedMemorySocket::releaseSharedMemory()
+{
+    if (m_active)
+        return;
+
+    m_requested = false;
+    closeSegmentFD();
+    m_inbound.reset();
+    m_outbound.reset();
+    if (m_memory != nullptr) {
+        munmap(m_memory, m_memorySize);
+        m_memory = nullptr;
+        m_memorySize = 0;
+    }
+}
+
+size_t MQSharedMemorySocket::receiveWithSegment(void* buffer, size_t size)
+{
+    iovec data = {buffer, size};
+    union {
+        cmsghdr header;
+        char    space[CMSG_SPACE(sizeof(int))];
+    } control = {};
+
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.space;
+    message.msg_controllen = sizeof(control.space);
+
+#ifdef MSG_CMSG_CLOEXEC
+    auto bytes = ::recvmsg(socketFD(), &message, MSG_CMSG_CLOEXEC);
+#else
+    auto bytes = ::recvmsg(socketFD(), &message, 0);
+#endif
+
+    for (auto* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+            continue;
+        size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        auto* fds = (const int*) CMSG_DATA(header);
+        for (size_t i = 0; i < count; i++) {
+            // Only one segment is expected, any other descriptor is closed
+            if (m_segmentFD < 0)
+                m_segmentFD = fds[i];
+            else
+                ::close(fds[i]);
+        }
+    }
+
+    return (size_t) bytes;
+}
+
+size_t MQSharedMemorySocket::sendWithSegment(const void* buffer, size_t size)
+{
+    iovec data = {(void*) buffer, size};
+    union {
+        cmsghdr header;
+        char    space[CMSG_SPACE(sizeof(int))];
+    } control = {};
+
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.space;
+    message.msg_controllen = sizeof(control.space);
+
+    auto* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &m_segmentFD, sizeof(int));
+
+    auto bytes = ::sendmsg(socketFD(), &message, MSG_NOSIGNAL);
+
+    // Descriptor is passed with the first sent byte, and the server doesn't need it after that
+    if (bytes > 0)
+        closeSegmentFD();
+
+    return (size_t) bytes;
+}
+
+void MQSharedMemorySocket::readWakeups()
+{
+    char wakeups[256];
+    while (::recv(socketFD(), wakeups, sizeof(wakeups), MSG_DONTWAIT) > 0)
+        continue;
+}
+
+void MQSharedMemorySocket::sendWakeup()
+{
+    // If the socket buffer is full, the peer has unread wakeups already
+    char wakeup = 1;
+    ::send(socketFD(), &wakeup, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+void MQSharedMemorySocket::waitForPeer(milliseconds timeout)
+{
+    pollfd pfd = {};
+    pfd.fd = socketFD();
+    pfd.events = POLLIN;
+    poll(&pfd, 1, int(timeout.count()));
+}
+
+bool MQSharedMemorySocket::peerClosed()
+{
+    if (!active())
+        return true;
+
+    pollfd pfd = {};
+    pfd.fd = socketFD();
+    pfd.events = POLLIN | PEER_CLOSED;
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & PEER_CLOSED) != 0;
+}
+
+size_t MQSharedMemorySocket::recv(void* buffer, size_t size)
+{
+    if (m_requested)
+        return receiveWithSegment(buffer, size);
+
+    if (!m_active)
+        return TCPSocket::recv(buffer, size);
+
+    for (;;) {
+        size_t bytes = m_inbound->read((char*) buffer, size);
+        if (bytes > 0)
+            return bytes;
+        if (peerClosed())
+            throw ConnectionException("Connection closed");
+        waitForPeer(milliseconds(1));
+        readWakeups();
+    }
+}
+
+size_t MQSharedMemorySocket::send(const void* buffer, size_t size)
+{
+    if (!m_active) {
+        if (m_segmentFD >= 0 && m_memory != nullptr && !m_requested)
+            return sendWithSegment(buffer, size);
+        return TCPSocket::send(buffer, size);
+    }
+
+    auto data = (const char*) buffer;
+    size_t total = 0;
+    auto deadline = steady_clock::now() + m_writeTimeout;
+    while (total < size) {
+        bool wakeup;
+        size_t bytes = m_outbound->write(data + total, size - total, wakeup);
+        total += bytes;
+        if (wakeup)
+            sendWakeup();
+        if (total < size) {
+            // Ring is full: wait until the peer reads some data
+            if (peerClosed())
+                throw ConnectionException("Connection closed");
+            if (bytes > 0)
+                deadline = steady_clock::now() + m_writeTimeout;
+            else if (m_writeTimeout.count() > 0 && steady_clock::now() >= deadline)
+                throw TimeoutException("Can't write to shared memory: peer doesn't read");
+            this_thread::sleep_for(microseconds(50));
+        }
+    }
+
+    return total;
+}
+
+size_t MQSharedMemorySocket::socketBytes()
+{
+    if (!m_active)
+        return TCPSocket::socketBytes();
+
+    if (reader().availableBytes() > 0)
+        return reader().availableBytes();
+
+    readWakeups();
+    return m_inbound->available();
+}
+
+bool MQSharedMemorySocket::readyToRead(milliseconds timeout)
+{
+    if (!m_active)
+        return TCPSocket::readyToRead(timeout);
+
+    auto deadline = steady_clock::now() + timeout;
+    for (;;) {
+        if (socketBytes() > 0)
+            return true;
+        if (peerClosed())
+            throw ConnectionException("Connection closed");
+        auto now = steady_clock::now();
+        if (now >= deadline)
+            return false;
+        waitForPeer(min(duration_cast<milliseconds>(deadline - now) + milliseconds(1), milliseconds(100)));
+    }
+}
+
+#else
+
+void MQSharedMemorySocket::requestSharedMemory()
+{
+    throw Exception("Shared memory transport isn't supported on this platform");
+}
+
+void MQSharedMemorySocket::createSharedMemory(size_t)
+{
+    throw Exception("Shared memory transport isn't supported on this platform");
+}
+
+void MQSharedMemorySocket::attachSharedMemory()
+{
+    throw Exception("Shared memory transport isn't supported on this platform");
+}
+
+void MQSharedMemorySocket::activateSharedMemory()
+{
+    throw Exception("Shared memory transport isn't supported on this platform");
+}
+
+void MQSharedMemorySocket::releaseSharedMemory()
+{
+}
+
+size_t MQSharedMemorySocket::recv(void* buffer, size_t size)
+{
+    return TCPSocket::recv(buffer, size);
+}
+
+size_t MQSharedMemorySocket::send(const void* buffer, size_t size)
+{
+    return TCPSocket::send(buffer, size);
+}
+
+size_t MQSharedMemorySocket::socketBytes()
+{
+    return TCPSocket::socketBytes();
+}
+
+bool MQSharedMemorySocket::readyToRead(milliseconds timeout)
+{
+    return TCPSocket::readyToRead(timeout);
+}
+
+#endif
+
+size_t MQSharedMemorySocket::bufferedBytes()
+{
+    size_t bytes = reader().availableBytes();
+    if (m_active)
+        bytes += m_inbound->available();
+    return bytes;
+}
+
+bool MQSharedMemorySocket::sharedMemoryActive() const
+{
+    return m_active;
+}
+
+void MQSharedMemorySocket::writeTimeout(milliseconds timeout)
+{
+    m_writeTimeout = timeout;
+}
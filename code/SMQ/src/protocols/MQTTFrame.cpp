@@ -134,7 +134,8 @@ const Buffer& MQTTFrame::setCONNECT(uint16_t keepAliveSeconds, const String& use
     return *this;
 }
 
-const Buffer& MQTTFrame::setPUBLISH(const String& topic, const Buffer& data, sptk::QOS qos, bool dup, bool retain)
+const Buffer& MQTTFrame::setPUBLISH(const String& topic, const Buffer& data, sptk::QOS qos, bool dup, bool retain,
+                                    uint16_t packetId)
 {
     m_type = FT_PUBLISH;
     bytes(0);
@@ -152,7 +153,7 @@ const Buffer& MQTTFrame::setPUBLISH(const String& topic, const Buffer& data, spt
     // Variable header
     appendVariableHeader(topic);
     if (qos != QOS_0) {
-        m_id = nextPacketId();
+        m_id = packetId != 0 ? packetId : nextPacketId();
         appendShortValue(m_id);
     } else {
         m_id = 0;
@@ -422,6 +423,7 @@ bool MQTTFrame::read(TCPSocket& socket, String& destination, MQProtocol::Paramet
     socket.read((char*)&messageHeader, 1);
     m_type = (MQTTFrameType) (messageHeader & 0xF0);
     m_qos = (QOS) ((messageHeader & 0x06) >> 1);
+    m_retain = m_type == FT_PUBLISH && (messageHeader & 0x01) != 0;
     unsigned remainingLength = receiveRemainingLength(socket);
 
     switch (m_type) {
@@ -441,6 +443,10 @@ bool MQTTFrame::read(TCPSocket& socket, String& destination, MQProtocol::Paramet
             readSubscribeFrame(socket, remainingLength, m_qos, destination);
             break;
 
+        case FT_PUBACK:
+            m_id = readShortInteger(socket);
+            break;
+
         case FT_UNDEFINED:
             throw Exception("Received frame type");
 
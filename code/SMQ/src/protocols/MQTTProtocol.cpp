@@ -32,7 +32,7 @@ using namespace std;
 using namespace sptk;
 using namespace chrono;
 
-void MQTTProtocol::ack(Message::Type sourceMessageType, const String& messageId)
+SharedMQFrame MQTTProtocol::encodeAck(Message::Type sourceMessageType, const vector<uint16_t>& messageIds) const
 {
     MQTTFrameType ackType = FT_UNDEFINED;
     switch (sourceMessageType) {
@@ -46,29 +46,41 @@ void MQTTProtocol::ack(Message::Type sourceMessageType, const String& messageId)
             ackType = FT_PUBACK;
             break;
         default:
-            return;
+            return nullptr;
     }
 
-    auto shortMessageId = uint16_t(messageId.empty() ? 0 : string2int(messageId));
-    MQTTFrame ackFrame(ackType, shortMessageId, QOS_0);
-    ackFrame.setACK(shortMessageId, ackType);
-    socket().send(ackFrame.c_str(), ackFrame.bytes());
+    // MQTT acknowledges one packet per frame, so batched acknowledgements are concatenated frames
+    auto output = make_shared<Buffer>(4 * (messageIds.empty() ? 1 : messageIds.size()));
+    MQTTFrame ackFrame(ackType, 0, QOS_0);
+    if (messageIds.empty()) {
+        ackFrame.setACK(0, ackType);
+        output->append(ackFrame.c_str(), ackFrame.bytes());
+    }
+    for (auto messageId: messageIds) {
+        ackFrame.setACK(messageId, ackType);
+        output->append(ackFrame.c_str(), ackFrame.bytes());
+    }
+
+    return output;
 }
 
 bool MQTTProtocol::readMessage(SMessage& message)
 {
     MQTTFrame frame(FT_UNDEFINED, 0, QOS_0);
 
-    Message::Headers headers;
+    Parameters parameters;
     String destination;
     try {
-        if (frame.read(socket(), destination, headers, seconds(10))) {
+        if (frame.read(socket(), destination, parameters, seconds(10))) {
             message = make_shared<Message>(mqMessageType(frame.type()));
             message->destination(destination);
-            message->headers() = move(headers);
+            for (auto& parameter: parameters)
+                message->headers()[parameter.first] = move(parameter.second);
             message->headers()["qos"] = to_string(frame.qos());
-            if (frame.qos() != QOS_0)
+            if (frame.qos() != QOS_0 || frame.type() == FT_PUBACK)
                 message->headers()["message_id"] = to_string(frame.id());
+            if (frame.retain())
+                message->headers()["retain"] = "1";
             message->set(frame);
             return true;
         }
@@ -81,32 +93,35 @@ bool MQTTProtocol::readMessage(SMessage& message)
     return false;
 }
 
-bool MQTTProtocol::sendMessage(const String& destination, SMessage& message)
+SharedMQFrame MQTTProtocol::encodeMessage(const String& destination, const Message& message, QOS qos,
+                                          uint16_t packetId, bool duplicate) const
 {
-    MQTTFrame frame;
-    switch (message->type()) {
+    auto frame = make_shared<MQTTFrame>();
+    switch (message.type()) {
         case Message::CONNECT:
-            frame.setCONNECT(
+            frame->setCONNECT(
                     60,
-                    (*message)["username"],
-                    (*message)["password"],
-                    (*message)["client_id"],
-                    (*message)["last_will_destination"],
-                    (*message)["last_will_message"],
+                    message["username"],
+                    message["password"],
+                    message["client_id"],
+                    message["last_will_destination"],
+                    message["last_will_message"],
                     MQTT_PROTOCOL_V311
                     );
             break;
         case Message::SUBSCRIBE:
-            frame.setSUBSCRIBE(destination, QOS_0);
+            frame->setSUBSCRIBE(destination, QOS(string2int(message["qos"], QOS_0)));
             break;
-        case Message::MESSAGE:
-            frame.setPUBLISH(destination, *message, QOS_0);
+        case Message::MESSAGE: {
+            auto retain = message.headers().find("retain");
+            bool retainFlag = retain != message.headers().end() && retain->second == "1";
+            frame->setPUBLISH(destination, message, qos, duplicate, retainFlag, packetId);
             break;
+        }
         default:
             throw Exception("Message type not handled!");
     }
-    socket().send(frame.c_str(), frame.bytes());
-    return true;
+    return frame;
 }
 
 Message::Type MQTTProtocol::mqMessageType(MQTTFrameType nativeMessageType)
@@ -31,7 +31,116 @@
 using namespace std;
 using namespace sptk;
 
-static void parseHeaders(Buffer& buffer, Message::Headers& headers)
+namespace {
+
+/**
+ * Version 2 frame signature, it never matches the first byte of version 1 signature "MSG:"
+ */
+constexpr uint8_t BinarySignature = 0xB2;
+
+/**
+ * Version 2 destination encoding
+ */
+enum DestinationKind : uint8_t
+{
+    DESTINATION_NONE,       ///< No destination
+    DESTINATION_INLINE,     ///< Destination name
+    DESTINATION_DEFINE,     ///< Destination id, followed by destination name
+    DESTINATION_REFERENCE   ///< Destination id, defined by the earlier frame
+};
+
+/**
+ * Version 2 header tags of the well-known headers.
+ * Tag 0 means that header name follows the tag.
+ */
+const char* const knownHeaders[] = {
+    "",
+    "qos",
+    "message_id",
+    "dup",
+    "client_id",
+    "username",
+    "password",
+    "last_will_destination",
+    "last_will_message",
+    "protocol_version"
+};
+
+constexpr uint8_t knownHeaderCount = sizeof(knownHeaders) / sizeof(knownHeaders[0]);
+
+uint8_t headerTag(const String& name)
+{
+    for (uint8_t tag = 1; tag < knownHeaderCount; ++tag) {
+        if (name == knownHeaders[tag])
+            return tag;
+    }
+    return 0;
+}
+
+void appendShortString(Buffer& output, const String& str)
+{
+    if (str.length() > 0xFFFF)
+        throw Exception("String is too long: " + str.substr(0, 32) + "..");
+    output.append((uint16_t) str.length());
+    output.append(str.c_str(), str.length());
+}
+
+void appendHeader(Buffer& output, const String& name, const String& value)
+{
+    uint8_t tag = headerTag(name);
+    output.append(tag);
+    if (tag == 0) {
+        if (name.empty() || name.length() > 0xFF)
+            throw Exception("Invalid header name: " + name.substr(0, 32));
+        output.append((uint8_t) name.length());
+        output.append(name.c_str(), name.length());
+    }
+    appendShortString(output, value);
+}
+
+/**
+ * Reads version 2 frame fields, checking the frame boundaries
+ */
+class FrameReader
+{
+    const char* m_position;
+    const char* m_end;
+
+public:
+    explicit FrameReader(const Buffer& frame)
+    : m_position(frame.c_str()), m_end(frame.c_str() + frame.bytes())
+    {
+    }
+
+    template<class T> T read()
+    {
+        T value;
+        memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    const char* take(size_t bytes)
+    {
+        if (size_t(m_end - m_position) < bytes)
+            throw Exception("Invalid message: truncated frame");
+        auto data = m_position;
+        m_position += bytes;
+        return data;
+    }
+
+    String readShortString()
+    {
+        size_t length = read<uint16_t>();
+        return String(take(length), length);
+    }
+
+    size_t remaining() const
+    {
+        return size_t(m_end - m_position);
+    }
+};
+
+void parseHeaders(Buffer& buffer, Message::Headers& headers)
 {
     char* pstart = buffer.data();
     char* pend = buffer.data() + buffer.bytes();
@@ -51,70 +160,48 @@ static void parseHeaders(Buffer& buffer, Message::Headers& headers)
     }
 }
 
-void SMQProtocol::ack(Message::Type sourceMessageType, const String& messageId)
+}
+
+bool SMQProtocol::readMessage(SMessage& outputMessage)
 {
-    return;
+    uint8_t signature;
 
-    Message::Type ackType;
-    switch (sourceMessageType) {
-        case Message::CONNECT:
-            ackType = Message::CONNECT_ACK;
-            break;
-        case Message::SUBSCRIBE:
-            ackType = Message::SUBSCRIBE_ACK;
-            break;
-        case Message::UNSUBSCRIBE:
-            ackType = Message::SUBSCRIBE_ACK;
-            break;
-        case Message::MESSAGE:
-            ackType = Message::PUBLISH_ACK;
-            break;
-        case Message::PING:
-            ackType = Message::PING_ACK;
-            break;
-        default:
-            return;
-    }
-    auto ackMessage = make_shared<Message>(ackType);
-    ackMessage->headers()["id"] = messageId;
-    sendMessage("", ackMessage);
+    // Read the first byte of message signature, that defines wire format version
+    size_t bytes = read((char*)&signature, sizeof(signature));
+    if (bytes == 0)
+        throw ConnectionException("Connection closed");
+
+    if (signature == BinarySignature)
+        readBinaryMessage(outputMessage);
+    else if (signature == 'M')
+        readTextMessage(outputMessage);
+    else
+        throw Exception("Invalid message magic byte");
+
+    return true;
 }
 
-bool SMQProtocol::readMessage(SMessage& outputMessage)
+void SMQProtocol::readTextMessage(SMessage& outputMessage)
 {
     char    data[16];
     Buffer  headers;
     Buffer  message;
     uint8_t messageType;
 
-    // Read message signature
-    size_t bytes = read(data, 4);
-    if (bytes == 0)
-        throw ConnectionException("Connection closed");
-
-    if (strncmp(data, "MSG:", 4) != 0)
+    // Read the rest of message signature
+    read(data, 3);
+    if (strncmp(data, "SG:", 3) != 0)
         throw Exception("Invalid message magic byte");
 
     // Read message type
     read((char*)&messageType, sizeof(messageType));
-    if (messageType > Message::MESSAGE)
+    if (messageType > Message::PING_ACK)
         throw Exception("Invalid message type");
 
-    switch (messageType) {
-        case Message::CONNECT:
-        case Message::SUBSCRIBE:
-            read(headers);
-            break;
-
-        case Message::MESSAGE:
-            read(headers);
-            read(message);
-            break;
-
-        default:
-            message.bytes(0);
-            break;
-    }
+    // Every message type has headers, and only MESSAGE has data
+    read(headers);
+    if (messageType == Message::MESSAGE)
+        read(message);
 
     outputMessage = make_shared<Message>((Message::Type) messageType, move(message));
     if (!headers.empty()) {
@@ -125,48 +212,317 @@ bool SMQProtocol::readMessage(SMessage& outputMessage)
             outputMessage->headers().erase(itor);
         }
     }
+}
 
-    return true;
+void SMQProtocol::readBinaryMessage(SMessage& outputMessage)
+{
+    uint8_t messageType;
+
+    // Read message type
+    read((char*)&messageType, sizeof(messageType));
+    if (messageType > Message::PING_ACK)
+        throw Exception("Invalid message type");
+
+    // The rest of the frame is read with a single read
+    Buffer frame;
+    read(frame);
+
+    FrameReader reader(frame);
+
+    String destination;
+    auto destinationKind = reader.read<uint8_t>();
+    switch (destinationKind) {
+        case DESTINATION_NONE:
+            break;
+        case DESTINATION_INLINE:
+            destination = reader.readShortString();
+            break;
+        case DESTINATION_DEFINE: {
+            auto destinationId = reader.read<uint16_t>();
+            destination = reader.readShortString();
+            if (destinationId == 0 || destinationId > MaxInternedDestinations)
+                throw Exception("Invalid destination id");
+            if (m_incomingDestinations.size() < destinationId)
+                m_incomingDestinations.resize(destinationId);
+            m_incomingDestinations[destinationId - 1] = destination;
+            break;
+        }
+        case DESTINATION_REFERENCE: {
+            auto destinationId = reader.read<uint16_t>();
+            if (destinationId == 0 || destinationId > m_incomingDestinations.size() ||
+                m_incomingDestinations[destinationId - 1].empty())
+                throw Exception("Unknown destination id " + int2string(destinationId));
+            destination = m_incomingDestinations[destinationId - 1];
+            break;
+        }
+        default:
+            throw Exception("Invalid destination kind");
+    }
+
+    auto headerCount = reader.read<uint16_t>();
+    Message::Headers headers;
+    headers.reserve(headerCount);
+    for (uint16_t i = 0; i < headerCount; ++i) {
+        auto tag = reader.read<uint8_t>();
+        String name;
+        if (tag == 0) {
+            size_t nameLength = reader.read<uint8_t>();
+            name.assign(reader.take(nameLength), nameLength);
+        } else if (tag < knownHeaderCount)
+            name = knownHeaders[tag];
+        else
+            throw Exception("Invalid header tag");
+        headers.add(move(name), reader.readShortString());
+    }
+
+    // Only MESSAGE has data, that takes the rest of the frame
+    Buffer message;
+    if (messageType == Message::MESSAGE) {
+        auto dataSize = reader.remaining();
+        message.set(reader.take(dataSize), dataSize);
+    }
+
+    outputMessage = make_shared<Message>((Message::Type) messageType, move(message));
+    outputMessage->headers() = move(headers);
+    if (!destination.empty())
+        outputMessage->destination(destination);
 }
 
 bool SMQProtocol::sendMessage(const String& destination, SMessage& message)
 {
-    Buffer output("MSG:", 4);
+    message->destination(destination);
+    return MQProtocol::sendMessage(destination, message);
+}
 
-    if (!socket().active())
-        throw Exception("Not connected");
+void SMQProtocol::sendMessage(const String& destination, const Message& message, QOS qos, uint16_t packetId,
+                              bool duplicate)
+{
+    lock_guard<mutex> lock(m_sendMutex);
+    Buffer frame;
+    appendMessageUnlocked(frame, destination, message, qos, packetId, duplicate);
+    sendFrame(frame);
+}
 
-    // Append message type
-    output.append(message->type());
-    message->destination(destination);
+void SMQProtocol::appendMessage(Buffer& frames, const String& destination, const Message& message, QOS qos,
+                                uint16_t packetId, bool duplicate)
+{
+    lock_guard<mutex> lock(m_sendMutex);
+    appendMessageUnlocked(frames, destination, message, qos, packetId, duplicate);
+}
 
-    Buffer headers;
+void SMQProtocol::appendMessageUnlocked(Buffer& frames, const String& destination, const Message& message, QOS qos,
+                                        uint16_t packetId, bool duplicate)
+{
+    SharedMQFrame frame;
+    if (!m_internDestinations || message.type() != Message::MESSAGE)
+        frame = encodeMessage(destination, message, qos, packetId, duplicate);
+    else {
+        // Destination id is defined by the first message sent to this destination,
+        // and the following messages only refer to it
+        uint16_t destinationId = 0;
+        bool defineDestination = false;
+        auto itor = m_outgoingDestinations.find(destination);
+        if (itor != m_outgoingDestinations.end())
+            destinationId = itor->second;
+        else if (m_outgoingDestinations.size() < MaxInternedDestinations && destination.length() <= 0xFFFF) {
+            destinationId = uint16_t(m_outgoingDestinations.size() + 1);
+            defineDestination = true;
+        }
 
-    headers.append("destination: ", 13);
-    headers.append(destination);
-    headers.append('\n');
+        frame = encodeBinaryMessage(destination, message, qos, packetId, duplicate, destinationId, defineDestination);
 
-    for (auto& itor: message->headers()) {
-        headers.append(itor.first);
-        headers.append(": ", 2);
-        headers.append(itor.second);
-        headers.append('\n');
+        if (defineDestination)
+            m_outgoingDestinations[destination] = destinationId;
     }
 
-    output.append((uint32_t) headers.bytes());
-    output.append(headers.c_str(), headers.bytes());
+    frames.append(frame->c_str(), frame->bytes());
+}
 
-    if (message->type() == Message::MESSAGE || message->type() == Message::SUBSCRIBE) {
-        if (message->destination().empty())
+SharedMQFrame SMQProtocol::encodeMessage(const String& destination, const Message& message, QOS qos,
+                                         uint16_t packetId, bool duplicate) const
+{
+    if (message.type() == Message::MESSAGE || message.type() == Message::SUBSCRIBE) {
+        if (destination.empty())
             throw Exception("Message destination is empty or not defined");
+    }
+
+    // Encoded frames may be shared between connections, so they don't use interned destinations
+    if (m_version >= 2)
+        return encodeBinaryMessage(destination, message, qos, packetId, duplicate, 0, false);
+
+    return encodeTextMessage(destination, message, qos, packetId, duplicate);
+}
+
+SharedMQFrame SMQProtocol::encodeTextMessage(const String& destination, const Message& message, QOS qos,
+                                             uint16_t packetId, bool duplicate) const
+{
+    auto output = make_shared<Buffer>(64 + message.bytes());
+    output->append("MSG:", 4);
+
+    // Append message type
+    output->append(message.type());
+
+    // Reserve space for headers size, and write headers directly into the output
+    size_t headersSizeOffset = output->bytes();
+    output->append((uint32_t) 0);
+
+    output->append("destination: ", 13);
+    output->append(destination);
+    output->append('\n');
+
+    bool isMessage = message.type() == Message::MESSAGE;
+    for (auto& itor: message.headers()) {
+        // Delivery headers of the received message don't apply to this delivery
+        if (isMessage && (itor.first == "qos" || itor.first == "message_id" || itor.first == "dup"))
+            continue;
+        output->append(itor.first);
+        output->append(": ", 2);
+        output->append(itor.second);
+        output->append('\n');
+    }
+
+    if (qos != QOS_0) {
+        String deliveryHeaders("qos: " + int2string(qos) + "\nmessage_id: " + int2string(packetId) + "\n");
+        if (duplicate)
+            deliveryHeaders += "dup: 1\n";
+        output->append(deliveryHeaders);
+    }
+
+    auto headersSize = uint32_t(output->bytes() - headersSizeOffset - sizeof(uint32_t));
+    memcpy(output->data() + headersSizeOffset, &headersSize, sizeof(headersSize));
+
+    if (message.type() == Message::MESSAGE) {
+        output->append((uint32_t) message.bytes());
+        output->append(message.c_str(), message.bytes());
+    }
+
+    return output;
+}
+
+SharedMQFrame SMQProtocol::encodeBinaryMessage(const String& destination, const Message& message, QOS qos,
+                                               uint16_t packetId, bool duplicate,
+                                               uint16_t destinationId, bool defineDestination) const
+{
+    bool isMessage = message.type() == Message::MESSAGE;
+
+    auto output = make_shared<Buffer>(32 + destination.length() + message.bytes());
+    output->append(BinarySignature);
+    output->append(message.type());
 
-        if (message->type() == Message::MESSAGE) {
-            output.append((uint32_t) message->bytes());
-            output.append(message->c_str(), message->bytes());
+    // Reserve space for frame size
+    size_t frameSizeOffset = output->bytes();
+    output->append((uint32_t) 0);
+
+    if (destination.empty())
+        output->append((uint8_t) DESTINATION_NONE);
+    else if (destinationId == 0) {
+        output->append((uint8_t) DESTINATION_INLINE);
+        appendShortString(*output, destination);
+    } else if (defineDestination) {
+        output->append((uint8_t) DESTINATION_DEFINE);
+        output->append(destinationId);
+        appendShortString(*output, destination);
+    } else {
+        output->append((uint8_t) DESTINATION_REFERENCE);
+        output->append(destinationId);
+    }
+
+    // Reserve space for header count
+    size_t headerCountOffset = output->bytes();
+    output->append((uint16_t) 0);
+
+    uint16_t headerCount = 0;
+    for (auto& itor: message.headers()) {
+        // Delivery headers of the received message don't apply to this delivery
+        if (isMessage && (itor.first == "qos" || itor.first == "message_id" || itor.first == "dup"))
+            continue;
+        appendHeader(*output, itor.first, itor.second);
+        ++headerCount;
+    }
+
+    if (qos != QOS_0) {
+        appendHeader(*output, "qos", int2string(qos));
+        appendHeader(*output, "message_id", int2string(packetId));
+        headerCount += 2;
+        if (duplicate) {
+            appendHeader(*output, "dup", "1");
+            ++headerCount;
         }
     }
 
-    socket().write(output);
+    memcpy(output->data() + headerCountOffset, &headerCount, sizeof(headerCount));
 
-    return true;
+    if (isMessage)
+        output->append(message.c_str(), message.bytes());
+
+    auto frameSize = uint32_t(output->bytes() - frameSizeOffset - sizeof(uint32_t));
+    memcpy(output->data() + frameSizeOffset, &frameSize, sizeof(frameSize));
+
+    return output;
+}
+
+SharedMQFrame SMQProtocol::encodeAck(Message::Type sourceMessageType, const vector<uint16_t>& messageIds) const
+{
+    Message::Type ackType;
+    switch (sourceMessageType) {
+        case Message::CONNECT:
+            ackType = Message::CONNECT_ACK;
+            break;
+        case Message::SUBSCRIBE:
+            ackType = Message::SUBSCRIBE_ACK;
+            break;
+        case Message::UNSUBSCRIBE:
+            ackType = Message::UNSUBSCRIBE_ACK;
+            break;
+        case Message::MESSAGE:
+            ackType = Message::PUBLISH_ACK;
+            break;
+        case Message::PING:
+            ackType = Message::PING_ACK;
+            break;
+        default:
+            return nullptr;
+    }
+
+    // A single acknowledgement carries the list of acknowledged message ids
+    Message ackMessage(ackType);
+    if (!messageIds.empty()) {
+        String ids;
+        for (auto messageId: messageIds) {
+            if (!ids.empty())
+                ids += ",";
+            ids += int2string(messageId);
+        }
+        ackMessage.headers()["message_id"] = ids;
+    }
+
+    // Connection acknowledgement confirms negotiated wire format version
+    if (ackType == Message::CONNECT_ACK && m_version > 1)
+        ackMessage.headers()["protocol_version"] = int2string(m_version);
+
+    return encodeMessage("", ackMessage);
+}
+
+uint8_t SMQProtocol::version() const
+{
+    return m_version;
+}
+
+void SMQProtocol::negotiate(const Message& message)
+{
+    auto itor = message.headers().find("protocol_version");
+    int requestedVersion = itor == message.headers().end() ? 1 : string2int(itor->second, 1);
+    if (requestedVersion < 1)
+        requestedVersion = 1;
+    if (requestedVersion > LatestVersion)
+        requestedVersion = LatestVersion;
+
+    if (message.type() == Message::CONNECT)
+        m_version = uint8_t(requestedVersion);
+    else if (message.type() == Message::CONNECT_ACK) {
+        lock_guard<mutex> lock(m_sendMutex);
+        m_version = uint8_t(requestedVersion);
+        m_internDestinations = requestedVersion >= 2;
+        m_outgoingDestinations.clear();
+    }
 }
@@ -0,0 +1,386 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQCluster.cpp - description                           ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQServer.h>
+#include <smq/server/SMQCluster.h>
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+const String SMQCluster::NodeClientIdPrefix("smq-node:");
+
+SMQClusterLink::SMQClusterLink(MQProtocolType protocolType, SMQCluster& cluster, const String& peerNode)
+: SMQClient(protocolType, SMQCluster::NodeClientIdPrefix + cluster.nodeName()),
+  m_cluster(cluster), m_peerNode(peerNode)
+{
+    // Messages are complete when the peer stores or delivers them.
+    // A full pending queue fails the message instead of blocking the caller.
+    setDeliveryQOS(QOS_1);
+    setBatching(DefaultBatchBytes, milliseconds(0), DefaultMaxPendingBytes, milliseconds(0));
+}
+
+void SMQClusterLink::forwardInterest(const String& destination, bool subscribe)
+{
+    auto message = make_shared<Message>(subscribe ? Message::SUBSCRIBE : Message::UNSUBSCRIBE);
+    if (subscribe)
+        (*message)["qos"] = int2string(QOS_1);
+    sendAsync(destination, message, nullptr);
+}
+
+bool SMQClusterLink::previewMessage(SMessage& message)
+{
+    m_cluster.deliverFromPeer(message);
+    return false;
+}
+
+SMQCluster::SMQCluster(SMQServer& server, const Host& node, const vector<Host>& peers,
+                       const String& username, const String& clusterKey)
+: m_server(server), m_nodeName(node.toString(false)), m_username(username), m_password(clusterKey),
+  m_maintenanceTimer(maintenanceTimerCallback)
+{
+    for (auto& peer: peers) {
+        String peerName = peer.toString(false);
+        if (peerName != m_nodeName)
+            m_peers[peerName] = peer;
+    }
+    m_ring.add(m_nodeName);
+}
+
+SMQCluster::~SMQCluster()
+{
+    stop();
+}
+
+void SMQCluster::start(milliseconds interval)
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_maintenanceEvent)
+        m_maintenanceEvent = m_maintenanceTimer.repeat(interval, this);
+}
+
+void SMQCluster::stop()
+{
+    m_maintenanceTimer.cancel();
+
+    map<String, SharedSMQClusterLink> links;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_maintenanceEvent = nullptr;
+        swap(links, m_links);
+        m_ring = SMQHashRing();
+        m_ring.add(m_nodeName);
+    }
+
+    for (auto& itor: links)
+        itor.second->disconnect(true);
+}
+
+void SMQCluster::maintenanceTimerCallback(void* eventData)
+{
+    auto* cluster = (SMQCluster*) eventData;
+    try {
+        cluster->maintain();
+    }
+    catch (const Exception& e) {
+        cluster->m_server.log(LP_ERROR, "Cluster maintenance failed: " + e.message());
+    }
+}
+
+bool SMQCluster::authenticatePeer(const String& username, const String& password) const
+{
+    return username == m_username && password == m_password;
+}
+
+bool SMQCluster::isQueue(const String& destination)
+{
+    return destination.startsWith("/queue/");
+}
+
+SharedSMQClusterLink SMQCluster::linkUnlocked(const String& node) const
+{
+    auto itor = m_links.find(node);
+    if (itor == m_links.end() || !itor->second->connected())
+        return nullptr;
+    return itor->second;
+}
+
+bool SMQCluster::route(SMessage& message)
+{
+    if (!isQueue(message->destination()))
+        return false;
+
+    SharedSMQClusterLink link;
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        String owner = m_ring.owner(message->destination());
+        if (owner == m_nodeName)
+            return false;
+
+        // If the owner just left, the message is delivered here until the ring is rebuilt
+        link = linkUnlocked(owner);
+        if (!link)
+            return false;
+    }
+
+    try {
+        link->sendAsync(message->destination(), message, [this, link](const SMessage& sentMessage, const exception_ptr& error) {
+            if (!error)
+                return;
+            try {
+                rethrow_exception(error);
+            }
+            catch (const exception& e) {
+                m_server.log(LP_WARNING, "Can't forward message to " + link->peerNode() + ": " + String(e.what()));
+            }
+            m_server.distributeMessage(sentMessage, true);
+        });
+    }
+    catch (const Exception& e) {
+        m_server.log(LP_WARNING, "Can't forward message to " + link->peerNode() + ": " + e.message());
+        return false;
+    }
+
+    ++m_forwardedMessages;
+    return true;
+}
+
+void SMQCluster::deliverFromPeer(SMessage& message)
+{
+    ++m_receivedMessages;
+    m_server.deliverLocalMessage(message);
+}
+
+void SMQCluster::forwardInterestUnlocked(const String& destination, bool subscribe)
+{
+    auto forward = [this, &destination, subscribe](const SharedSMQClusterLink& link) {
+        try {
+            link->forwardInterest(destination, subscribe);
+        }
+        catch (const Exception& e) {
+            m_server.log(LP_WARNING, "Can't forward subscription to " + link->peerNode() + ": " + e.message());
+        }
+    };
+
+    if (isQueue(destination)) {
+        // Queue messages are delivered by the owner only
+        auto link = linkUnlocked(m_ring.owner(destination));
+        if (link)
+            forward(link);
+        return;
+    }
+
+    for (auto& itor: m_links) {
+        if (itor.second->connected())
+            forward(itor.second);
+    }
+}
+
+void SMQCluster::subscribe(const map<String, QOS>& destinations)
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (auto& itor: destinations) {
+        if (m_interest.insert(itor.first).second)
+            forwardInterestUnlocked(itor.first, true);
+    }
+}
+
+void SMQCluster::unsubscribe(const String& destination)
+{
+    if (m_server.hasLocalSubscribers(destination))
+        return;
+
+    lock_guard<mutex> lock(m_mutex);
+    if (m_interest.erase(destination) != 0)
+        forwardInterestUnlocked(destination, false);
+}
+
+void SMQCluster::maintain()
+{
+    // Connect peers outside of the lock, so that connection timeouts don't delay routing
+    map<String, Host> disconnectedPeers;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (!m_maintenanceEvent)
+            return;
+        for (auto& itor: m_peers) {
+            if (!linkUnlocked(itor.first))
+                disconnectedPeers.insert(itor);
+        }
+    }
+
+    map<String, SharedSMQClusterLink> connectedLinks;
+    for (auto& itor: disconnectedPeers) {
+        auto link = make_shared<SMQClusterLink>(m_server.protocol(), *this, itor.first);
+        try {
+            link->connect(itor.second, m_username, m_password, false, seconds(1));
+            connectedLinks[itor.first] = link;
+        }
+        catch (const Exception&) {
+            // Peer isn't available yet
+        }
+    }
+
+    // Interest of the destinations without local subscribers is no longer forwarded
+    Strings unusedDestinations;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        for (auto& destination: m_interest) {
+            if (!m_server.hasLocalSubscribers(destination))
+                unusedDestinations.push_back(destination);
+        }
+    }
+    for (auto& destination: unusedDestinations)
+        unsubscribe(destination);
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (!m_maintenanceEvent)
+            return;
+
+        for (auto& itor: connectedLinks)
+            m_links[itor.first] = itor.second;
+
+        set<String> members;
+        members.insert(m_nodeName);
+        for (auto& itor: m_links) {
+            if (itor.second->connected())
+                members.insert(itor.first);
+        }
+
+        set<String> joined;
+        for (auto& itor: connectedLinks)
+            joined.insert(itor.first);
+
+        if (members != m_ring.nodes() || !joined.empty())
+            rebalanceUnlocked(joined);
+    }
+
+    // Handoff waits for the owners to acknowledge the messages, so it's done outside of the lock
+    handoff();
+}
+
+void SMQCluster::rebalanceUnlocked(const set<String>& joined)
+{
+    SMQHashRing previousRing = m_ring;
+
+    m_ring = SMQHashRing();
+    m_ring.add(m_nodeName);
+    Strings memberNames;
+    for (auto& itor: m_links) {
+        if (itor.second->connected()) {
+            m_ring.add(itor.first);
+            memberNames.push_back(itor.first);
+        }
+    }
+    m_server.log(LP_NOTICE, "Cluster members: " + m_nodeName + (memberNames.empty() ? "" : "," + memberNames.join(",")));
+
+    for (auto& destination: m_interest) {
+        if (!isQueue(destination)) {
+            // Topic interest is forwarded to every node that joined
+            for (auto& node: joined) {
+                auto link = linkUnlocked(node);
+                if (link)
+                    link->forwardInterest(destination, true);
+            }
+            continue;
+        }
+
+        // Queue subscription moves to the new owner
+        String previousOwner = previousRing.owner(destination);
+        String owner = m_ring.owner(destination);
+        if (previousOwner != owner && previousOwner != m_nodeName) {
+            auto link = linkUnlocked(previousOwner);
+            if (link)
+                link->forwardInterest(destination, false);
+        }
+        if (owner != m_nodeName && (owner != previousOwner || joined.count(owner) != 0)) {
+            auto link = linkUnlocked(owner);
+            if (link)
+                link->forwardInterest(destination, true);
+        }
+    }
+}
+
+void SMQCluster::handoff()
+{
+    static const seconds acknowledgeTimeout(1);
+
+    auto messageStore = m_server.messageStore();
+    if (!messageStore)
+        return;
+
+    map<String, SharedSMQClusterLink> owners;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        for (auto& destination: messageStore->destinations()) {
+            if (!SMQMessageStore::isDurable(destination))
+                continue;
+            String owner = m_ring.owner(destination);
+            if (owner == m_nodeName || messageStore->pending(destination) == 0)
+                continue;
+            auto link = linkUnlocked(owner);
+            if (link)
+                owners[destination] = link;
+        }
+    }
+
+    for (auto& itor: owners) {
+        auto& link = itor.second;
+        // Message stays in the store until the owner acknowledges it
+        size_t handedOff = messageStore->replay(itor.first, [this, &link](const SMessage& storedMessage) {
+            SMessage message = make_shared<Message>(*storedMessage);
+            try {
+                auto sent = link->sendAsync(message->destination(), message);
+                if (sent.wait_for(acknowledgeTimeout) != future_status::ready)
+                    return false;
+                sent.get();
+            }
+            catch (const Exception&) {
+                return false;
+            }
+            ++m_forwardedMessages;
+            return true;
+        });
+        if (handedOff != 0)
+            m_server.log(LP_NOTICE, "Handed off " + int2string(handedOff) + " messages of " + itor.first + " to " + link->peerNode());
+    }
+}
+
+set<String> SMQCluster::members() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_ring.nodes();
+}
+
+String SMQCluster::owner(const String& queueName) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_ring.owner(queueName);
+}
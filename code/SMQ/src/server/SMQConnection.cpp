@@ -38,8 +38,13 @@ static String clientLogPrefix(const String& clientId)
     return "{" + clientId + "} ";
 }
 
+static size_t heldMessageBytes(const SMessage& message)
+{
+    return message->bytes() + message->destination().length();
+}
+
 SMQConnection::SMQConnection(TCPServer& server, ThreadPool& sendThreadPool, SOCKET connectionSocket, sockaddr_in*, sptk::LogEngine& logEngine, uint8_t debugLogFilter)
-: TCPServerConnection(server, connectionSocket),
+: TCPServerConnection(server, connectionSocket, new MQSharedMemorySocket),
   m_logEngine(logEngine),
   m_debugLogFilter(debugLogFilter),
   m_sendQueue(sendThreadPool, *this)
@@ -48,6 +53,11 @@ SMQConnection::SMQConnection(TCPServer& server, ThreadPool& sendThreadPool, SOCK
     if (smqServer != nullptr) {
         m_protocolType = smqServer->protocol();
         m_protocol = MQProtocol::factory(m_protocolType, socket());
+        m_sendQueue.maxBatchBytes(smqServer->maxSendBatchBytes());
+        m_sendQueue.limits(smqServer->sendQueueLimits());
+        m_sendQueue.stats(&smqServer->m_sendQueueStats);
+        m_deliveryWindow.windowSize(smqServer->deliveryWindowSize());
+        m_deliveryWindow.redeliveryTimeout(smqServer->redeliveryTimeout());
         smqServer->watchSocket(socket(), this);
     }
 }
@@ -64,6 +74,17 @@ SMQConnection::~SMQConnection()
         subscription->removeConnection(this, false);
     m_subscriptions.clear();
 
+    {
+        // Stored messages that the client didn't acknowledge are delivered again
+        lock_guard<mutex> lock(m_deliveryMutex);
+        for (auto& delivery: m_pendingDeliveries) {
+            if (delivery.second)
+                delivery.second(false);
+        }
+        for (auto& itor: m_deliveryCompletions)
+            itor.second(false);
+    }
+
     socket().close();
 
     if (m_debugLogFilter & LOG_SUBSCRIPTIONS) {
@@ -88,10 +109,11 @@ String SMQConnection::clientId() const
     return m_clientId;
 }
 
-void SMQConnection::setupClient(const String& id, const String& lastWillDestination, const String& lastWillMessage)
+void SMQConnection::setupClient(const String& id, bool peer, const String& lastWillDestination, const String& lastWillMessage)
 {
     UniqueLock(m_mutex);
     m_clientId = id;
+    m_peer = peer;
     if (!lastWillDestination.empty())
         m_lastWillMessage = make_shared<MQLastWillMessage>(lastWillDestination, lastWillMessage);
     else
@@ -102,10 +124,142 @@ void SMQConnection::setupClient(const String& id, const String& lastWillDestinat
     }
 }
 
-void SMQConnection::sendMessage(SMessage& message)
+bool SMQConnection::createSharedMemory()
+{
+    auto* sharedMemorySocket = dynamic_cast<MQSharedMemorySocket*>(&socket());
+    if (sharedMemorySocket == nullptr || m_protocolType != MP_SMQ)
+        return false;
+
+    try {
+        // Consumer that stops reading must not hold the send thread forever
+        sharedMemorySocket->writeTimeout(m_sendQueue.limits().writeTimeout);
+        sharedMemorySocket->createSharedMemory();
+        return true;
+    }
+    catch (const Exception& e) {
+        Logger logger(m_logEngine, clientLogPrefix(clientId()));
+        logger.warning("Can't use shared memory transport: " + String(e.what()));
+        return false;
+    }
+}
+
+void SMQConnection::activateSharedMemory()
+{
+    auto* sharedMemorySocket = dynamic_cast<MQSharedMemorySocket*>(&socket());
+    if (sharedMemorySocket != nullptr)
+        sharedMemorySocket->activateSharedMemory();
+}
+
+bool SMQConnection::sendMessage(SMessage& message, const SMQDeliveryCompletion& completion)
+{
+    return m_sendQueue.push(protocol().encodeMessage(message->destination(), *message), false, completion);
+}
+
+void SMQConnection::sendFrame(const SharedMQFrame& frame)
+{
+    m_sendQueue.push(frame);
+}
+
+void SMQConnection::sendControlFrame(const SharedMQFrame& frame)
+{
+    m_sendQueue.push(frame, true);
+}
+
+void SMQConnection::shutdown()
+{
+    Logger logger(m_logEngine, clientLogPrefix(clientId()));
+    logger.warning("Send queue overflow, disconnecting slow consumer");
+
+#ifdef _WIN32
+    ::shutdown(socket().handle(), SD_BOTH);
+#else
+    ::shutdown(socket().handle(), SHUT_RDWR);
+#endif
+}
+
+void SMQConnection::resumePublishers()
+{
+    auto* smqServer = dynamic_cast<SMQServer*>(&server());
+    if (smqServer != nullptr)
+        smqServer->resumePublishers();
+}
+
+bool SMQConnection::sendQueueCongested() const
+{
+    return m_sendQueue.congested();
+}
+
+void SMQConnection::checkSendQueue()
+{
+    if (m_sendQueue.congestionExpired())
+        shutdown();
+}
+
+size_t SMQConnection::bufferedBytes()
+{
+    auto* sharedMemorySocket = dynamic_cast<MQSharedMemorySocket*>(&socket());
+    return sharedMemorySocket != nullptr ? sharedMemorySocket->bufferedBytes() : 0;
+}
+
+bool SMQConnection::sendReliableMessage(const SMessage& message, const SMQDeliveryCompletion& completion)
+{
+    lock_guard<mutex> lock(m_deliveryMutex);
+    // Messages waiting for a free window slot count against the send queue limits
+    if (!m_sendQueue.hold(heldMessageBytes(message)))
+        return false;
+    m_pendingDeliveries.emplace_back(message, completion);
+    sendPendingDeliveries();
+    return true;
+}
+
+void SMQConnection::sendPendingDeliveries()
+{
+    while (!m_pendingDeliveries.empty()) {
+        auto& message = m_pendingDeliveries.front().first;
+        uint16_t packetId;
+        if (!m_deliveryWindow.tryAdd(message->destination(), message, packetId))
+            break;
+        if (m_pendingDeliveries.front().second)
+            m_deliveryCompletions[packetId] = move(m_pendingDeliveries.front().second);
+        m_sendQueue.pushHeld(protocol().encodeMessage(message->destination(), *message, QOS_1, packetId, false),
+                             heldMessageBytes(message));
+        m_pendingDeliveries.pop_front();
+    }
+}
+
+void SMQConnection::acknowledge(uint16_t packetId)
+{
+    lock_guard<mutex> lock(m_deliveryMutex);
+    if (!m_deliveryWindow.acknowledge(packetId))
+        return;
+
+    auto itor = m_deliveryCompletions.find(packetId);
+    if (itor != m_deliveryCompletions.end()) {
+        itor->second(true);
+        m_deliveryCompletions.erase(itor);
+    }
+    sendPendingDeliveries();
+}
+
+void SMQConnection::redeliver()
+{
+    vector<MQDeliveryWindow::Delivery> deliveries;
+    m_deliveryWindow.expired(deliveries);
+
+    for (auto& delivery: deliveries) {
+        m_sendQueue.push(protocol().encodeMessage(delivery.destination, *delivery.message, QOS_1,
+                                                  delivery.packetId, true));
+    }
+
+    if (!deliveries.empty() && (m_debugLogFilter & LOG_MESSAGE_OPS)) {
+        Logger logger(m_logEngine, clientLogPrefix(clientId()));
+        logger.debug("Redelivered " + int2string(uint32_t(deliveries.size())) + " messages");
+    }
+}
+
+size_t SMQConnection::inFlight() const
 {
-    m_sendQueue.push(message);
-    //protocol().sendMessage(message->destination(), message);
+    return m_deliveryWindow.inFlight();
 }
 
 void SMQConnection::subscribe(const String& destination, SMQSubscription* subscription)
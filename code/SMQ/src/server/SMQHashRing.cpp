@@ -0,0 +1,141 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQHashRing.cpp - description                          ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQHashRing.h>
+
+using namespace std;
+using namespace sptk;
+
+SMQHashRing::SMQHashRing(size_t virtualNodes)
+: m_virtualNodes(virtualNodes == 0 ? 1 : virtualNodes)
+{
+}
+
+uint64_t SMQHashRing::hash(const String& data)
+{
+    uint64_t value = 14695981039346656037ULL;
+    for (unsigned char ch: data) {
+        value ^= ch;
+        value *= 1099511628211ULL;
+    }
+    // Mix the bits, so that similar names are spread over the ring
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return value;
+}
+
+void SMQHashRing::add(const String& node)
+{
+    if (!m_nodes.insert(node).second)
+        return;
+    for (size_t i = 0; i < m_virtualNodes; ++i)
+        m_points[hash(node + "#" + int2string(i))] = node;
+}
+
+void SMQHashRing::remove(const String& node)
+{
+    if (m_nodes.erase(node) == 0)
+        return;
+    for (auto itor = m_points.begin(); itor != m_points.end(); ) {
+        if (itor->second == node)
+            itor = m_points.erase(itor);
+        else
+            ++itor;
+    }
+}
+
+String SMQHashRing::owner(const String& key) const
+{
+    if (m_points.empty())
+        return "";
+    auto itor = m_points.lower_bound(hash(key));
+    if (itor == m_points.end())
+        itor = m_points.begin();
+    return itor->second;
+}
+
+#if USE_GTEST
+
+TEST(SPTK_SMQHashRing, owner)
+{
+    SMQHashRing ring;
+    EXPECT_STREQ("", ring.owner("/queue/test").c_str());
+
+    ring.add("node1");
+    ring.add("node2");
+    ring.add("node3");
+
+    map<String, size_t> ownedKeys;
+    for (size_t i = 0; i < 3000; ++i)
+        ownedKeys[ring.owner("/queue/" + int2string(i))]++;
+
+    // Keys are spread over all the nodes
+    EXPECT_EQ(size_t(3), ownedKeys.size());
+    for (auto& itor: ownedKeys)
+        EXPECT_LT(size_t(500), itor.second);
+
+    // The same members give the same owners, regardless of the order they are added
+    SMQHashRing ring2;
+    ring2.add("node3");
+    ring2.add("node1");
+    ring2.add("node2");
+    for (size_t i = 0; i < 100; ++i)
+        EXPECT_STREQ(ring.owner(int2string(i)).c_str(), ring2.owner(int2string(i)).c_str());
+}
+
+TEST(SPTK_SMQHashRing, handoff)
+{
+    SMQHashRing ring;
+    ring.add("node1");
+    ring.add("node2");
+    ring.add("node3");
+
+    map<String, String> owners;
+    for (size_t i = 0; i < 1000; ++i) {
+        String key = "/queue/" + int2string(i);
+        owners[key] = ring.owner(key);
+    }
+
+    // Only the keys of the removed node change their owner
+    ring.remove("node2");
+    for (auto& itor: owners) {
+        String owner = ring.owner(itor.first);
+        if (itor.second == "node2")
+            EXPECT_STRNE("node2", owner.c_str());
+        else
+            EXPECT_STREQ(itor.second.c_str(), owner.c_str());
+    }
+
+    // When the node joins again, it gets the same keys back
+    ring.add("node2");
+    for (auto& itor: owners)
+        EXPECT_STREQ(itor.second.c_str(), ring.owner(itor.first).c_str());
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQMessageStore.cpp - description                      ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQMessageStore.h>
+#include <sptk5/DirectoryDS.h>
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+/**
+ * Convert destination into a directory name, escaping any characters
+ * that aren't safe in file names as %XX
+ */
+static String destinationToDirectoryName(const String& destination)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    String directoryName;
+    for (auto ch: destination) {
+        if (isalnum((unsigned char) ch) || ch == '-' || ch == '_' || (ch == '.' && !directoryName.empty()))
+            directoryName += ch;
+        else {
+            directoryName += '%';
+            directoryName += hexDigits[(unsigned char) ch >> 4];
+            directoryName += hexDigits[(unsigned char) ch & 0xF];
+        }
+    }
+    return directoryName;
+}
+
+static String directoryNameToDestination(const String& directoryName)
+{
+    String destination;
+    for (size_t i = 0; i < directoryName.length(); i++) {
+        if (directoryName[i] == '%' && i + 2 < directoryName.length()) {
+            destination += (char) strtol(directoryName.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else
+            destination += directoryName[i];
+    }
+    return destination;
+}
+
+SMQMessageStore::SMQMessageStore(const String& directory, SMQSyncPolicy syncPolicy, milliseconds syncInterval,
+                                 size_t maxSegmentBytes)
+: m_directory(directory), m_syncPolicy(syncPolicy), m_syncInterval(syncInterval), m_maxSegmentBytes(maxSegmentBytes),
+  m_syncTimer(syncTimerCallback)
+{
+    SMQSegmentLog::createDirectory(m_directory);
+
+    DirectoryDS logDirectories(m_directory, "", DDS_HIDE_FILES | DDS_HIDE_DOT_FILES);
+    logDirectories.open();
+    while (!logDirectories.eof()) {
+        String directoryName = logDirectories["Name"].asString();
+        String destination = directoryNameToDestination(directoryName);
+        m_logs[destination] = make_shared<SMQSegmentLog>(m_directory + "/" + directoryName, destination,
+                                                         m_maxSegmentBytes, m_syncPolicy, m_syncInterval);
+        logDirectories.next();
+    }
+    logDirectories.close();
+
+    // Consumers complete deliveries asynchronously, so consumer offsets are advanced by the timer too
+    m_syncEvent = m_syncTimer.repeat(m_syncInterval, this);
+}
+
+SMQMessageStore::~SMQMessageStore()
+{
+    m_syncTimer.cancel();
+}
+
+void SMQMessageStore::syncTimerCallback(void* eventData)
+{
+    auto* messageStore = (SMQMessageStore*) eventData;
+    messageStore->flush();
+}
+
+bool SMQMessageStore::isDurable(const String& destination)
+{
+    return destination.startsWith("/queue/");
+}
+
+SharedSMQSegmentLog SMQMessageStore::log(const String& destination)
+{
+    {
+        SharedLock(m_mutex);
+        auto itor = m_logs.find(destination);
+        if (itor != m_logs.end())
+            return itor->second;
+    }
+
+    UniqueLock(m_mutex);
+    auto& log = m_logs[destination];
+    if (!log)
+        log = make_shared<SMQSegmentLog>(m_directory + "/" + destinationToDirectoryName(destination), destination,
+                                         m_maxSegmentBytes, m_syncPolicy, m_syncInterval);
+    return log;
+}
+
+size_t SMQMessageStore::store(const String& destination, const SMessage& message, const SMQDeliveryCallback& deliver)
+{
+    auto destinationLog = log(destination);
+    destinationLog->append(message);
+    return destinationLog->deliver(deliver);
+}
+
+void SMQMessageStore::append(const String& destination, const SMessage& message)
+{
+    log(destination)->append(message);
+}
+
+size_t SMQMessageStore::store(const String& destination, const SMessage& message,
+                              const SMQAcknowledgedDeliveryCallback& deliver)
+{
+    auto destinationLog = log(destination);
+    destinationLog->append(message);
+    return destinationLog->deliver(deliver);
+}
+
+size_t SMQMessageStore::replay(const String& destination, const SMQDeliveryCallback& deliver)
+{
+    SharedSMQSegmentLog destinationLog;
+    {
+        SharedLock(m_mutex);
+        auto itor = m_logs.find(destination);
+        if (itor == m_logs.end())
+            return 0;
+        destinationLog = itor->second;
+    }
+    return destinationLog->deliver(deliver);
+}
+
+size_t SMQMessageStore::replay(const String& destination, const SMQAcknowledgedDeliveryCallback& deliver)
+{
+    SharedSMQSegmentLog destinationLog;
+    {
+        SharedLock(m_mutex);
+        auto itor = m_logs.find(destination);
+        if (itor == m_logs.end())
+            return 0;
+        destinationLog = itor->second;
+    }
+    return destinationLog->deliver(deliver);
+}
+
+bool SMQMessageStore::hasLostMessages(const String& destination) const
+{
+    SharedSMQSegmentLog destinationLog;
+    {
+        SharedLock(m_mutex);
+        auto itor = m_logs.find(destination);
+        if (itor == m_logs.end())
+            return false;
+        destinationLog = itor->second;
+    }
+    return destinationLog->hasLostMessages();
+}
+
+size_t SMQMessageStore::pending(const String& destination) const
+{
+    SharedLock(m_mutex);
+    auto itor = m_logs.find(destination);
+    if (itor == m_logs.end())
+        return 0;
+    return itor->second->pending();
+}
+
+void SMQMessageStore::flush()
+{
+    SharedLock(m_mutex);
+    for (auto& itor: m_logs)
+        itor.second->flush();
+}
+
+void SMQMessageStore::sync()
+{
+    SharedLock(m_mutex);
+    for (auto& itor: m_logs)
+        itor.second->sync();
+}
+
+Strings SMQMessageStore::destinations() const
+{
+    SharedLock(m_mutex);
+    Strings destinations;
+    for (auto& itor: m_logs)
+        destinations.push_back(itor.first);
+    return destinations;
+}
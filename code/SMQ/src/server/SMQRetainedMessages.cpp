@@ -0,0 +1,341 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQRetainedMessages.cpp - description                  ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQRetainedMessages.h>
+#include <smq/server/SMQTopicTrie.h>
+
+using namespace std;
+using namespace sptk;
+
+const String SMQRetainedMessages::StoreDestination("$retained");
+
+bool SMQRetainedMessages::isRetained(const Message& message)
+{
+    auto itor = message.headers().find("retain");
+    return itor != message.headers().end() && string2int(itor->second) != 0;
+}
+
+SMQRetainedMessages::SMQRetainedMessages(const SMQRetainedLimits& limits)
+: m_limits(limits)
+{
+}
+
+SMQRetainedLimits SMQRetainedMessages::limits() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_limits;
+}
+
+void SMQRetainedMessages::limits(const SMQRetainedLimits& limits)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_limits = limits;
+    while (!m_lru.empty() && ((m_limits.maxBytes != 0 && m_bytes > m_limits.maxBytes) ||
+                              (m_limits.maxMessages != 0 && m_messages.size() > m_limits.maxMessages))) {
+        removeUnlocked(m_messages.find(m_lru.back()));
+        ++m_evicted;
+    }
+}
+
+size_t SMQRetainedMessages::messageBytes(const String& topic, const Message& message)
+{
+    size_t bytes = sizeof(Entry) + topic.length() * 2 + message.bytes();
+    for (auto& itor: message.headers())
+        bytes += itor.first.length() + itor.second.length();
+    return bytes;
+}
+
+void SMQRetainedMessages::removeUnlocked(map<String, Entry>::iterator itor)
+{
+    m_bytes -= itor->second.bytes;
+    m_lru.erase(itor->second.lru);
+    m_messages.erase(itor);
+}
+
+bool SMQRetainedMessages::storeUnlocked(const String& topic, const SMessage& message)
+{
+    size_t bytes = messageBytes(topic, *message);
+    if (m_limits.maxBytes != 0 && bytes > m_limits.maxBytes)
+        return false;
+
+    auto existing = m_messages.find(topic);
+    bool replaces = existing != m_messages.end();
+    size_t replacedBytes = replaces ? existing->second.bytes : 0;
+    size_t newMessages = replaces ? 0 : 1;
+
+    // Evict least recently used messages of other topics, until the message fits
+    while ((m_limits.maxBytes != 0 && m_bytes - replacedBytes + bytes > m_limits.maxBytes) ||
+           (m_limits.maxMessages != 0 && m_messages.size() + newMessages > m_limits.maxMessages)) {
+        if (!m_limits.evictLRU || m_lru.size() <= (replaces ? 1 : 0))
+            return false;
+        auto victim = prev(m_lru.end());
+        if (*victim == topic)
+            --victim;
+        removeUnlocked(m_messages.find(*victim));
+        ++m_evicted;
+    }
+
+    if (replaces) {
+        m_bytes -= existing->second.bytes;
+        existing->second.message = message;
+        existing->second.bytes = bytes;
+        m_lru.splice(m_lru.begin(), m_lru, existing->second.lru);
+    } else {
+        m_lru.push_front(topic);
+        m_messages[topic] = Entry {message, bytes, m_lru.begin()};
+    }
+    m_bytes += bytes;
+
+    return true;
+}
+
+void SMQRetainedMessages::persistUnlocked(const String& topic, const SMessage& message)
+{
+    if (!m_messageStore)
+        return;
+
+    // Store log has its own destination, so the topic is kept in a header
+    auto record = make_shared<Message>(*message);
+    record->headers()["destination"] = topic;
+    m_messageStore->append(StoreDestination, record);
+
+    if (m_messageStore->pending(StoreDestination) > m_messages.size() * 2 + 1024)
+        compactUnlocked();
+}
+
+void SMQRetainedMessages::compactUnlocked()
+{
+    // Current messages are appended before the old records are consumed,
+    // so the log always holds every retained message
+    size_t staleRecords = m_messageStore->pending(StoreDestination);
+    for (auto& itor: m_messages) {
+        auto record = make_shared<Message>(*itor.second.message);
+        record->headers()["destination"] = itor.first;
+        m_messageStore->append(StoreDestination, record);
+    }
+
+    size_t consumed = 0;
+    m_messageStore->replay(StoreDestination, [&consumed, staleRecords](const SMessage&) {
+        return consumed++ < staleRecords;
+    });
+}
+
+bool SMQRetainedMessages::retain(const SMessage& message)
+{
+    const String& topic = message->destination();
+    if (topic.empty())
+        return false;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    // Message with empty payload removes retained message
+    if (message->empty()) {
+        auto itor = m_messages.find(topic);
+        if (itor != m_messages.end()) {
+            removeUnlocked(itor);
+            persistUnlocked(topic, message);
+        }
+        return true;
+    }
+
+    // Retained message is a copy, since delivered message loses its retain flag
+    auto retainedMessage = make_shared<Message>(*message);
+    retainedMessage->headers()["retain"] = "1";
+    if (!storeUnlocked(topic, retainedMessage)) {
+        ++m_rejected;
+        return false;
+    }
+    persistUnlocked(topic, retainedMessage);
+
+    return true;
+}
+
+void SMQRetainedMessages::match(const String& topicFilter, vector<SMessage>& messages)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto itor = m_messages.find(topicFilter);
+    if (itor != m_messages.end()) {
+        messages.push_back(itor->second.message);
+        m_lru.splice(m_lru.begin(), m_lru, itor->second.lru);
+        return;
+    }
+
+    if (topicFilter.find_first_of("+#") == string::npos)
+        return;
+
+    for (auto& entry: m_messages) {
+        if (SMQTopicTrie::matches(topicFilter, entry.first)) {
+            messages.push_back(entry.second.message);
+            m_lru.splice(m_lru.begin(), m_lru, entry.second.lru);
+        }
+    }
+}
+
+void SMQRetainedMessages::messageStore(const SharedSMQMessageStore& messageStore)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_messageStore = messageStore;
+    if (!m_messageStore || m_messageStore->pending(StoreDestination) == 0)
+        return;
+
+    // Stored records are read in order, so the last record of every topic wins
+    m_messageStore->replay(StoreDestination, [this](const SMessage& record) {
+        auto message = make_shared<Message>(*record);
+        auto itor = message->headers().find("destination");
+        if (itor == message->headers().end())
+            return true;
+        String topic = itor->second;
+        message->headers().erase(itor);
+        message->destination(topic);
+        if (message->empty()) {
+            auto existing = m_messages.find(topic);
+            if (existing != m_messages.end())
+                removeUnlocked(existing);
+        } else if (!storeUnlocked(topic, message))
+            ++m_rejected;
+        return true;
+    });
+
+    // Replayed records are consumed, so current messages are stored again
+    for (auto& itor: m_messages) {
+        auto record = make_shared<Message>(*itor.second.message);
+        record->headers()["destination"] = itor.first;
+        m_messageStore->append(StoreDestination, record);
+    }
+    m_messageStore->sync();
+}
+
+void SMQRetainedMessages::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_messages.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+size_t SMQRetainedMessages::size() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_messages.size();
+}
+
+size_t SMQRetainedMessages::bytes() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+size_t SMQRetainedMessages::evicted() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_evicted;
+}
+
+size_t SMQRetainedMessages::rejected() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_rejected;
+}
+
+#if USE_GTEST
+
+static SMessage retainedMessage(const String& topic, const String& data)
+{
+    auto message = make_shared<Message>(Message::MESSAGE, Buffer(data));
+    message->destination(topic);
+    message->headers()["retain"] = "1";
+    return message;
+}
+
+static Strings matchRetained(SMQRetainedMessages& retainedMessages, const String& topicFilter)
+{
+    vector<SMessage> messages;
+    retainedMessages.match(topicFilter, messages);
+    Strings result;
+    for (auto& message: messages)
+        result.push_back(message->destination() + "=" + message->c_str());
+    result.sort();
+    return result;
+}
+
+TEST(SPTK_SMQRetainedMessages, retain)
+{
+    SMQRetainedMessages retainedMessages;
+
+    retainedMessages.retain(retainedMessage("/sensors/1/temperature", "20"));
+    retainedMessages.retain(retainedMessage("/sensors/2/temperature", "21"));
+    retainedMessages.retain(retainedMessage("/sensors/1/temperature", "22"));
+    EXPECT_EQ(size_t(2), retainedMessages.size());
+
+    EXPECT_STREQ("/sensors/1/temperature=22", matchRetained(retainedMessages, "/sensors/1/temperature").join(",").c_str());
+    EXPECT_STREQ("/sensors/1/temperature=22,/sensors/2/temperature=21",
+                 matchRetained(retainedMessages, "/sensors/+/temperature").join(",").c_str());
+    EXPECT_STREQ("", matchRetained(retainedMessages, "/sensors/3/temperature").join(",").c_str());
+
+    // Empty payload removes retained message
+    retainedMessages.retain(retainedMessage("/sensors/1/temperature", ""));
+    EXPECT_STREQ("/sensors/2/temperature=21", matchRetained(retainedMessages, "/sensors/#").join(",").c_str());
+}
+
+TEST(SPTK_SMQRetainedMessages, limits)
+{
+    SMQRetainedLimits limits;
+    limits.maxMessages = 2;
+    SMQRetainedMessages retainedMessages(limits);
+
+    retainedMessages.retain(retainedMessage("/topic/1", "1"));
+    retainedMessages.retain(retainedMessage("/topic/2", "2"));
+    matchRetained(retainedMessages, "/topic/1");                 // Topic 2 is now least recently used
+    retainedMessages.retain(retainedMessage("/topic/3", "3"));
+
+    EXPECT_STREQ("/topic/1=1,/topic/3=3", matchRetained(retainedMessages, "/topic/#").join(",").c_str());
+    EXPECT_EQ(size_t(1), retainedMessages.evicted());
+
+    // Without LRU eviction, messages for new topics are rejected, but existing topics are updated
+    limits.evictLRU = false;
+    retainedMessages.limits(limits);
+    EXPECT_FALSE(retainedMessages.retain(retainedMessage("/topic/4", "4")));
+    EXPECT_TRUE(retainedMessages.retain(retainedMessage("/topic/3", "33")));
+    EXPECT_STREQ("/topic/1=1,/topic/3=33", matchRetained(retainedMessages, "/topic/#").join(",").c_str());
+    EXPECT_EQ(size_t(1), retainedMessages.rejected());
+
+    // Memory cap evicts the oldest messages
+    limits.maxMessages = 0;
+    limits.maxBytes = 1024;
+    limits.evictLRU = true;
+    retainedMessages.limits(limits);
+    for (int i = 0; i < 100; ++i)
+        retainedMessages.retain(retainedMessage("/topic/" + int2string(i), String(100, 'x')));
+    EXPECT_GE(size_t(1024), retainedMessages.bytes());
+    EXPECT_LT(size_t(0), retainedMessages.size());
+    EXPECT_EQ(size_t(1), matchRetained(retainedMessages, "/topic/99").size());
+}
+
+#endif
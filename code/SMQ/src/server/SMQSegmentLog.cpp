@@ -0,0 +1,910 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQSegmentLog.cpp - description                        ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQSegmentLog.h>
+#include <sptk5/SystemException.h>
+#include <sptk5/DirectoryDS.h>
+#include <sptk5/Printer.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <io.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+namespace {
+
+const char* segmentFileExtension = ".seg";
+const char* consumerOffsetFileName = "consumer.offset";
+
+/**
+ * Stored message record header, followed by encoded message
+ */
+struct RecordHeader
+{
+    uint32_t    size;       ///< Encoded message size
+    uint32_t    checksum;   ///< Checksum of offset and encoded message
+    uint64_t    offset;     ///< Message offset
+};
+
+uint32_t recordChecksum(uint64_t offset, const char* data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    auto mix = [&hash](const char* ptr, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            hash ^= uint8_t(ptr[i]);
+            hash *= 16777619U;
+        }
+    };
+    mix((const char*) &offset, sizeof(offset));
+    mix(data, size);
+    return hash;
+}
+
+void encodeMessage(const Message& message, Buffer& output)
+{
+    output.append((uint8_t) message.type());
+    output.append((uint16_t) message.headers().size());
+    for (auto& itor: message.headers()) {
+        output.append((uint16_t) itor.first.length());
+        output.append(itor.first);
+        output.append((uint32_t) itor.second.length());
+        output.append(itor.second);
+    }
+    if (message.bytes() > 0)
+        output.append(message.c_str(), message.bytes());
+}
+
+SMessage decodeMessage(const char* data, size_t size, const String& destination)
+{
+    const char* ptr = data;
+    const char* end = data + size;
+
+    auto get = [&ptr, end](void* value, size_t length) {
+        if (ptr + length > end)
+            throw Exception("Corrupted message record");
+        memcpy(value, ptr, length);
+        ptr += length;
+    };
+
+    auto getString = [&ptr, end](size_t length) {
+        if (ptr + length > end)
+            throw Exception("Corrupted message record");
+        String value(ptr, length);
+        ptr += length;
+        return value;
+    };
+
+    uint8_t type;
+    uint16_t headerCount;
+    get(&type, sizeof(type));
+    get(&headerCount, sizeof(headerCount));
+
+    auto message = make_shared<Message>((Message::Type) type);
+    for (uint16_t i = 0; i < headerCount; i++) {
+        uint16_t nameLength;
+        uint32_t valueLength;
+        get(&nameLength, sizeof(nameLength));
+        String name = getString(nameLength);
+        get(&valueLength, sizeof(valueLength));
+        message->headers()[name] = getString(valueLength);
+    }
+    message->set(ptr, size_t(end - ptr));
+    message->destination(destination);
+
+    return message;
+}
+
+/**
+ * Validate record at position
+ * @return record size including header, or 0 if there is no valid record at position
+ */
+size_t validRecord(const char* data, size_t size, size_t position, uint64_t expectedOffset)
+{
+    RecordHeader header {};
+    if (position + sizeof(header) > size)
+        return 0;
+    memcpy(&header, data + position, sizeof(header));
+    if (header.offset != expectedOffset || position + sizeof(header) + header.size > size)
+        return 0;
+    if (recordChecksum(header.offset, data + position + sizeof(header), header.size) != header.checksum)
+        return 0;
+    return sizeof(header) + header.size;
+}
+
+/**
+ * Read-only view of a segment file
+ */
+class SegmentMapping
+{
+    const char*     m_data {nullptr};
+    size_t          m_size {0};
+#ifdef _WIN32
+    Buffer          m_buffer;
+#endif
+
+public:
+    SegmentMapping(const String& fileName, size_t size)
+    {
+        if (size == 0)
+            return;
+#ifdef _WIN32
+        m_buffer.loadFromFile(fileName);
+        m_data = m_buffer.data();
+        m_size = min(size, m_buffer.bytes());
+#else
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw SystemException("Can't open segment " + fileName);
+        void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw SystemException("Can't map segment " + fileName);
+        madvise(data, size, MADV_SEQUENTIAL);
+        m_data = (const char*) data;
+        m_size = size;
+#endif
+    }
+
+    SegmentMapping(const SegmentMapping&) = delete;
+    SegmentMapping& operator = (const SegmentMapping&) = delete;
+
+    ~SegmentMapping()
+    {
+#ifndef _WIN32
+        if (m_data != nullptr)
+            munmap((void*) m_data, m_size);
+#endif
+    }
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+void dataSync(int fd)
+{
+    if (fd < 0)
+        return;
+#if defined(_WIN32)
+    _commit(fd);
+#elif defined(__APPLE__)
+    fsync(fd);
+#else
+    fdatasync(fd);
+#endif
+}
+
+void syncDirectory(const String& directory)
+{
+#ifndef _WIN32
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#endif
+}
+
+void truncateFile(int fd, size_t size)
+{
+#ifdef _WIN32
+    int rc = _chsize(fd, (long) size);
+#else
+    int rc = ftruncate(fd, (off_t) size);
+#endif
+    if (rc != 0)
+        throw SystemException("Can't truncate segment");
+}
+
+void writeAll(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        auto bytes = ::write(fd, data, (unsigned) size);
+        if (bytes <= 0)
+            throw SystemException("Can't write to segment");
+        data += bytes;
+        size -= size_t(bytes);
+    }
+}
+
+void writeAt(int fd, const char* data, size_t size, size_t position)
+{
+#ifdef _WIN32
+    if (_lseek(fd, (long) position, SEEK_SET) != (long) position)
+        throw SystemException("Can't seek in file");
+    writeAll(fd, data, size);
+#else
+    if (pwrite(fd, data, size, (off_t) position) != (ssize_t) size)
+        throw SystemException("Can't write to file");
+#endif
+}
+
+String segmentFileName(const String& directory, uint64_t firstOffset)
+{
+    stringstream name;
+    name << directory << "/" << setw(20) << setfill('0') << firstOffset << segmentFileExtension;
+    return name.str();
+}
+
+size_t fileSize(const String& fileName)
+{
+    struct stat st = {};
+    if (stat(fileName.c_str(), &st) != 0)
+        throw SystemException("Can't stat '" + fileName + "'");
+    return size_t(st.st_size);
+}
+
+} // namespace
+
+void SMQSegmentLog::createDirectory(const String& directory)
+{
+    struct stat st = {};
+    if (stat(directory.c_str(), &st) == 0) {
+        if ((st.st_mode & S_IFDIR) == 0)
+            throw Exception("'" + directory + "' isn't a directory");
+        return;
+    }
+#ifdef _WIN32
+    if (mkdir(directory.c_str()) != 0)
+#else
+    if (mkdir(directory.c_str(), 0770) != 0)
+#endif
+        throw SystemException("Can't create directory '" + directory + "'");
+}
+
+SMQSegmentLog::SMQSegmentLog(const String& directory, const String& destination, size_t maxSegmentBytes,
+                             SMQSyncPolicy syncPolicy, milliseconds syncInterval)
+: m_directory(directory), m_destination(destination), m_maxSegmentBytes(maxSegmentBytes),
+  m_syncPolicy(syncPolicy), m_syncInterval(syncInterval), m_lastSync(steady_clock::now()),
+  m_completions(make_shared<Completions>())
+{
+    open();
+}
+
+SMQSegmentLog::~SMQSegmentLog()
+{
+    lock_guard<mutex> lock(m_mutex);
+    try {
+        applyCompletions();
+        syncUnlocked(true);
+    }
+    catch (const Exception&) {
+        // Destructor shouldn't throw
+    }
+    if (m_segmentFile >= 0)
+        ::close(m_segmentFile);
+    if (m_offsetFile >= 0)
+        ::close(m_offsetFile);
+}
+
+void SMQSegmentLog::open()
+{
+    createDirectory(m_directory);
+
+    DirectoryDS directory(m_directory, String("*") + segmentFileExtension, DDS_HIDE_DIRECTORIES | DDS_HIDE_DOT_FILES);
+    directory.open();
+    while (!directory.eof()) {
+        String fileName = directory["Name"].asString();
+        uint64_t firstOffset = strtoull(fileName.c_str(), nullptr, 10);
+        String fullName = m_directory + "/" + fileName;
+        m_segments.push_back({firstOffset, fullName, fileSize(fullName)});
+        directory.next();
+    }
+    directory.close();
+
+    sort(m_segments.begin(), m_segments.end(),
+         [](const Segment& a, const Segment& b) { return a.firstOffset < b.firstOffset; });
+
+    if (m_segments.empty())
+        startSegment();
+    else {
+        // Only the last segment may have a torn tail: previous segments are synced before the next one is started
+        recoverSegment(m_segments.back());
+        m_segmentFile = ::open(m_segments.back().fileName.c_str(), O_WRONLY | O_APPEND);
+        if (m_segmentFile < 0)
+            throw SystemException("Can't open segment " + m_segments.back().fileName);
+    }
+
+    String offsetFileName = m_directory + "/" + consumerOffsetFileName;
+    m_offsetFile = ::open(offsetFileName.c_str(), O_RDWR | O_CREAT, 0660);
+    if (m_offsetFile < 0)
+        throw SystemException("Can't open " + offsetFileName);
+
+    uint64_t storedOffset = 0;
+    if (::read(m_offsetFile, &storedOffset, sizeof(storedOffset)) == sizeof(storedOffset))
+        m_consumerOffset = storedOffset;
+
+    // Consumer offset may point to compacted segments, or past the recovered tail
+    m_consumerOffset = max(m_consumerOffset, m_segments.front().firstOffset);
+    m_consumerOffset = min(m_consumerOffset, m_nextOffset);
+
+    // Messages dispatched before restart, that weren't consumed, are dispatched again
+    m_dispatchOffset = m_consumerOffset;
+    locateDispatchOffset();
+}
+
+void SMQSegmentLog::recoverSegment(Segment& segment)
+{
+    SegmentMapping mapping(segment.fileName, segment.bytes);
+
+    size_t position = 0;
+    uint64_t offset = segment.firstOffset;
+    while (true) {
+        size_t recordBytes = validRecord(mapping.data(), mapping.size(), position, offset);
+        if (recordBytes == 0)
+            break;
+        position += recordBytes;
+        offset++;
+    }
+
+    if (position < segment.bytes) {
+        int fd = ::open(segment.fileName.c_str(), O_WRONLY);
+        if (fd < 0)
+            throw SystemException("Can't open segment " + segment.fileName);
+        truncateFile(fd, position);
+        dataSync(fd);
+        ::close(fd);
+        segment.bytes = position;
+    }
+
+    m_nextOffset = offset;
+}
+
+void SMQSegmentLog::locateDispatchOffset()
+{
+    // Find the last segment that starts at or before dispatch offset
+    m_readSegment = 0;
+    for (size_t i = 1; i < m_segments.size(); i++) {
+        if (m_segments[i].firstOffset > m_dispatchOffset)
+            break;
+        m_readSegment = i;
+    }
+
+    const auto& segment = m_segments[m_readSegment];
+    SegmentMapping mapping(segment.fileName, segment.bytes);
+
+    m_readPosition = 0;
+    for (uint64_t offset = segment.firstOffset; offset < m_dispatchOffset; offset++) {
+        size_t recordBytes = validRecord(mapping.data(), mapping.size(), m_readPosition, offset);
+        if (recordBytes == 0)
+            throw Exception("Corrupted segment " + segment.fileName);
+        m_readPosition += recordBytes;
+    }
+}
+
+void SMQSegmentLog::startSegment()
+{
+    if (m_segmentFile >= 0) {
+        dataSync(m_segmentFile);
+        ::close(m_segmentFile);
+        m_segmentFile = -1;
+    }
+
+    Segment segment {m_nextOffset, segmentFileName(m_directory, m_nextOffset), 0};
+    m_segmentFile = ::open(segment.fileName.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC, 0660);
+    if (m_segmentFile < 0)
+        throw SystemException("Can't create segment " + segment.fileName);
+    m_segments.push_back(segment);
+
+    if (m_syncPolicy != SYNC_NEVER)
+        syncDirectory(m_directory);
+}
+
+uint64_t SMQSegmentLog::append(const SMessage& message)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_record.checkSize(sizeof(RecordHeader) + 64 + message->bytes());
+    m_record.bytes(sizeof(RecordHeader));
+    encodeMessage(*message, m_record);
+
+    RecordHeader header {};
+    header.size = uint32_t(m_record.bytes() - sizeof(RecordHeader));
+    header.offset = m_nextOffset;
+    header.checksum = recordChecksum(header.offset, m_record.data() + sizeof(RecordHeader), header.size);
+    memcpy(m_record.data(), &header, sizeof(header));
+
+    if (m_segments.back().bytes > 0 && m_segments.back().bytes + m_record.bytes() > m_maxSegmentBytes)
+        startSegment();
+
+    auto& segment = m_segments.back();
+    try {
+        writeAll(m_segmentFile, m_record.data(), m_record.bytes());
+    }
+    catch (const Exception&) {
+        // Don't leave a partial record in the middle of the segment
+        truncateFile(m_segmentFile, segment.bytes);
+        throw;
+    }
+    segment.bytes += m_record.bytes();
+
+    m_lastMessage = message;
+    m_dirty = true;
+    syncUnlocked(m_syncPolicy == SYNC_ALWAYS);
+
+    return m_nextOffset++;
+}
+
+void SMQSegmentLog::normalizeReadPosition()
+{
+    while (m_readSegment + 1 < m_segments.size() && m_readPosition >= m_segments[m_readSegment].bytes) {
+        m_readSegment++;
+        m_readPosition = 0;
+    }
+}
+
+void SMQSegmentLog::advance(size_t recordBytes)
+{
+    m_readPosition += recordBytes;
+    m_dispatchOffset++;
+}
+
+size_t SMQSegmentLog::readRecords(size_t maxMessages, vector<pair<SMessage,size_t>>& records)
+{
+    normalizeReadPosition();
+
+    const auto& segment = m_segments[m_readSegment];
+    SegmentMapping mapping(segment.fileName, segment.bytes);
+
+    size_t position = m_readPosition;
+    uint64_t offset = m_dispatchOffset;
+    while (records.size() < maxMessages && offset < m_nextOffset && position < mapping.size()) {
+        size_t recordBytes = validRecord(mapping.data(), mapping.size(), position, offset);
+        if (recordBytes == 0)
+            throw Exception("Corrupted segment " + segment.fileName);
+        auto message = decodeMessage(mapping.data() + position + sizeof(RecordHeader),
+                                     recordBytes - sizeof(RecordHeader), m_destination);
+        records.emplace_back(message, recordBytes);
+        position += recordBytes;
+        offset++;
+    }
+
+    return records.size();
+}
+
+size_t SMQSegmentLog::deliver(const SMQDeliveryCallback& deliver)
+{
+    return this->deliver([&deliver](const SMessage& message, const SMQDeliveryCompletion& completion) {
+        if (!deliver(message))
+            return false;
+        completion(true);
+        return true;
+    });
+}
+
+size_t SMQSegmentLog::deliver(const SMQAcknowledgedDeliveryCallback& deliver)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    applyCompletions();
+    m_lost = false;
+
+    auto completions = m_completions;
+    auto dispatch = [&deliver, &completions](const SMessage& message, uint64_t offset) {
+        return deliver(message, [completions, offset](bool delivered) {
+            lock_guard<mutex> lock(completions->mutex);
+            if (delivered)
+                completions->delivered.push_back(offset);
+            else
+                completions->lost.push_back(offset);
+        });
+    };
+
+    size_t dispatched = 0;
+
+    if (m_dispatchOffset + 1 == m_nextOffset && m_lastMessage) {
+        // The only undispatched message is the last appended one, it's still in memory
+        if (dispatch(m_lastMessage, m_dispatchOffset)) {
+            m_inFlight.insert(m_dispatchOffset);
+            m_dispatchOffset = m_nextOffset;
+            m_readSegment = m_segments.size() - 1;
+            m_readPosition = m_segments.back().bytes;
+            dispatched++;
+        }
+    } else {
+        vector<pair<SMessage,size_t>> records;
+        bool stopped = false;
+        while (!stopped && m_dispatchOffset < m_nextOffset) {
+            records.clear();
+            if (readRecords(1024, records) == 0)
+                break;
+            for (auto& record: records) {
+                // After a lost message is dispatched again, the messages that followed it may still be in flight
+                uint64_t offset = m_dispatchOffset;
+                if (m_inFlight.count(offset) == 0 && m_acknowledged.count(offset) == 0) {
+                    if (!dispatch(record.first, offset)) {
+                        stopped = true;
+                        break;
+                    }
+                    m_inFlight.insert(offset);
+                    dispatched++;
+                }
+                advance(record.second);
+            }
+        }
+    }
+
+    m_lastMessage.reset();
+
+    // Callback may have completed the delivery already
+    applyCompletions();
+    syncUnlocked(m_syncPolicy == SYNC_ALWAYS);
+
+    return dispatched;
+}
+
+void SMQSegmentLog::applyCompletions()
+{
+    vector<uint64_t> delivered;
+    vector<uint64_t> lost;
+    {
+        lock_guard<mutex> lock(m_completions->mutex);
+        swap(delivered, m_completions->delivered);
+        swap(lost, m_completions->lost);
+    }
+
+    for (auto offset: delivered) {
+        if (m_inFlight.erase(offset) != 0)
+            m_acknowledged.insert(offset);
+    }
+
+    uint64_t rewindOffset = m_dispatchOffset;
+    for (auto offset: lost) {
+        if (m_inFlight.erase(offset) != 0)
+            rewindOffset = min(rewindOffset, offset);
+    }
+    if (rewindOffset < m_dispatchOffset) {
+        m_dispatchOffset = rewindOffset;
+        locateDispatchOffset();
+        m_lost = true;
+    }
+
+    uint64_t consumerOffset = m_consumerOffset;
+    while (!m_acknowledged.empty() && *m_acknowledged.begin() == m_consumerOffset) {
+        m_acknowledged.erase(m_acknowledged.begin());
+        m_consumerOffset++;
+    }
+
+    if (m_consumerOffset != consumerOffset) {
+        storeConsumerOffset();
+        compact();
+    }
+}
+
+bool SMQSegmentLog::hasLostMessages()
+{
+    lock_guard<mutex> lock(m_mutex);
+    applyCompletions();
+    return m_lost;
+}
+
+void SMQSegmentLog::storeConsumerOffset()
+{
+    writeAt(m_offsetFile, (const char*) &m_consumerOffset, sizeof(m_consumerOffset), 0);
+    m_dirty = true;
+}
+
+void SMQSegmentLog::compact()
+{
+    normalizeReadPosition();
+
+    // Segment is consumed when the next segment starts at or before consumer offset.
+    // Dispatch offset is never behind consumer offset, so the read segment is never removed.
+    size_t consumedSegments = 0;
+    while (consumedSegments + 1 < m_segments.size() && m_segments[consumedSegments + 1].firstOffset <= m_consumerOffset)
+        consumedSegments++;
+    if (consumedSegments == 0)
+        return;
+
+    // Consumer offset must be durable before the segments it replaces are deleted
+    dataSync(m_offsetFile);
+
+    for (size_t i = 0; i < consumedSegments; i++) {
+        if (remove(m_segments[i].fileName.c_str()) != 0)
+            throw SystemException("Can't remove segment " + m_segments[i].fileName);
+    }
+    m_segments.erase(m_segments.begin(), m_segments.begin() + long(consumedSegments));
+    m_readSegment -= consumedSegments;
+}
+
+void SMQSegmentLog::syncUnlocked(bool force)
+{
+    if (!m_dirty)
+        return;
+
+    auto now = steady_clock::now();
+    if (!force && (m_syncPolicy != SYNC_PERIODIC || now - m_lastSync < m_syncInterval))
+        return;
+
+    dataSync(m_segmentFile);
+    dataSync(m_offsetFile);
+    m_lastSync = now;
+    m_dirty = false;
+}
+
+void SMQSegmentLog::flush()
+{
+    lock_guard<mutex> lock(m_mutex);
+    applyCompletions();
+    syncUnlocked(false);
+}
+
+void SMQSegmentLog::sync()
+{
+    lock_guard<mutex> lock(m_mutex);
+    applyCompletions();
+    syncUnlocked(true);
+}
+
+uint64_t SMQSegmentLog::consumerOffset() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_consumerOffset;
+}
+
+uint64_t SMQSegmentLog::nextOffset() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_nextOffset;
+}
+
+size_t SMQSegmentLog::pending() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return size_t(m_nextOffset - m_consumerOffset);
+}
+
+size_t SMQSegmentLog::segmentCount() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_segments.size();
+}
+
+#if USE_GTEST
+
+static const String testLogDirectory("/tmp/smq_segment_log_test");
+
+static void removeTestLog()
+{
+    DirectoryDS logFiles(testLogDirectory, "", DDS_HIDE_DIRECTORIES | DDS_HIDE_DOT_FILES);
+    try {
+        logFiles.open();
+    }
+    catch (const Exception&) {
+        return; // Directory doesn't exist
+    }
+    while (!logFiles.eof()) {
+        String fileName = testLogDirectory + "/" + logFiles["Name"].asString();
+        remove(fileName.c_str());
+        logFiles.next();
+    }
+    logFiles.close();
+    rmdir(testLogDirectory.c_str());
+}
+
+static SMessage testMessage(size_t index)
+{
+    auto message = make_shared<Message>(Message::MESSAGE, Buffer("Test message " + to_string(index)));
+    (*message)["index"] = int2string(index);
+    return message;
+}
+
+TEST(SPTK_SMQSegmentLog, appendDeliver)
+{
+    removeTestLog();
+    {
+        SMQSegmentLog log(testLogDirectory, "/queue/test", 1024 * 1024, SYNC_NEVER, milliseconds(100));
+
+        for (size_t i = 0; i < 10; i++)
+            EXPECT_EQ(i, log.append(testMessage(i)));
+        EXPECT_EQ(size_t(10), log.pending());
+
+        // Consumer only accepts the first five messages
+        size_t index = 0;
+        size_t delivered = log.deliver([&index](const SMessage& message) {
+            if (index == 5)
+                return false;
+            EXPECT_STREQ(("Test message " + to_string(index)).c_str(), message->c_str());
+            EXPECT_STREQ(int2string(index).c_str(), (*message)["index"].c_str());
+            EXPECT_EQ(Message::MESSAGE, message->type());
+            EXPECT_STREQ("/queue/test", message->destination().c_str());
+            index++;
+            return true;
+        });
+        EXPECT_EQ(size_t(5), delivered);
+        EXPECT_EQ(uint64_t(5), log.consumerOffset());
+        EXPECT_EQ(size_t(5), log.pending());
+    }
+
+    // Reopen the log: undelivered messages are replayed
+    SMQSegmentLog log(testLogDirectory, "/queue/test", 1024 * 1024, SYNC_NEVER, milliseconds(100));
+    EXPECT_EQ(uint64_t(5), log.consumerOffset());
+    EXPECT_EQ(uint64_t(10), log.nextOffset());
+
+    size_t index = 5;
+    size_t delivered = log.deliver([&index](const SMessage& message) {
+        EXPECT_STREQ(("Test message " + to_string(index)).c_str(), message->c_str());
+        index++;
+        return true;
+    });
+    EXPECT_EQ(size_t(5), delivered);
+    EXPECT_EQ(size_t(0), log.pending());
+
+    removeTestLog();
+}
+
+TEST(SPTK_SMQSegmentLog, acknowledgedDelivery)
+{
+    removeTestLog();
+    {
+        SMQSegmentLog log(testLogDirectory, "/queue/test", 1024 * 1024, SYNC_NEVER, milliseconds(100));
+        for (size_t i = 0; i < 5; i++)
+            log.append(testMessage(i));
+
+        vector<SMQDeliveryCompletion> completions;
+        auto dispatch = [&completions](const SMessage&, const SMQDeliveryCompletion& completion) {
+            completions.push_back(completion);
+            return true;
+        };
+        EXPECT_EQ(size_t(5), log.deliver(dispatch));
+
+        // Dispatched messages are consumed in order, when they are delivered
+        EXPECT_EQ(size_t(5), log.pending());
+        completions[1](true);
+        log.flush();
+        EXPECT_EQ(uint64_t(0), log.consumerOffset());
+        completions[0](true);
+        log.flush();
+        EXPECT_EQ(uint64_t(2), log.consumerOffset());
+
+        // Lost message is dispatched again, messages that are still in flight aren't
+        completions[2](false);
+        EXPECT_TRUE(log.hasLostMessages());
+        completions.clear();
+        size_t index = 0;
+        EXPECT_EQ(size_t(1), log.deliver([&completions, &index](const SMessage& message, const SMQDeliveryCompletion& completion) {
+            index = (size_t) string2int((*message)["index"]);
+            completions.push_back(completion);
+            return true;
+        }));
+        EXPECT_EQ(size_t(2), index);
+        EXPECT_FALSE(log.hasLostMessages());
+    }
+
+    // Messages that weren't delivered before the log is closed are dispatched again
+    SMQSegmentLog log(testLogDirectory, "/queue/test", 1024 * 1024, SYNC_NEVER, milliseconds(100));
+    EXPECT_EQ(uint64_t(2), log.consumerOffset());
+    size_t index = 2;
+    size_t delivered = log.deliver([&index](const SMessage& message) {
+        EXPECT_STREQ(("Test message " + to_string(index)).c_str(), message->c_str());
+        index++;
+        return true;
+    });
+    EXPECT_EQ(size_t(3), delivered);
+    EXPECT_EQ(size_t(0), log.pending());
+
+    removeTestLog();
+}
+
+TEST(SPTK_SMQSegmentLog, tornTail)
+{
+    removeTestLog();
+    String segmentName;
+    {
+        SMQSegmentLog log(testLogDirectory, "/queue/test", 1024 * 1024, SYNC_ALWAYS, milliseconds(100));
+        for (size_t i = 0; i < 3; i++)
+            log.append(testMessage(i));
+        segmentName = segmentFileName(testLogDirectory, 0);
+    }
+
+    // Simulate a crash in the middle of appending a record
+    int fd = ::open(segmentName.c_str(), O_WRONLY);
+    ASSERT_NE(-1, fd);
+    truncateFile(fd, fileSize(segmentName) - 5);
+    ::close(fd);
+
+    SMQSegmentLog log(testLogDirectory, "/queue/test", 1024 * 1024, SYNC_NEVER, milliseconds(100));
+    EXPECT_EQ(uint64_t(2), log.nextOffset());
+
+    EXPECT_EQ(uint64_t(2), log.append(testMessage(2)));
+
+    size_t index = 0;
+    log.deliver([&index](const SMessage& message) {
+        EXPECT_STREQ(("Test message " + to_string(index)).c_str(), message->c_str());
+        index++;
+        return true;
+    });
+    EXPECT_EQ(size_t(3), index);
+
+    removeTestLog();
+}
+
+TEST(SPTK_SMQSegmentLog, compaction)
+{
+    removeTestLog();
+
+    SMQSegmentLog log(testLogDirectory, "/queue/test", 256, SYNC_NEVER, milliseconds(100));
+    for (size_t i = 0; i < 100; i++)
+        log.append(testMessage(i));
+    EXPECT_GT(log.segmentCount(), size_t(10));
+
+    size_t delivered = log.deliver([](const SMessage&) { return true; });
+    EXPECT_EQ(size_t(100), delivered);
+
+    // Fully consumed segments are removed
+    EXPECT_EQ(size_t(1), log.segmentCount());
+
+    removeTestLog();
+}
+
+TEST(SPTK_SMQSegmentLog, performanceSyncPolicies)
+{
+    struct PolicyInfo {
+        SMQSyncPolicy   policy;
+        const char*     name;
+        size_t          messageCount;
+    };
+    PolicyInfo policies[] = {
+        { SYNC_NEVER,    "never",    100000 },
+        { SYNC_PERIODIC, "periodic", 100000 },
+        { SYNC_ALWAYS,   "always",   1000 }
+    };
+
+    for (auto& policyInfo: policies) {
+        removeTestLog();
+        SMQSegmentLog log(testLogDirectory, "/queue/test", 64 * 1024 * 1024, policyInfo.policy, milliseconds(10));
+
+        auto message = make_shared<Message>(Message::MESSAGE, Buffer(String(100, 'x')));
+        DateTime started("now");
+        for (size_t i = 0; i < policyInfo.messageCount; i++) {
+            log.append(message);
+            log.flush();
+        }
+        log.sync();
+        DateTime ended("now");
+
+        double durationSec = duration_cast<microseconds>(ended - started).count() / 1E6;
+        COUT("Sync " << policyInfo.name << ": appended " << policyInfo.messageCount << " messages, "
+             << fixed << setprecision(1) << policyInfo.messageCount / durationSec / 1000 << "K msg/s" << endl);
+    }
+
+    removeTestLog();
+}
+
+#endif
@@ -31,45 +31,335 @@
 using namespace std;
 using namespace sptk;
 
+thread_local SMQBackpressure* SMQBackpressure::m_current;
+
+SMQBackpressure::SMQBackpressure()
+: m_previous(m_current)
+{
+    m_current = this;
+}
+
+SMQBackpressure::~SMQBackpressure()
+{
+    m_current = m_previous;
+}
+
+bool SMQBackpressure::blocked() const
+{
+    return m_blocked;
+}
+
+void SMQBackpressure::block()
+{
+    m_blocked = true;
+}
+
+SMQBackpressure* SMQBackpressure::current()
+{
+    return m_current;
+}
+
 SMQSendQueue::SMQSendQueue(ThreadPool& threadPool, SMQConnection& connection)
 : Runable("SMQ Send Queue"), m_connection(connection), m_threadPool(threadPool)
 {}
 
-void SMQSendQueue::push(SMessage& message)
+SMQSendQueue::~SMQSendQueue()
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (auto& frame: m_frames) {
+        if (frame.completion)
+            frame.completion(false);
+    }
+    account(-int64_t(m_frames.size() + m_heldFrames), -int64_t(m_queuedBytes + m_heldBytes));
+    setCongested(false);
+}
+
+bool SMQSendQueue::push(const SharedMQFrame& frame, bool control, const SMQDeliveryCompletion& completion)
+{
+    bool disconnect = false;
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        if (m_disconnected)
+            return false;
+
+        if (!control && !hasSpace(frame->bytes()) && !overflow(frame->bytes())) {
+            // The policy may have just disconnected the slow consumer
+            disconnect = m_disconnected;
+        } else {
+            m_frames.push_back({frame, control, completion});
+            m_queuedBytes += frame->bytes();
+            account(1, frame->bytes());
+            if (!m_processing) {
+                m_processing = true;
+                m_threadPool.execute(this);
+            }
+            return true;
+        }
+    }
+
+    if (disconnect)
+        m_connection.shutdown();
+    return false;
+}
+
+bool SMQSendQueue::hold(size_t bytes)
+{
+    bool disconnect = false;
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        if (m_disconnected)
+            return false;
+
+        if (hasSpace(bytes) || overflow(bytes)) {
+            m_heldFrames++;
+            m_heldBytes += bytes;
+            account(1, bytes);
+            return true;
+        }
+        disconnect = m_disconnected;
+    }
+
+    if (disconnect)
+        m_connection.shutdown();
+    return false;
+}
+
+void SMQSendQueue::pushHeld(const SharedMQFrame& frame, size_t heldBytes)
 {
     lock_guard<mutex> lock(m_mutex);
-    m_messages.push(message);
+
+    // Held messages are released when the slow consumer is disconnected
+    if (m_disconnected)
+        return;
+
+    m_heldFrames--;
+    m_heldBytes -= heldBytes;
+    account(-1, -int64_t(heldBytes));
+
+    m_frames.push_back({frame, false, nullptr});
+    m_queuedBytes += frame->bytes();
+    account(1, frame->bytes());
     if (!m_processing) {
         m_processing = true;
         m_threadPool.execute(this);
     }
 }
 
+bool SMQSendQueue::hasSpace(size_t bytes) const
+{
+    size_t frames = m_frames.size() + m_heldFrames;
+    if (m_limits.maxFrames != 0 && frames >= m_limits.maxFrames)
+        return false;
+
+    // A frame larger than the limit still fits into an empty queue
+    if (m_limits.maxBytes != 0 && frames != 0 && m_queuedBytes + m_heldBytes + bytes > m_limits.maxBytes)
+        return false;
+
+    return m_stats == nullptr || m_stats->maxQueuedBytes == 0 ||
+           m_stats->queuedBytes + bytes <= m_stats->maxQueuedBytes;
+}
+
+bool SMQSendQueue::drained() const
+{
+    // Publishers are resumed at half of the limits, so they aren't paused again by the next message
+    if (m_limits.maxFrames != 0 && m_frames.size() + m_heldFrames > m_limits.maxFrames / 2)
+        return false;
+    return m_limits.maxBytes == 0 || m_queuedBytes + m_heldBytes <= m_limits.maxBytes / 2;
+}
+
+bool SMQSendQueue::overflow(size_t bytes)
+{
+    switch (m_limits.policy) {
+        case OVERFLOW_BLOCK:
+            {
+                // Event thread must never wait here: instead, the publisher isn't read until the queue drains
+                auto* backpressure = SMQBackpressure::current();
+                if (backpressure == nullptr) {
+                    if (m_stats != nullptr)
+                        m_stats->droppedNewest++;
+                    return false;
+                }
+                backpressure->block();
+                if (!m_congested) {
+                    setCongested(true);
+                    m_congestedSince = chrono::steady_clock::now();
+                    if (m_stats != nullptr)
+                        m_stats->blocked++;
+                }
+            }
+            return true;
+
+        case OVERFLOW_DROP_OLDEST:
+            while (!hasSpace(bytes)) {
+                if (!dropOldest()) {
+                    // Only control frames are left, or other queues use the server-wide space
+                    if (m_stats != nullptr)
+                        m_stats->droppedNewest++;
+                    return false;
+                }
+                if (m_stats != nullptr)
+                    m_stats->droppedOldest++;
+            }
+            return true;
+
+        case OVERFLOW_DROP_NEWEST:
+            if (m_stats != nullptr)
+                m_stats->droppedNewest++;
+            return false;
+
+        case OVERFLOW_DISCONNECT:
+            if (m_stats != nullptr)
+                m_stats->disconnected++;
+            dropAll();
+            return false;
+    }
+
+    return false;
+}
+
+bool SMQSendQueue::dropOldest()
+{
+    for (auto itor = m_frames.begin(); itor != m_frames.end(); ++itor) {
+        if (itor->control)
+            continue;
+        size_t bytes = itor->frame->bytes();
+        m_queuedBytes -= bytes;
+        account(-1, -int64_t(bytes));
+        if (itor->completion)
+            itor->completion(false);
+        m_frames.erase(itor);
+        return true;
+    }
+    return false;
+}
+
+void SMQSendQueue::dropAll()
+{
+    account(-int64_t(m_frames.size() + m_heldFrames), -int64_t(m_queuedBytes + m_heldBytes));
+    for (auto& frame: m_frames) {
+        if (frame.completion)
+            frame.completion(false);
+    }
+    m_frames.clear();
+    m_queuedBytes = 0;
+    m_heldFrames = 0;
+    m_heldBytes = 0;
+    m_disconnected = true;
+}
+
+void SMQSendQueue::setCongested(bool congested)
+{
+    if (m_congested == congested)
+        return;
+    m_congested = congested;
+    if (m_stats != nullptr) {
+        if (congested)
+            m_stats->congested++;
+        else
+            m_stats->congested--;
+    }
+}
+
+void SMQSendQueue::account(int64_t frames, int64_t bytes)
+{
+    if (m_stats != nullptr) {
+        m_stats->queuedFrames += frames;
+        m_stats->queuedBytes += bytes;
+    }
+}
+
 void SMQSendQueue::run()
 {
     setProcessing(true);
-    while (true) {
-        SMessage message = getMessage();
-        if (!message)
-            break;
-        m_connection.protocol().sendMessage(message->destination(), message);
+    try {
+        while (getBatch())
+            sendBatch();
+    }
+    catch (const TimeoutException&) {
+        // Consumer doesn't read, and the frame is partially sent, so the connection can't be used anymore
+        dropBatch();
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (m_stats != nullptr)
+                m_stats->disconnected++;
+            dropAll();
+            m_processing = false;
+        }
+        m_connection.shutdown();
     }
+    catch (const Exception&) {
+        // The connection is broken, and the server removes it on connection closed event.
+        // Frames queued for it are released right away.
+        dropBatch();
+        lock_guard<mutex> lock(m_mutex);
+        dropAll();
+        m_processing = false;
+    }
+}
+
+void SMQSendQueue::dropBatch()
+{
+    for (auto& completion: m_batchCompletions)
+        completion(false);
+    m_batchCompletions.clear();
 }
 
-SMessage SMQSendQueue::getMessage()
+bool SMQSendQueue::getBatch()
 {
-    SMessage message;
+    m_batch.clear();
+    m_batchCompletions.clear();
 
-    lock_guard<mutex> lock(m_mutex);
+    unique_lock<mutex> lock(m_mutex);
 
-    if (!m_messages.empty()) {
-        message = m_messages.front();
-        m_messages.pop();
+    size_t batchBytes = 0;
+    while (!m_frames.empty()) {
+        auto& frame = m_frames.front().frame;
+        if (!m_batch.empty() && batchBytes + frame->bytes() > m_maxBatchBytes)
+            break;
+        batchBytes += frame->bytes();
+        m_batch.push_back(move(frame));
+        if (m_frames.front().completion)
+            m_batchCompletions.push_back(move(m_frames.front().completion));
+        m_frames.pop_front();
     }
 
-    m_processing = !m_messages.empty();
+    if (!m_batch.empty()) {
+        m_queuedBytes -= batchBytes;
+        account(-int64_t(m_batch.size()), -int64_t(batchBytes));
+    }
+
+    // Processing is only finished when there is nothing left to send,
+    // otherwise a concurrent push() could start another writer on the same socket
+    m_processing = !m_batch.empty();
+    bool processing = m_processing;
+
+    bool resumePublishers = m_congested && drained();
+    if (resumePublishers)
+        setCongested(false);
+    lock.unlock();
+
+    if (resumePublishers)
+        m_connection.resumePublishers();
 
-    return message;
+    return processing;
+}
+
+void SMQSendQueue::sendBatch()
+{
+    if (m_batch.size() == 1)
+        m_connection.protocol().sendFrame(*m_batch.front());
+    else {
+        m_batchBuffer.bytes(0);
+        for (auto& frame: m_batch)
+            m_batchBuffer.append(*frame);
+        m_connection.protocol().sendFrame(m_batchBuffer);
+    }
+
+    for (auto& completion: m_batchCompletions)
+        completion(true);
+    m_batchCompletions.clear();
 }
 
 void SMQSendQueue::setProcessing(bool processing)
@@ -77,3 +367,66 @@ void SMQSendQueue::setProcessing(bool processing)
     lock_guard<mutex> lock(m_mutex);
     m_processing = processing;
 }
+
+size_t SMQSendQueue::maxBatchBytes() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_maxBatchBytes;
+}
+
+void SMQSendQueue::maxBatchBytes(size_t maxBatchBytes)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_maxBatchBytes = maxBatchBytes;
+}
+
+SMQSendQueueLimits SMQSendQueue::limits() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_limits;
+}
+
+void SMQSendQueue::limits(const SMQSendQueueLimits& limits)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_limits = limits;
+}
+
+void SMQSendQueue::stats(SMQSendQueueStats* stats)
+{
+    lock_guard<mutex> lock(m_mutex);
+    account(-int64_t(m_frames.size() + m_heldFrames), -int64_t(m_queuedBytes + m_heldBytes));
+    m_stats = stats;
+    account(int64_t(m_frames.size() + m_heldFrames), int64_t(m_queuedBytes + m_heldBytes));
+}
+
+size_t SMQSendQueue::size() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_frames.size();
+}
+
+size_t SMQSendQueue::bytes() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_queuedBytes;
+}
+
+bool SMQSendQueue::congested() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_congested;
+}
+
+bool SMQSendQueue::congestionExpired()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_congested || m_disconnected || chrono::steady_clock::now() - m_congestedSince < m_limits.blockTimeout)
+        return false;
+
+    // Publishers stay paused until the slow consumer connection is closed
+    if (m_stats != nullptr)
+        m_stats->disconnected++;
+    dropAll();
+    return true;
+}
@@ -42,17 +42,74 @@ SMQServer::SMQServer(MQProtocolType protocol, const String& username, const Stri
   m_subscriptions(logEngine, debugLogFilter),
   m_logEngine(logEngine),
   m_debugLogFilter(debugLogFilter),
-  m_sendThreadPool(16)
+  m_sendThreadPool(16),
+  m_redeliveryTimer(redeliveryTimerCallback)
 {
+    m_redeliveryEvent = m_redeliveryTimer.repeat(milliseconds(100), this);
 }
 
 SMQServer::~SMQServer()
 {
+    m_redeliveryTimer.cancel();
+    m_cluster.reset();
     clear();
 }
 
+void SMQServer::redeliveryTimerCallback(void* eventData)
+{
+    auto* smqServer = (SMQServer*) eventData;
+    smqServer->redeliver();
+}
+
+void SMQServer::redeliver()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        for (auto* connection: m_connections) {
+            connection->redeliver();
+            connection->checkSendQueue();
+        }
+    }
+    m_subscriptions.redeliverStoredMessages();
+}
+
+bool SMQServer::pausePublisher(SMQConnection* connection)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    // Send queues may have drained since the message was delivered
+    if (m_sendQueueStats.congested == 0)
+        return false;
+
+    m_pausedPublishers.insert(connection);
+    forgetSocket(connection->socket());
+
+    return true;
+}
+
+void SMQServer::resumePublishersUnlocked()
+{
+    for (auto* connection: m_pausedPublishers) {
+        try {
+            watchSocket(connection->socket(), connection);
+        }
+        catch (const Exception& e) {
+            log(LP_ERROR, e.message());
+        }
+    }
+    m_pausedPublishers.clear();
+}
+
+void SMQServer::resumePublishers()
+{
+    lock_guard<mutex> lock(m_mutex);
+    resumePublishersUnlocked();
+}
+
 void SMQServer::stop()
 {
+    if (m_cluster)
+        m_cluster->stop();
     m_sendThreadPool.stop();
     m_socketEvents.terminate();
 	TCPServer::stop();
@@ -78,6 +135,11 @@ void SMQServer::closeConnection(ServerConnection* connection, bool brokenConnect
         lock_guard<mutex> lock(m_mutex);
         m_clientIds.erase(clientId);
         m_connections.erase(smqConnection);
+        m_pausedPublishers.erase(smqConnection);
+
+        // Slow consumer is gone, so publishers paused by its full send queue can continue
+        if (smqConnection->sendQueueCongested())
+            resumePublishersUnlocked();
 
         if (brokenConnection) {
             SMessage lastWillMessage = smqConnection->getLastWillMessage();
@@ -100,6 +162,14 @@ static map<String,sptk::QOS> parseDestinations(const String& destinations)
     return destinationsAndQOS;
 }
 
+static void acknowledge(SMQConnection* connection, const String& messageIds)
+{
+    vector<uint16_t> packetIds;
+    parseMessageIds(messageIds, packetIds);
+    for (auto packetId: packetIds)
+        connection->acknowledge(packetId);
+}
+
 void SMQServer::socketEventCallback(void *userData, SocketEventType eventType)
 {
     auto* connection = (SMQConnection*) userData;
@@ -111,10 +181,18 @@ void SMQServer::socketEventCallback(void *userData, SocketEventType eventType)
         return;
     }
 
-    String messageId;
+    // Acknowledgements of the messages received in this call are sent together
+    vector<uint16_t> publishAcks;
+
+    // Full send queues don't block this thread: the publisher isn't read until they drain
+    SMQBackpressure backpressure;
+    bool paused = false;
 
     try {
-        while (connection != nullptr && connection->socket().socketBytes() > 0) {
+        // Paused publisher is only read until the data it has already sent is processed
+        while (connection != nullptr &&
+               (paused ? connection->bufferedBytes() : connection->socket().socketBytes()) > 0)
+        {
 
             SMessage msg;
             MQProtocol& protocol = connection->protocol();
@@ -129,26 +207,58 @@ void SMQServer::socketEventCallback(void *userData, SocketEventType eventType)
                     } else {
                         const String& lastWillDestination = (*msg)["last_will_destination"];
                         const String& lastWillMessage = (*msg)["last_will_message"];
-                        connection->setupClient((*msg)["client_id"], lastWillDestination, lastWillMessage);
+                        // Authenticated node client id is only accepted with the cluster key
+                        bool peer = (*msg)["client_id"].startsWith(SMQCluster::NodeClientIdPrefix);
+                        connection->setupClient((*msg)["client_id"], peer, lastWillDestination, lastWillMessage);
                         if (!lastWillDestination.empty()) {
                             msg->headers().erase("last_will_destination");
                             msg->headers().erase("last_will_message");
                         }
-                        protocol.ack(msg->type(), "");
+                        // Nothing is queued for the connection yet, so the acknowledgement is written
+                        // directly rather than waiting for a send thread
+                        protocol.negotiate(*msg);
+                        auto sharedMemory = msg->headers().find("shared_memory");
+                        if (sharedMemory != msg->headers().end() && sharedMemory->second == "1"
+                            && connection->createSharedMemory())
+                        {
+                            // The acknowledgement carries the segment descriptor, and is the last frame
+                            // sent through the socket
+                            Message ackMessage(Message::CONNECT_ACK);
+                            if (protocol.version() > 1)
+                                ackMessage["protocol_version"] = int2string(protocol.version());
+                            ackMessage["shared_memory"] = "1";
+                            protocol.sendFrame(*protocol.encodeMessage("", ackMessage));
+                            connection->activateSharedMemory();
+                        }
+                        else
+                            protocol.sendFrame(*protocol.encodeAck(msg->type(), {}));
                     }
                     break;
                 case Message::SUBSCRIBE:
-                    smqServer->subscribe(connection, parseDestinations(msg->destination()));
-                    protocol.ack(msg->type(), "");
+                    if (smqServer->subscribe(connection, parseDestinations(msg->destination())))
+                        connection->sendControlFrame(protocol.encodeAck(msg->type(), {}));
+                    else {
+                        String error = "Invalid subscription '" + msg->destination() + "' is rejected";
+                        smqServer->log(LP_WARNING, "{" + connection->clientId() + "} " + error);
+                        if (connection->getProtocolType() == MP_SMQ) {
+                            Message ackMessage(Message::SUBSCRIBE_ACK);
+                            ackMessage["error"] = error;
+                            connection->sendControlFrame(protocol.encodeMessage("", ackMessage));
+                        } else {
+                            // MQTT acknowledgement can't report the failure
+                            connection->sendControlFrame(protocol.encodeAck(msg->type(), {}));
+                        }
+                    }
                     break;
                 case Message::UNSUBSCRIBE:
                     smqServer->unsubscribe(connection, msg->destination());
                     break;
                 case Message::MESSAGE:
-                    smqServer->distributeMessage(msg);
-                    messageId = msg->headers()["message_id"];
-                    if (!messageId.empty())
-                        protocol.ack(msg->type(), messageId);
+                    smqServer->distributeMessage(msg, connection->isPeer());
+                    parseMessageIds(msg->headers()["message_id"], publishAcks);
+                    break;
+                case Message::PUBLISH_ACK:
+                    acknowledge(connection, msg->headers()["message_id"]);
                     break;
                 case Message::DISCONNECT:
                     smqServer->closeConnection(connection, false);
@@ -158,7 +268,13 @@ void SMQServer::socketEventCallback(void *userData, SocketEventType eventType)
                 default:
                     break;
             }
+
+            if (connection != nullptr && !paused && backpressure.blocked())
+                paused = smqServer->pausePublisher(connection);
         }
+
+        if (connection != nullptr && !publishAcks.empty())
+            connection->sendControlFrame(connection->protocol().encodeAck(Message::MESSAGE, publishAcks));
     }
     catch (const Exception& e) {
         if (connection != nullptr) {
@@ -169,11 +285,23 @@ void SMQServer::socketEventCallback(void *userData, SocketEventType eventType)
     }
 }
 
-void SMQServer::distributeMessage(SMessage message)
+void SMQServer::distributeMessage(SMessage message, bool fromPeer)
 {
+    if (m_cluster && !fromPeer && m_cluster->route(message))
+        return;
     m_subscriptions.deliverMessage(message->destination(), message);
 }
 
+void SMQServer::deliverLocalMessage(SMessage message)
+{
+    m_subscriptions.deliverMessage(message->destination(), message, true);
+}
+
+bool SMQServer::hasLocalSubscribers(const String& destination) const
+{
+    return m_subscriptions.hasLocalSubscribers(destination);
+}
+
 bool SMQServer::authenticate(const String& clientId, const String& username, const String& password)
 {
     lock_guard<mutex> lock(m_mutex);
@@ -185,7 +313,14 @@ bool SMQServer::authenticate(const String& clientId, const String& username, con
         return false;
     }
 
-    if (username != m_username || password != m_password) {
+    // Peer node messages bypass routing and storage, so a peer must know the cluster key
+    if (clientId.startsWith(SMQCluster::NodeClientIdPrefix)) {
+        if (!m_cluster || !m_cluster->authenticatePeer(username, password)) {
+            log(LP_ERROR, logPrefix + "Invalid cluster node credentials");
+            return false;
+        }
+    }
+    else if (username != m_username || password != m_password) {
         log(LP_ERROR, logPrefix + "Invalid username or password");
         return false;
     }
@@ -212,14 +347,20 @@ void SMQServer::run()
     log(LP_NOTICE, "Server started");
 }
 
-void SMQServer::subscribe(SMQConnection* connection, const map<String,sptk::QOS>& destinations)
+bool SMQServer::subscribe(SMQConnection* connection, const map<String,sptk::QOS>& destinations)
 {
-    m_subscriptions.subscribe(connection, destinations);
+    if (!m_subscriptions.subscribe(connection, destinations))
+        return false;
+    if (m_cluster && !connection->isPeer())
+        m_cluster->subscribe(destinations);
+    return true;
 }
 
 void SMQServer::unsubscribe(SMQConnection* connection, const String& destination)
 {
     m_subscriptions.unsubscribe(connection, destination);
+    if (m_cluster && !connection->isPeer())
+        m_cluster->unsubscribe(destination);
 }
 
 void SMQServer::clear()
@@ -229,6 +370,7 @@ void SMQServer::clear()
     for (auto* connection: m_connections)
         delete connection;
     m_connections.clear();
+    m_pausedPublishers.clear();
     m_clientIds.clear();
 }
 
@@ -237,6 +379,102 @@ void SMQServer::execute(Runable*)
     // SMQServer doesn't use tasks model
 }
 
+size_t SMQServer::maxSendBatchBytes() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_maxSendBatchBytes;
+}
+
+void SMQServer::maxSendBatchBytes(size_t maxBatchBytes)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_maxSendBatchBytes = maxBatchBytes;
+}
+
+SMQSendQueueLimits SMQServer::sendQueueLimits() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_sendQueueLimits;
+}
+
+void SMQServer::sendQueueLimits(const SMQSendQueueLimits& limits)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_sendQueueLimits = limits;
+}
+
+size_t SMQServer::maxQueuedBytes() const
+{
+    return m_sendQueueStats.maxQueuedBytes;
+}
+
+void SMQServer::maxQueuedBytes(size_t maxBytes)
+{
+    m_sendQueueStats.maxQueuedBytes = maxBytes;
+}
+
+const SMQSendQueueStats& SMQServer::sendQueueStats() const
+{
+    return m_sendQueueStats;
+}
+
+size_t SMQServer::deliveryWindowSize() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_deliveryWindowSize;
+}
+
+void SMQServer::deliveryWindowSize(size_t windowSize)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_deliveryWindowSize = windowSize;
+}
+
+milliseconds SMQServer::redeliveryTimeout() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_redeliveryTimeout;
+}
+
+void SMQServer::redeliveryTimeout(milliseconds timeout)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_redeliveryTimeout = timeout;
+}
+
+void SMQServer::enablePersistence(const String& directory, SMQSyncPolicy syncPolicy, milliseconds syncInterval,
+                                  size_t maxSegmentBytes)
+{
+    auto messageStore = make_shared<SMQMessageStore>(directory, syncPolicy, syncInterval, maxSegmentBytes);
+    m_subscriptions.messageStore(messageStore);
+    log(LP_NOTICE, "Durable queues are stored in " + directory);
+}
+
+SharedSMQMessageStore SMQServer::messageStore() const
+{
+    return m_subscriptions.messageStore();
+}
+
+SMQRetainedMessages& SMQServer::retainedMessages()
+{
+    return m_subscriptions.retainedMessages();
+}
+
+void SMQServer::enableCluster(const Host& node, const vector<Host>& peers, const String& clusterKey,
+                              milliseconds interval)
+{
+    if (clusterKey.empty())
+        throw Exception("Cluster key is required");
+    m_cluster = make_unique<SMQCluster>(*this, node, peers, m_username, clusterKey);
+    m_cluster->start(interval);
+    log(LP_NOTICE, "Cluster node " + m_cluster->nodeName());
+}
+
+SMQCluster* SMQServer::cluster() const
+{
+    return m_cluster.get();
+}
+
 MQProtocolType SMQServer::protocol() const
 {
     lock_guard<mutex> lock(m_mutex);
@@ -41,36 +41,68 @@ SMQSubscription::SMQSubscription(const String& destination, Type type, sptk::QOS
 SMQSubscription::~SMQSubscription()
 {
     UniqueLock(m_mutex);
-    for (auto* connection: m_connections)
-        connection->unsubscribe(m_destination, this);
+    for (auto& itor: m_connections)
+        itor.first->unsubscribe(m_destination, this);
     m_connections.clear();
 }
 
-void SMQSubscription::addConnection(SMQConnection* connection)
+void SMQSubscription::addConnection(SMQConnection* connection, QOS qos)
 {
     UniqueLock(m_mutex);
-    m_connections.insert(connection);
+    m_connections[connection] = qos;
     connection->subscribe(m_destination, this);
 }
 
 void SMQSubscription::removeConnection(SMQConnection* connection, bool updateConnection)
 {
     UniqueLock(m_mutex);
-    m_connections.erase(connection);
+    auto itor = m_connections.find(connection);
+    if (itor != m_connections.end()) {
+        if (m_currentConnection == itor)
+            ++m_currentConnection;
+        m_connections.erase(itor);
+    }
     if (updateConnection)
         connection->unsubscribe(m_destination, this);
 }
 
-bool SMQSubscription::deliverMessage(SMessage message)
+/**
+ * Get QoS requested by message publisher.
+ * QoS 2 isn't supported, and such messages are delivered with QoS 1.
+ */
+static QOS messageQOS(const Message& message)
+{
+    auto itor = message.headers().find("qos");
+    if (itor == message.headers().end() || string2int(itor->second) == QOS_0)
+        return QOS_0;
+    return QOS_1;
+}
+
+bool SMQSubscription::deliverMessage(SMessage message, bool localOnly, const SMQDeliveryCompletion& completion)
 {
     Logger logger(m_logEngine, "(SMQ) ");
     SharedLock(m_mutex);
 
-    // If the subscription is TOPIC, send it to every subscriber:
+    QOS qos = messageQOS(*message);
+
+    // If the subscription is TOPIC, send it to every subscriber.
+    // The message is encoded only once per protocol and wire format version, and all the QoS 0 subscribers
+    // share the same encoded frame. QoS 1 deliveries carry per-connection packet ids.
     if (m_type == TOPIC) {
-        for (auto subscriber: m_connections) {
+        map<pair<MQProtocolType, uint8_t>, SharedMQFrame> frames;
+        for (auto& itor: m_connections) {
+            auto* subscriber = itor.first;
+            if (localOnly && subscriber->isPeer())
+                continue;
             try {
-                subscriber->sendMessage(message);
+                if (qos != QOS_0 && itor.second != QOS_0)
+                    subscriber->sendReliableMessage(message);
+                else {
+                    auto& frame = frames[make_pair(subscriber->getProtocolType(), subscriber->protocol().version())];
+                    if (!frame)
+                        frame = subscriber->protocol().encodeMessage(message->destination(), *message);
+                    subscriber->sendFrame(frame);
+                }
                 if (m_debugLogFilter & LOG_MESSAGE_OPS)
                     logger.debug("Sent message to " + subscriber->clientId());
                 if (m_debugLogFilter & LOG_MESSAGE_DETAILS)
@@ -84,24 +116,56 @@ bool SMQSubscription::deliverMessage(SMessage message)
         // If the subscription is QUEUE, send it to current subscriber,
         // and switch to next subscriber
         if (m_connections.empty())
-            return true;
+            return false;
         if (m_currentConnection == m_connections.end())
             m_currentConnection = m_connections.begin();
+        if (localOnly) {
+            // Message is already routed by a peer cluster node, so it isn't sent to peers again
+            size_t skipped = 0;
+            while (m_currentConnection->first->isPeer()) {
+                if (++skipped == m_connections.size())
+                    return false;
+                if (++m_currentConnection == m_connections.end())
+                    m_currentConnection = m_connections.begin();
+            }
+        }
+        auto* subscriber = m_currentConnection->first;
         try {
-            (*m_currentConnection)->sendMessage(message);
+            bool sent;
+            if (qos != QOS_0 && m_currentConnection->second != QOS_0)
+                sent = subscriber->sendReliableMessage(message, completion);
+            else
+                sent = subscriber->sendMessage(message, completion);
+            if (!sent) {
+                // Dropped by the send queue of a slow subscriber
+                ++m_currentConnection;
+                return false;
+            }
             if (m_debugLogFilter & LOG_MESSAGE_OPS)
-                logger.debug("Sent message to " + (*m_currentConnection)->clientId());
+                logger.debug("Sent message to " + subscriber->clientId());
             if (m_debugLogFilter & LOG_MESSAGE_DETAILS)
                 logger.debug(message->toString());
         }
         catch (const Exception& e) {
-            logger.error("Can't send message to a subscriber " + (*m_currentConnection)->clientId() + ": " + String(e.what()));
+            logger.error("Can't send message to a subscriber " + subscriber->clientId() + ": " + String(e.what()));
+            ++m_currentConnection;
+            return false;
         }
         ++m_currentConnection;
     }
     return true;
 }
 
+bool SMQSubscription::hasLocalConnections() const
+{
+    SharedLock(m_mutex);
+    for (auto& itor: m_connections) {
+        if (!itor.first->isPeer())
+            return true;
+    }
+    return false;
+}
+
 SMQSubscription::Type SMQSubscription::type() const
 {
     SharedLock(m_mutex);
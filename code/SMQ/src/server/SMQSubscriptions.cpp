@@ -37,16 +37,39 @@ SMQSubscriptions::SMQSubscriptions(LogEngine& logEngine, uint8_t debugLogFilter)
 {
 }
 
-void SMQSubscriptions::deliverMessage(const String& queueName, const SMessage message)
+void SMQSubscriptions::deliverMessage(const String& queueName, const SMessage message, bool localOnly)
 {
-    SharedLock(m_mutex);
-    auto itor = m_subscriptions.find(queueName);
-    if (itor != m_subscriptions.end())
-        itor->second->deliverMessage(message);
+    // Delivery doesn't lock subscriptions: topic trie matches against immutable snapshot
+    auto messageStore = atomic_load(&m_messageStore);
+    if (messageStore && SMQMessageStore::isDurable(queueName) && !localOnly) {
+        // Durable queue message is stored first, and stays stored until it's delivered to a consumer
+        auto subscription = m_topics.find(queueName);
+        messageStore->store(queueName, message,
+                            [&subscription](const SMessage& storedMessage, const SMQDeliveryCompletion& completion) {
+                                return subscription && subscription->deliverMessage(storedMessage, false, completion);
+                            });
+        return;
+    }
+
+    // Retain flag is only set for the messages delivered to new subscribers
+    if (!localOnly && SMQRetainedMessages::isRetained(*message)) {
+        m_retainedMessages.retain(message);
+        message->headers().erase("retain");
+    }
+
+    vector<SharedSMQSubscription> subscriptions;
+    m_topics.match(queueName, subscriptions);
+    for (auto& subscription: subscriptions)
+        subscription->deliverMessage(message, localOnly);
 }
 
-void SMQSubscriptions::subscribe(SMQConnection* connection, const map<String,sptk::QOS>& queueNames)
+bool SMQSubscriptions::subscribe(SMQConnection* connection, const map<String,sptk::QOS>& queueNames)
 {
+    for (auto& qtor: queueNames) {
+        if (!SMQTopicTrie::isValidFilter(qtor.first))
+            return false;
+    }
+
     UniqueLock(m_mutex);
 
     for (auto& qtor: queueNames) {
@@ -59,11 +82,31 @@ void SMQSubscriptions::subscribe(SMQConnection* connection, const map<String,spt
             SMQSubscription::Type subscriptionType = queueName.startsWith("/queue/") ? SMQSubscription::QUEUE
                                                                                      : SMQSubscription::TOPIC;
             subscription = make_shared<SMQSubscription>(queueName, subscriptionType, qos, m_logEngine, m_debugLogFilter);
+            m_topics.insert(queueName, subscription);
             m_subscriptions[queueName] = subscription;
         } else
             subscription = itor->second;
-        subscription->addConnection(connection);
+        subscription->addConnection(connection, qos);
+
+        // Deliver last values of the matching topics
+        if (subscription->type() == SMQSubscription::TOPIC) {
+            vector<SMessage> retainedMessages;
+            m_retainedMessages.match(queueName, retainedMessages);
+            for (auto& retainedMessage: retainedMessages)
+                connection->sendMessage(retainedMessage);
+        }
+
+        // Deliver durable queue messages, stored while there were no consumers
+        auto messageStore = atomic_load(&m_messageStore);
+        if (messageStore && SMQMessageStore::isDurable(queueName)) {
+            messageStore->replay(queueName,
+                                 [&subscription](const SMessage& storedMessage, const SMQDeliveryCompletion& completion) {
+                                     return subscription->deliverMessage(storedMessage, false, completion);
+                                 });
+        }
     }
+
+    return true;
 }
 
 void SMQSubscriptions::unsubscribe(SMQConnection* connection, const String& queueName)
@@ -80,8 +123,58 @@ void SMQSubscriptions::unsubscribe(SMQConnection* connection, const String& queu
     subscription->removeConnection(connection, true);
 }
 
+void SMQSubscriptions::redeliverStoredMessages()
+{
+    auto messageStore = atomic_load(&m_messageStore);
+    if (!messageStore)
+        return;
+
+    map<String,SharedSMQSubscription> durableSubscriptions;
+    {
+        SharedLock(m_mutex);
+        for (auto& itor: m_subscriptions) {
+            if (SMQMessageStore::isDurable(itor.first))
+                durableSubscriptions.insert(itor);
+        }
+    }
+
+    for (auto& itor: durableSubscriptions) {
+        if (!messageStore->hasLostMessages(itor.first))
+            continue;
+        auto& subscription = itor.second;
+        messageStore->replay(itor.first,
+                             [&subscription](const SMessage& storedMessage, const SMQDeliveryCompletion& completion) {
+                                 return subscription->deliverMessage(storedMessage, false, completion);
+                             });
+    }
+}
+
+void SMQSubscriptions::messageStore(const SharedSMQMessageStore& messageStore)
+{
+    atomic_store(&m_messageStore, messageStore);
+    m_retainedMessages.messageStore(messageStore);
+}
+
+SharedSMQMessageStore SMQSubscriptions::messageStore() const
+{
+    return atomic_load(&m_messageStore);
+}
+
+bool SMQSubscriptions::hasLocalSubscribers(const String& queueName) const
+{
+    SharedLock(m_mutex);
+    auto itor = m_subscriptions.find(queueName);
+    return itor != m_subscriptions.end() && itor->second->hasLocalConnections();
+}
+
+SMQRetainedMessages& SMQSubscriptions::retainedMessages()
+{
+    return m_retainedMessages;
+}
+
 void SMQSubscriptions::clear()
 {
     UniqueLock(m_mutex);
+    m_topics.clear();
     m_subscriptions.clear();
 }
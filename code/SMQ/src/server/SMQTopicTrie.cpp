@@ -0,0 +1,602 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SMQTopicTrie.cpp - description                         ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <smq/server/SMQTopicTrie.h>
+#include <sptk5/Printer.h>
+#include <sptk5/FileLogEngine.h>
+#include <array>
+#include <iomanip>
+
+using namespace std;
+using namespace sptk;
+
+namespace {
+
+typedef SMQTopicTrie::SharedNode SharedNode;
+
+/**
+ * Persistent hash map of topic level to child node.
+ *
+ * Hash bits select slots in the chain of 32-slot tables. Changes create a new map,
+ * copying only the tables on the path to the changed entry. That keeps the cost of
+ * copying a trie node with thousands of children low.
+ */
+class ChildMap
+{
+    static constexpr unsigned BitsPerTable = 5;
+    static constexpr unsigned TableSize = 1 << BitsPerTable;
+    static constexpr unsigned MaxDepth = (sizeof(size_t) * 8 + BitsPerTable - 1) / BitsPerTable;
+
+    struct Entry
+    {
+        size_t          hash;
+        String          level;
+        SharedNode      node;
+    };
+    typedef shared_ptr<const Entry> SharedEntry;
+
+    struct Table;
+    typedef shared_ptr<const Table> SharedTable;
+
+    struct Slot
+    {
+        SharedEntry     entry;      ///< Single entry in slot
+        SharedTable     table;      ///< Next level table, if there is more than one entry in slot
+    };
+
+    struct Table
+    {
+        array<Slot, TableSize>  slots;
+        vector<SharedEntry>     collisions;     ///< Entries with the same hash, used at MaxDepth only
+
+        bool empty() const
+        {
+            if (!collisions.empty())
+                return false;
+            for (auto& slot: slots) {
+                if (slot.entry || slot.table)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    SharedTable m_root;
+
+    static size_t hashLevel(string_view level)
+    {
+        return hash<string_view>()(level);
+    }
+
+    static size_t slotIndex(size_t hash, unsigned depth)
+    {
+        return (hash >> (depth * BitsPerTable)) & (TableSize - 1);
+    }
+
+    static SharedTable insert(const SharedTable& table, const SharedEntry& entry, unsigned depth)
+    {
+        auto newTable = table ? make_shared<Table>(*table) : make_shared<Table>();
+
+        if (depth == MaxDepth) {
+            for (auto& existing: newTable->collisions) {
+                if (existing->level == entry->level) {
+                    existing = entry;
+                    return newTable;
+                }
+            }
+            newTable->collisions.push_back(entry);
+            return newTable;
+        }
+
+        auto& slot = newTable->slots[slotIndex(entry->hash, depth)];
+        if (slot.table)
+            slot.table = insert(slot.table, entry, depth + 1);
+        else if (!slot.entry || slot.entry->level == entry->level)
+            slot.entry = entry;
+        else {
+            // Slot is taken by another entry: move both entries to the next level table
+            auto existing = move(slot.entry);
+            slot.entry.reset();
+            slot.table = insert(insert(nullptr, existing, depth + 1), entry, depth + 1);
+        }
+        return newTable;
+    }
+
+    static SharedTable erase(const SharedTable& table, size_t hash, string_view level, unsigned depth)
+    {
+        auto newTable = make_shared<Table>(*table);
+
+        if (depth == MaxDepth) {
+            auto& collisions = newTable->collisions;
+            collisions.erase(remove_if(collisions.begin(), collisions.end(),
+                                       [level](const SharedEntry& entry) { return entry->level == level; }),
+                             collisions.end());
+        } else {
+            auto& slot = newTable->slots[slotIndex(hash, depth)];
+            if (slot.table)
+                slot.table = erase(slot.table, hash, level, depth + 1);
+            else if (slot.entry && slot.entry->level == level)
+                slot.entry.reset();
+        }
+
+        if (newTable->empty())
+            return nullptr;
+        return newTable;
+    }
+
+public:
+    /**
+     * Find child node
+     * @param level             Topic level
+     * @return child node, or nullptr if not found
+     */
+    const SharedNode* find(string_view level) const
+    {
+        size_t hash = hashLevel(level);
+        const Table* table = m_root.get();
+        for (unsigned depth = 0; table != nullptr; depth++) {
+            if (depth == MaxDepth) {
+                for (auto& entry: table->collisions) {
+                    if (entry->level == level)
+                        return &entry->node;
+                }
+                return nullptr;
+            }
+            auto& slot = table->slots[slotIndex(hash, depth)];
+            if (slot.entry)
+                return slot.entry->hash == hash && slot.entry->level == level ? &slot.entry->node : nullptr;
+            table = slot.table.get();
+        }
+        return nullptr;
+    }
+
+    /**
+     * Set or remove child node
+     * @param level             Topic level
+     * @param node              Child node, or nullptr to remove the child
+     */
+    void set(string_view level, const SharedNode& node)
+    {
+        if (node) {
+            auto entry = make_shared<Entry>(Entry{hashLevel(level), String(level.data(), level.length()), node});
+            m_root = insert(m_root, entry, 0);
+        } else if (m_root)
+            m_root = erase(m_root, hashLevel(level), level, 0);
+    }
+
+    bool empty() const
+    {
+        return !m_root;
+    }
+};
+
+void splitLevels(string_view topic, vector<string_view>& levels)
+{
+    size_t start = 0;
+    for (;;) {
+        size_t end = topic.find('/', start);
+        if (end == string_view::npos) {
+            levels.push_back(topic.substr(start));
+            return;
+        }
+        levels.push_back(topic.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+} // namespace
+
+/**
+ * Immutable trie node. Nodes are never changed after they are published in a snapshot.
+ */
+class SMQTopicTrie::Node
+{
+public:
+    ChildMap                children;       ///< Children for regular topic levels
+    SharedNode              plusChild;      ///< Child for '+' level
+    SharedNode              hashChild;      ///< Child for '#' level
+    SharedSMQSubscription   subscription;   ///< Subscription for topic filter ending at this node
+
+    bool empty() const
+    {
+        return !subscription && !plusChild && !hashChild && children.empty();
+    }
+
+    const SharedNode* child(string_view level) const
+    {
+        if (level == "+")
+            return &plusChild;
+        if (level == "#")
+            return &hashChild;
+        return children.find(level);
+    }
+
+    void child(string_view level, const SharedNode& node)
+    {
+        if (level == "+")
+            plusChild = node;
+        else if (level == "#")
+            hashChild = node;
+        else
+            children.set(level, node);
+    }
+};
+
+static SharedNode insertNode(const SharedNode& node, const vector<string_view>& levels, size_t level,
+                             const SharedSMQSubscription& subscription, bool& added)
+{
+    auto newNode = node ? make_shared<SMQTopicTrie::Node>(*node) : make_shared<SMQTopicTrie::Node>();
+
+    if (level == levels.size()) {
+        added = !newNode->subscription;
+        newNode->subscription = subscription;
+    } else {
+        auto child = newNode->child(levels[level]);
+        newNode->child(levels[level], insertNode(child ? *child : SharedNode(), levels, level + 1, subscription, added));
+    }
+
+    return newNode;
+}
+
+static SharedNode removeNode(const SharedNode& node, const vector<string_view>& levels, size_t level, bool& found)
+{
+    if (!node)
+        return node;
+
+    shared_ptr<SMQTopicTrie::Node> newNode;
+    if (level == levels.size()) {
+        if (!node->subscription)
+            return node;
+        found = true;
+        newNode = make_shared<SMQTopicTrie::Node>(*node);
+        newNode->subscription.reset();
+    } else {
+        auto child = node->child(levels[level]);
+        if (child == nullptr)
+            return node;
+        auto newChild = removeNode(*child, levels, level + 1, found);
+        if (!found)
+            return node;
+        newNode = make_shared<SMQTopicTrie::Node>(*node);
+        newNode->child(levels[level], newChild);
+    }
+
+    // Nodes without subscriptions and children are removed from the trie
+    if (newNode->empty())
+        return nullptr;
+
+    return newNode;
+}
+
+static void matchNode(const SMQTopicTrie::Node& node, const vector<string_view>& levels, size_t level,
+                      bool matchWildcards, vector<SharedSMQSubscription>& subscriptions)
+{
+    // '#' matches the parent level, and any number of remaining levels
+    if (matchWildcards && node.hashChild && node.hashChild->subscription)
+        subscriptions.push_back(node.hashChild->subscription);
+
+    if (level == levels.size()) {
+        if (node.subscription)
+            subscriptions.push_back(node.subscription);
+        return;
+    }
+
+    if (matchWildcards && node.plusChild)
+        matchNode(*node.plusChild, levels, level + 1, true, subscriptions);
+
+    auto child = node.children.find(levels[level]);
+    if (child != nullptr)
+        matchNode(**child, levels, level + 1, true, subscriptions);
+}
+
+SMQTopicTrie::SMQTopicTrie()
+{
+}
+
+bool SMQTopicTrie::isValidFilter(const String& topicFilter)
+{
+    if (topicFilter.empty())
+        return false;
+
+    vector<string_view> levels;
+    splitLevels(topicFilter, levels);
+    for (size_t i = 0; i < levels.size(); i++) {
+        auto& level = levels[i];
+        if (level.find_first_of("+#") == string_view::npos)
+            continue;
+        if (level.length() != 1)
+            return false;
+        if (level == "#" && i + 1 != levels.size())
+            return false;
+    }
+
+    return true;
+}
+
+bool SMQTopicTrie::matches(const String& topicFilter, const String& topic)
+{
+    vector<string_view> filterLevels;
+    vector<string_view> topicLevels;
+    splitLevels(topicFilter, filterLevels);
+    splitLevels(topic, topicLevels);
+
+    // Wildcards don't match topics starting with '$'
+    if (topic[0] == '$' && (filterLevels[0] == "+" || filterLevels[0] == "#"))
+        return false;
+
+    for (size_t i = 0; i < filterLevels.size(); i++) {
+        if (filterLevels[i] == "#")
+            return true;
+        if (i == topicLevels.size())
+            return false;
+        if (filterLevels[i] != "+" && filterLevels[i] != topicLevels[i])
+            return false;
+    }
+
+    return filterLevels.size() == topicLevels.size();
+}
+
+void SMQTopicTrie::insert(const String& topicFilter, const SharedSMQSubscription& subscription)
+{
+    if (!isValidFilter(topicFilter))
+        throw Exception("Invalid topic filter '" + topicFilter + "'");
+
+    vector<string_view> levels;
+    splitLevels(topicFilter, levels);
+
+    lock_guard<mutex> lock(m_writeMutex);
+    bool added = false;
+    atomic_store(&m_root, insertNode(m_root, levels, 0, subscription, added));
+    if (added)
+        m_size++;
+}
+
+bool SMQTopicTrie::remove(const String& topicFilter)
+{
+    vector<string_view> levels;
+    splitLevels(topicFilter, levels);
+
+    lock_guard<mutex> lock(m_writeMutex);
+    bool found = false;
+    auto root = removeNode(m_root, levels, 0, found);
+    if (!found)
+        return false;
+
+    atomic_store(&m_root, root);
+    m_size--;
+
+    return true;
+}
+
+SharedSMQSubscription SMQTopicTrie::find(const String& topicFilter) const
+{
+    auto root = atomic_load(&m_root);
+    if (!root)
+        return nullptr;
+
+    vector<string_view> levels;
+    splitLevels(topicFilter, levels);
+
+    const Node* node = root.get();
+    for (auto& level: levels) {
+        auto child = node->child(level);
+        if (child == nullptr || !*child)
+            return nullptr;
+        node = child->get();
+    }
+
+    return node->subscription;
+}
+
+void SMQTopicTrie::match(const String& topic, vector<SharedSMQSubscription>& subscriptions) const
+{
+    auto root = atomic_load(&m_root);
+    if (!root)
+        return;
+
+    vector<string_view> levels;
+    splitLevels(topic, levels);
+
+    // Wildcards don't match topics starting with '$', such as $SYS
+    bool matchWildcards = topic.empty() || topic[0] != '$';
+
+    matchNode(*root, levels, 0, matchWildcards, subscriptions);
+}
+
+void SMQTopicTrie::clear()
+{
+    lock_guard<mutex> lock(m_writeMutex);
+    atomic_store(&m_root, SharedNode());
+    m_size = 0;
+}
+
+size_t SMQTopicTrie::size() const
+{
+    lock_guard<mutex> lock(m_writeMutex);
+    return m_size;
+}
+
+#if USE_GTEST
+
+static SharedSMQSubscription testSubscription(LogEngine& logEngine, const String& topicFilter)
+{
+    return make_shared<SMQSubscription>(topicFilter, SMQSubscription::TOPIC, QOS(0), logEngine, 0);
+}
+
+static Strings matchTopic(const SMQTopicTrie& trie, const String& topic)
+{
+    vector<SharedSMQSubscription> subscriptions;
+    trie.match(topic, subscriptions);
+    Strings topicFilters;
+    for (auto& subscription: subscriptions)
+        topicFilters.push_back(subscription->destination());
+    topicFilters.sort();
+    return topicFilters;
+}
+
+TEST(SPTK_SMQTopicTrie, match)
+{
+    FileLogEngine logEngine("SMQTopicTrie.log");
+    SMQTopicTrie trie;
+
+    Strings topicFilters("sport/tennis/player1|sport/tennis/+|sport/#|sport/+/player1|+/+/+|#|+|/queue/test|$SYS/#", "|");
+    for (auto& topicFilter: topicFilters)
+        trie.insert(topicFilter, testSubscription(logEngine, topicFilter));
+    EXPECT_EQ(topicFilters.size(), trie.size());
+
+    EXPECT_STREQ("#|+/+/+|sport/#|sport/+/player1|sport/tennis/+|sport/tennis/player1",
+                 matchTopic(trie, "sport/tennis/player1").join("|").c_str());
+    EXPECT_STREQ("#|+/+/+|sport/#|sport/tennis/+", matchTopic(trie, "sport/tennis/player2").join("|").c_str());
+    EXPECT_STREQ("#|+|sport/#", matchTopic(trie, "sport").join("|").c_str());
+    EXPECT_STREQ("#|+/+/+|sport/#|sport/tennis/+", matchTopic(trie, "sport/tennis/").join("|").c_str());
+    EXPECT_STREQ("#|+/+/+|/queue/test", matchTopic(trie, "/queue/test").join("|").c_str());
+    EXPECT_STREQ("#", matchTopic(trie, "a/b/c/d").join("|").c_str());
+
+    // Wildcards don't match topics starting with '$'
+    EXPECT_STREQ("$SYS/#", matchTopic(trie, "$SYS/broker/uptime").join("|").c_str());
+
+    EXPECT_TRUE(trie.find("sport/+/player1") != nullptr);
+    EXPECT_TRUE(trie.find("sport/tennis") == nullptr);
+    EXPECT_TRUE(trie.find("sport/tennis/player3") == nullptr);
+}
+
+TEST(SPTK_SMQTopicTrie, matches)
+{
+    EXPECT_TRUE(SMQTopicTrie::matches("sport/tennis/+", "sport/tennis/player1"));
+    EXPECT_TRUE(SMQTopicTrie::matches("sport/#", "sport"));
+    EXPECT_TRUE(SMQTopicTrie::matches("sport/#", "sport/tennis/player1"));
+    EXPECT_TRUE(SMQTopicTrie::matches("+/+/+", "sport/tennis/"));
+    EXPECT_TRUE(SMQTopicTrie::matches("/queue/test", "/queue/test"));
+    EXPECT_FALSE(SMQTopicTrie::matches("sport/tennis/+", "sport/tennis"));
+    EXPECT_FALSE(SMQTopicTrie::matches("sport/+", "sport/tennis/player1"));
+    EXPECT_FALSE(SMQTopicTrie::matches("sport/tennis", "sport/tennis/player1"));
+    EXPECT_FALSE(SMQTopicTrie::matches("#", "$SYS/broker/uptime"));
+    EXPECT_TRUE(SMQTopicTrie::matches("$SYS/#", "$SYS/broker/uptime"));
+}
+
+TEST(SPTK_SMQTopicTrie, remove)
+{
+    FileLogEngine logEngine("SMQTopicTrie.log");
+    SMQTopicTrie trie;
+
+    trie.insert("a/b", testSubscription(logEngine, "a/b"));
+    trie.insert("a/+", testSubscription(logEngine, "a/+"));
+    trie.insert("a/b/c", testSubscription(logEngine, "a/b/c"));
+
+    EXPECT_TRUE(trie.remove("a/b"));
+    EXPECT_FALSE(trie.remove("a/b"));
+    EXPECT_FALSE(trie.remove("a"));
+    EXPECT_EQ(size_t(2), trie.size());
+
+    EXPECT_STREQ("a/+", matchTopic(trie, "a/b").join("|").c_str());
+    EXPECT_STREQ("a/b/c", matchTopic(trie, "a/b/c").join("|").c_str());
+
+    EXPECT_TRUE(trie.remove("a/b/c"));
+    EXPECT_TRUE(trie.remove("a/+"));
+    EXPECT_EQ(size_t(0), trie.size());
+    EXPECT_EQ(size_t(0), matchTopic(trie, "a/b").size());
+}
+
+TEST(SPTK_SMQTopicTrie, invalidFilters)
+{
+    FileLogEngine logEngine("SMQTopicTrie.log");
+    SMQTopicTrie trie;
+
+    EXPECT_TRUE(SMQTopicTrie::isValidFilter("a/+/#"));
+    EXPECT_FALSE(SMQTopicTrie::isValidFilter(""));
+    EXPECT_FALSE(SMQTopicTrie::isValidFilter("a/#/b"));
+    EXPECT_FALSE(SMQTopicTrie::isValidFilter("a/b+"));
+    EXPECT_FALSE(SMQTopicTrie::isValidFilter("a/#b"));
+
+    EXPECT_THROW(trie.insert("a/#/b", testSubscription(logEngine, "a/#/b")), Exception);
+}
+
+TEST(SPTK_SMQTopicTrie, performance)
+{
+    FileLogEngine   logEngine("SMQTopicTrie.log");
+    SMQTopicTrie    trie;
+    size_t          subscriptionCount {100000};
+    size_t          buildingCount {100};
+
+    // Mostly exact topic filters, with some wildcard ones
+    Strings topicFilters;
+    for (size_t i = 0; i < subscriptionCount - buildingCount * 2; i++)
+        topicFilters.push_back("devices/" + to_string(i % buildingCount) + "/sensor" + to_string(i) + "/temperature");
+    for (size_t i = 0; i < buildingCount; i++) {
+        topicFilters.push_back("devices/" + to_string(i) + "/+/humidity");
+        topicFilters.push_back("devices/" + to_string(i) + "/#");
+    }
+
+    vector<SharedSMQSubscription> subscriptions;
+    for (auto& topicFilter: topicFilters)
+        subscriptions.push_back(testSubscription(logEngine, topicFilter));
+
+    DateTime started("now");
+    for (size_t i = 0; i < subscriptionCount; i++)
+        trie.insert(topicFilters[i], subscriptions[i]);
+    DateTime ended("now");
+    EXPECT_EQ(subscriptionCount, trie.size());
+
+    auto durationMS = chrono::duration_cast<chrono::milliseconds>(ended - started).count();
+    COUT("Inserted " << subscriptionCount << " subscriptions for " << durationMS << " ms" << endl);
+
+    Strings topics;
+    for (size_t i = 0; i < 1000; i++)
+        topics.push_back("devices/" + to_string(i * 97 % buildingCount) + "/sensor" + to_string(i * 97) + "/temperature");
+
+    size_t matchCount {1000000};
+    for (size_t threadCount: {1, 4}) {
+        vector<thread> threads;
+        atomic<size_t> matched {0};
+        started = DateTime("now");
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([&trie, &topics, &matched, matchCount, threadCount]() {
+                vector<SharedSMQSubscription> found;
+                size_t threadMatched = 0;
+                for (size_t m = 0; m < matchCount / threadCount; m++) {
+                    found.clear();
+                    trie.match(topics[m % topics.size()], found);
+                    threadMatched += found.size();
+                }
+                matched += threadMatched;
+            });
+        }
+        for (auto& thread: threads)
+            thread.join();
+        ended = DateTime("now");
+
+        // Every topic matches one exact and one '#' topic filter
+        EXPECT_EQ(matchCount / threadCount * threadCount * 2, matched);
+
+        durationMS = chrono::duration_cast<chrono::milliseconds>(ended - started).count();
+        COUT(threadCount << " thread(s): matched " << matchCount << " topics for " << durationMS << " ms, "
+             << fixed << setprecision(1) << double(matchCount) / durationMS / 1000 << "M matches/s" << endl);
+    }
+}
+
+#endif
@@ -30,6 +30,7 @@
 #include <smq/clients/SMQClient.h>
 #include <smq/protocols/MQTTProtocol.h>
 #include <smq/unit_tests/SMQServer_UT.h>
+#include <sptk5/DirectoryDS.h>
 
 using namespace std;
 using namespace sptk;
@@ -456,57 +457,1279 @@ TEST(SPTK_SMQServer, mqttMinimal)
     smqServer->stop();
 }
 
+TEST(SPTK_SMQServer, mqttWildcards)
+{
+    MQProtocolType  protocolType {MP_MQTT};
+    Host            serverHost("localhost", 4013);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("sensors/+/temperature", std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    auto testMessage = make_shared<Message>(Message::MESSAGE, Buffer("This is SMQ test"));
+    smqSender.send("sensors/kitchen/temperature", testMessage, sendTimeout);
+    smqSender.send("sensors/kitchen/humidity", testMessage, sendTimeout);
+    smqSender.send("sensors/garage/temperature", testMessage, sendTimeout);
+
+    size_t maxWait = 1000;
+    while (smqReceiver.hasMessages() < 2) {
+        this_thread::sleep_for(milliseconds(1));
+        maxWait--;
+        if (maxWait == 0)
+            break;
+    }
+    this_thread::sleep_for(milliseconds(10)); // Make sure non-matching message isn't delivered
+
+    EXPECT_EQ(size_t(2), smqReceiver.hasMessages());
+
+    // Messages keep the topic they were published to
+    auto msg = smqReceiver.getMessage(milliseconds(100));
+    ASSERT_TRUE(msg != nullptr);
+    EXPECT_STREQ("sensors/kitchen/temperature", msg->destination().c_str());
+    msg = smqReceiver.getMessage(milliseconds(100));
+    ASSERT_TRUE(msg != nullptr);
+    EXPECT_STREQ("sensors/garage/temperature", msg->destination().c_str());
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, invalidSubscription)
+{
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4038);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    // Invalid subscription is rejected, and the client stays connected
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("sensors/#/temperature", std::chrono::milliseconds()));
+    ASSERT_NO_THROW(smqReceiver.subscribe("sensors/+/temperature", std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    auto testMessage = make_shared<Message>(Message::MESSAGE, Buffer("This is SMQ test"));
+    smqSender.send("sensors/kitchen/temperature", testMessage, sendTimeout);
+
+    auto msg = smqReceiver.getMessage(milliseconds(1000));
+    ASSERT_TRUE(msg != nullptr);
+    EXPECT_STREQ("sensors/kitchen/temperature", msg->destination().c_str());
+    EXPECT_TRUE(smqReceiver.connected());
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
 TEST(SPTK_SMQServer, mqttLastWill)
 {
-    Buffer          buffer;
+    Buffer          buffer;
+
+    MQProtocolType  protocolType {MP_MQTT};
+    Host            serverHost("localhost", 4008);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+
+    SMQClient smqReceiver1(protocolType, "test-receiver1");
+    SMQClient smqReceiver2(protocolType, "test-receiver2");
+    auto lastWillMessage = make_unique<MQLastWillMessage>("last_will", "Client connection terminated");
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.setLastWillMessage(lastWillMessage));
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    smqReceiver1.connect(serverHost, "user", "secret", false, connectTimeout);
+    smqReceiver2.connect(serverHost, "user", "secret", false, connectTimeout);
+    smqReceiver1.subscribe("last_will", std::chrono::milliseconds());
+    smqReceiver2.subscribe("last_will", std::chrono::milliseconds());
+
+    this_thread::sleep_for(milliseconds(100)); // Wait until subscription is completed
+
+    smqSender.disconnect(true);
+
+    int counter = 0;
+    while (true) {
+        auto msg = smqReceiver1.getMessage(milliseconds(50));
+        if (msg) {
+            counter++;
+            EXPECT_STREQ("Client connection terminated", msg->c_str());
+        } else
+            break;
+    }
+    EXPECT_EQ(counter, 1);
+
+    counter = 0;
+    while (true) {
+        auto msg = smqReceiver2.getMessage(milliseconds(50));
+        if (msg) {
+            counter++;
+            EXPECT_STREQ("Client connection terminated", msg->c_str());
+        } else
+            break;
+    }
+    EXPECT_EQ(counter, 1);
+
+    smqReceiver1.disconnect(true);
+    smqReceiver2.disconnect(true);
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, sendBatches)
+{
+    size_t          messageCount {1000};
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4011);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+    smqServer->maxSendBatchBytes(512); // Force a burst to be split into several batches
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("test-batches", std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    auto msg = make_shared<Message>();
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->set("data " + to_string(m));
+        smqSender.send("test-batches", msg, sendTimeout);
+    }
+
+    size_t maxWait = 1000;
+    while (smqReceiver.hasMessages() < messageCount) {
+        this_thread::sleep_for(milliseconds(1));
+        maxWait--;
+        if (maxWait == 0)
+            break;
+    }
+
+    EXPECT_EQ(messageCount, smqReceiver.hasMessages());
+
+    // Messages are received intact and in order
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            FAIL() << "Received " << m << " messages out of " << messageCount;
+        EXPECT_STREQ(("data " + to_string(m)).c_str(), message->c_str());
+    }
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
+static void testReliableDelivery(MQProtocolType protocolType, const Host& serverHost)
+{
+    size_t messageCount {1000};
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+    smqServer->deliveryWindowSize(16);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    smqReceiver.setDeliveryQOS(QOS_1);
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("test-reliable", std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(protocolType, "test-sender");
+    smqSender.setDeliveryQOS(QOS_1, 16);
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    auto msg = make_shared<Message>();
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->set("data " + to_string(m));
+        smqSender.send("test-reliable", msg, sendTimeout);
+    }
+
+    // Every sent message is acknowledged by the server
+    EXPECT_TRUE(smqSender.waitForAcknowledgements(seconds(5)));
+    EXPECT_EQ(size_t(0), smqSender.inFlight());
+
+    size_t maxWait = 1000;
+    while (smqReceiver.hasMessages() < messageCount) {
+        this_thread::sleep_for(milliseconds(1));
+        maxWait--;
+        if (maxWait == 0)
+            break;
+    }
+
+    EXPECT_EQ(messageCount, smqReceiver.hasMessages());
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            FAIL() << "Received " << m << " messages out of " << messageCount;
+        EXPECT_STREQ(("data " + to_string(m)).c_str(), message->c_str());
+    }
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, reliableDelivery)
+{
+    testReliableDelivery(MP_SMQ, Host("localhost", 4014));
+}
+
+TEST(SPTK_SMQServer, mqttReliableDelivery)
+{
+    testReliableDelivery(MP_MQTT, Host("localhost", 4015));
+}
+
+/**
+ * Publish large messages to a subscriber that never reads from its socket,
+ * and check the send queue overflow counters
+ */
+static void testSlowConsumer(const Host& serverHost, SMQOverflowPolicy policy)
+{
+    size_t messageCount {200};
+
+    auto smqServer = createSMQServer(MP_SMQ, serverHost);
+
+    SMQSendQueueLimits limits;
+    limits.maxFrames = 16;
+    limits.maxBytes = 1024 * 1024;
+    limits.policy = policy;
+    limits.blockTimeout = milliseconds(10);
+    smqServer->sendQueueLimits(limits);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    // Slow consumer connects and subscribes, but never reads
+    TCPSocket consumerSocket;
+    consumerSocket.open(serverHost, TCPSocket::SOM_CONNECT, true, connectTimeout);
+    SMQProtocol consumer(consumerSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = "slow-consumer";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    consumer.sendMessage("", connectMessage);
+    auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    consumer.sendMessage("test-slow", subscribeMessage);
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(String(65536, 'x')));
+    for (size_t m = 0; m < messageCount; m++)
+        smqSender.send("test-slow", msg, sendTimeout);
+
+    const SMQSendQueueStats& stats = smqServer->sendQueueStats();
+    for (size_t maxWait = 5000; maxWait > 0; maxWait -= 10) {
+        if (stats.droppedOldest + stats.droppedNewest + stats.disconnected > 0)
+            break;
+        this_thread::sleep_for(milliseconds(10));
+    }
+
+    // Queued messages never exceed the limits
+    EXPECT_GE(limits.maxFrames, stats.queuedFrames.load());
+    EXPECT_GE(limits.maxBytes + msg->bytes(), stats.queuedBytes.load());
+
+    switch (policy) {
+        case OVERFLOW_BLOCK:
+            EXPECT_LT(uint64_t(0), stats.blocked.load());
+            EXPECT_EQ(uint64_t(1), stats.disconnected.load()); // Block timeout
+            break;
+        case OVERFLOW_DROP_OLDEST:
+            EXPECT_LT(uint64_t(0), stats.droppedOldest.load());
+            break;
+        case OVERFLOW_DROP_NEWEST:
+            EXPECT_LT(uint64_t(0), stats.droppedNewest.load());
+            EXPECT_EQ(uint64_t(0), stats.droppedOldest.load());
+            break;
+        case OVERFLOW_DISCONNECT:
+            EXPECT_EQ(uint64_t(1), stats.disconnected.load());
+            break;
+    }
+
+    smqSender.disconnect(true);
+    consumerSocket.close();
+
+    // Queued frames are released when the consumer connection is gone
+    for (size_t maxWait = 1000; maxWait > 0 && stats.queuedBytes > 0; maxWait -= 10)
+        this_thread::sleep_for(milliseconds(10));
+    EXPECT_EQ(size_t(0), stats.queuedBytes.load());
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, slowConsumerBlock)
+{
+    testSlowConsumer(Host("localhost", 4017), OVERFLOW_BLOCK);
+}
+
+TEST(SPTK_SMQServer, slowConsumerBackpressure)
+{
+    size_t messageCount {200};
+    Host   serverHost("localhost", 4034);
+
+    auto smqServer = createSMQServer(MP_SMQ, serverHost);
+
+    SMQSendQueueLimits limits;
+    limits.maxFrames = 16;
+    limits.maxBytes = 1024 * 1024;
+    limits.policy = OVERFLOW_BLOCK;
+    limits.blockTimeout = seconds(30);
+    smqServer->sendQueueLimits(limits);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    // Slow consumer doesn't read until the publisher is paused
+    TCPSocket consumerSocket;
+    consumerSocket.open(serverHost, TCPSocket::SOM_CONNECT, true, connectTimeout);
+    SMQProtocol consumer(consumerSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = "slow-consumer";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    consumer.sendMessage("", connectMessage);
+    auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    consumer.sendMessage("test-slow", subscribeMessage);
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    // Paused publisher can't write when its socket buffer is full
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(String(65536, 'x')));
+    thread publisher([&]() {
+        for (size_t m = 0; m < messageCount; m++)
+            smqSender.send("test-slow", msg, sendTimeout);
+    });
+
+    const SMQSendQueueStats& stats = smqServer->sendQueueStats();
+    for (size_t maxWait = 5000; maxWait > 0 && stats.blocked == 0; maxWait -= 10)
+        this_thread::sleep_for(milliseconds(10));
+    EXPECT_LT(uint64_t(0), stats.blocked.load());
+
+    // Other connections are served while the publisher is paused
+    SMQClient otherReceiver(MP_SMQ, "other-receiver");
+    ASSERT_NO_THROW(otherReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(otherReceiver.subscribe("test-other", std::chrono::milliseconds()));
+    SMQClient otherSender(MP_SMQ, "other-sender");
+    ASSERT_NO_THROW(otherSender.connect(serverHost, "user", "secret", false, connectTimeout));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+    auto otherMsg = make_shared<Message>(Message::MESSAGE, Buffer("Not blocked"));
+    otherSender.send("test-other", otherMsg, sendTimeout);
+    auto otherMessage = otherReceiver.getMessage(seconds(1));
+    ASSERT_TRUE(otherMessage != nullptr);
+    EXPECT_STREQ("Not blocked", otherMessage->c_str());
+
+    // Queue is drained, and publisher resumes: no messages are lost
+    size_t received = 0;
+    while (received < messageCount && consumerSocket.readyToRead(seconds(3))) {
+        SMessage message;
+        consumer.readMessage(message);
+        if (message->type() == Message::MESSAGE)
+            received++;
+    }
+    publisher.join();
+
+    EXPECT_EQ(messageCount, received);
+    EXPECT_EQ(uint64_t(0), stats.droppedOldest.load());
+    EXPECT_EQ(uint64_t(0), stats.droppedNewest.load());
+    EXPECT_EQ(uint64_t(0), stats.disconnected.load());
+    EXPECT_EQ(size_t(0), stats.congested.load());
+
+    otherSender.disconnect(true);
+    otherReceiver.disconnect(true);
+    smqSender.disconnect(true);
+    consumerSocket.close();
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, slowConsumerDropOldest)
+{
+    testSlowConsumer(Host("localhost", 4018), OVERFLOW_DROP_OLDEST);
+}
+
+TEST(SPTK_SMQServer, slowConsumerDropNewest)
+{
+    testSlowConsumer(Host("localhost", 4019), OVERFLOW_DROP_NEWEST);
+}
+
+TEST(SPTK_SMQServer, slowConsumerDisconnect)
+{
+    testSlowConsumer(Host("localhost", 4020), OVERFLOW_DISCONNECT);
+}
+
+/**
+ * QoS 1 consumer never acknowledges, so messages wait for delivery window slots.
+ * Waiting messages count against send queue limits.
+ */
+TEST(SPTK_SMQServer, slowReliableConsumer)
+{
+    size_t messageCount {200};
+    size_t windowSize {16};
+    Host   serverHost("localhost", 4036);
+
+    auto smqServer = createSMQServer(MP_SMQ, serverHost);
+    smqServer->deliveryWindowSize(windowSize);
+
+    SMQSendQueueLimits limits;
+    limits.maxFrames = 16;
+    limits.policy = OVERFLOW_DROP_NEWEST;
+    smqServer->sendQueueLimits(limits);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    TCPSocket consumerSocket;
+    consumerSocket.open(serverHost, TCPSocket::SOM_CONNECT, true, connectTimeout);
+    SMQProtocol consumer(consumerSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = "slow-consumer";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    consumer.sendMessage("", connectMessage);
+    auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    (*subscribeMessage)["qos"] = "1";
+    consumer.sendMessage("test-slow", subscribeMessage);
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    smqSender.setDeliveryQOS(QOS_1);
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer("data"));
+    for (size_t m = 0; m < messageCount; m++)
+        smqSender.send("test-slow", msg, sendTimeout);
+    EXPECT_TRUE(smqSender.waitForAcknowledgements(seconds(5)));
+
+    // Only the window and the queue limit are kept, the rest is dropped
+    const SMQSendQueueStats& stats = smqServer->sendQueueStats();
+    EXPECT_GE(limits.maxFrames, stats.queuedFrames.load());
+    EXPECT_LE(uint64_t(messageCount - windowSize - limits.maxFrames), stats.droppedNewest.load());
+
+    smqSender.disconnect(true);
+    consumerSocket.close();
+
+    for (size_t maxWait = 1000; maxWait > 0 && stats.queuedBytes > 0; maxWait -= 10)
+        this_thread::sleep_for(milliseconds(10));
+    EXPECT_EQ(size_t(0), stats.queuedBytes.load());
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, binaryWireFormat)
+{
+    size_t          messageCount {90};
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4021);
+    Strings         destinations("test-queue1|test-queue2|test-queue3", "|");
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    for (auto& destination: destinations)
+        ASSERT_NO_THROW(smqReceiver.subscribe(destination, std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription and negotiation are completed
+
+    EXPECT_EQ(SMQProtocol::LatestVersion, smqSender.protocol().version());
+    EXPECT_EQ(SMQProtocol::LatestVersion, smqReceiver.protocol().version());
+
+    // After the first message, every destination is sent as interned id
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(""));
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->headers()["subject"] = "subject " + to_string(m);
+        msg->headers()["client_id"] = "sender";
+        msg->set("data " + to_string(m));
+        smqSender.send(destinations[m % destinations.size()], msg, sendTimeout);
+    }
+
+    for (size_t maxWait = 1000; maxWait > 0 && smqReceiver.hasMessages() < messageCount; maxWait--)
+        this_thread::sleep_for(milliseconds(1));
+
+    EXPECT_EQ(messageCount, smqReceiver.hasMessages());
+
+    size_t receivedMessages = 0;
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            break;
+        String subject = (*message)["subject"];
+        auto index = (size_t) string2int(subject.substr(8));
+        EXPECT_STREQ(destinations[index % destinations.size()].c_str(), message->destination().c_str());
+        EXPECT_STREQ(("data " + to_string(index)).c_str(), message->c_str());
+        EXPECT_STREQ("sender", (*message)["client_id"].c_str());
+        receivedMessages++;
+    }
+    EXPECT_EQ(messageCount, receivedMessages);
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, mixedWireFormats)
+{
+    size_t          messageCount {50};
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4022);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    // Version 1 consumer doesn't request binary wire format
+    TCPSocket consumerSocket;
+    consumerSocket.open(serverHost, TCPSocket::SOM_CONNECT, true, connectTimeout);
+    SMQProtocol consumer(consumerSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = "text-consumer";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    consumer.sendMessage("", connectMessage);
+    auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    consumer.sendMessage("/topic/mixed", subscribeMessage);
+
+    SMQClient smqReceiver(protocolType, "binary-consumer");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("/topic/mixed", std::chrono::milliseconds()));
+
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription and negotiation are completed
+
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(""));
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->headers()["subject"] = "subject " + to_string(m);
+        msg->set("data " + to_string(m));
+        smqSender.send("/topic/mixed", msg, sendTimeout);
+    }
+
+    size_t textMessages = 0;
+    while (textMessages < messageCount && consumerSocket.readyToRead(seconds(1))) {
+        SMessage message;
+        consumer.readMessage(message);
+        if (message->type() != Message::MESSAGE)
+            continue;
+        EXPECT_STREQ("/topic/mixed", message->destination().c_str());
+        EXPECT_STREQ(("subject " + to_string(textMessages)).c_str(), (*message)["subject"].c_str());
+        EXPECT_STREQ(("data " + to_string(textMessages)).c_str(), message->c_str());
+        textMessages++;
+    }
+    EXPECT_EQ(messageCount, textMessages);
+    EXPECT_EQ(1, consumer.version());
+
+    for (size_t maxWait = 1000; maxWait > 0 && smqReceiver.hasMessages() < messageCount; maxWait--)
+        this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(messageCount, smqReceiver.hasMessages());
+    EXPECT_EQ(SMQProtocol::LatestVersion, smqReceiver.protocol().version());
+
+    // Binary frame is more compact than text frame
+    SMQProtocol binaryProtocol(consumerSocket);
+    auto connectAck = make_shared<Message>(Message::CONNECT_ACK);
+    (*connectAck)["protocol_version"] = "2";
+    binaryProtocol.negotiate(*connectAck);
+    EXPECT_GT(consumer.encodeMessage("/topic/mixed", *msg)->bytes(),
+              binaryProtocol.encodeMessage("/topic/mixed", *msg)->bytes());
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+    consumerSocket.close();
+
+    smqServer->stop();
+}
+
+static vector<unique_ptr<SMQServer>> createSMQCluster(const vector<Host>& nodes)
+{
+    vector<unique_ptr<SMQServer>> servers;
+    for (auto& node: nodes) {
+        auto smqServer = createSMQServer(MP_SMQ, node);
+        smqServer->enableCluster(node, nodes, "cluster-secret", milliseconds(50));
+        servers.push_back(move(smqServer));
+    }
+    return servers;
+}
+
+static bool waitForClusterMembers(const vector<unique_ptr<SMQServer>>& servers, size_t memberCount)
+{
+    for (size_t maxWait = 500; maxWait > 0; maxWait--) {
+        bool complete = true;
+        for (auto& smqServer: servers) {
+            if (smqServer && smqServer->cluster()->members().size() != memberCount)
+                complete = false;
+        }
+        if (complete)
+            return true;
+        this_thread::sleep_for(milliseconds(10));
+    }
+    return false;
+}
+
+static size_t waitForMessages(SMQClient& client, size_t messageCount)
+{
+    for (size_t maxWait = 1000; maxWait > 0 && client.hasMessages() < messageCount; maxWait--)
+        this_thread::sleep_for(milliseconds(1));
+    return client.hasMessages();
+}
+
+TEST(SPTK_SMQServer, clusterTopicRouting)
+{
+    size_t          messageCount {100};
+    vector<Host>    nodes = {Host("localhost", 4023), Host("localhost", 4024), Host("localhost", 4025)};
+
+    auto servers = createSMQCluster(nodes);
+    ASSERT_TRUE(waitForClusterMembers(servers, nodes.size()));
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqReceiver(MP_SMQ, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(nodes[2], "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("/topic/cluster", std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(50)); // Wait until subscription is forwarded to peers
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(nodes[0], "user", "secret", false, connectTimeout));
+
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(""));
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->set("data " + to_string(m));
+        smqSender.send("/topic/cluster", msg, sendTimeout);
+    }
+
+    EXPECT_EQ(messageCount, waitForMessages(smqReceiver, messageCount));
+    auto message = smqReceiver.getMessage(milliseconds(100));
+    ASSERT_TRUE(message != nullptr);
+    EXPECT_STREQ("/topic/cluster", message->destination().c_str());
+    EXPECT_STREQ("data 0", message->c_str());
+
+    // Messages only travel to the node that has subscribers
+    EXPECT_EQ(size_t(0), servers[1]->cluster()->receivedMessages());
+    EXPECT_EQ(messageCount, servers[2]->cluster()->receivedMessages());
+
+    // Client with peer node client id is rejected without the cluster key
+    TCPSocket impostorSocket;
+    impostorSocket.open(nodes[1], TCPSocket::SOM_CONNECT, true, connectTimeout);
+    SMQProtocol impostor(impostorSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = SMQCluster::NodeClientIdPrefix + "impostor";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    impostor.sendMessage("", connectMessage);
+    bool rejected = true;
+    try {
+        SMessage reply;
+        if (impostorSocket.readyToRead(seconds(3)) && impostor.readMessage(reply))
+            rejected = reply->type() != Message::CONNECT_ACK;
+    }
+    catch (const Exception&) {
+        rejected = true;
+    }
+    EXPECT_TRUE(rejected);
+    impostorSocket.close();
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    for (auto& smqServer: servers)
+        smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, clusterQueueOwnership)
+{
+    size_t          messageCount {100};
+    String          queueName("/queue/cluster");
+    vector<Host>    nodes = {Host("localhost", 4026), Host("localhost", 4027), Host("localhost", 4028)};
+
+    auto servers = createSMQCluster(nodes);
+    ASSERT_TRUE(waitForClusterMembers(servers, nodes.size()));
+
+    // All the nodes agree on the queue owner
+    String owner = servers[0]->cluster()->owner(queueName);
+    size_t ownerIndex = nodes.size();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        EXPECT_STREQ(owner.c_str(), servers[i]->cluster()->owner(queueName).c_str());
+        if (servers[i]->cluster()->nodeName() == owner)
+            ownerIndex = i;
+    }
+    ASSERT_GT(nodes.size(), ownerIndex);
+
+    // Consumer and publisher are connected to the nodes that don't own the queue
+    size_t consumerIndex = (ownerIndex + 1) % nodes.size();
+    size_t publisherIndex = (ownerIndex + 2) % nodes.size();
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqReceiver(MP_SMQ, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(nodes[consumerIndex], "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe(queueName, std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(50)); // Wait until subscription is forwarded to the owner
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(nodes[publisherIndex], "user", "secret", false, connectTimeout));
+
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer("queue data"));
+    for (size_t m = 0; m < messageCount; m++)
+        smqSender.send(queueName, msg, sendTimeout);
+
+    // Every message is delivered once, through the owner
+    EXPECT_EQ(messageCount, waitForMessages(smqReceiver, messageCount));
+    EXPECT_EQ(messageCount, servers[publisherIndex]->cluster()->forwardedMessages());
+    EXPECT_EQ(messageCount, servers[consumerIndex]->cluster()->receivedMessages());
+    while (smqReceiver.getMessage(milliseconds(10))) {}
+
+    // When the owner leaves, the queue is handed off to another node
+    smqSender.disconnect(true);
+    servers[ownerIndex]->stop();
+    servers[ownerIndex].reset();
+    ASSERT_TRUE(waitForClusterMembers(servers, nodes.size() - 1));
+
+    String newOwner = servers[consumerIndex]->cluster()->owner(queueName);
+    EXPECT_STRNE(owner.c_str(), newOwner.c_str());
+    EXPECT_STREQ(newOwner.c_str(), servers[publisherIndex]->cluster()->owner(queueName).c_str());
+    this_thread::sleep_for(milliseconds(50)); // Wait until subscription is forwarded to the new owner
+
+    SMQClient smqSender2(MP_SMQ, "test-sender2");
+    ASSERT_NO_THROW(smqSender2.connect(nodes[publisherIndex], "user", "secret", false, connectTimeout));
+    for (size_t m = 0; m < messageCount; m++)
+        smqSender2.send(queueName, msg, sendTimeout);
+
+    EXPECT_EQ(messageCount, waitForMessages(smqReceiver, messageCount));
+
+    smqSender2.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    for (auto& smqServer: servers) {
+        if (smqServer)
+            smqServer->stop();
+    }
+}
+
+static void removeDirectory(const String& directory)
+{
+    DirectoryDS directoryDS(directory, "", DDS_HIDE_DOT_FILES);
+    try {
+        directoryDS.open();
+    }
+    catch (const Exception&) {
+        return; // Directory doesn't exist
+    }
+    while (!directoryDS.eof()) {
+        String path = directory + "/" + directoryDS["Name"].asString();
+        if (directoryDS["Type"].asString() == "Directory")
+            removeDirectory(path);
+        else
+            remove(path.c_str());
+        directoryDS.next();
+    }
+    directoryDS.close();
+    rmdir(directory.c_str());
+}
+
+TEST(SPTK_SMQServer, durableQueue)
+{
+    size_t          messageCount {100};
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4012);
+    String          storeDirectory("/tmp/smq_durable_queue_test");
+    String          queueName("/queue/durable");
+
+    removeDirectory(storeDirectory);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    {
+        auto smqServer = createSMQServer(protocolType, serverHost);
+        smqServer->enablePersistence(storeDirectory, SYNC_ALWAYS);
+
+        // Messages are sent while there are no consumers
+        SMQClient smqSender(protocolType, "test-sender");
+        ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+        auto msg = make_shared<Message>();
+        for (size_t m = 0; m < messageCount; m++) {
+            msg->set("data " + to_string(m));
+            smqSender.send(queueName, msg, sendTimeout);
+        }
+        this_thread::sleep_for(milliseconds(100)); // Wait until the messages are stored
+        smqSender.disconnect(true);
+
+        smqServer->stop();
+    }
+
+    // Stored messages survive server restart, and are delivered to the first consumer
+    auto smqServer = createSMQServer(protocolType, serverHost);
+    smqServer->enablePersistence(storeDirectory, SYNC_ALWAYS);
+
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe(queueName, std::chrono::milliseconds()));
+
+    size_t maxWait = 1000;
+    while (smqReceiver.hasMessages() < messageCount) {
+        this_thread::sleep_for(milliseconds(1));
+        maxWait--;
+        if (maxWait == 0)
+            break;
+    }
+
+    EXPECT_EQ(messageCount, smqReceiver.hasMessages());
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            FAIL() << "Received " << m << " messages out of " << messageCount;
+        EXPECT_STREQ(("data " + to_string(m)).c_str(), message->c_str());
+    }
+
+    smqReceiver.disconnect(true);
+    smqServer->stop();
+
+    removeDirectory(storeDirectory);
+}
+
+/**
+ * Durable queue message stays stored until QoS 1 consumer acknowledges it
+ */
+TEST(SPTK_SMQServer, durableQueueUnacknowledged)
+{
+    size_t          messageCount {10};
+    Host            serverHost("localhost", 4037);
+    String          storeDirectory("/tmp/smq_durable_unacknowledged_test");
+    String          queueName("/queue/durable");
 
-    MQProtocolType  protocolType {MP_MQTT};
-    Host            serverHost("localhost", 4008);
+    removeDirectory(storeDirectory);
 
-    auto smqServer = createSMQServer(protocolType, serverHost);
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    auto smqServer = createSMQServer(MP_SMQ, serverHost);
+    smqServer->enablePersistence(storeDirectory, SYNC_ALWAYS);
+
+    // Consumer receives the messages, but disconnects without acknowledging them
+    TCPSocket consumerSocket;
+    consumerSocket.open(serverHost, TCPSocket::SOM_CONNECT, true, connectTimeout);
+    SMQProtocol consumer(consumerSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = "unacknowledging-consumer";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    consumer.sendMessage("", connectMessage);
+    auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    (*subscribeMessage)["qos"] = "1";
+    consumer.sendMessage(queueName, subscribeMessage);
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    smqSender.setDeliveryQOS(QOS_1);
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+    auto msg = make_shared<Message>();
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->set("data " + to_string(m));
+        smqSender.send(queueName, msg, sendTimeout);
+    }
+    EXPECT_TRUE(smqSender.waitForAcknowledgements(seconds(5)));
+    smqSender.disconnect(true);
+
+    auto messageStore = smqServer->messageStore();
+    ASSERT_TRUE(messageStore != nullptr);
+    EXPECT_EQ(messageCount, messageStore->pending(queueName));
+
+    consumerSocket.close();
+    this_thread::sleep_for(milliseconds(100)); // Wait until the server closes the connection
+
+    // Unacknowledged messages are delivered to the next consumer
+    SMQClient smqReceiver(MP_SMQ, "test-receiver");
+    smqReceiver.setDeliveryQOS(QOS_1);
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe(queueName, std::chrono::milliseconds()));
+
+    EXPECT_EQ(messageCount, waitForMessages(smqReceiver, messageCount));
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            FAIL() << "Received " << m << " messages out of " << messageCount;
+        EXPECT_STREQ(("data " + to_string(m)).c_str(), message->c_str());
+    }
+
+    // Acknowledged messages are consumed
+    for (size_t maxWait = 1000; maxWait > 0 && messageStore->pending(queueName) > 0; maxWait -= 10)
+        this_thread::sleep_for(milliseconds(10));
+    EXPECT_EQ(size_t(0), messageStore->pending(queueName));
+
+    smqReceiver.disconnect(true);
+    smqServer->stop();
+
+    removeDirectory(storeDirectory);
+}
+
+static void sendRetained(SMQClient& sender, const String& topic, const String& data)
+{
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(data));
+    msg->headers()["retain"] = "1";
+    sender.send(topic, msg, seconds(1));
+}
+
+static Strings receiveMessages(SMQClient& receiver, size_t messageCount)
+{
+    waitForMessages(receiver, messageCount);
+    Strings messages;
+    while (auto message = receiver.getMessage(milliseconds(10))) {
+        String retain = message->headers().find("retain") != message->headers().end() ? " retained" : "";
+        messages.push_back(message->destination() + "=" + message->c_str() + retain);
+    }
+    messages.sort();
+    return messages;
+}
 
+static void testRetainedMessages(MQProtocolType protocolType, const Host& serverHost)
+{
     seconds connectTimeout(10);
 
-    SMQClient smqReceiver1(protocolType, "test-receiver1");
-    SMQClient smqReceiver2(protocolType, "test-receiver2");
-    auto lastWillMessage = make_unique<MQLastWillMessage>("last_will", "Client connection terminated");
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
     SMQClient smqSender(protocolType, "test-sender");
-    ASSERT_NO_THROW(smqSender.setLastWillMessage(lastWillMessage));
     ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+    sendRetained(smqSender, "/retained/1", "v1");
+    sendRetained(smqSender, "/retained/1", "v2");
+    sendRetained(smqSender, "/retained/2", "w1");
+    this_thread::sleep_for(milliseconds(50)); // Wait until the messages are retained
 
-    smqReceiver1.connect(serverHost, "user", "secret", false, connectTimeout);
-    smqReceiver2.connect(serverHost, "user", "secret", false, connectTimeout);
-    smqReceiver1.subscribe("last_will", std::chrono::milliseconds());
-    smqReceiver2.subscribe("last_will", std::chrono::milliseconds());
+    // New subscriber gets the last values immediately
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("/retained/+", std::chrono::milliseconds()));
+    EXPECT_STREQ("/retained/1=v2 retained|/retained/2=w1 retained", receiveMessages(smqReceiver, 2).join("|").c_str());
 
-    this_thread::sleep_for(milliseconds(100)); // Wait until subscription is completed
+    // Existing subscriber gets messages without retain flag
+    sendRetained(smqSender, "/retained/1", "v3");
+    EXPECT_STREQ("/retained/1=v3", receiveMessages(smqReceiver, 1).join("|").c_str());
+    EXPECT_EQ(size_t(2), smqServer->retainedMessages().size());
 
     smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+    smqServer->stop();
+}
 
-    int counter = 0;
-    while (true) {
-        auto msg = smqReceiver1.getMessage(milliseconds(50));
-        if (msg) {
-            counter++;
-            EXPECT_STREQ("Client connection terminated", msg->c_str());
-        } else
-            break;
+TEST(SPTK_SMQServer, retainedMessages)
+{
+    testRetainedMessages(MP_SMQ, Host("localhost", 4029));
+}
+
+TEST(SPTK_SMQServer, mqttRetainedMessages)
+{
+    testRetainedMessages(MP_MQTT, Host("localhost", 4030));
+}
+
+TEST(SPTK_SMQServer, durableRetainedMessages)
+{
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4031);
+    String          storeDirectory("/tmp/smq_retained_test");
+
+    removeDirectory(storeDirectory);
+
+    seconds connectTimeout(10);
+
+    {
+        auto smqServer = createSMQServer(protocolType, serverHost);
+        smqServer->enablePersistence(storeDirectory, SYNC_ALWAYS);
+
+        SMQClient smqSender(protocolType, "test-sender");
+        ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+        for (size_t m = 0; m < 10; m++)
+            sendRetained(smqSender, "/retained/" + to_string(m % 3), "data " + to_string(m));
+        sendRetained(smqSender, "/retained/2", "");
+        this_thread::sleep_for(milliseconds(100)); // Wait until the messages are stored
+        smqSender.disconnect(true);
+
+        smqServer->stop();
     }
-    EXPECT_EQ(counter, 1);
 
-    counter = 0;
-    while (true) {
-        auto msg = smqReceiver2.getMessage(milliseconds(50));
-        if (msg) {
-            counter++;
-            EXPECT_STREQ("Client connection terminated", msg->c_str());
-        } else
-            break;
+    // Retained messages survive server restart
+    auto smqServer = createSMQServer(protocolType, serverHost);
+    smqServer->enablePersistence(storeDirectory, SYNC_ALWAYS);
+    EXPECT_EQ(size_t(2), smqServer->retainedMessages().size());
+
+    SMQClient smqReceiver(protocolType, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("/retained/#", std::chrono::milliseconds()));
+    EXPECT_STREQ("/retained/0=data 9 retained|/retained/1=data 7 retained",
+                 receiveMessages(smqReceiver, 2).join("|").c_str());
+
+    smqReceiver.disconnect(true);
+    smqServer->stop();
+
+    removeDirectory(storeDirectory);
+}
+
+static void testAsyncPublish(const Host& serverHost, QOS qos)
+{
+    size_t messageCount {1000};
+
+    auto smqServer = createSMQServer(MP_SMQ, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqReceiver(MP_SMQ, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connect(serverHost, "user", "secret", false, connectTimeout));
+    ASSERT_NO_THROW(smqReceiver.subscribe("test-async", std::chrono::milliseconds()));
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    smqSender.setDeliveryQOS(qos, 16);
+    smqSender.setBatching(1024, milliseconds(5));
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    // First half is sent as a single batch
+    vector<BaseMQClient::OutgoingMessage> batch;
+    for (size_t m = 0; m < messageCount / 2; m++)
+        batch.emplace_back("test-async", make_shared<Message>(Message::MESSAGE, Buffer("data " + to_string(m))));
+    ASSERT_NO_THROW(smqSender.sendBatch(batch, sendTimeout));
+
+    // Second half is sent asynchronously, every message completes exactly once
+    atomic<size_t> completed {0};
+    atomic<size_t> failed {0};
+    future<void> lastSent;
+    for (size_t m = messageCount / 2; m < messageCount; m++) {
+        auto msg = make_shared<Message>(Message::MESSAGE, Buffer("data " + to_string(m)));
+        if (m == messageCount - 1)
+            lastSent = smqSender.sendAsync("test-async", msg);
+        else
+            smqSender.sendAsync("test-async", msg,
+                                [&completed, &failed](const SMessage&, const exception_ptr& error) {
+                                    if (error)
+                                        failed++;
+                                    else
+                                        completed++;
+                                });
     }
-    EXPECT_EQ(counter, 1);
 
-    smqReceiver1.disconnect(true);
-    smqReceiver2.disconnect(true);
+    EXPECT_TRUE(smqSender.flush(seconds(5)));
+    EXPECT_EQ(size_t(0), smqSender.pending());
+    ASSERT_EQ(future_status::ready, lastSent.wait_for(seconds(5)));
+    EXPECT_NO_THROW(lastSent.get());
+    EXPECT_TRUE(smqSender.waitForAcknowledgements(seconds(5)));
+    EXPECT_EQ(messageCount / 2 - 1, completed.load());
+    EXPECT_EQ(size_t(0), failed.load());
+
+    EXPECT_EQ(messageCount, waitForMessages(smqReceiver, messageCount));
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            FAIL() << "Received " << m << " messages out of " << messageCount;
+        EXPECT_STREQ(("data " + to_string(m)).c_str(), message->c_str());
+    }
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, asyncPublish)
+{
+    testAsyncPublish(Host("localhost", 4032), QOS_0);
+}
+
+TEST(SPTK_SMQServer, asyncReliablePublish)
+{
+    testAsyncPublish(Host("localhost", 4033), QOS_1);
+}
+
+TEST(SPTK_SMQServer, asyncPublishPendingLimit)
+{
+    Host serverHost("localhost", 4035);
+    auto smqServer = createSMQServer(MP_SMQ, serverHost);
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    // Linger is long enough to keep the messages pending
+    smqSender.setBatching(1024 * 1024, seconds(10), 256, milliseconds(50));
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, seconds(10)));
+
+    auto msg1 = make_shared<Message>(Message::MESSAGE, Buffer(String(200, 'x')));
+    ASSERT_NO_THROW(smqSender.sendAsync("test-async", msg1, nullptr));
+
+    // Pending size would exceed the limit: sendAsync waits for max block time, and fails
+    atomic<bool> called {false};
+    auto msg2 = make_shared<Message>(Message::MESSAGE, Buffer(String(200, 'y')));
+    DateTime started("now");
+    EXPECT_THROW(smqSender.sendAsync("test-async", msg2,
+                                     [&called](const SMessage&, const exception_ptr&) { called = true; }),
+                 TimeoutException);
+    EXPECT_GE(chrono::duration_cast<milliseconds>(DateTime::Now() - started).count(), 40);
+    EXPECT_EQ(size_t(1), smqSender.pending());
+
+    // After the pending messages are sent, there is space again
+    EXPECT_TRUE(smqSender.flush(seconds(1)));
+    EXPECT_NO_THROW(smqSender.sendAsync("test-async", msg2, nullptr));
+    EXPECT_TRUE(smqSender.flush(seconds(1)));
+    EXPECT_FALSE(called);
+
+    smqSender.disconnect(true);
+    smqServer->stop();
+}
+
+static void testLocalTransport(const String& socketPath, bool sharedMemory)
+{
+    size_t messageCount {1000};
+
+    if (!logEngine)
+        logEngine = make_shared<FileLogEngine>("SMQServer.log");
+
+    auto smqServer = make_unique<SMQServer>(MP_SMQ, "user", "secret", *logEngine);
+    smqServer->listen(socketPath);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqReceiver(MP_SMQ, "test-receiver");
+    ASSERT_NO_THROW(smqReceiver.connectLocal(socketPath, "user", "secret", connectTimeout, sharedMemory));
+    EXPECT_EQ(sharedMemory, smqReceiver.sharedMemoryActive());
+    ASSERT_NO_THROW(smqReceiver.subscribe("test-local", std::chrono::milliseconds()));
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    ASSERT_NO_THROW(smqSender.connectLocal(socketPath, "user", "secret", connectTimeout, sharedMemory));
+    EXPECT_EQ(sharedMemory, smqSender.sharedMemoryActive());
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    auto msg = make_shared<Message>();
+    for (size_t m = 0; m < messageCount; m++) {
+        msg->set("data " + to_string(m));
+        smqSender.send("test-local", msg, sendTimeout);
+    }
+
+    // Message larger than shared memory ring is passed in parts
+    size_t largeSize = MQSharedMemorySocket::DefaultRingCapacity * 3;
+    Buffer largeData(largeSize);
+    for (size_t i = 0; i < largeSize; i++)
+        largeData.append(char('A' + i % 26));
+    auto largeMessage = make_shared<Message>(Message::MESSAGE, largeData);
+    smqSender.send("test-local", largeMessage, sendTimeout);
+
+    EXPECT_EQ(messageCount + 1, waitForMessages(smqReceiver, messageCount + 1));
+    for (size_t m = 0; m < messageCount; m++) {
+        auto message = smqReceiver.getMessage(milliseconds(100));
+        if (!message)
+            FAIL() << "Received " << m << " messages out of " << messageCount;
+        EXPECT_STREQ(("data " + to_string(m)).c_str(), message->c_str());
+    }
+
+    auto message = smqReceiver.getMessage(milliseconds(100));
+    ASSERT_TRUE(message != nullptr);
+    EXPECT_EQ(largeData.bytes(), message->bytes());
+    EXPECT_EQ(0, memcmp(largeData.data(), message->data(), largeData.bytes()));
+
+    smqSender.disconnect(true);
+    smqReceiver.disconnect(true);
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, unixSocket)
+{
+    testLocalTransport("/tmp/sptk_smq_server.sock", false);
+}
+
+TEST(SPTK_SMQServer, sharedMemory)
+{
+    testLocalTransport("/tmp/sptk_smq_server_shm.sock", true);
+}
+
+/**
+ * Subscriber with shared memory transport stops reading, and is disconnected after write timeout
+ */
+TEST(SPTK_SMQServer, sharedMemorySlowConsumer)
+{
+    String socketPath("/tmp/sptk_smq_server_shm_slow.sock");
+
+    if (!logEngine)
+        logEngine = make_shared<FileLogEngine>("SMQServer.log");
+
+    auto smqServer = make_unique<SMQServer>(MP_SMQ, "user", "secret", *logEngine);
+    SMQSendQueueLimits limits;
+    limits.writeTimeout = milliseconds(100);
+    smqServer->sendQueueLimits(limits);
+    smqServer->listen(socketPath);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    // Consumer switches to shared memory transport and subscribes, but never reads
+    MQSharedMemorySocket consumerSocket;
+    consumerSocket.openUnix(socketPath);
+    consumerSocket.requestSharedMemory();
+    SMQProtocol consumer(consumerSocket);
+    auto connectMessage = make_shared<Message>(Message::CONNECT);
+    (*connectMessage)["client_id"] = "slow-consumer";
+    (*connectMessage)["username"] = "user";
+    (*connectMessage)["password"] = "secret";
+    (*connectMessage)["shared_memory"] = "1";
+    consumer.sendMessage("", connectMessage);
+    ASSERT_TRUE(consumerSocket.readyToRead(connectTimeout));
+    SMessage connectAck;
+    consumer.readMessage(connectAck);
+    ASSERT_EQ(Message::CONNECT_ACK, connectAck->type());
+    ASSERT_STREQ("1", connectAck->headers()["shared_memory"].c_str());
+    consumerSocket.attachSharedMemory();
+    consumerSocket.activateSharedMemory();
+    auto subscribeMessage = make_shared<Message>(Message::SUBSCRIBE);
+    consumer.sendMessage("test-shm-slow", subscribeMessage);
+    this_thread::sleep_for(milliseconds(10)); // Wait until subscription is completed
+
+    SMQClient smqSender(MP_SMQ, "test-sender");
+    ASSERT_NO_THROW(smqSender.connectLocal(socketPath, "user", "secret", connectTimeout, false));
+
+    // Messages don't fit into the ring, and fit into the send queue
+    auto msg = make_shared<Message>(Message::MESSAGE, Buffer(String(65536, 'x')));
+    size_t messageCount = MQSharedMemorySocket::DefaultRingCapacity / msg->bytes() * 2;
+    for (size_t m = 0; m < messageCount; m++)
+        smqSender.send("test-shm-slow", msg, sendTimeout);
+
+    const SMQSendQueueStats& stats = smqServer->sendQueueStats();
+    for (size_t maxWait = 5000; maxWait > 0 && stats.disconnected == 0; maxWait -= 10)
+        this_thread::sleep_for(milliseconds(10));
+    EXPECT_EQ(uint64_t(1), stats.disconnected.load());
+    EXPECT_EQ(size_t(0), stats.queuedBytes.load());
+
+    smqSender.disconnect(true);
+    consumerSocket.close();
+
     smqServer->stop();
 }
 
@@ -617,4 +1840,141 @@ TEST(SPTK_SMQServer, performanceMultipleSendersSingleReceiver)
     smqServer->stop();
 }
 
+TEST(SPTK_SMQServer, performanceDeliveryWindow)
+{
+    size_t          messageCount {5000};
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4016);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(5);
+
+    // Window of 1 message is stop-and-wait: every message waits for the acknowledgement of the previous one
+    for (size_t windowSize: {1, 16, 256}) {
+        SMQClient smqSender(protocolType, "test-sender");
+        smqSender.setDeliveryQOS(QOS_1, windowSize);
+        ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+        auto msg = make_shared<Message>(Message::MESSAGE, Buffer("This is SMQ test"));
+        DateTime started("now");
+        for (size_t m = 0; m < messageCount; m++)
+            smqSender.send("test-window", msg, sendTimeout);
+        EXPECT_TRUE(smqSender.waitForAcknowledgements(seconds(10)));
+        DateTime ended("now");
+
+        long durationMS = duration_cast<milliseconds>(ended - started).count();
+        COUT("Window " << windowSize << ": sent and acknowledged " << messageCount << " messages for " << durationMS << " ms, "
+             << fixed << setprecision(1) << messageCount / (durationMS + 1.0) << "K msg/s" << endl);
+
+        smqSender.disconnect(true);
+        this_thread::sleep_for(milliseconds(10)); // Wait until the server releases the client id
+    }
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, performanceTopicFanOut)
+{
+    size_t          messageCount {200};
+    size_t          subscriberCount {500};
+    MQProtocolType  protocolType {MP_SMQ};
+    Host            serverHost("localhost", 4010);
+
+    auto smqServer = createSMQServer(protocolType, serverHost);
+
+    seconds connectTimeout(10);
+    seconds sendTimeout(1);
+
+    SMQClient smqSender(protocolType, "test-sender");
+    ASSERT_NO_THROW(smqSender.connect(serverHost, "user", "secret", false, connectTimeout));
+
+    vector< shared_ptr<SMQClient> > receivers;
+    for (size_t i = 0; i < subscriberCount; i++) {
+        auto smqReceiver = make_shared<SMQClient>(protocolType, "test-receiver" + to_string(i));
+        ASSERT_NO_THROW(smqReceiver->connect(serverHost, "user", "secret", false, connectTimeout));
+        ASSERT_NO_THROW(smqReceiver->subscribe("/topic/fan-out", std::chrono::milliseconds()));
+        receivers.push_back(smqReceiver);
+    }
+    this_thread::sleep_for(milliseconds(100)); // Wait until subscriptions are completed
+
+    DateTime started("now");
+
+    auto testMessage = make_shared<Message>(Message::MESSAGE, Buffer("This is SMQ fan-out performance test"));
+    for (size_t m = 0; m < messageCount; m++)
+        smqSender.send("/topic/fan-out", testMessage, sendTimeout);
+
+    size_t totalMessages = 0;
+    size_t maxWait = 10000;
+    while (totalMessages < messageCount * subscriberCount) {
+        this_thread::sleep_for(milliseconds(1));
+        totalMessages = 0;
+        for (auto& client: receivers)
+            totalMessages += client->hasMessages();
+        maxWait--;
+        if (maxWait == 0)
+            break;
+    }
+    DateTime ended("now");
+    milliseconds elapsed = duration_cast<milliseconds>(ended - started);
+    double performance = double(totalMessages) / elapsed.count();
+    COUT("Fan-out to " << subscriberCount << " subscribers: " << fixed << setprecision(1) << performance << "K msg/s" << endl);
+
+    EXPECT_EQ(messageCount * subscriberCount, totalMessages);
+
+    smqSender.disconnect(true);
+    for (auto& client: receivers)
+        client->disconnect(true);
+
+    smqServer->stop();
+}
+
+TEST(SPTK_SMQServer, performanceFanOutEncoding)
+{
+    size_t      messageCount {1000};
+    size_t      subscriberCount {500};
+    TCPSocket   socket;
+
+    Buffer      payload;
+    payload.fill('X', 256);
+    Message     message(Message::MESSAGE, payload);
+    message.destination("/topic/fan-out");
+    message["subject"] = "fan-out";
+
+    for (auto protocolType: { MP_SMQ, MP_MQTT }) {
+        auto protocol = MQProtocol::factory(protocolType, socket);
+
+        // Encode the message for every subscriber
+        DateTime started("now");
+        size_t encodedBytes = 0;
+        for (size_t m = 0; m < messageCount; m++) {
+            for (size_t s = 0; s < subscriberCount; s++) {
+                auto frame = protocol->encodeMessage(message.destination(), message);
+                encodedBytes += frame->bytes();
+            }
+        }
+        DateTime ended("now");
+        auto perSubscriber = duration_cast<microseconds>(ended - started).count();
+
+        // Encode the message once, and share the frame between all subscribers
+        started = DateTime("now");
+        size_t sharedBytes = 0;
+        for (size_t m = 0; m < messageCount; m++) {
+            auto frame = protocol->encodeMessage(message.destination(), message);
+            for (size_t s = 0; s < subscriberCount; s++) {
+                SharedMQFrame subscriberFrame(frame);
+                sharedBytes += subscriberFrame->bytes();
+            }
+        }
+        ended = DateTime("now");
+        auto shared = duration_cast<microseconds>(ended - started).count();
+
+        EXPECT_EQ(encodedBytes, sharedBytes);
+        COUT((protocolType == MP_SMQ ? "SMQ" : "MQTT") << " fan-out encoding to " << subscriberCount
+             << " subscribers: per subscriber " << perSubscriber / 1000 << " ms, shared frame "
+             << shared / 1000 << " ms" << endl);
+    }
+}
+
 #endif
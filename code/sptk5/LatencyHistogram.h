@@ -0,0 +1,128 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       LatencyHistogram.h - description                       ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <sptk5/sptk.h>
+#include <atomic>
+#include <vector>
+
+namespace sptk {
+
+/**
+ * @addtogroup utility Utility Classes
+ * @{
+ */
+
+/**
+ * Histogram of latency values with bounded relative error, in the manner of HDR histogram.
+ *
+ * Values below 128 are counted exactly. Larger values are counted in log-linear buckets:
+ * every power of two range is split into 64 sub-buckets, so any recorded value is reported
+ * with relative error below 1.6%, for the whole 64 bit range, using a fixed 30 KB of counters.
+ * Recording is lock-free, so several threads may record into the same histogram.
+ * The value units are up to the caller, typically microseconds or nanoseconds.
+ */
+class SP_EXPORT LatencyHistogram
+{
+    std::vector<std::atomic<uint64_t>>  m_counts;           ///< Counts per bucket
+    std::atomic<uint64_t>               m_count {0};        ///< Total number of values
+    std::atomic<uint64_t>               m_sum {0};          ///< Sum of all values
+    std::atomic<uint64_t>               m_min {UINT64_MAX}; ///< Min value
+    std::atomic<uint64_t>               m_max {0};          ///< Max value
+
+    /**
+     * Get bucket index of a value
+     * @param value             Value
+     */
+    static size_t bucketIndex(uint64_t value);
+
+    /**
+     * Get the highest value, counted by a bucket
+     * @param index             Bucket index
+     */
+    static uint64_t bucketValue(size_t index);
+
+public:
+    /**
+     * Constructor
+     */
+    LatencyHistogram();
+
+    /**
+     * Record a value
+     * @param value             Value
+     */
+    void record(uint64_t value);
+
+    /**
+     * Add all values, recorded by other histogram
+     * @param other             Other histogram
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * Remove all recorded values
+     */
+    void reset();
+
+    /**
+     * @return number of recorded values
+     */
+    uint64_t count() const;
+
+    /**
+     * @return min recorded value, or 0 if histogram is empty
+     */
+    uint64_t min() const;
+
+    /**
+     * @return max recorded value
+     */
+    uint64_t max() const;
+
+    /**
+     * @return mean of recorded values, or 0 if histogram is empty
+     */
+    double mean() const;
+
+    /**
+     * Get value at percentile: the value that is greater than or equal to the given percent of recorded values
+     * @param percentile        Percentile, 0 to 100
+     * @return value at percentile, or 0 if histogram is empty
+     */
+    uint64_t valueAtPercentile(double percentile) const;
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
@@ -60,14 +60,16 @@ public:
 
     /**
      * Constructor
-     * Automatically gets connection from connection pool
+     * Automatically gets connection from connection pool.
+     * Throws TimeoutException if all connections of the pool are in use during pool wait timeout.
      * @param connectionPool    Database connection pool
      */
     explicit AutoDatabaseConnection(DatabaseConnectionPool& connectionPool);
 
     /**
      * Destructor
-     * Releases connection to connection pool
+     * Releases connection to connection pool.
+     * Connection isn't closed, so it may be reused.
      */
     ~AutoDatabaseConnection();
 
@@ -199,6 +201,20 @@ public:
         m_connection->bulkInsert(tableName, columnNames, data, format);
     }
 
+    /**
+     * Creates bulk loader of typed rows
+     *
+     * Rows are added to the loader with BulkLoader::addRow(), and sent to the database
+     * the fastest way supported by the driver. BulkLoader::finish() must be called after the last row.
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     * @return bulk loader
+     */
+    SBulkLoader bulkLoader(const String& tableName, const Strings& columnNames)
+    {
+        return m_connection->bulkLoader(tableName, columnNames);
+    }
+
     /**
      * Executes SQL batch file
      *
@@ -0,0 +1,225 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       BulkLoader.h - description                             ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SPTK_BULK_LOADER_H__
+#define __SPTK_BULK_LOADER_H__
+
+#include <sptk5/db/PoolDatabaseConnection.h>
+#include <sptk5/FieldList.h>
+#include <sptk5/Variant.h>
+
+namespace sptk
+{
+
+/**
+ * @addtogroup Database Database Support
+ * @{
+ */
+
+class Query;
+
+/**
+ * @brief Loads typed rows into database table
+ *
+ * Rows are added one by one, and sent to the database by the driver, the fastest way
+ * it supports. The rows may be buffered by the driver, so finish() must be called after the last row.
+ * If connection isn't in transaction, the loader wraps the load into transaction, that is committed
+ * by finish(), or rolled back if the loader is destroyed before finish().
+ *
+ * The default implementation buffers the rows, and inserts them with prepared multi-row INSERT statement.
+ * The number of rows in one INSERT is limited by the max number of query parameters, supported by driver.
+ */
+class SP_EXPORT BulkLoader
+{
+    /**
+     * Database connection
+     */
+    PoolDatabaseConnection*     m_db;
+
+    /**
+     * Table name
+     */
+    String                      m_tableName;
+
+    /**
+     * Table columns to load
+     */
+    Strings                     m_columnNames;
+
+    /**
+     * Number of added rows
+     */
+    size_t                      m_rows {0};
+
+    /**
+     * True after finish() is called
+     */
+    bool                        m_finished {false};
+
+    /**
+     * True if the loader started the transaction
+     */
+    bool                        m_ownTransaction {false};
+
+    /**
+     * Max number of rows in one INSERT statement
+     */
+    size_t                      m_batchRows;
+
+    /**
+     * Values of the rows that are not inserted yet, used by the default implementation
+     */
+    VariantVector               m_batch;
+
+    /**
+     * Insert query for the complete batch of rows, used by the default implementation
+     */
+    std::shared_ptr<Query>      m_insertQuery;
+
+    /**
+     * Insert buffered rows
+     */
+    void insertBatch();
+
+protected:
+
+    /**
+     * @return database connection
+     */
+    PoolDatabaseConnection* database() const
+    {
+        return m_db;
+    }
+
+    /**
+     * @return max number of rows in one INSERT statement
+     */
+    size_t batchRows() const
+    {
+        return m_batchRows;
+    }
+
+    /**
+     * @brief Build INSERT statement for several rows
+     * @param rowCount          Number of rows
+     * @param paramMark         Parameter placeholder, or empty string to use numbered parameter names
+     * @return INSERT statement
+     */
+    String insertSQL(size_t rowCount, const String& paramMark = "") const;
+
+    /**
+     * @brief Load or buffer one row
+     *
+     * The number of values is already checked to match the number of columns.
+     * @param row               Row values, in the order of columns
+     */
+    virtual void loadRow(const VariantVector& row);
+
+    /**
+     * @brief Send buffered rows, and complete the load
+     */
+    virtual void finishLoad();
+
+public:
+    /**
+     * Default max number of query parameters in one INSERT statement
+     */
+    static constexpr size_t DefaultMaxParameters = 999;
+
+    /**
+     * Max number of rows in one INSERT statement
+     */
+    static constexpr size_t MaxBatchRows = 1000;
+
+    /**
+     * @brief Constructor
+     * @param db                Database connection
+     * @param tableName         Table name
+     * @param columnNames       Table columns to load
+     * @param maxParameters     Max number of query parameters in one INSERT statement, supported by driver
+     */
+    BulkLoader(PoolDatabaseConnection* db, const String& tableName, const Strings& columnNames,
+               size_t maxParameters = DefaultMaxParameters);
+
+    /**
+     * @brief Destructor
+     *
+     * Rows that aren't finished are discarded: the transaction, started by the loader, is rolled back.
+     */
+    virtual ~BulkLoader();
+
+    /**
+     * @brief Add row
+     * @param row               Row values, in the order of columns
+     */
+    void addRow(const VariantVector& row);
+
+    /**
+     * @brief Add row
+     * @param row               Row fields, in the order of columns
+     */
+    void addRow(const FieldList& row);
+
+    /**
+     * @brief Send remaining rows, and complete the load
+     *
+     * Throws DatabaseException if database rejects the data.
+     * @return number of loaded rows
+     */
+    size_t finish();
+
+    /**
+     * @return number of added rows
+     */
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+    /**
+     * @return table name
+     */
+    const String& tableName() const
+    {
+        return m_tableName;
+    }
+
+    /**
+     * @return table columns to load
+     */
+    const Strings& columnNames() const
+    {
+        return m_columnNames;
+    }
+};
+
+/**
+ * @}
+ */
+}
+#endif
@@ -33,8 +33,10 @@
 #include <sptk5/db/PoolDatabaseConnection.h>
 #include <sptk5/db/DatabaseConnectionString.h>
 #include <sptk5/CaseInsensitiveCompare.h>
-#include <sptk5/threads/SynchronizedList.h>
-#include <sptk5/threads/SynchronizedQueue.h>
+#include <sptk5/Logger.h>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 
 namespace sptk
 {
@@ -95,11 +97,32 @@ struct SP_EXPORT DatabaseDriver
  *
  * Loads and initializes SPTK database driver by request.
  * Already loaded drivers are cached.
+ *
+ * Connections returned to the pool stay open, and are reused by the next
+ * getConnection() call, after the session state is reset. The pool may keep a minimum
+ * number of idle connections opened, close connections that are idle or live for too long,
+ * and serve the threads waiting for a connection in the order they came.
  */
 class SP_EXPORT DatabaseConnectionPool : public DatabaseConnectionString, public std::mutex
 {
     friend class AutoDatabaseConnection;
 
+    typedef std::chrono::steady_clock::time_point   TimePoint;
+
+    /**
+     * Idle connection, and the time it was returned to the pool
+     */
+    typedef std::pair<PoolDatabaseConnection*, TimePoint> IdleConnection;
+
+    /**
+     * Thread waiting for a connection
+     */
+    struct Waiter
+    {
+        PoolDatabaseConnection*     connection {nullptr};   ///< Connection handed over by releasing thread
+        bool                        createAllowed {false};  ///< Waiter may create a new connection
+    };
+
     /**
      * Database driver
      */
@@ -121,14 +144,148 @@ class SP_EXPORT DatabaseConnectionPool : public DatabaseConnectionString, public
     unsigned                                   m_maxConnections;
 
     /**
-     * Connection pool
+     * Mutex that protects connection lists
+     */
+    mutable std::mutex                         m_poolMutex;
+
+    /**
+     * Signals waiters when connection is handed over to them
+     */
+    std::condition_variable                    m_poolCondition;
+
+    /**
+     * Idle connections, the most recently used are at the back
+     */
+    std::deque<IdleConnection>                 m_idle;
+
+    /**
+     * All connections, and their creation time
+     */
+    std::map<PoolDatabaseConnection*, TimePoint> m_connections;
+
+    /**
+     * Number of connections, including the connections that are being created
+     */
+    size_t                                     m_connectionCount {0};
+
+    /**
+     * Threads waiting for connection, in the order they came
+     */
+    std::deque<Waiter*>                        m_waiters;
+
+    /**
+     * Minimum number of idle connections kept opened
+     */
+    unsigned                                   m_minIdle {0};
+
+    /**
+     * Connection is closed after it lived this long, 0 means no limit
+     */
+    std::chrono::milliseconds                  m_maxLifetime {0};
+
+    /**
+     * Idle connection is closed after this timeout, 0 means no limit
+     */
+    std::chrono::milliseconds                  m_idleTimeout {0};
+
+    /**
+     * Max time to wait for connection in getConnection()
+     */
+    std::chrono::milliseconds                  m_waitTimeout {std::chrono::seconds(10)};
+
+    /**
+     * Pool maintenance interval, 0 if maintenance isn't needed
+     */
+    std::chrono::milliseconds                  m_maintenanceInterval {0};
+
+    /**
+     * Signals maintenance thread when maintenance interval is changed, or the pool is destroyed
+     */
+    std::condition_variable                    m_maintenanceCondition;
+
+    /**
+     * True when maintenance thread should exit
+     */
+    bool                                       m_maintenanceStopped {false};
+
+    /**
+     * Closes expired idle connections and opens min idle connections periodically.
+     * Pool has its own thread, so slow connects don't delay other timers.
+     */
+    std::thread                                m_maintenanceThread;
+
+    /**
+     * Optional log for the errors that can't be reported to the caller
+     */
+    std::shared_ptr<Logger>                    m_logger;
+
+    /**
+     * Query result cache, shared by the pool connections
+     */
+    SQueryResultCache                          m_resultCache;
+
+    /**
+     * Database statistics, shared by the pool connections
+     */
+    SDatabaseStatistics                        m_statistics;
+
+    /**
+     * Maintenance thread function: calls evictIdle() every maintenance interval
+     */
+    void maintenanceThreadFunction();
+
+    /**
+     * Write error to the pool log, if it's defined
+     * @param error             Error message
      */
-    SynchronizedQueue<PoolDatabaseConnection*>     m_pool;
+    void logError(const String& error);
 
     /**
-     * List all connections
+     * @return true if connection lived longer than max lifetime
+     * @param connection        Database connection
+     * @param now               Current time
      */
-    SynchronizedList<PoolDatabaseConnection*>      m_connections;
+    bool expired(PoolDatabaseConnection* connection, const TimePoint& now) const;
+
+    /**
+     * Remove expired connections from idle connection list.
+     * Must be called with locked m_poolMutex.
+     * @param now               Current time
+     * @param expiredConnections Removed connections, that should be destroyed (output)
+     */
+    void takeExpired(const TimePoint& now, std::vector<PoolDatabaseConnection*>& expiredConnections);
+
+    /**
+     * Hand over connection, or a slot for a new connection, to the first waiter,
+     * or return connection to idle list.
+     * Must be called with locked m_poolMutex.
+     * @param connection        Connection, or nullptr if a connection slot is freed
+     */
+    void handOver(PoolDatabaseConnection* connection);
+
+    /**
+     * Create and register new driver instance.
+     * The connection slot should be already counted in m_connectionCount.
+     */
+    PoolDatabaseConnection* newConnection();
+
+    /**
+     * Check if opened connection that is taken from idle list is still usable.
+     * Connection that failed validation is reopened. If it can't be reopened,
+     * it is destroyed, and exception is thrown.
+     * @param connection        Database connection
+     */
+    void validate(PoolDatabaseConnection* connection);
+
+    /**
+     * Schedule periodic idle connection eviction in maintenance thread, according to timeouts
+     */
+    void scheduleEviction();
+
+    /**
+     * Open connections until there are at least minimum idle connections
+     */
+    void warmUp();
 
 protected:
 
@@ -139,14 +296,6 @@ protected:
      */
     void load();
 
-    /**
-     * Close connection callback
-     * @param item          Database connection
-     * @param data          Data (connection pool pointer)
-     * @return true if callback should continue to be executed
-     */
-    static bool closeConnectionCB(PoolDatabaseConnection*& item, void* data);
-
 public:
     /**
      * @brief Constructor
@@ -165,17 +314,106 @@ public:
      */
     ~DatabaseConnectionPool();
 
+    /**
+     * @brief Get connection from the pool
+     *
+     * Idle connection is reused if there is one, otherwise new connection is created.
+     * If the pool already has max connections, waits until one of them is released.
+     * Throws TimeoutException if no connection is released during wait timeout.
+     */
     DatabaseConnection getConnection();
 
+    /**
+     * @brief Set minimum number of idle connections
+     *
+     * The pool opens that many connections now, and keeps at least that many
+     * idle connections opened when closing expired connections.
+     * @param minIdle           Minimum number of idle connections
+     */
+    void setMinIdle(unsigned minIdle);
+
+    /**
+     * @brief Set max connection lifetime
+     *
+     * Connection that is older than that is closed when it's released, rather than reused.
+     * @param maxLifetime       Max connection lifetime, 0 means no limit
+     */
+    void setMaxLifetime(std::chrono::milliseconds maxLifetime);
+
+    /**
+     * @brief Set idle connection timeout
+     *
+     * Connections (above min idle) that are idle longer than that are closed.
+     * @param idleTimeout       Idle connection timeout, 0 means no limit
+     */
+    void setIdleTimeout(std::chrono::milliseconds idleTimeout);
+
+    /**
+     * @brief Set max time to wait for connection in getConnection()
+     * @param waitTimeout       Wait timeout
+     */
+    void setWaitTimeout(std::chrono::milliseconds waitTimeout);
+
+    /**
+     * @return number of connections, used and idle
+     */
+    size_t size() const;
+
+    /**
+     * @return number of idle connections
+     */
+    size_t idleSize() const;
+
+    /**
+     * @brief Query result cache, shared by the pool connections
+     *
+     * Queries use the cache after Query::cacheResults() is called.
+     * The cache may be used to invalidate the results of modified tables, or to read cache statistics.
+     */
+    QueryResultCache& resultCache()
+    {
+        return *m_resultCache;
+    }
+
+    /**
+     * @brief Database statistics, shared by the pool connections
+     *
+     * Collects per-statement latency histograms of the queries executed with the pool connections,
+     * and the time waiting for connections in getConnection().
+     * Slow query log is enabled with DatabaseStatistics::setSlowQueryLog().
+     */
+    DatabaseStatistics& statistics()
+    {
+        return *m_statistics;
+    }
+
+    /**
+     * @brief Close idle connections that are expired
+     *
+     * Called periodically by the pool maintenance thread, if idle timeout, max lifetime, or min idle is defined.
+     */
+    void evictIdle();
+
+    /**
+     * @brief Set log for the errors that can't be reported to the caller
+     *
+     * Such errors are failed session reset of released connection, errors closing connections,
+     * and errors of the pool maintenance thread. Without log, these errors are ignored.
+     * @param logEngine         Log engine, or nullptr to disable the log
+     */
+    void setLogEngine(LogEngine* logEngine);
+
 protected:
 
     /**
-     * @brief Creates database connection
+     * @brief Get connection from the pool, or create a new one
      */
     PoolDatabaseConnection* createConnection();
 
     /**
      * @brief Returns used database connection back to the pool
+     *
+     * The connection session state is reset, so it may be reused.
      * @param connection        Database that is no longer in use and may be returned to the pool
      */
     void releaseConnection(PoolDatabaseConnection* connection);
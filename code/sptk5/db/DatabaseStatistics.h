@@ -0,0 +1,273 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       DatabaseStatistics.h - description                     ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SPTK_DATABASE_STATISTICS_H__
+#define __SPTK_DATABASE_STATISTICS_H__
+
+#include <sptk5/LatencyHistogram.h>
+#include <sptk5/Logger.h>
+#include <sptk5/Strings.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sptk {
+
+/**
+ * @addtogroup Database Database Support
+ * @{
+ */
+
+/**
+ * @brief Execution statistics of SQL statement
+ *
+ * Statements with the same normalized SQL share statistics.
+ * Histograms are in microseconds. Counters are updated without locks.
+ */
+struct SP_EXPORT StatementStatistics
+{
+    /**
+     * Normalized SQL
+     */
+    const String                sql;
+
+    /**
+     * Statement prepare time
+     */
+    LatencyHistogram            prepare;
+
+    /**
+     * Statement execution time, until the first row is available, not including prepare time
+     */
+    LatencyHistogram            execute;
+
+    /**
+     * Fetch time, for every fetch of a row or a record batch
+     */
+    LatencyHistogram            fetch;
+
+    /**
+     * Number of rows returned by statement executions
+     */
+    std::atomic<uint64_t>       rows {0};
+
+    /**
+     * Number of failed statement executions
+     */
+    std::atomic<uint64_t>       errors {0};
+
+    /**
+     * Constructor
+     * @param sql               Normalized SQL
+     */
+    explicit StatementStatistics(const String& sql)
+    : sql(sql)
+    {
+    }
+};
+
+/**
+ * Shared pointer to statement statistics
+ */
+typedef std::shared_ptr<StatementStatistics> SStatementStatistics;
+
+/**
+ * @brief Database instrumentation
+ *
+ * Collects latency histograms for every normalized SQL statement, connection pool wait time,
+ * and optionally logs the queries that are executed longer than the threshold.
+ *
+ * Queries find their statement statistics once, when SQL is set, and update it without locks.
+ * Pool connections cache the statement statistics by SQL, so only the first query with the SQL
+ * on the connection normalizes it and locks the statement map.
+ * Every tracked statement uses about 90 KB for its histograms, so the number of tracked statements
+ * is limited: the statements above the limit share the statistics with SQL OtherStatements.
+ *
+ * Connection pool shares its statistics with the pool connections.
+ */
+class SP_EXPORT DatabaseStatistics
+{
+    mutable std::mutex                          m_mutex;                ///< Protects statement map and slow query logger
+    std::map<String, SStatementStatistics>      m_statements;           ///< Statement statistics by normalized SQL
+    SStatementStatistics                        m_otherStatements;      ///< Statistics of statements above the limit
+    size_t                                      m_maxStatements;        ///< Max number of tracked statements
+    LatencyHistogram                            m_poolWait;             ///< Time waiting for connection pool connection, in microseconds
+    std::atomic<uint64_t>                       m_poolTimeouts {0};     ///< Number of connection pool wait timeouts
+    std::atomic<int64_t>                        m_slowQueryThreshold {0};   ///< Slow query threshold in microseconds, 0 if disabled
+    std::atomic<uint64_t>                       m_slowQueries {0};      ///< Number of slow queries
+    std::atomic<uint64_t>                       m_generation {0};       ///< Incremented when statement statistics are removed
+    std::shared_ptr<Logger>                     m_slowQueryLogger;      ///< Slow query log
+
+public:
+    /**
+     * Default max number of tracked statements
+     */
+    static constexpr size_t DefaultMaxStatements = 256;
+
+    /**
+     * SQL of the statements above the limit
+     */
+    static const char* const OtherStatements;
+
+    /**
+     * Constructor
+     * @param maxStatements     Max number of tracked statements
+     */
+    explicit DatabaseStatistics(size_t maxStatements = DefaultMaxStatements);
+
+    /**
+     * @brief Normalize SQL
+     *
+     * Whitespace is collapsed to single spaces, and literal strings and numbers are replaced with '?',
+     * so the statements that only differ by literal values share the statistics.
+     * @param sql               SQL
+     * @return normalized SQL
+     */
+    static String normalize(const String& sql);
+
+    /**
+     * Find or create statistics of the statement
+     * @param sql               Statement SQL, not normalized
+     * @return statement statistics
+     */
+    SStatementStatistics statement(const String& sql);
+
+    /**
+     * Statement statistics generation, incremented by reset().
+     * Statement statistics cached with the previous generation are no longer tracked.
+     * @return statement statistics generation
+     */
+    uint64_t generation() const
+    {
+        return m_generation;
+    }
+
+    /**
+     * @return statistics of all the tracked statements
+     */
+    std::vector<SStatementStatistics> statements() const;
+
+    /**
+     * @return time waiting for connection pool connection, in microseconds
+     */
+    LatencyHistogram& poolWait()
+    {
+        return m_poolWait;
+    }
+
+    /**
+     * @return time waiting for connection pool connection, in microseconds
+     */
+    const LatencyHistogram& poolWait() const
+    {
+        return m_poolWait;
+    }
+
+    /**
+     * Count connection pool wait timeout
+     */
+    void poolTimeout()
+    {
+        ++m_poolTimeouts;
+    }
+
+    /**
+     * @return number of connection pool wait timeouts
+     */
+    uint64_t poolTimeouts() const
+    {
+        return m_poolTimeouts;
+    }
+
+    /**
+     * @brief Enable or disable slow query log
+     *
+     * Queries that are executed longer than threshold, including prepare time,
+     * are logged with warning priority. Only normalized SQL is logged, without parameter values.
+     * @param logEngine         Log engine, or nullptr to disable the log
+     * @param threshold         Slow query threshold, 0 disables the log
+     */
+    void setSlowQueryLog(LogEngine* logEngine, std::chrono::microseconds threshold);
+
+    /**
+     * @return slow query threshold, 0 if slow query log is disabled
+     */
+    std::chrono::microseconds slowQueryThreshold() const
+    {
+        return std::chrono::microseconds(m_slowQueryThreshold);
+    }
+
+    /**
+     * @return number of queries that were executed longer than slow query threshold
+     */
+    uint64_t slowQueries() const
+    {
+        return m_slowQueries;
+    }
+
+    /**
+     * Log the query if it was executed longer than slow query threshold
+     * @param statement         Statement statistics
+     * @param duration          Execution time, including prepare time
+     */
+    void logSlowQuery(const StatementStatistics& statement, std::chrono::microseconds duration)
+    {
+        int64_t threshold = m_slowQueryThreshold;
+        if (threshold > 0 && duration.count() >= threshold)
+            writeSlowQuery(statement, duration);
+    }
+
+    /**
+     * Remove all statement statistics, and reset pool statistics.
+     * Queries that already found their statement statistics continue to update it.
+     */
+    void reset();
+
+private:
+    /**
+     * Write slow query to the log
+     * @param statement         Statement statistics
+     * @param duration          Execution time
+     */
+    void writeSlowQuery(const StatementStatistics& statement, std::chrono::microseconds duration);
+};
+
+/**
+ * Shared pointer to database statistics
+ */
+typedef std::shared_ptr<DatabaseStatistics> SDatabaseStatistics;
+
+/**
+ * @}
+ */
+}
+
+#endif
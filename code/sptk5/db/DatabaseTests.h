@@ -115,6 +115,78 @@ public:
      * @param connectionString Database connection string
      */
     void testBulkInsert(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test loading typed rows with bulk loader
+     * @param connectionString Database connection string
+     */
+    void testBulkLoader(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Compare the speed of bulk loader and text bulk insert
+     * @param connectionString Database connection string
+     */
+    void testBulkLoaderPerformance(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test SELECT that streams the result set, fetching a few rows at a time
+     * @param connectionString Database connection string
+     */
+    void testStreamingSelect(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test connection reuse, session reset, waiting for connection, and connection eviction
+     * @param connectionString Database connection string
+     */
+    void testConnectionPool(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Measure the latency of getting connection from the pool, with and without connection reuse
+     * @param connectionString Database connection string
+     */
+    void testCheckoutPerformance(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test executing a batch of queries, that has a failed query, and compare it with sequential execution
+     * @param connectionString Database connection string
+     */
+    void testQueryBatch(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test reusing prepared statements by query objects with the same SQL, and statement cache limits
+     * @param connectionString Database connection string
+     */
+    void testStatementCache(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test SQLite3 options defined in connection string, and reading the data in WAL mode
+     * @param connectionString Database connection string
+     */
+    void testSQLite3Options(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test fetching query rows into columnar record batch, and exporting the batch to JSON and CSV
+     * @param connectionString Database connection string
+     */
+    void testFetchBatch(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test asynchronous query execution, with futures and completion callbacks
+     * @param connectionString Database connection string
+     */
+    void testAsyncQuery(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test query result cache, with TTL expiration and table invalidation
+     * @param connectionString Database connection string
+     */
+    void testQueryResultCache(const DatabaseConnectionString& connectionString);
+
+    /**
+     * Test database statistics: statement latency histograms, pool wait time and slow query log
+     * @param connectionString Database connection string
+     */
+    void testDatabaseStatistics(const DatabaseConnectionString& connectionString);
 };
 
 /**
@@ -54,6 +54,12 @@ class SP_EXPORT MySQLConnection: public PoolDatabaseConnection
 
     MYSQL*                      m_connection;           ///< MySQL database connection
     mutable std::mutex          m_mutex;                ///< Mutex that protects access to data members
+    const Strings*              m_bulkInsertRows {nullptr}; ///< Rows of bulk insert in progress. LOAD DATA LOCAL is refused without it.
+
+    /**
+     * Max number of prepared statement parameters
+     */
+    static constexpr size_t     MaxQueryParameters = 65535;
 
     /**
      * @brief Init connection to MySQL server
@@ -134,6 +140,11 @@ protected:
      */
     void queryFetch(Query *query) override;
 
+    /**
+     * Reads up to maxRows rows, starting from the current row, directly from the fetch buffers into record batch
+     */
+    size_t queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows) override;
+
 
     /**
      * @brief Returns parameter mark
@@ -165,17 +176,27 @@ public:
     /**
      * @brief Executes bulk inserts of data from memory buffer
      *
-     * Data is inserted the fastest possible way. The server-specific format definition provides extra information
-     * about data. If format is empty than default server-specific data format is used.
-     * For instance, for PostgreSQL it is TAB-delimited data, with some escaped characters ('\\t', '\\n', '\\r') and "\\N" for NULLs.
+     * Data is sent with LOAD DATA LOCAL INFILE, in TAB-delimited format. If format is empty, values are inserted
+     * as is, without backslash escapes, same as with other drivers. If LOAD DATA LOCAL is disabled by server,
+     * data is inserted with multi-row INSERT statements.
+     *
+     * The server may only read the rows of the bulk insert: LOAD DATA LOCAL requests at any other time
+     * are refused, so the server can't read the client files.
      * @param tableName         Table name to insert into
      * @param columnNames       List of table columns to populate
      * @param data              Data for bulk insert
-     * @param format            MySQL-specific data format options
+     * @param format            MySQL-specific data format options, such as FIELDS and LINES clauses of LOAD DATA
      */
     void _bulkInsert(const String& tableName, const Strings& columnNames, const Strings& data,
                      const String& format) override;
 
+    /**
+     * @brief Creates bulk loader that inserts rows with multi-row INSERT statements
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     */
+    SBulkLoader _bulkLoader(const String& tableName, const Strings& columnNames) override;
+
     /**
      * @brief Executes SQL batch file
      *
@@ -202,6 +223,14 @@ public:
      */
     ~MySQLConnection() override;
 
+    /**
+     * @brief Resets session state with mysql_reset_connection(): rolls back open transaction,
+     * resets session variables, drops temporary tables, and releases locks.
+     *
+     * Server-side prepared statements are released, so the queries, linked to the connection, are unprepared.
+     */
+    void resetSession() override;
+
     /**
      * @brief Closes the database connection. If unsuccessful throws an exception.
      */
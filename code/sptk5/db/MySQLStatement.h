@@ -37,6 +37,7 @@
 
 #include <sptk5/db/DatabaseField.h>
 #include <sptk5/db/DatabaseStatement.h>
+#include <sptk5/db/RecordBatch.h>
 
 namespace sptk
 {
@@ -79,6 +80,11 @@ class MySQLStatement : public DatabaseStatement<MySQLConnection,MYSQL_STMT>
      */
     MYSQL_ROW                       m_row;
 
+    /**
+     * Number of rows fetched from server at once, 0 to fetch the entire result set
+     */
+    unsigned                        m_fetchSize {0};
+
 
     /**
      * Reads not prepared statement result row to query fields
@@ -166,6 +172,18 @@ public:
      */
     void prepare(const std::string& sql);
 
+    /**
+     * Sets the number of rows, fetched from server at once
+     *
+     * Non-zero fetch size makes not prepared statement read the rows with mysql_use_result(),
+     * and prepared statement open read-only server-side cursor, that prefetches that number of rows.
+     * @param fetchSize         Number of rows, or 0 to fetch the entire result set
+     */
+    void fetchSize(unsigned fetchSize)
+    {
+        m_fetchSize = fetchSize;
+    }
+
     /**
      * Executes statement
      */
@@ -183,6 +201,13 @@ public:
      */
     void readResultRow(FieldList& fields);
 
+    /**
+     * Appends the current result row to record batch, without updating query fields
+     * @param fields            Query fields
+     * @param batch             Record batch, with the columns matching query fields
+     */
+    void readResultRow(FieldList& fields, RecordBatch& batch);
+
     /**
      * Closes statement and releases allocated resources
      */
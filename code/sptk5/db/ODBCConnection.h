@@ -36,6 +36,7 @@
 #include <sptk5/db/DatabaseField.h>
 #include <sptk5/db/ODBCEnvironment.h>
 #include <sptk5/db/PoolDatabaseConnection.h>
+#include <map>
 
 namespace sptk {
 
@@ -44,6 +45,8 @@ namespace sptk {
  * @{
  */
 
+class ODBCRowset;
+
 /**
  * @brief ODBC database
  *
@@ -52,12 +55,17 @@ namespace sptk {
 class SP_DRIVER_EXPORT ODBCConnection: public PoolDatabaseConnection
 {
     friend class Query;
+    friend class ODBCBulkLoader;
 
     /**
      * The ODBC connection object
      */
     ODBCConnectionBase *m_connect;
 
+    /**
+     * Bound column buffers of the statements, that are fetched with block cursors
+     */
+    std::map<SQLHSTMT, std::shared_ptr<ODBCRowset>> m_rowsets;
 
     /**
      * @brief Retrieves an error (if any) after statement was executed
@@ -169,6 +177,15 @@ protected:
      */
     void _openDatabase(const String& connectionString) override;
 
+    /**
+     * @brief Creates bulk loader that inserts rows with parameter arrays
+     *
+     * Single-row INSERT statement is executed once for every batch of rows.
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     */
+    SBulkLoader _bulkLoader(const String& tableName, const Strings& columnNames) override;
+
     /**
      * @brief Executes SQL batch file
      *
@@ -262,6 +279,29 @@ private:
     SQLRETURN readTimestampField(SQLHSTMT statement, DatabaseField* field, SQLUSMALLINT column, int16_t fieldType,
                                  SQLLEN& dataLength);
 
+    /**
+     * @brief Bind query columns to block cursor buffers, if query fetch size is greater than 1
+     *
+     * If query fetch size isn't greater than 1, or some columns can't be bound (long strings or blobs),
+     * the rows are fetched one by one.
+     * @param query             Opened query, with parsed columns
+     */
+    void bindRowset(Query* query);
+
+    /**
+     * @brief Unbind statement columns from block cursor buffers, and release the buffers
+     *
+     * Connection mutex must be locked by the caller.
+     * @param statement         Statement
+     */
+    void releaseRowset(SQLHSTMT statement);
+
+    /**
+     * @brief Advance to the next row of block cursor, fetching the next rowset if needed, and read it into query fields
+     * @param query             Query
+     * @param rowset            Query rowset
+     */
+    void fetchRowsetRow(Query* query, ODBCRowset& rowset);
 };
 
 
@@ -32,9 +32,16 @@
 #include <sptk5/sptk.h>
 #include <sptk5/Strings.h>
 #include <sptk5/db/DatabaseConnectionString.h>
+#include <sptk5/db/DatabaseStatistics.h>
+#include <sptk5/db/QueryResultCache.h>
 #include <sptk5/Variant.h>
 #include <sptk5/Logger.h>
 
+#include <exception>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
 #include <vector>
 
 namespace sptk {
@@ -45,6 +52,20 @@ namespace sptk {
  */
 
 class Query;
+class BulkLoader;
+class QueryBatch;
+class RecordBatch;
+
+/**
+ * Shared pointer to bulk loader
+ */
+typedef std::shared_ptr<BulkLoader> SBulkLoader;
+
+/**
+ * Callback, executed when asynchronous query execution is complete.
+ * The argument is the execution error, or nullptr if the query is executed successfully.
+ */
+typedef std::function<void(const std::exception_ptr& error)> AsyncQueryCallback;
 
 /**
  * Database connection type
@@ -132,6 +153,27 @@ typedef std::vector<QueryColumnTypeSize> QueryColumnTypeSizeVector;
  */
 typedef std::map<std::string,QueryColumnTypeSize> QueryColumnTypeSizeMap;
 
+/**
+ * Prepared statement cache statistics
+ */
+struct StatementCacheStatistics
+{
+    /**
+     * Number of statements taken from the cache
+     */
+    size_t          hits {0};
+
+    /**
+     * Number of statements that weren't found in the cache, and had to be prepared
+     */
+    size_t          misses {0};
+
+    /**
+     * Number of least recently used statements released to keep the cache size
+     */
+    size_t          evictions {0};
+};
+
 class SP_EXPORT PoolDatabaseConnection_QueryMethods
 {
     friend class Query;
@@ -184,6 +226,11 @@ protected:
      */
     virtual void queryPrepare(Query* query);
 
+    /**
+     * Prepares a query with queryPrepare(), and records prepare time in database statistics
+     */
+    void prepareQuery(Query* query);
+
     /**
      * Unprepares a query if supported by database
      */
@@ -224,11 +271,33 @@ protected:
      */
     virtual void queryOpen(Query* query);
 
+    /**
+     * Sends the query to server, and returns without waiting for the results.
+     * When the results are received, the query is opened, and the callback is executed.
+     * Errors, detected before the query is sent, are thrown by this method.
+     * Default implementation opens the query synchronously, and executes the callback before returning.
+     */
+    virtual void queryOpenAsync(Query* query, const AsyncQueryCallback& callback);
+
+    /**
+     * Cancels asynchronous execution of the query, if it's in progress, and executes its callback with an error.
+     * Called before the query is closed, changed, or destroyed, so the callback never uses a destroyed query.
+     * Default implementation does nothing, since default queryOpenAsync() completes before returning.
+     */
+    virtual void queryCancelAsync(Query* query);
+
     /**
      * Reads data from the query' recordset into fields, and advances to the next row. After reading the last row sets the EOF (end of file, or no more data) flag.
      */
     virtual void queryFetch(Query* query);
 
+    /**
+     * Reads up to maxRows rows, starting from the current row, into record batch, and fetches the next row.
+     * Default implementation reads the rows from the query fields.
+     * @return number of rows added to the batch
+     */
+    virtual size_t queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows);
+
     /**
      * Returns parameter mark
      *
@@ -262,6 +331,25 @@ class SP_EXPORT PoolDatabaseConnection : public PoolDatabaseConnection_QueryMeth
     String                      m_driverDescription;    ///< Driver description is filled by the particular driver.
     bool                        m_inTransaction;        ///< The in-transaction flag
 
+    typedef std::pair<String, void*>            CachedStatement;
+    typedef std::list<CachedStatement>          CachedStatementList;
+
+    mutable std::mutex                          m_statementCacheMutex;  ///< Protects statement cache and statement statistics cache
+    CachedStatementList                         m_statementCache;       ///< Cached statements, the most recently used first
+    std::multimap<String, CachedStatementList::iterator> m_statementCacheIndex; ///< Cached statements by cache key
+    size_t                                      m_statementCacheSize;   ///< Max number of cached statements
+    StatementCacheStatistics                    m_statementCacheStatistics; ///< Statement cache statistics
+    SQueryResultCache                           m_resultCache;          ///< Query result cache, shared with the other pool connections
+    SDatabaseStatistics                         m_statistics;           ///< Database statistics, shared with the other pool connections
+    std::map<String, SStatementStatistics>      m_statementStatistics;  ///< Statement statistics by SQL, not normalized
+    uint64_t                                    m_statementStatisticsGeneration {0};   ///< Database statistics generation of cached statement statistics
+
+    /**
+     * Remove least recently used statements above the size limit from the cache
+     * @param released          Removed statements, to be released by driver (output)
+     */
+    void trimStatementCache(std::vector<void*>& released);
+
 protected:
 
     bool   getInTransaction() const;
@@ -317,6 +405,41 @@ protected:
      */
     virtual void driverEndTransaction(bool commit);
 
+    /**
+     * Take prepared statement from the statement cache
+     *
+     * Drivers that support statement cache call it before preparing a statement.
+     * The statement is removed from the cache, so it is used by a single query at a time.
+     * @param cacheKey          Statement cache key, the statement SQL and anything else that affects preparing
+     * @return prepared statement, or nullptr if the cache doesn't have it
+     */
+    void* takeCachedStatement(const String& cacheKey);
+
+    /**
+     * Return prepared statement, that is no longer used by a query, to the statement cache
+     *
+     * If the cache is full, the least recently used statements are released with releaseCachedStatement().
+     * @param cacheKey          Statement cache key, the same as used for takeCachedStatement()
+     * @param statement         Prepared statement, that is ready for the next execution
+     * @return false if the statement cache is disabled, and the caller should release the statement
+     */
+    bool cacheStatement(const String& cacheKey, void* statement);
+
+    /**
+     * Release the statement that is removed from the statement cache
+     *
+     * Drivers that use statement cache must implement it.
+     * @param statement         Prepared statement
+     */
+    virtual void releaseCachedStatement(void* statement);
+
+    /**
+     * Release all the cached statements
+     *
+     * Drivers that use statement cache call it before closing the connection.
+     */
+    void clearStatementCache();
+
     /**
      * Throws an exception
      *
@@ -332,6 +455,7 @@ protected:
      * Data is inserted the fastest possible way. The server-specific format definition provides extra information
      * about data. If format is empty than default server-specific data format is used.
      * For instance, for PostgreSQL it is TAB-delimited data, with some escaped characters ('\\t', '\\n', '\\r') and "\\N" for NULLs.
+     * The default implementation splits TAB-delimited rows, and loads the values as strings with bulk loader.
      * @param tableName         Table name to insert into
      * @param columnNames       List of table columns to populate
      * @param data              Data for bulk insert
@@ -340,6 +464,23 @@ protected:
     virtual void _bulkInsert(const String& tableName, const Strings& columnNames, const Strings& data,
                              const String& format);
 
+    /**
+     * Creates bulk loader of typed rows
+     * The default bulk loader inserts rows with prepared multi-row INSERT statements, inside transaction.
+     * Drivers override it to use the fastest data load method of the database.
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     */
+    virtual SBulkLoader _bulkLoader(const String& tableName, const Strings& columnNames);
+
+    /**
+     * Executes queued query executions, and stores their results in the batch
+     *
+     * The default implementation executes the queries one by one.
+     * @param batch             Queued query executions
+     */
+    virtual void _executeBatch(QueryBatch& batch);
+
     /**
      * Executes SQL batch file
      *
@@ -396,6 +537,22 @@ public:
      */
     virtual bool active() const;
 
+    /**
+     * Cheap check that opened connection is still usable.
+     *
+     * Connection pool calls it when the connection is taken from the pool.
+     * It should not make a round trip to server. Default implementation returns active().
+     */
+    virtual bool validate() const;
+
+    /**
+     * Reset the session state, so the connection may be reused by connection pool.
+     *
+     * Rolls back the transaction that is left open. Drivers override it to also reset
+     * session variables, temporary tables and other server-side session state.
+     */
+    virtual void resetSession();
+
     /**
      * Returns the database connection handle
      */
@@ -488,6 +645,95 @@ public:
         _bulkInsert(tableName, columnNames, data, format);
     }
 
+    /**
+     * Creates bulk loader of typed rows
+     *
+     * Rows are added to the loader with BulkLoader::addRow(), and sent to the database
+     * the fastest way supported by the driver. BulkLoader::finish() must be called after the last row.
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     * @return bulk loader
+     */
+    SBulkLoader bulkLoader(const String& tableName, const Strings& columnNames)
+    {
+        return _bulkLoader(tableName, columnNames);
+    }
+
+    /**
+     * Default max number of prepared statements in the statement cache
+     */
+    static constexpr size_t DefaultStatementCacheSize = 64;
+
+    /**
+     * Set max number of prepared statements in the statement cache
+     *
+     * Queries with the same SQL reuse prepared statements from the cache, instead of preparing them again.
+     * Cache size 0 disables the statement cache.
+     * @param size              Max number of cached statements
+     */
+    void setStatementCacheSize(size_t size);
+
+    /**
+     * @return max number of prepared statements in the statement cache
+     */
+    size_t statementCacheSize() const;
+
+    /**
+     * @return number of prepared statements in the statement cache
+     */
+    size_t cachedStatements() const;
+
+    /**
+     * @return statement cache statistics
+     */
+    StatementCacheStatistics statementCacheStatistics() const;
+
+    /**
+     * Set query result cache, used by the queries that cache their results
+     * @param cache             Query result cache, or nullptr to disable result caching
+     */
+    void setResultCache(const SQueryResultCache& cache);
+
+    /**
+     * @return query result cache, or nullptr if it isn't set
+     */
+    SQueryResultCache resultCache() const;
+
+    /**
+     * Set database statistics, collected by the queries that use this connection
+     * @param statistics        Database statistics, or nullptr to disable statistics
+     */
+    void setStatistics(const SDatabaseStatistics& statistics);
+
+    /**
+     * @return database statistics, or nullptr if it isn't set
+     */
+    const SDatabaseStatistics& statistics() const
+    {
+        return m_statistics;
+    }
+
+    /**
+     * Find statement statistics.
+     * Statement statistics are cached by SQL in the connection, so the queries with the same SQL
+     * don't normalize it and don't lock database statistics shared by the pool connections.
+     * @param sql               Statement SQL
+     * @return statement statistics, or nullptr if database statistics isn't set
+     */
+    SStatementStatistics statementStatistics(const String& sql);
+
+    /**
+     * Executes queued query executions, and stores their results in the batch
+     *
+     * Executions are performed in the order they are queued, the fastest way supported by the driver.
+     * Failed execution doesn't stop the executions that follow it.
+     * @param batch             Queued query executions
+     */
+    void executeBatch(QueryBatch& batch)
+    {
+        _executeBatch(batch);
+    }
+
     /**
      * Executes SQL batch file
      *
@@ -514,6 +760,12 @@ public:
         _executeBatchSQL(batchSQL, errors);
     }
 
+    /**
+     * Releases the statements of the queries, linked to the database.
+     * Queries allocate and prepare their statements again, when executed.
+     */
+    void releaseQueryStatements();
+
     /**
      * Close all queries, connected to this connection,
      * free their statements, and empty connected query
@@ -30,7 +30,11 @@
 #define __SPTK_POSTGRESQLCONNECTION_H__
 
 #include <sptk5/db/PoolDatabaseConnection.h>
+#include <sptk5/db/QueryBatch.h>
+#include <sptk5/net/SocketEvents.h>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #if HAVE_POSTGRESQL == 1
 
@@ -58,8 +62,144 @@ class SP_EXPORT PostgreSQLConnection: public PoolDatabaseConnection
 {
     friend class Query;
 
+    /**
+     * Asynchronous query execution, waiting for the results
+     */
+    struct AsyncQuery
+    {
+        Query*                          query {nullptr};    ///< Executed query
+        AsyncQueryCallback              callback;           ///< Completion callback
+        std::shared_ptr<BaseSocket>     socket;             ///< Connection socket, watched for the results
+        PGresult*                       result {nullptr};   ///< The first result of the query
+    };
+
+    /**
+     * Connection state, shared with the events thread.
+     * Events callback finds the state by its address, so it never uses the connection after it's closed.
+     */
+    struct AsyncState
+    {
+        std::mutex                      mutex;                  ///< Protects the state
+        std::condition_variable         idle;                   ///< Signaled when events callback is complete
+        PostgreSQLConnection*           connection {nullptr};   ///< Connection, or nullptr after it's closed
+        size_t                          callbacks {0};          ///< Number of events callbacks in progress
+        std::thread::id                 callbackThread;         ///< Thread that executes events callback
+        Query*                          completing {nullptr};   ///< Query, completed by events callback in progress
+    };
+
     mutable std::mutex      m_mutex;                ///< Mutex that protects access to data members
     PGconn*                 m_connect {nullptr};    ///< PostgreSQL database connection
+    AsyncQuery              m_async;                ///< Asynchronous query execution, if any
+    std::shared_ptr<AsyncState> m_asyncState;       ///< State shared with the events thread, if the connection executed asynchronous queries
+
+    /**
+     * @brief Socket events, shared by all the connections, that execute queries asynchronously
+     */
+    static SocketEvents& asyncEvents();
+
+    /**
+     * @brief Socket events callback: reads the results of asynchronous query
+     * @param userData          Connection that executes the query
+     * @param eventType         Socket event type
+     */
+    static void asyncEvent(void* userData, SocketEventType eventType);
+
+    /**
+     * @brief Stop receiving socket events, and wait until events callback that is in progress is complete
+     */
+    void closeAsync();
+
+    /**
+     * @brief Read available results of asynchronous query, and complete the query if all results are received
+     * @param state             Connection state, shared with the events thread
+     * @param eventType         Socket event type
+     */
+    void readAsyncResults(AsyncState& state, SocketEventType eventType);
+
+    /**
+     * @brief Open the query with the received result, and execute completion callback
+     * @param async             Asynchronous query execution, removed from the connection
+     * @param error             Error that interrupted the execution, if any
+     */
+    void completeAsync(AsyncQuery& async, const String& error);
+
+    /**
+     * @brief Throw an exception if the connection executes asynchronous query
+     *
+     * Synchronous commands would fail, since libpq allows only one command in progress.
+     */
+    void checkAsyncIdle() const;
+
+    /**
+     * @brief Read the column descriptions of the executed query into fields, and fetch the first row
+     * @param query             Query
+     */
+    void openResult(Query* query);
+
+    /**
+     * @brief Switch the connection, that has just sent a query, to streaming mode, and get the first result
+     *
+     * Uses chunked-rows mode if libpq supports it, otherwise single-row mode.
+     * @param fetchSize         Max number of rows in a single result
+     * @return the first result
+     */
+    PGresult* startStreaming(unsigned fetchSize);
+
+    /**
+     * @brief Read and discard the remaining results of the streaming query
+     * @param cancel            If true then ask server to stop sending rows
+     */
+    void finishStreaming(bool cancel);
+
+    /**
+     * @brief Deallocate prepared statement, removed from the statement cache
+     * @param statement         Prepared statement
+     */
+    void releaseCachedStatement(void* statement) override;
+
+    /**
+     * @brief Send the query of the batch entry to server, in pipeline mode
+     * @param entry             Queued query execution
+     */
+    void sendPipelined(QueryBatch::Entry& entry);
+
+    /**
+     * Results of the query sent in pipeline mode, that are read so far
+     */
+    struct PipelinedResults
+    {
+        QueryBatch::Entry*  entry;                  ///< Queued query execution
+        String              error;                  ///< The first error of the query
+        int64_t             rows {-1};              ///< Number of affected or returned rows, -1 if unknown
+        bool                resultsEnded {false};   ///< True after the end of the query results
+
+        explicit PipelinedResults(QueryBatch::Entry* entry)
+        : entry(entry)
+        {}
+    };
+
+    /**
+     * @brief Read the results of the query sent in pipeline mode, that are already received, up to its sync point
+     *
+     * Doesn't wait for the server. When the sync point is read, the entry receives the execution result.
+     * @param results           Results of the query, read so far
+     * @return true if the sync point is read
+     */
+    bool readPipelined(PipelinedResults& results);
+
+    /**
+     * @brief Replace exhausted rows of the streaming query with the next rows from server
+     * @param query             Streaming query
+     * @param statement         Query statement
+     */
+    void fetchStreamingRows(Query* query, PostgreSQLStatement* statement);
+
+    /**
+     * @brief Read the current row of the statement into query fields
+     * @param query             Query
+     * @param statement         Query statement
+     */
+    void readResultRow(Query* query, PostgreSQLStatement* statement);
 
 protected:
 
@@ -134,11 +274,27 @@ protected:
      */
     void queryOpen(Query *query) override;
 
+    /**
+     * Sends the query with PQsendQueryPrepared or PQsendQueryParams, and reads the results in the events thread
+     */
+    void queryOpenAsync(Query* query, const AsyncQueryCallback& callback) override;
+
+    /**
+     * Cancels the query on the server, discards its results, and executes its callback with an error.
+     * If the query is being completed by the events thread, waits until the callback is complete.
+     */
+    void queryCancelAsync(Query* query) override;
+
     /**
      * Reads data from the query' recordset into fields, and advances to the next row. After reading the last row sets the EOF (end of file, or no more data) flag.
      */
     void queryFetch(Query *query) override;
 
+    /**
+     * Reads up to maxRows rows, starting from the current row, directly from the query result into record batch
+     */
+    size_t queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows) override;
+
 
     /**
      * @brief Returns parameter mark
@@ -187,6 +343,23 @@ public:
     void _bulkInsert(const String& tableName, const Strings& columnNames, const Strings& data,
                      const String& format) override;
 
+    /**
+     * @brief Creates bulk loader that sends typed rows with COPY in binary format
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     */
+    SBulkLoader _bulkLoader(const String& tableName, const Strings& columnNames) override;
+
+    /**
+     * @brief Executes queued query executions in pipeline mode
+     *
+     * Queries are sent without waiting for the results of the previous queries,
+     * every query followed by its own sync point, so a failed query doesn't abort the others.
+     * Result sets of the queries are discarded.
+     * @param batch             Queued query executions
+     */
+    void _executeBatch(QueryBatch& batch) override;
+
     /**
      * @brief Executes SQL batch file
      *
@@ -218,6 +391,14 @@ public:
      */
     String nativeConnectionString() const override;
 
+    /**
+     * @brief Resets session state: rolls back open transaction, resets session parameters,
+     * drops temporary tables, releases advisory locks and stops listening for notifications.
+     *
+     * DISCARD ALL isn't used, so the prepared statements in the statement cache are kept.
+     */
+    void resetSession() override;
+
     /**
      * @brief Closes the database connection. If unsuccessful throws an exception.
      */
@@ -228,6 +409,11 @@ public:
      */
     bool active() const override;
 
+    /**
+     * @brief Returns true if connection is opened, and libpq reports it as usable
+     */
+    bool validate() const override;
+
     /**
      * @brief Returns the database connection handle
      */
@@ -37,9 +37,13 @@
 #include <sptk5/DataSource.h>
 
 #include <sptk5/db/AutoDatabaseConnection.h>
+#include <sptk5/db/DatabaseStatistics.h>
 #include <sptk5/db/QueryParameterList.h>
+#include <sptk5/db/QueryResultCache.h>
+#include <sptk5/db/RecordBatch.h>
 #include <sptk5/FieldList.h>
 #include <sptk5/threads/Locks.h>
+#include <future>
 
 namespace sptk {
 
@@ -80,6 +84,11 @@ class SP_EXPORT Query_StatementManagement: public DataSource
      */
     bool                    m_bulkMode {false};
 
+    /**
+     * Number of rows the driver fetches from server at once, 0 means entire result set
+     */
+    unsigned                m_fetchSize {0};
+
     /**
      * SQL statement string
      */
@@ -189,7 +198,7 @@ public:
     {}
 
     Query_StatementManagement(const Query_StatementManagement& other)
-    : m_autoPrepare(other.m_autoPrepare)
+    : m_autoPrepare(other.m_autoPrepare), m_fetchSize(other.m_fetchSize)
     {}
 
     /**
@@ -240,6 +249,32 @@ public:
      */
     bool bulkMode() const;
 
+    /**
+     * @brief Returns the number of rows, fetched from server at once
+     *
+     * 0 means the entire result set is fetched when the query is opened.
+     */
+    unsigned fetchSize() const
+    {
+        return m_fetchSize;
+    }
+
+    /**
+     * @brief Set the number of rows, fetched from server at once
+     *
+     * Non-zero fetch size makes the query stream the result set: the first row is available
+     * as soon as server sends it, and the memory used by the result set doesn't depend on the number of rows.
+     * While the streaming query is opened, the connection can't execute other queries,
+     * except MySQL prepared queries, that read the rows through read-only server-side cursor.
+     * ODBC driver uses fetch size greater than 1 as the rowset size of the block cursor.
+     * Drivers that don't support streaming ignore it.
+     * @param fetchSize         Number of rows, or 0 to fetch the entire result set
+     */
+    void setFetchSize(unsigned fetchSize)
+    {
+        m_fetchSize = fetchSize;
+    }
+
     /**
      * @brief Connects a query to a database
      *
@@ -293,6 +328,128 @@ class SP_EXPORT Query: public Query_StatementManagement
      */
     FieldList               m_fields;
 
+    /**
+     * Time to live of cached query results, 0 if results aren't cached
+     */
+    std::chrono::milliseconds m_cacheTTL {0};
+
+    /**
+     * Tables the query reads from, invalidating cached results
+     */
+    Strings                 m_cacheTables;
+
+    /**
+     * Cached result the query reads rows from, if any
+     */
+    SRecordBatch            m_cachedResult;
+
+    /**
+     * Current row of cached result
+     */
+    size_t                  m_cachedRow {0};
+
+    /**
+     * True if query fields are created from cached result, rather than by database driver
+     */
+    bool                    m_fieldsFromCache {false};
+
+    /**
+     * True if the rows after cached result are read from the database.
+     * The result is only partially fetched when it's too large to cache.
+     */
+    bool                    m_continueAfterCachedResult {false};
+
+    /**
+     * Number of rows fetched at once while reading the result into result cache
+     */
+    static constexpr size_t CacheFetchRows = 1024;
+
+    /**
+     * Database statistics that statement statistics belongs to
+     */
+    SDatabaseStatistics     m_databaseStatistics;
+
+    /**
+     * Statement statistics, found for the current SQL
+     */
+    SStatementStatistics    m_statementStatistics;
+
+    /**
+     * Time when the current statement execution started
+     */
+    std::chrono::steady_clock::time_point m_executeStarted;
+
+    /**
+     * Time spent preparing the statement during the current execution
+     */
+    std::chrono::microseconds m_prepareTime {0};
+
+    /**
+     * @brief Returns statement statistics, or nullptr if the connection doesn't collect statistics
+     */
+    StatementStatistics* statementStatistics();
+
+    /**
+     * @brief Opens the query in the database, and records execution time in statement statistics
+     */
+    void openStatement();
+
+    /**
+     * @brief Starts measuring statement execution time
+     */
+    void executionStarted();
+
+    /**
+     * @brief Records statement execution in statement statistics
+     * @param statistics        Statement statistics
+     * @param failed            True if execution failed
+     */
+    void executionCompleted(StatementStatistics& statistics, bool failed);
+
+    /**
+     * @brief Returns result cache key: SQL and parameter values
+     */
+    String resultCacheKey() const;
+
+    /**
+     * @brief Opens the query in the database, reconnecting if the connection is lost
+     */
+    void openDatabaseQuery();
+
+    /**
+     * @brief Returns the result cache of the connection, if the query results should be cached
+     */
+    QueryResultCache* resultCache() const;
+
+    /**
+     * @brief Fetches up to maxRows rows, appending them to the batch, from the database
+     * @param batch             Record batch with columns matching query fields
+     * @param maxRows           Max number of rows to fetch
+     * @return number of fetched rows
+     */
+    size_t fetchRows(RecordBatch& batch, size_t maxRows);
+
+    /**
+     * @brief Reads all rows of opened query into result cache, closes the statement, and opens the cached result
+     *
+     * Rows are fetched in chunks. If the result exceeds cache max size, it isn't cached:
+     * the query returns the rows that are already fetched, and then reads the rest from the database.
+     * @param cache             Result cache
+     * @param key               Result cache key
+     */
+    void cacheResult(QueryResultCache& cache, const String& key);
+
+    /**
+     * @brief Opens the query with cached result, without executing the statement
+     * @param result            Cached result
+     */
+    void openCachedResult(const SRecordBatch& result);
+
+    /**
+     * @brief Reads the current row of cached result into query fields
+     */
+    void readCachedRow();
+
     /**
      * Parse query parameter during assigning SQL to query
      * @param paramStart        Start of parameter
@@ -480,6 +637,8 @@ public:
      */
     bool close() override
     {
+        m_cachedResult.reset();
+        m_continueAfterCachedResult = false;
         closeQuery();
         return true;
     }
@@ -513,11 +672,78 @@ public:
         open();
     }
 
+    /**
+     * @brief Sends the query to server, and opens it when the results are received, without blocking
+     *
+     * Drivers that support asynchronous execution (PostgreSQL) read the results in the database
+     * events thread, so the calling thread isn't blocked while server executes the query.
+     * The entire result set is received before the query is opened, fetch size is ignored.
+     * Other drivers open the query synchronously.
+     * The connection can't execute other queries until the results are received.
+     * @return future, that is ready when the query is opened, or throws execution error
+     */
+    std::future<void> openAsync();
+
+    /**
+     * @brief Sends the query to server, and opens it when the results are received, without blocking
+     *
+     * The callback is executed when the query is opened, or execution fails.
+     * For asynchronous drivers, it is executed by the database events thread, so it shouldn't block.
+     * Errors, detected before the query is sent to server, are thrown by this method.
+     * @param callback          Completion callback
+     */
+    void openAsync(const AsyncQueryCallback& callback);
+
+    /**
+     * @brief Caches query results in connection pool result cache
+     *
+     * The results are cached by SQL and parameter values. While the cached result is valid,
+     * open() reads the rows from the cache, without executing the statement.
+     * Cached results expire after ttl, or when QueryResultCache::invalidate() is called for one of the tables.
+     * Only the queries, that return rows, are cached. Connections that don't belong to a connection pool
+     * don't have result cache, unless it is set with PoolDatabaseConnection::setResultCache().
+     * @param ttl               Time to live of cached results, 0 disables caching
+     * @param tables            Tables the query reads from
+     */
+    void cacheResults(std::chrono::milliseconds ttl, const Strings& tables = Strings());
+
+    /**
+     * @brief Executes the query without blocking, same as openAsync()
+     * @return future, that is ready when the query is executed, or throws execution error
+     */
+    std::future<void> execAsync()
+    {
+        return openAsync();
+    }
+
+    /**
+     * @brief Executes the query without blocking, same as openAsync(callback)
+     * @param callback          Completion callback
+     */
+    void execAsync(const AsyncQueryCallback& callback)
+    {
+        openAsync(callback);
+    }
+
     /**
      * @brief Fetches the next row from the recordset, same as next()
      */
     void fetch();
 
+    /**
+     * @brief Fetches up to maxRows rows into columnar record batch
+     *
+     * The batch starts from the current row. After the rows are fetched,
+     * the next row (if any) becomes the current row, available through query fields.
+     * The batch is cleared before fetching. If batch columns don't match query fields,
+     * the columns are created again.
+     * Drivers that don't support batch fetch natively, fill the batch from the query fields.
+     * @param batch             Record batch to fill
+     * @param maxRows           Max number of rows to fetch
+     * @return number of fetched rows, 0 if there is no more rows
+     */
+    size_t fetchBatch(RecordBatch& batch, size_t maxRows);
+
     /**
      * @brief Reports the number of unique parameters in the query.
      *
@@ -0,0 +1,245 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       QueryBatch.h - description                             ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SPTK_QUERY_BATCH_H__
+#define __SPTK_QUERY_BATCH_H__
+
+#include <sptk5/db/AutoDatabaseConnection.h>
+#include <sptk5/Variant.h>
+
+namespace sptk
+{
+
+/**
+ * @addtogroup Database Database Support
+ * @{
+ */
+
+class Query;
+
+/**
+ * @brief Batch of query executions
+ *
+ * Every add() queues execution of the query with its current parameter values.
+ * The same query may be added many times, with different parameter values.
+ * execute() runs all the queued executions in the order they are added, the fastest way
+ * supported by the driver, and stores the error of every failed execution.
+ * A failed execution doesn't stop the executions that follow it.
+ *
+ * Batch is meant for the statements that modify data: the rows returned by the queries aren't kept,
+ * and execution result only has the number of affected or returned rows, if the driver reports it.
+ *
+ * PostgreSQL driver sends the executions in pipeline mode, without waiting for
+ * the result of each one, and reports the number of rows. Other drivers execute the queries one by one.
+ */
+class SP_EXPORT QueryBatch
+{
+public:
+    /**
+     * Queued query execution
+     */
+    class SP_EXPORT Entry
+    {
+        Query*              m_query;                ///< Query to execute
+        VariantVector       m_params;               ///< Query parameter values
+        bool                m_executed {false};     ///< True after query is executed, or failed
+        String              m_error;                ///< Execution error, or empty string
+        int64_t             m_rows {-1};            ///< Number of affected or returned rows, -1 if unknown
+
+    public:
+        /**
+         * Constructor
+         * @param query         Query to execute
+         * @param params        Query parameter values
+         */
+        Entry(Query* query, VariantVector&& params)
+        : m_query(query), m_params(std::move(params))
+        {}
+
+        /**
+         * @return query to execute
+         */
+        Query* query() const
+        {
+            return m_query;
+        }
+
+        /**
+         * Set query parameters to the values that were current when query was added
+         */
+        void bindParameters() const;
+
+        /**
+         * Store execution result
+         * @param error         Execution error, or empty string if query succeeded
+         * @param rows          Number of affected or returned rows, -1 if unknown
+         */
+        void setResult(const String& error = "", int64_t rows = -1)
+        {
+            m_executed = true;
+            m_error = error;
+            m_rows = rows;
+        }
+
+        /**
+         * Forget execution result, before executing the query again
+         */
+        void resetResult()
+        {
+            m_executed = false;
+            m_error = "";
+            m_rows = -1;
+        }
+
+        /**
+         * @return true if query is executed, successfully or not
+         */
+        bool executed() const
+        {
+            return m_executed;
+        }
+
+        /**
+         * @return true if query execution failed
+         */
+        bool failed() const
+        {
+            return !m_error.empty();
+        }
+
+        /**
+         * @return number of rows affected by the execution, or returned by the query,
+         *         -1 if the driver doesn't report it, or execution failed
+         */
+        int64_t rows() const
+        {
+            return m_rows;
+        }
+
+        /**
+         * @return execution error, or empty string
+         */
+        const String& error() const
+        {
+            return m_error;
+        }
+    };
+
+private:
+
+    PoolDatabaseConnection*     m_db;           ///< Database connection
+    std::vector<Entry>          m_entries;      ///< Queued executions
+
+public:
+    /**
+     * Constructor
+     * @param db                Database connection
+     */
+    explicit QueryBatch(PoolDatabaseConnection* db)
+    : m_db(db)
+    {}
+
+    /**
+     * Constructor
+     * @param db                Database connection
+     */
+    explicit QueryBatch(const DatabaseConnection& db)
+    : m_db(db->connection())
+    {}
+
+    /**
+     * Queue query execution with the current query parameter values
+     * @param query             Query, connected to the same database connection
+     */
+    void add(Query& query);
+
+    /**
+     * Execute all queued queries.
+     * The results of executions are available through operator [].
+     * @return number of failed executions
+     */
+    size_t execute();
+
+    /**
+     * Remove all queued executions
+     */
+    void clear()
+    {
+        m_entries.clear();
+    }
+
+    /**
+     * @return number of queued executions
+     */
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    /**
+     * @return true if there are no queued executions
+     */
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    /**
+     * @param index             Execution index, in the order of add() calls
+     * @return queued execution, and its result after execute()
+     */
+    Entry& operator[](size_t index)
+    {
+        return m_entries[index];
+    }
+
+    /**
+     * @param index             Execution index, in the order of add() calls
+     * @return queued execution, and its result after execute()
+     */
+    const Entry& operator[](size_t index) const
+    {
+        return m_entries[index];
+    }
+
+    std::vector<Entry>::iterator begin()
+    {
+        return m_entries.begin();
+    }
+
+    std::vector<Entry>::iterator end()
+    {
+        return m_entries.end();
+    }
+};
+
+/**
+ * @}
+ */
+}
+#endif
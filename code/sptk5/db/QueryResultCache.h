@@ -0,0 +1,219 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       QueryResultCache.h - description                       ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SPTK_QUERY_RESULT_CACHE_H__
+#define __SPTK_QUERY_RESULT_CACHE_H__
+
+#include <sptk5/db/RecordBatch.h>
+#include <sptk5/CaseInsensitiveCompare.h>
+#include <sptk5/Strings.h>
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace sptk
+{
+
+/**
+ * @addtogroup Database Database Support
+ * @{
+ */
+
+/**
+ * Shared pointer to immutable record batch
+ */
+typedef std::shared_ptr<const RecordBatch> SRecordBatch;
+
+/**
+ * Query result cache statistics
+ */
+struct QueryResultCacheStatistics
+{
+    /**
+     * Number of results taken from the cache
+     */
+    size_t          hits {0};
+
+    /**
+     * Number of results that weren't found in the cache, or were expired
+     */
+    size_t          misses {0};
+
+    /**
+     * Number of least recently used results removed to keep the cache size
+     */
+    size_t          evictions {0};
+
+    /**
+     * Number of results removed by table invalidation
+     */
+    size_t          invalidations {0};
+
+    /**
+     * Number of cached results
+     */
+    size_t          entries {0};
+
+    /**
+     * Memory used by cached results
+     */
+    size_t          memorySize {0};
+
+    /**
+     * @return share of lookups that found the result in the cache, from 0 to 1
+     */
+    double hitRate() const
+    {
+        size_t lookups = hits + misses;
+        return lookups == 0 ? 0 : double(hits) / double(lookups);
+    }
+};
+
+/**
+ * @brief Cache of query results
+ *
+ * Results are immutable record batches, shared by the queries that read them.
+ * Every result expires after its time to live, and may be invalidated by the names of the tables
+ * it is read from. When total size of the results exceeds the limit, the least recently used
+ * results are removed.
+ *
+ * The cache is thread-safe. Connection pool shares its cache between the pool connections,
+ * and the queries use it after Query::cacheResults() is called.
+ */
+class SP_EXPORT QueryResultCache
+{
+    typedef std::chrono::steady_clock::time_point   TimePoint;
+
+    /**
+     * Cached result
+     */
+    struct Entry
+    {
+        String              key;            ///< Cache key
+        SRecordBatch        result;         ///< Query result
+        TimePoint           expires;        ///< Expiration time
+        Strings             tables;         ///< Tables the result is read from
+        size_t              size;           ///< Memory used by the result
+    };
+
+    typedef std::list<Entry>                                EntryList;
+    typedef std::map<String, std::set<String>, CaseInsensitiveCompare> TableKeys;
+
+    mutable std::mutex                          m_mutex;            ///< Protects cache data
+    EntryList                                   m_entries;          ///< Cached results, the most recently used first
+    std::map<String, EntryList::iterator>       m_index;            ///< Cached results by cache key
+    TableKeys                                   m_tableKeys;        ///< Cache keys by table names
+    size_t                                      m_maxSize;          ///< Max total size of cached results
+    QueryResultCacheStatistics                  m_statistics;       ///< Cache statistics
+
+    /**
+     * Remove cached result.
+     * Must be called with locked m_mutex.
+     * @param itor              Cached result
+     */
+    void erase(EntryList::iterator itor);
+
+    /**
+     * Remove least recently used results above the size limit.
+     * Must be called with locked m_mutex.
+     */
+    void trim();
+
+public:
+    /**
+     * Default max total size of cached results
+     */
+    static constexpr size_t DefaultMaxSize = 64 * 1024 * 1024;
+
+    /**
+     * Constructor
+     * @param maxSize           Max total size of cached results
+     */
+    explicit QueryResultCache(size_t maxSize = DefaultMaxSize);
+
+    /**
+     * Find the result, that isn't expired
+     * @param key               Cache key
+     * @return cached result, or nullptr if it isn't found
+     */
+    SRecordBatch find(const String& key);
+
+    /**
+     * Add or replace the result.
+     * Results that are larger than max cache size aren't cached.
+     * @param key               Cache key
+     * @param result            Query result
+     * @param ttl               Time to live
+     * @param tables            Tables the result is read from, used for invalidation
+     */
+    void insert(const String& key, const SRecordBatch& result, std::chrono::milliseconds ttl,
+                const Strings& tables = Strings());
+
+    /**
+     * Remove all the results, read from the table
+     * @param tableName         Table name, case-insensitive
+     * @return number of removed results
+     */
+    size_t invalidate(const String& tableName);
+
+    /**
+     * Remove all the results
+     */
+    void clear();
+
+    /**
+     * Set max total size of cached results
+     * @param maxSize           Max size, 0 disables the cache
+     */
+    void setMaxSize(size_t maxSize);
+
+    /**
+     * @return max total size of cached results
+     */
+    size_t maxSize() const;
+
+    /**
+     * @return cache statistics
+     */
+    QueryResultCacheStatistics statistics() const;
+};
+
+/**
+ * Shared pointer to query result cache
+ */
+typedef std::shared_ptr<QueryResultCache> SQueryResultCache;
+
+/**
+ * @}
+ */
+}
+
+#endif
@@ -0,0 +1,476 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       RecordBatch.h - description                            ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SPTK_RECORD_BATCH_H__
+#define __SPTK_RECORD_BATCH_H__
+
+#include <sptk5/Buffer.h>
+#include <sptk5/Variant.h>
+#include <deque>
+#include <vector>
+
+namespace sptk
+{
+
+/**
+ * @addtogroup Database Database Support
+ * @{
+ */
+
+/**
+ * @brief Columnar batch of records
+ *
+ * Every column keeps its values in a contiguous typed array:
+ * integers, booleans, dates and timestamps in 64-bit integer array (dates and timestamps
+ * as microseconds since epoch), floating point and money values in double array,
+ * strings and buffers in the column string arena, with the offset of every value.
+ * NULL values are marked in the column null bitmap, and occupy an empty slot in the array.
+ *
+ * Record batch is filled by Query::fetchBatch(), that may be called again with the same batch,
+ * to reuse the allocated memory.
+ */
+class SP_EXPORT RecordBatch
+{
+public:
+    /**
+     * @brief Column of record batch
+     */
+    class SP_EXPORT Column
+    {
+        /**
+         * Storage used for the column values
+         */
+        enum Storage : uint8_t
+        {
+            NO_STORAGE,
+            INTEGER_STORAGE,
+            FLOAT_STORAGE,
+            STRING_STORAGE
+        };
+
+        String                  m_name;                     ///< Column name
+        VariantType             m_type {VAR_NONE};          ///< Column data type
+        Storage                 m_storage {NO_STORAGE};     ///< Storage used for the column values
+        size_t                  m_size {0};                 ///< Number of values in the column
+        std::vector<uint8_t>    m_nulls;                    ///< Null bitmap, a bit is set for null value
+        std::vector<int64_t>    m_integers;                 ///< Integer values
+        std::vector<double>     m_floats;                   ///< Floating point values
+        std::vector<size_t>     m_offsets {0};              ///< String value offsets in arena, one extra for the end
+        Buffer                  m_arena;                    ///< String arena
+
+        /**
+         * Add the bit for the next value to null bitmap
+         * @param isNull        True if value is null
+         */
+        void addNullBit(bool isNull)
+        {
+            if ((m_size & 7) == 0)
+                m_nulls.push_back(0);
+            if (isNull)
+                m_nulls[m_size >> 3] |= uint8_t(1 << (m_size & 7));
+            m_size++;
+        }
+
+        /**
+         * Append value that doesn't match the column storage
+         * @param value         Value to append
+         */
+        void appendConverted(const Variant& value);
+
+    public:
+        /**
+         * Constructor
+         * @param name          Column name
+         * @param type          Column data type, or VAR_NONE to define it by the first not null value
+         */
+        explicit Column(const String& name, VariantType type = VAR_NONE);
+
+        /**
+         * @return column name
+         */
+        const String& name() const
+        {
+            return m_name;
+        }
+
+        /**
+         * @return column data type, or VAR_NONE if it's not defined yet
+         */
+        VariantType type() const
+        {
+            return m_type;
+        }
+
+        /**
+         * @brief Set column data type
+         *
+         * Values that are already in the column should all be null.
+         * @param type          Column data type
+         */
+        void type(VariantType type);
+
+        /**
+         * @return number of values in the column
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @param row           Row number
+         * @return true if the value is null
+         */
+        bool isNull(size_t row) const
+        {
+            return (m_nulls[row >> 3] & (1 << (row & 7))) != 0;
+        }
+
+        /**
+         * @param row           Row number
+         * @return integer, boolean, date or timestamp value, as stored in the column
+         */
+        int64_t integer(size_t row) const
+        {
+            return m_integers[row];
+        }
+
+        /**
+         * @param row           Row number
+         * @return floating point value
+         */
+        double number(size_t row) const
+        {
+            return m_floats[row];
+        }
+
+        /**
+         * @param row           Row number
+         * @return string or buffer value, not zero-terminated
+         */
+        const char* string(size_t row) const
+        {
+            return m_arena.c_str() + m_offsets[row];
+        }
+
+        /**
+         * @param row           Row number
+         * @return string or buffer value length
+         */
+        size_t length(size_t row) const
+        {
+            return m_offsets[row + 1] - m_offsets[row];
+        }
+
+        /**
+         * @param row           Row number
+         * @return date or timestamp value
+         */
+        DateTime dateTime(size_t row) const;
+
+        /**
+         * @param row           Row number
+         * @return value converted to string, or empty string for null value
+         */
+        String asString(size_t row) const;
+
+        /**
+         * @return null bitmap, a bit is set for null value
+         */
+        const std::vector<uint8_t>& nulls() const
+        {
+            return m_nulls;
+        }
+
+        /**
+         * @return integer array
+         */
+        const std::vector<int64_t>& integers() const
+        {
+            return m_integers;
+        }
+
+        /**
+         * @return floating point array
+         */
+        const std::vector<double>& floats() const
+        {
+            return m_floats;
+        }
+
+        /**
+         * @return string arena
+         */
+        const Buffer& arena() const
+        {
+            return m_arena;
+        }
+
+        /**
+         * @brief Append null value
+         */
+        void appendNull()
+        {
+            switch (m_storage) {
+                case INTEGER_STORAGE:
+                    m_integers.push_back(0);
+                    break;
+                case FLOAT_STORAGE:
+                    m_floats.push_back(0);
+                    break;
+                case STRING_STORAGE:
+                    m_offsets.push_back(m_arena.bytes());
+                    break;
+                default:
+                    break;
+            }
+            addNullBit(true);
+        }
+
+        /**
+         * @brief Append integer or boolean value
+         *
+         * If column data type isn't defined yet, it becomes VAR_INT64.
+         * @param value         Value to append
+         */
+        void appendInteger(int64_t value)
+        {
+            if (m_storage == NO_STORAGE)
+                type(VAR_INT64);
+            if (m_storage != INTEGER_STORAGE) {
+                appendConverted(Variant(value));
+                return;
+            }
+            m_integers.push_back(value);
+            addNullBit(false);
+        }
+
+        /**
+         * @brief Append floating point value
+         *
+         * If column data type isn't defined yet, it becomes VAR_FLOAT.
+         * @param value         Value to append
+         */
+        void appendFloat(double value)
+        {
+            if (m_storage == NO_STORAGE)
+                type(VAR_FLOAT);
+            if (m_storage != FLOAT_STORAGE) {
+                appendConverted(Variant(value));
+                return;
+            }
+            m_floats.push_back(value);
+            addNullBit(false);
+        }
+
+        /**
+         * @brief Append string or buffer value
+         *
+         * If column data type isn't defined yet, it becomes VAR_STRING.
+         * @param value         Value to append
+         * @param length        Value length
+         */
+        void appendString(const char* value, size_t length)
+        {
+            if (m_storage == NO_STORAGE)
+                type(VAR_STRING);
+            if (m_storage != STRING_STORAGE) {
+                appendConverted(Variant(String(value, length)));
+                return;
+            }
+            if (length != 0)
+                m_arena.append(value, length);
+            m_offsets.push_back(m_arena.bytes());
+            addNullBit(false);
+        }
+
+        /**
+         * @brief Append date or timestamp value
+         *
+         * If column data type isn't defined yet, it becomes VAR_DATE_TIME.
+         * @param microseconds  Microseconds since epoch
+         */
+        void appendDateTime(int64_t microseconds)
+        {
+            if (m_storage == NO_STORAGE)
+                type(VAR_DATE_TIME);
+            if (m_type != VAR_DATE && m_type != VAR_DATE_TIME) {
+                appendConverted(Variant(microsecondsToDateTime(microseconds)));
+                return;
+            }
+            m_integers.push_back(microseconds);
+            addNullBit(false);
+        }
+
+        /**
+         * @brief Append value, converted to column data type
+         *
+         * If column data type isn't defined yet, it is defined by the value data type.
+         * @param value         Value to append
+         */
+        void append(const Variant& value);
+
+        /**
+         * @brief Remove all the values, keeping the allocated memory
+         */
+        void clear();
+
+        /**
+         * @brief Allocate memory for the number of values
+         * @param rows          Number of values
+         */
+        void reserve(size_t rows);
+
+        /**
+         * @brief Release the memory that is allocated, but not used by the values
+         */
+        void shrinkToFit();
+
+        /**
+         * @return memory used by the column values
+         */
+        size_t memorySize() const;
+
+        /**
+         * @param microseconds  Microseconds since epoch
+         * @return date and time
+         */
+        static DateTime microsecondsToDateTime(int64_t microseconds);
+
+        /**
+         * @param dateTime      Date and time
+         * @return microseconds since epoch
+         */
+        static int64_t dateTimeToMicroseconds(const DateTime& dateTime);
+    };
+
+private:
+
+    std::deque<Column>      m_columns;      ///< Batch columns, references to added columns stay valid
+
+public:
+    /**
+     * @brief Add column
+     * @param name              Column name
+     * @param type              Column data type, or VAR_NONE to define it by the first not null value
+     * @return added column
+     */
+    Column& addColumn(const String& name, VariantType type = VAR_NONE);
+
+    /**
+     * @brief Remove all the rows, keeping columns and the allocated memory
+     */
+    void clear();
+
+    /**
+     * @brief Release the memory that is allocated, but not used by the values
+     */
+    void shrinkToFit();
+
+    /**
+     * @return memory used by the batch values
+     */
+    size_t memorySize() const;
+
+    /**
+     * @brief Remove all the rows and columns
+     */
+    void reset()
+    {
+        m_columns.clear();
+    }
+
+    /**
+     * @return number of rows in the batch
+     */
+    size_t rows() const
+    {
+        return m_columns.empty() ? 0 : m_columns[0].size();
+    }
+
+    /**
+     * @return number of columns in the batch
+     */
+    size_t columnCount() const
+    {
+        return m_columns.size();
+    }
+
+    /**
+     * @brief Column access by index
+     * @param columnIndex       Column index
+     */
+    Column& operator [](size_t columnIndex)
+    {
+        return m_columns[columnIndex];
+    }
+
+    /**
+     * @brief Column access by index, const version
+     * @param columnIndex       Column index
+     */
+    const Column& operator [](size_t columnIndex) const
+    {
+        return m_columns[columnIndex];
+    }
+
+    /**
+     * @brief Column access by name
+     *
+     * If the column isn't found, throws an exception.
+     * @param columnName        Column name
+     */
+    const Column& operator [](const String& columnName) const;
+
+    /**
+     * @brief Export rows as JSON array of objects
+     *
+     * Dates and timestamps are exported in ISO format, and buffers in Base64 encoding.
+     * @param output            Output buffer, the data is appended to it
+     */
+    void exportJSON(Buffer& output) const;
+
+    /**
+     * @brief Export rows as CSV
+     *
+     * Values that contain delimiter, double quote or line end are quoted.
+     * Null values are exported as empty values.
+     * Dates and timestamps are exported in ISO format, and buffers in Base64 encoding.
+     * @param output            Output buffer, the data is appended to it
+     * @param delimiter         Value delimiter
+     * @param header            If true then the first line contains column names
+     */
+    void exportCSV(Buffer& output, char delimiter = ',', bool header = true) const;
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
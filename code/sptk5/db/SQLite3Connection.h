@@ -78,6 +78,16 @@ protected:
      */
     virtual String queryError(const Query *query) const override;
 
+    /**
+     * Resets SQLite3 statement, and returns it to the statement cache, or finalizes it if cache is disabled
+     */
+    void releaseStatement(SQLHSTMT stmt);
+
+    /**
+     * Finalizes SQLite3 statement, removed from the statement cache
+     */
+    void releaseCachedStatement(void* statement) override;
+
     /**
      * Allocates an SQLite3 statement
      */
@@ -128,6 +138,16 @@ protected:
      */
     virtual void queryFetch(Query *query) override;
 
+    /**
+     * Reads up to maxRows rows, starting from the current row, directly from the statement into record batch
+     */
+    size_t queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows) override;
+
+    /**
+     * Reads the current row of the statement into query fields
+     */
+    void readResultRow(Query* query);
+
 
     /**
      * @brief Returns the SQLite3 connection object
@@ -148,6 +168,22 @@ protected:
      */
     void _openDatabase(const String& connectionString = "") override;
 
+    /**
+     * @brief Applies connection options, defined by the connection string parameters
+     *
+     * Supported options are journal_mode, synchronous, cache_size and mmap_size pragmas,
+     * and busy_timeout in milliseconds. For instance:
+     * sqlite3://localhost/var/db/cache.sqlite3?journal_mode=wal&synchronous=normal&busy_timeout=5000
+     */
+    void setOptions();
+
+    /**
+     * @brief Creates bulk loader that inserts rows with reused multi-row INSERT statement
+     * @param tableName         Table name to load into
+     * @param columnNames       List of table columns to populate
+     */
+    SBulkLoader _bulkLoader(const String& tableName, const Strings& columnNames) override;
+
 public:
 
     /**
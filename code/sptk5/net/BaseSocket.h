@@ -170,6 +170,19 @@ public:
     };
 
 
+private:
+
+    /**
+     * Creates the socket, and connects or binds it to address
+     * @param openMode          Socket open mode
+     * @param addr              Socket address
+     * @param addrLength        Socket address length
+     * @param timeout           Connection timeout. If 0 then wait forever.
+     * @param addressName       Address name for error messages
+     */
+    void openAddress(CSocketOpenMode openMode, const sockaddr* addr, socklen_t addrLength,
+                     std::chrono::milliseconds timeout, const String& addressName);
+
 protected:
 
 #ifdef _WIN32
@@ -224,6 +237,17 @@ public:
      */
     void open_addr(CSocketOpenMode openMode = SOM_CREATE, const sockaddr_in* addr = nullptr, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
 
+#ifndef _WIN32
+    /**
+     * Opens the Unix domain socket connection by address.
+     * Socket domain becomes AF_UNIX. When binding, stale socket file with the same path is removed.
+     * @param openMode          SOM_BIND for the server socket, and SOM_CONNECT for the client socket
+     * @param addr              Defines socket path
+     * @param timeout           Connection timeout. If 0 then wait forever.
+     */
+    void open_addr(CSocketOpenMode openMode, const sockaddr_un* addr, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+#endif
+
     /**
      * Constructor
      * @param domain            Socket domain type
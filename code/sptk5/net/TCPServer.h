@@ -114,6 +114,20 @@ public:
      */
     void listen(uint16_t port);
 
+#ifndef _WIN32
+    /**
+     * Starts Unix domain socket listener.
+     * Connections are served the same way as TCP connections.
+     * @param socketPath        Listener socket file path
+     */
+    void listen(const String& socketPath);
+
+    /**
+     * Returns listener socket file path, or empty string for TCP listener
+     */
+    String socketPath() const;
+#endif
+
     /**
      * Stops listener
      */
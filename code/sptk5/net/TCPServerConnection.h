@@ -59,6 +59,19 @@ public:
         setSocket(new TCPSocket);
         socket().attach(connectionSocket);
     }
+
+    /**
+     * @brief Constructor
+     * @param server            TCP server
+     * @param connectionSocket  Already accepted by accept() function incoming connection socket
+     * @param socket            Socket object derived from TCPSocket, that takes ownership of the connection socket
+     */
+    TCPServerConnection(TCPServer& server, SOCKET connectionSocket, TCPSocket* socket)
+    : ServerConnection(server, connectionSocket, "TCPServerConnection")
+    {
+        setSocket(socket);
+        socket->attach(connectionSocket);
+    }
 };
 
 /**
@@ -65,6 +65,16 @@ class TCPServerListener: public Thread, public std::mutex
      */
     String          m_error;
 
+    /**
+     * Unix domain socket path, or empty string for TCP listener
+     */
+    String          m_socketPath;
+
+    /**
+     * True if the listener has bound the Unix domain socket, and owns the socket file
+     */
+    bool            m_socketBound {false};
+
     void acceptConnection();
 
 public:
@@ -75,6 +85,13 @@ public:
      */
     TCPServerListener(TCPServer* server, uint16_t port);
 
+    /**
+     * @brief Constructor of Unix domain socket listener
+     * @param server TCPServer*, TCP server created connection
+     * @param socketPath const String&, Listener socket file path
+     */
+    TCPServerListener(TCPServer* server, const String& socketPath);
+
     /**
      * @brief Thread function
      */
@@ -88,10 +105,7 @@ public:
     /**
      * @brief Start socket listening
      */
-    void listen()
-    {
-        m_listenerSocket.listen();
-    }
+    void listen();
 
     /**
      * @brief Returns listener port number
@@ -101,6 +115,14 @@ public:
         return m_listenerSocket.host().port();
     }
 
+    /**
+     * @brief Returns listener socket file path, or empty string for TCP listener
+     */
+    const String& socketPath() const
+    {
+        return m_socketPath;
+    }
+
     /**
      * @brief Returns latest socket error (if any)
      */
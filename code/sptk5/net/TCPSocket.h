@@ -216,6 +216,20 @@ public:
      */
     void close() noexcept override;
 
+#ifndef _WIN32
+    /**
+     * @brief Opens Unix domain socket connection
+     *
+     * Unix domain socket is a faster alternative to TCP loopback connection, for peers on the same host.
+     * @param socketPath        Socket file path
+     * @param openMode          Socket open mode, SOM_CONNECT or SOM_BIND
+     * @param blockingMode      Socket blocking (true) on non-blocking (false) mode
+     * @param timeout           Connection timeout. The default is 0 (wait forever)
+     */
+    void openUnix(const String& socketPath, CSocketOpenMode openMode = SOM_CONNECT, bool blockingMode = true,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+#endif
+
     /**
      * @brief In server mode, waits for the incoming connection.
      *
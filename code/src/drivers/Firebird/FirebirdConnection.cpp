@@ -295,7 +295,7 @@ void FirebirdConnection::queryOpen(Query *query)
         queryAllocStmt(query);
 
     if (!query->prepared())
-        queryPrepare(query);
+        prepareQuery(query);
 
     // Bind parameters also executes a query
     queryBindParameters(query);
@@ -30,6 +30,8 @@
 #include <sptk5/RegularExpression.h>
 #include <sptk5/db/MySQLConnection.h>
 #include <sptk5/db/Query.h>
+#include <sptk5/db/BulkLoader.h>
+#include <cstring>
 
 using namespace std;
 using namespace sptk;
@@ -52,6 +54,68 @@ MySQLConnection::~MySQLConnection()
     }
 }
 
+/**
+ * File name of LOAD DATA LOCAL, that bulk insert sends its rows as
+ */
+static const char* bulkInsertFileName = "bulk_insert";
+
+/**
+ * Rows of bulk insert, sent as the content of the local file of LOAD DATA LOCAL
+ */
+struct LocalInfileData
+{
+    const Strings&  rows;
+    size_t          row {0};        ///< Current row
+    size_t          offset {0};     ///< Offset of the not sent data in current row
+
+    explicit LocalInfileData(const Strings& rows) : rows(rows) {}
+};
+
+static int localInfileInit(void** ptr, const char* fileName, void* userData)
+{
+    // Server request is refused, unless bulk insert is in progress
+    auto* rows = *(const Strings* const*) userData;
+    if (rows == nullptr || strcmp(fileName, bulkInsertFileName) != 0) {
+        *ptr = nullptr;
+        return 1;
+    }
+    *ptr = new LocalInfileData(*rows);
+    return 0;
+}
+
+static int localInfileRead(void* ptr, char* buffer, unsigned bufferSize)
+{
+    auto* data = (LocalInfileData*) ptr;
+    unsigned bytes = 0;
+    while (bytes < bufferSize && data->row < data->rows.size()) {
+        const String& row = data->rows[data->row];
+        if (data->offset < row.length()) {
+            size_t size = min(size_t(bufferSize - bytes), row.length() - data->offset);
+            memcpy(buffer + bytes, row.c_str() + data->offset, size);
+            data->offset += size;
+            bytes += unsigned(size);
+            continue;
+        }
+        buffer[bytes++] = '\n';
+        data->row++;
+        data->offset = 0;
+    }
+    return int(bytes);
+}
+
+static void localInfileEnd(void* ptr)
+{
+    delete (LocalInfileData*) ptr;
+}
+
+static int localInfileError(void* ptr, char* errorMessage, unsigned errorMessageSize)
+{
+    if (ptr != nullptr)
+        return 0;
+    snprintf(errorMessage, errorMessageSize, "LOAD DATA LOCAL is only allowed for bulk insert");
+    return 2000;    // CR_UNKNOWN_ERROR
+}
+
 void MySQLConnection::initConnection()
 {
     static std::mutex libraryInitMutex;
@@ -62,6 +126,12 @@ void MySQLConnection::initConnection()
         throw DatabaseException("Can't initialize MySQL environment");
     mysql_options(m_connection, MYSQL_SET_CHARSET_NAME, "utf8");
     mysql_options(m_connection, MYSQL_INIT_COMMAND, "SET NAMES utf8");
+    unsigned localInfile = 1;   // Allows bulk insert with LOAD DATA LOCAL
+    mysql_options(m_connection, MYSQL_OPT_LOCAL_INFILE, &localInfile);
+
+    // Default handler would read any file the server asks for
+    mysql_set_local_infile_handler(m_connection, localInfileInit, localInfileRead, localInfileEnd,
+                                   localInfileError, &m_bulkInsertRows);
 }
 
 void MySQLConnection::_openDatabase(const String& newConnectionString)
@@ -102,6 +172,26 @@ void MySQLConnection::closeDatabase()
     }
 }
 
+void MySQLConnection::resetSession()
+{
+    PoolDatabaseConnection::resetSession();
+    if (!active())
+        return;
+
+    // Server-side prepared statements don't survive the reset
+    releaseQueryStatements();
+
+#if MYSQL_VERSION_ID >= 50703
+    if (mysql_reset_connection(m_connection) != 0)
+        throwMySQLException("Can't reset session");
+#else
+    const DatabaseConnectionString& connString = connectionString();
+    if (mysql_change_user(m_connection, connString.userName().c_str(), connString.password().c_str(),
+                          connString.databaseName().c_str()) != 0)
+        throwMySQLException("Can't reset session");
+#endif
+}
+
 void* MySQLConnection::handle() const
 {
     return m_connection;
@@ -244,6 +334,7 @@ void MySQLConnection::queryExecute(Query* query)
     auto* statement = (MySQLStatement*) query->statement();
     try {
         if (statement == nullptr) throwDatabaseException("Query is not prepared");
+        statement->fetchSize(query->fetchSize());
         statement->execute(getInTransaction());
     }
     catch (const Exception& e) {
@@ -265,7 +356,7 @@ void MySQLConnection::queryOpen(Query* query)
 
     if (query->autoPrepare()) {
         if (!query->prepared())
-            queryPrepare(query);
+            prepareQuery(query);
         queryBindParameters(query);
     }
 
@@ -309,6 +400,47 @@ void MySQLConnection::queryFetch(Query* query)
     }
 }
 
+size_t MySQLConnection::queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows)
+{
+    if (!query->active())
+        THROW_QUERY_ERROR(query, "Dataset isn't open");
+
+    lock_guard<mutex> lock(m_mutex);
+
+    size_t rows = 0;
+    try {
+        auto* statement = (MySQLStatement*) query->statement();
+        FieldList& fields = query->fields();
+
+        for (uint32_t column = 0; column < fields.size(); column++) {
+            RecordBatch::Column& batchColumn = batch[column];
+            if (batchColumn.type() == VAR_NONE) {
+                auto* field = (DatabaseField*) &fields[column];
+                batchColumn.type(MySQLStatement::mySQLTypeToVariantType((enum_field_types) field->fieldType()));
+            }
+        }
+
+        // The current row is already fetched, so the batch starts from it
+        while (rows < maxRows) {
+            statement->readResultRow(fields, batch);
+            rows++;
+
+            statement->fetch();
+            if (statement->eof()) {
+                querySetEof(query, true);
+                return rows;
+            }
+        }
+
+        statement->readResultRow(fields);
+    }
+    catch (const Exception& e) {
+        query->throwError("CMySQLConnection::queryFetchBatch", e.what());
+    }
+
+    return rows;
+}
+
 void MySQLConnection::objectList(DatabaseObjectType objectType, Strings& objects)
 {
     string objectsSQL;
@@ -359,23 +491,54 @@ void MySQLConnection::objectList(DatabaseObjectType objectType, Strings& objects
     }
 }
 
+/**
+ * Errors of LOAD DATA LOCAL, rejected by server or client library configuration
+ */
+static bool localInfileDisabled(unsigned error)
+{
+    return error == 1148    // ER_NOT_ALLOWED_COMMAND
+        || error == 3948    // ER_CLIENT_LOCAL_FILES_DISABLED
+        || error == 2068;   // CR_LOAD_DATA_LOCAL_INFILE_REJECTED
+}
+
 void MySQLConnection::_bulkInsert(const String& tableName, const Strings& columnNames, const Strings& data,
-                                  const String& /*format*/)
-{
-    Query insertQuery(this,
-                      "INSERT INTO " + tableName + "(" + columnNames.join(",") +
-                      ") VALUES (:" + columnNames.join(",:") + ")");
-    for (auto& row: data) {
-        Strings rowData(row,"\t");
-        for (unsigned i = 0; i < columnNames.size(); i++) {
-            String& value = rowData[i];
-            if (value.length() > 255)
-                insertQuery.param(i).setBuffer(value.c_str(), value.size(), VAR_TEXT);
-            else
-                insertQuery.param(i).setString(value);
+                                  const String& format)
+{
+    if (m_connection == nullptr)
+        open();
+
+    // Values are inserted as is, same as other drivers and multi-row insert fallback do.
+    // LOAD DATA defaults would treat backslash sequences as escapes, and \N as NULL.
+    String fields = format.empty() ? String("FIELDS TERMINATED BY '\\t' ESCAPED BY '' LINES TERMINATED BY '\\n'")
+                                   : format;
+    String sql = "LOAD DATA LOCAL INFILE '" + String(bulkInsertFileName) + "' INTO TABLE " + tableName + " " +
+                 fields + " (" + columnNames.join(",") + ")";
+
+    unsigned error = 0;
+    String errorMessage;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_bulkInsertRows = &data;
+        if (mysql_real_query(m_connection, sql.c_str(), sql.length()) != 0) {
+            error = mysql_errno(m_connection);
+            errorMessage = mysql_error(m_connection);
         }
-        insertQuery.exec();
+        m_bulkInsertRows = nullptr;
     }
+
+    if (error == 0)
+        return;
+
+    if (!localInfileDisabled(error))
+        throw DatabaseException("Bulk insert into " + tableName + " failed: " + errorMessage);
+
+    // LOAD DATA LOCAL isn't allowed, using multi-row inserts
+    PoolDatabaseConnection::_bulkInsert(tableName, columnNames, data, format);
+}
+
+SBulkLoader MySQLConnection::_bulkLoader(const String& tableName, const Strings& columnNames)
+{
+    return make_shared<BulkLoader>(this, tableName, columnNames, MaxQueryParameters);
 }
 
 void MySQLConnection::_executeBatchSQL(const Strings& sqlBatch, Strings* errors)
@@ -304,6 +304,14 @@ void MySQLStatement::execute(bool)
         m_result = nullptr;
     }
     if (statement() != nullptr) {
+        unsigned long cursorType = m_fetchSize != 0 ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+        if (mysql_stmt_attr_set(statement(), STMT_ATTR_CURSOR_TYPE, &cursorType) != 0)
+            throwMySQLError();
+        if (m_fetchSize != 0) {
+            unsigned long prefetchRows = m_fetchSize;
+            if (mysql_stmt_attr_set(statement(), STMT_ATTR_PREFETCH_ROWS, &prefetchRows) != 0)
+                throwMySQLError();
+        }
         if (mysql_stmt_execute(statement()) != 0)
             throwMySQLError();
         state().columnCount = mysql_stmt_field_count(statement());
@@ -316,8 +324,13 @@ void MySQLStatement::execute(bool)
             throw DatabaseException(error);
         }
         state().columnCount = mysql_field_count(conn);
-        if (state().columnCount != 0)
-            m_result = mysql_store_result(conn);
+        if (state().columnCount != 0) {
+            // Streaming result set is read row by row, as the rows are fetched
+            if (m_fetchSize != 0)
+                m_result = mysql_use_result(conn);
+            else
+                m_result = mysql_store_result(conn);
+        }
     }
 }
 
@@ -413,6 +426,127 @@ void MySQLStatement::readResultRow(FieldList& fields)
         readUnpreparedResultRow(fields);
 }
 
+void MySQLStatement::readResultRow(FieldList& fields, RecordBatch& batch)
+{
+    uint32_t fieldCount = fields.size();
+
+    if (statement() == nullptr) {
+        unsigned long* lengths = mysql_fetch_lengths(m_result);
+        for (uint32_t fieldIndex = 0; fieldIndex < fieldCount; fieldIndex++) {
+            RecordBatch::Column& column = batch[fieldIndex];
+
+            const char* data = m_row[fieldIndex];
+            if (data == nullptr) {
+                column.appendNull();
+                continue;
+            }
+
+            switch (column.type()) {
+            case VAR_BOOL:
+                column.appendInteger(strchr("YyTt1", data[0]) != nullptr ? 1 : 0);
+                break;
+
+            case VAR_INT:
+            case VAR_INT64:
+                column.appendInteger(string2int64(data));
+                break;
+
+            case VAR_FLOAT:
+                column.appendFloat(string2double(data));
+                break;
+
+            case VAR_DATE:
+            case VAR_DATE_TIME:
+                if (strncmp(data, "0000-00", 7) == 0)
+                    column.appendNull();
+                else
+                    column.appendDateTime(RecordBatch::Column::dateTimeToMicroseconds(DateTime(data)));
+                break;
+
+            default:
+                column.appendString(data, (size_t) lengths[fieldIndex]);
+                break;
+            }
+        }
+        return;
+    }
+
+    for (uint32_t fieldIndex = 0; fieldIndex < fieldCount; fieldIndex++) {
+        RecordBatch::Column& column = batch[fieldIndex];
+        MYSQL_BIND& bind = m_fieldBuffers[fieldIndex];
+
+        if (*(bind.is_null)) {
+            column.appendNull();
+            continue;
+        }
+
+        auto dataLength = (size_t) *(bind.length);
+
+        switch (bind.buffer_type) {
+        case MYSQL_TYPE_BIT:
+        case MYSQL_TYPE_TINY:
+            column.appendInteger(*(int8_t*) bind.buffer);
+            break;
+
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_YEAR:
+            column.appendInteger(*(int16_t*) bind.buffer);
+            break;
+
+        case MYSQL_TYPE_LONG:
+            column.appendInteger(*(int32_t*) bind.buffer);
+            break;
+
+        case MYSQL_TYPE_LONGLONG:
+            column.appendInteger(*(int64_t*) bind.buffer);
+            break;
+
+        case MYSQL_TYPE_FLOAT:
+            column.appendFloat(*(float*) bind.buffer);
+            break;
+
+        case MYSQL_TYPE_DOUBLE:
+            column.appendFloat(*(double*) bind.buffer);
+            break;
+
+        case MYSQL_TYPE_NEWDECIMAL:
+            column.appendFloat(string2double(String((const char*) bind.buffer, dataLength)));
+            break;
+
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIME:
+        case MYSQL_TYPE_TIMESTAMP: {
+            auto& mysqlTime = *(MYSQL_TIME*) bind.buffer;
+            if (mysqlTime.day == 0 && mysqlTime.month == 0) {
+                // Date returned as 0000-00-00
+                column.appendNull();
+            } else {
+                DateTime dt(short(mysqlTime.year), short(mysqlTime.month), short(mysqlTime.day),
+                            short(mysqlTime.hour), short(mysqlTime.minute), short(mysqlTime.second));
+                column.appendDateTime(RecordBatch::Column::dateTimeToMicroseconds(dt));
+            }
+            break;
+        }
+
+        default:
+            if (dataLength <= bind.buffer_length)
+                column.appendString((const char*) bind.buffer, dataLength);
+            else {
+                /// Fetch truncated, fetch the whole value into temporary buffer
+                Buffer data(dataLength + 1);
+                MYSQL_BIND columnBind = bind;
+                columnBind.buffer = data.data();
+                columnBind.buffer_length = dataLength;
+                if (mysql_stmt_fetch_column(statement(), &columnBind, fieldIndex, 0) != 0)
+                    throwMySQLError();
+                column.appendString(data.data(), dataLength);
+            }
+            break;
+        }
+    }
+}
+
 void MySQLStatement::readUnpreparedResultRow(FieldList& fields)
 {
     uint32_t        fieldCount = fields.size();
@@ -540,10 +674,11 @@ void MySQLStatement::readPreparedResultRow(FieldList& fields)
                 field->setDataSize(0);
             } else {
                 if (bind.buffer_length < dataLength) {
-                    /// Fetch truncated, enlarge buffer and fetch remaining part
+                    /// Fetch truncated, enlarge buffer and fetch remaining part.
+                    /// Buffer size is at least doubled, so result buffers are rarely bound again.
                     auto remainingBytes = uint32_t(dataLength - bind.buffer_length);
                     auto offset = (uint32_t) bind.buffer_length;
-                    field->checkSize(dataLength+1);
+                    field->checkSize(max(size_t(dataLength) + 1, field->bufferSize() * 2));
                     bind.buffer = (char*) field->getBuffer() + offset;
                     bind.buffer_length = remainingBytes;
                     if (mysql_stmt_fetch_column(statement(), &bind, fieldIndex, offset) != 0)
@@ -572,11 +707,13 @@ void MySQLStatement::readPreparedResultRow(FieldList& fields)
 void MySQLStatement::close()
 {
     if (m_result != nullptr) {
-        // Read all the results until EOF
-        while (!state().eof)
-            fetch();
+        // Discard the rows that are not fetched yet, and close the cursor (if any),
+        // without reading the rows into the fields
+        if (statement() != nullptr)
+            mysql_stmt_free_result(statement());
         mysql_free_result(m_result);
         m_result = nullptr;
+        state().eof = true;
     }
 }
 
@@ -331,7 +331,7 @@ void OracleConnection::queryOpen(Query* query)
         queryAllocStmt(query);
 
     if (!query->prepared())
-        queryPrepare(query);
+        prepareQuery(query);
 
     // Bind parameters also executes a query
     queryBindParameters(query);
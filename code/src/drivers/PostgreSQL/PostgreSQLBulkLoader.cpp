@@ -0,0 +1,403 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       PostgreSQLBulkLoader.cpp - description                 ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include "PostgreSQLBulkLoader.h"
+#include "htonq.h"
+
+using namespace std;
+using namespace sptk;
+
+static const DateTime epochDate(2000, 1, 1);
+
+static const char binaryCopySignature[] = "PGCOPY\n\377\r\n";
+
+static inline void appendBytes(Buffer& buffer, const char* data, size_t size)
+{
+    // Buffer::append() treats zero size as null-terminated string
+    if (size != 0)
+        buffer.append(data, size);
+}
+
+static inline void appendInt16(Buffer& buffer, int16_t value)
+{
+    uint16_t networkValue = htons((uint16_t) value);
+    appendBytes(buffer, (const char*) &networkValue, sizeof(networkValue));
+}
+
+static inline void appendInt32(Buffer& buffer, int32_t value)
+{
+    uint32_t networkValue = htonl((uint32_t) value);
+    appendBytes(buffer, (const char*) &networkValue, sizeof(networkValue));
+}
+
+static inline void appendInt64(Buffer& buffer, int64_t value)
+{
+    uint64_t networkValue = htonq((uint64_t) value);
+    appendBytes(buffer, (const char*) &networkValue, sizeof(networkValue));
+}
+
+// Encodes decimal number text into NUMERIC binary format: base 10000 digits
+static void appendNumeric(Buffer& buffer, const String& text)
+{
+    String value = text.trim();
+    bool negative = false;
+    size_t pos = 0;
+    if (!value.empty() && (value[0] == '-' || value[0] == '+')) {
+        negative = value[0] == '-';
+        pos = 1;
+    }
+
+    size_t dot = value.find('.', pos);
+    string integerPart = value.substr(pos, dot == string::npos ? string::npos : dot - pos);
+    string fractionPart = dot == string::npos ? "" : value.substr(dot + 1);
+
+    if (integerPart.empty() && fractionPart.empty())
+        throw DatabaseException("Invalid numeric value: " + text);
+    for (char ch: integerPart + fractionPart) {
+        if (!isdigit(ch))
+            throw DatabaseException("Invalid numeric value: " + text);
+    }
+
+    auto dscale = (int16_t) fractionPart.length();
+    integerPart.insert(0, (4 - integerPart.length() % 4) % 4, '0');
+    fractionPart.append((4 - fractionPart.length() % 4) % 4, '0');
+
+    vector<int16_t> digits;
+    string allDigits = integerPart + fractionPart;
+    for (size_t i = 0; i < allDigits.length(); i += 4) {
+        int16_t digit = 0;
+        for (size_t j = i; j < i + 4; j++)
+            digit = int16_t(digit * 10 + (allDigits[j] - '0'));
+        digits.push_back(digit);
+    }
+
+    auto weight = int16_t(integerPart.length() / 4 - 1);
+    size_t first = 0;
+    while (first < digits.size() && digits[first] == 0) {
+        first++;
+        weight--;
+    }
+    size_t last = digits.size();
+    while (last > first && digits[last - 1] == 0)
+        last--;
+
+    if (first == last) {
+        weight = 0;
+        negative = false;
+    }
+
+    appendInt32(buffer, int32_t(sizeof(int16_t) * (4 + last - first)));
+    appendInt16(buffer, int16_t(last - first));
+    appendInt16(buffer, weight);
+    appendInt16(buffer, negative ? int16_t(0x4000) : int16_t(0));
+    appendInt16(buffer, dscale);
+    for (size_t i = first; i < last; i++)
+        appendInt16(buffer, digits[i]);
+}
+
+static bool binaryEncoded(Oid columnType)
+{
+    switch (columnType) {
+        case PG_BOOL:
+        case PG_INT2:
+        case PG_INT4:
+        case PG_OID:
+        case PG_INT8:
+        case PG_FLOAT4:
+        case PG_FLOAT8:
+        case PG_NUMERIC:
+        case PG_TEXT:
+        case PG_NAME:
+        case PG_CHAR:
+        case PG_VARCHAR:
+        case PG_JSON:
+        case PG_JSONB:
+        case PG_BYTEA:
+        case PG_DATE:
+        case PG_TIMESTAMP:
+        case PG_TIMESTAMPTZ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+PostgreSQLBulkLoader::PostgreSQLBulkLoader(PostgreSQLConnection* db, const String& tableName,
+                                           const Strings& columnNames, size_t chunkSize)
+: BulkLoader(db, tableName, columnNames), m_chunkSize(chunkSize)
+{
+    if (!db->active())
+        db->open();
+
+    m_connect = (PGconn*) db->handle();
+
+    const char* integerDatetimes = PQparameterStatus(m_connect, "integer_datetimes");
+    m_int64timestamps = integerDatetimes == nullptr || upperCase(integerDatetimes) == "ON";
+
+    readColumnTypes();
+    startCopy();
+}
+
+PostgreSQLBulkLoader::~PostgreSQLBulkLoader()
+{
+    if (m_copyStarted) {
+        PQputCopyEnd(m_connect, "Bulk load is cancelled");
+        PGresult* result;
+        while ((result = PQgetResult(m_connect)) != nullptr)
+            PQclear(result);
+    }
+}
+
+void PostgreSQLBulkLoader::throwError(const String& operation)
+{
+    throw DatabaseException("Bulk load into " + tableName() + ": " + operation + ": " + PQerrorMessage(m_connect));
+}
+
+void PostgreSQLBulkLoader::readColumnTypes()
+{
+    String sql = "SELECT " + columnNames().join(",") + " FROM " + tableName() + " WHERE false";
+    PGresult* result = PQexecParams(m_connect, sql.c_str(), 0, nullptr, nullptr, nullptr, nullptr, 1);
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        PQclear(result);
+        throwError("can't read column types");
+    }
+
+    int columnCount = PQnfields(result);
+    for (int column = 0; column < columnCount; column++) {
+        Oid columnType = PQftype(result, column);
+        m_columnTypes.push_back(columnType);
+        if (!binaryEncoded(columnType))
+            m_binary = false;
+    }
+    PQclear(result);
+}
+
+void PostgreSQLBulkLoader::startCopy()
+{
+    String sql = "COPY " + tableName() + "(" + columnNames().join(",") + ") FROM STDIN";
+    if (m_binary)
+        sql += " (FORMAT binary)";
+
+    PGresult* result = PQexec(m_connect, sql.c_str());
+    if (PQresultStatus(result) != PGRES_COPY_IN) {
+        PQclear(result);
+        throwError("COPY command failed");
+    }
+    PQclear(result);
+    m_copyStarted = true;
+
+    if (m_binary) {
+        appendBytes(m_buffer, binaryCopySignature, sizeof(binaryCopySignature));   // Including trailing zero
+        appendInt32(m_buffer, 0);    // Flags
+        appendInt32(m_buffer, 0);    // Header extension length
+    }
+}
+
+void PostgreSQLBulkLoader::sendBuffer()
+{
+    if (m_buffer.bytes() == 0)
+        return;
+
+    if (PQputCopyData(m_connect, m_buffer.c_str(), (int) m_buffer.bytes()) != 1)
+        throwError("COPY send data failed");
+
+    m_buffer.bytes(0);
+}
+
+void PostgreSQLBulkLoader::encodeBinaryValue(const Variant& value, Oid columnType)
+{
+    if (value.isNull()) {
+        appendInt32(m_buffer, -1);
+        return;
+    }
+
+    switch (columnType) {
+        case PG_BOOL:
+            appendInt32(m_buffer, 1);
+            m_buffer.append(char(value.asBool() ? 1 : 0));
+            break;
+
+        case PG_INT2:
+            appendInt32(m_buffer, sizeof(int16_t));
+            appendInt16(m_buffer, (int16_t) value.asInteger());
+            break;
+
+        case PG_INT4:
+        case PG_OID:
+            appendInt32(m_buffer, sizeof(int32_t));
+            appendInt32(m_buffer, value.asInteger());
+            break;
+
+        case PG_INT8:
+            appendInt32(m_buffer, sizeof(int64_t));
+            appendInt64(m_buffer, value.asInt64());
+            break;
+
+        case PG_FLOAT4: {
+            auto floatValue = (float) value.asFloat();
+            int32_t bits;
+            memcpy(&bits, &floatValue, sizeof(bits));
+            appendInt32(m_buffer, sizeof(int32_t));
+            appendInt32(m_buffer, bits);
+            break;
+        }
+
+        case PG_FLOAT8: {
+            double doubleValue = value.asFloat();
+            int64_t bits;
+            memcpy(&bits, &doubleValue, sizeof(bits));
+            appendInt32(m_buffer, sizeof(int64_t));
+            appendInt64(m_buffer, bits);
+            break;
+        }
+
+        case PG_NUMERIC:
+            appendNumeric(m_buffer, value.asString());
+            break;
+
+        case PG_DATE: {
+            auto days = chrono::duration_cast<chrono::hours>(value.asDateTime() - epochDate).count() / 24;
+            appendInt32(m_buffer, sizeof(int32_t));
+            appendInt32(m_buffer, (int32_t) days);
+            break;
+        }
+
+        case PG_TIMESTAMP:
+        case PG_TIMESTAMPTZ: {
+            int64_t mcs = chrono::duration_cast<chrono::microseconds>(value.asDateTime() - epochDate).count();
+            appendInt32(m_buffer, sizeof(int64_t));
+            if (m_int64timestamps)
+                appendInt64(m_buffer, mcs);
+            else {
+                double seconds = mcs / 1E6;
+                int64_t bits;
+                memcpy(&bits, &seconds, sizeof(bits));
+                appendInt64(m_buffer, bits);
+            }
+            break;
+        }
+
+        case PG_BYTEA:
+            if (value.dataType() == VAR_BUFFER) {
+                appendInt32(m_buffer, (int32_t) value.dataSize());
+                appendBytes(m_buffer, value.getBuffer(), value.dataSize());
+                break;
+            }
+            // fall through
+
+        default: {
+            String text = value.asString();
+            if (columnType == PG_JSONB) {
+                appendInt32(m_buffer, (int32_t) text.length() + 1);
+                m_buffer.append(char(1));   // JSONB format version
+            } else
+                appendInt32(m_buffer, (int32_t) text.length());
+            appendBytes(m_buffer, text.c_str(), text.length());
+            break;
+        }
+    }
+}
+
+void PostgreSQLBulkLoader::encodeTextValue(const Variant& value, Oid columnType)
+{
+    if (value.isNull()) {
+        appendBytes(m_buffer, "\\N", 2);
+        return;
+    }
+
+    String text;
+    if (columnType == PG_BOOL)
+        text = value.asBool() ? "t" : "f";
+    else if (columnType == PG_BYTEA && value.dataType() == VAR_BUFFER) {
+        static const char hexDigits[] = "0123456789abcdef";
+        text.reserve(value.dataSize() * 2 + 2);
+        text = "\\x";
+        auto* data = (const uint8_t*) value.getBuffer();
+        for (size_t i = 0; i < value.dataSize(); i++) {
+            text += hexDigits[data[i] >> 4];
+            text += hexDigits[data[i] & 0xF];
+        }
+    }
+    else if ((value.dataType() & (VAR_DATE | VAR_DATE_TIME)) != 0)
+        text = value.asDateTime().isoDateTimeString(DateTime::PA_MILLISECONDS);
+    else
+        text = value.asString();
+
+    for (char ch: text) {
+        switch (ch) {
+            case '\\': appendBytes(m_buffer, "\\\\", 2); break;
+            case '\t': appendBytes(m_buffer, "\\t", 2); break;
+            case '\n': appendBytes(m_buffer, "\\n", 2); break;
+            case '\r': appendBytes(m_buffer, "\\r", 2); break;
+            default:   m_buffer.append(ch); break;
+        }
+    }
+}
+
+void PostgreSQLBulkLoader::loadRow(const VariantVector& row)
+{
+    if (m_binary) {
+        appendInt16(m_buffer, (int16_t) row.size());
+        for (size_t column = 0; column < row.size(); column++)
+            encodeBinaryValue(row[column], m_columnTypes[column]);
+    } else {
+        for (size_t column = 0; column < row.size(); column++) {
+            if (column != 0)
+                m_buffer.append('\t');
+            encodeTextValue(row[column], m_columnTypes[column]);
+        }
+        m_buffer.append('\n');
+    }
+
+    if (m_buffer.bytes() >= m_chunkSize)
+        sendBuffer();
+}
+
+void PostgreSQLBulkLoader::finishLoad()
+{
+    if (m_binary)
+        appendInt16(m_buffer, -1);  // File trailer
+
+    sendBuffer();
+
+    m_copyStarted = false;
+    if (PQputCopyEnd(m_connect, nullptr) != 1)
+        throwError("COPY end failed");
+
+    String error;
+    PGresult* result;
+    while ((result = PQgetResult(m_connect)) != nullptr) {
+        if (PQresultStatus(result) != PGRES_COMMAND_OK && error.empty())
+            error = PQresultErrorMessage(result);
+        PQclear(result);
+    }
+
+    if (!error.empty())
+        throw DatabaseException("Bulk load into " + tableName() + " failed after " + int2string(uint64_t(rows())) +
+                                " rows: " + error);
+}
@@ -0,0 +1,101 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       PostgreSQLBulkLoader.h - description                   ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __POSTGRESQL_BULK_LOADER_H__
+#define __POSTGRESQL_BULK_LOADER_H__
+
+#include "pgtypes.h"
+#include <sptk5/db/BulkLoader.h>
+#include <sptk5/db/PostgreSQLConnection.h>
+
+namespace sptk {
+
+    /**
+     * PostgreSQL bulk loader.
+     *
+     * Rows are encoded in COPY binary format, and sent with COPY FROM STDIN in chunks of limited size,
+     * so the memory used by the loader doesn't depend on the number of rows.
+     * If the table has a column of the type that can't be encoded in binary format,
+     * the rows are encoded in COPY text format.
+     */
+    class PostgreSQLBulkLoader : public BulkLoader
+    {
+        PGconn*             m_connect;
+        std::vector<Oid>    m_columnTypes;          ///< Table column types
+        bool                m_binary {true};        ///< True if COPY binary format is used
+        bool                m_int64timestamps;      ///< Server timestamp format
+        bool                m_copyStarted {false};  ///< True while COPY is in progress
+        Buffer              m_buffer;               ///< Encoded rows that are not sent yet
+        size_t              m_chunkSize;            ///< Max size of encoded rows sent at once
+
+        void readColumnTypes();
+        void startCopy();
+        void sendBuffer();
+        void encodeBinaryValue(const Variant& value, Oid columnType);
+        void encodeTextValue(const Variant& value, Oid columnType);
+        void throwError(const String& operation);
+
+    protected:
+
+        void loadRow(const VariantVector& row) override;
+        void finishLoad() override;
+
+    public:
+        /**
+         * Default size of encoded rows sent at once
+         */
+        static constexpr size_t DefaultChunkSize = 256 * 1024;
+
+        /**
+         * Constructor
+         * @param db                Database connection
+         * @param tableName         Table name
+         * @param columnNames       Table columns to load
+         * @param chunkSize         Max size of encoded rows sent at once
+         */
+        PostgreSQLBulkLoader(PostgreSQLConnection* db, const String& tableName, const Strings& columnNames,
+                             size_t chunkSize = DefaultChunkSize);
+
+        /**
+         * Destructor.
+         * Cancels COPY if it isn't finished.
+         */
+        ~PostgreSQLBulkLoader() override;
+
+        /**
+         * @return true if COPY binary format is used
+         */
+        bool binary() const
+        {
+            return m_binary;
+        }
+    };
+
+} // namespace sptk
+
+#endif
@@ -28,9 +28,15 @@
 
 #include <sptk5/cutils>
 #include "PostgreSQLParamValues.h"
+#include "PostgreSQLBulkLoader.h"
 #include "htonq.h"
 #include <sptk5/db/DatabaseField.h>
 #include <sptk5/db/Query.h>
+#include <deque>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 using namespace std;
 using namespace sptk;
@@ -49,6 +55,8 @@ namespace sptk {
         int m_rows;
         int m_cols;
         int m_currentRow;
+        bool m_streaming {false};
+        String m_cacheKey;      ///< Statement cache key, not empty after statement is prepared
     public:
         PostgreSQLParamValues m_paramValues;
 
@@ -126,10 +134,59 @@ namespace sptk {
             return (unsigned) m_cols;
         }
 
+        /**
+         * @return true if the rest of the result set is still to be received from server
+         */
+        bool streaming() const
+        {
+            return m_streaming;
+        }
+
+        void streaming(bool streaming)
+        {
+            m_streaming = streaming;
+        }
+
+        /**
+         * @return statement cache key, or empty string if statement isn't prepared
+         */
+        const String& cacheKey() const
+        {
+            return m_cacheKey;
+        }
+
+        void cacheKey(const String& key)
+        {
+            m_cacheKey = key;
+        }
+
     };
 
     unsigned PostgreSQLStatement::index;
 
+    /**
+     * Socket of libpq connection, watched for the results of asynchronous query.
+     * The socket is owned by libpq, so it is never closed here.
+     */
+    class PostgreSQLSocket : public BaseSocket
+    {
+    public:
+        explicit PostgreSQLSocket(SOCKET socketHandle)
+        {
+            setSocketFD(socketHandle);
+        }
+
+        ~PostgreSQLSocket() override
+        {
+            setSocketFD(INVALID_SOCKET);
+        }
+
+        void close() noexcept override
+        {
+            setSocketFD(INVALID_SOCKET);
+        }
+    };
+
 } // namespace sptk
 
 enum PostgreSQLTimestampFormat
@@ -149,6 +206,7 @@ PostgreSQLConnection::~PostgreSQLConnection()
         if (getInTransaction() && PostgreSQLConnection::active())
             rollbackTransaction();
         close();
+        closeAsync();
     } catch (const Exception& e) {
         CERR(e.what() << endl)
     }
@@ -208,11 +266,48 @@ void PostgreSQLConnection::_openDatabase(const String& newConnectionString)
 
 void PostgreSQLConnection::closeDatabase()
 {
+    closeAsync();
+
+    AsyncQuery async;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        async = move(m_async);
+        m_async = AsyncQuery();
+    }
+    if (async.query != nullptr) {
+        asyncEvents().remove(*async.socket);
+        completeAsync(async, "Connection is closed before the query is complete");
+    }
+
     disconnectAllQueries();
+    clearStatementCache();
     PQfinish(m_connect);
     m_connect = nullptr;
 }
 
+void PostgreSQLConnection::resetSession()
+{
+    PoolDatabaseConnection::resetSession();
+    if (!active())
+        return;
+
+    // Same as DISCARD ALL, except DEALLOCATE ALL and DISCARD PLANS that would invalidate the statement cache
+    static const char* resetCommands =
+        "CLOSE ALL; SET SESSION AUTHORIZATION DEFAULT; RESET ALL; UNLISTEN *; "
+        "SELECT pg_advisory_unlock_all(); DISCARD TEMP; DISCARD SEQUENCES";
+
+    PGresult* res = PQexec(m_connect, resetCommands);
+    ExecStatusType status = PQresultStatus(res);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        string error = "Session reset failed: ";
+        error += PQerrorMessage(m_connect);
+        PQclear(res);
+        throw DatabaseException(error);
+    }
+
+    PQclear(res);
+}
+
 void* PostgreSQLConnection::handle() const
 {
     return m_connect;
@@ -223,11 +318,18 @@ bool PostgreSQLConnection::active() const
     return m_connect != nullptr;
 }
 
+bool PostgreSQLConnection::validate() const
+{
+    return m_connect != nullptr && PQstatus(m_connect) == CONNECTION_OK;
+}
+
 void PostgreSQLConnection::driverBeginTransaction()
 {
     if (m_connect == nullptr)
         open();
 
+    checkAsyncIdle();
+
     if (getInTransaction())
         throw DatabaseException("Transaction already started.");
 
@@ -250,6 +352,8 @@ void PostgreSQLConnection::driverEndTransaction(bool commit)
     if (!getInTransaction())
         throw DatabaseException("Transaction isn't started.");
 
+    checkAsyncIdle();
+
     string action;
 
     if (commit)
@@ -288,12 +392,27 @@ void PostgreSQLConnection::queryAllocStmt(Query* query)
 
 void PostgreSQLConnection::queryFreeStmt(Query* query)
 {
+    queryCancelAsync(query);
+
     lock_guard<mutex> lock(m_mutex);
 
     auto* statement = (PostgreSQLStatement*) query->statement();
 
     if (statement != nullptr) {
-        if (statement->stmt() != nullptr && !statement->name().empty()) {
+        if (statement->streaming()) {
+            finishStreaming(!getInTransaction());
+            statement->streaming(false);
+        }
+
+        if (!statement->cacheKey().empty()) {
+            // Prepared statement is returned to the statement cache
+            statement->clearRows();
+            if (cacheStatement(statement->cacheKey(), statement)) {
+                querySetStmt(query, nullptr);
+                querySetPrepared(query, false);
+                return;
+            }
+
             String deallocateCommand = "DEALLOCATE \"" + statement->name() + "\"";
             PGresult* res = PQexec(m_connect, deallocateCommand.c_str());
             ExecStatusType rc = PQresultStatus(res);
@@ -316,21 +435,45 @@ void PostgreSQLConnection::queryFreeStmt(Query* query)
 
 void PostgreSQLConnection::queryCloseStmt(Query* query)
 {
+    queryCancelAsync(query);
+
     lock_guard<mutex> lock(m_mutex);
 
     auto* statement = (PostgreSQLStatement*) query->statement();
+    if (statement->streaming()) {
+        // Cancelling the query would abort the transaction, so the rows are read instead
+        finishStreaming(!getInTransaction());
+        statement->streaming(false);
+    }
     statement->clearRows();
 }
 
 void PostgreSQLConnection::queryPrepare(Query* query)
 {
+    checkAsyncIdle();
+
     queryFreeStmt(query);
 
     lock_guard<mutex> lock(m_mutex);
 
-    querySetStmt(query, new PostgreSQLStatement(timestampsFormat == PG_INT64_TIMESTAMPS, query->autoPrepare()));
+    // Statement is prepared for the particular parameter types
+    String cacheKey = query->sql();
+    Oid paramType;
+    for (uint32_t i = 0; i < query->paramCount(); i++) {
+        CTypeToPostgreType(query->param(i).dataType(), paramType, query->param(i).name());
+        cacheKey += "\n" + int2string(paramType);
+    }
 
-    auto* statement = (PostgreSQLStatement*) query->statement();
+    auto* statement = (PostgreSQLStatement*) takeCachedStatement(cacheKey);
+    if (statement != nullptr) {
+        statement->m_paramValues.setParameters(query->params());
+        querySetStmt(query, statement);
+        querySetPrepared(query, true);
+        return;
+    }
+
+    statement = new PostgreSQLStatement(timestampsFormat == PG_INT64_TIMESTAMPS, query->autoPrepare());
+    querySetStmt(query, statement);
 
     PostgreSQLParamValues& params = statement->m_paramValues;
     params.setParameters(query->params());
@@ -357,10 +500,24 @@ void PostgreSQLConnection::queryPrepare(Query* query)
     PQclear(stmt2);
 
     statement->stmt(stmt, 0, fieldCount);
+    statement->cacheKey(cacheKey);
 
     querySetPrepared(query, true);
 }
 
+void PostgreSQLConnection::releaseCachedStatement(void* stmt)
+{
+    auto* statement = (PostgreSQLStatement*) stmt;
+
+    // Server side statement is released anyway when connection is closed, so DEALLOCATE errors are ignored
+    if (PQstatus(m_connect) == CONNECTION_OK) {
+        String deallocateCommand = "DEALLOCATE \"" + statement->name() + "\"";
+        PQclear(PQexec(m_connect, deallocateCommand.c_str()));
+    }
+
+    delete statement;
+}
+
 void PostgreSQLConnection::queryUnprepare(Query* query)
 {
     queryFreeStmt(query);
@@ -373,12 +530,8 @@ int PostgreSQLConnection::queryColCount(Query* query)
     return (int) statement->colCount();
 }
 
-void PostgreSQLConnection::queryBindParameters(Query* query)
+static void setParameterValues(PostgreSQLParamValues& paramValues)
 {
-    lock_guard<mutex> lock(m_mutex);
-
-    auto* statement = (PostgreSQLStatement*) query->statement();
-    PostgreSQLParamValues& paramValues = statement->m_paramValues;
     const CParamVector& params = paramValues.params();
     uint32_t paramNumber = 0;
 
@@ -386,15 +539,33 @@ void PostgreSQLConnection::queryBindParameters(Query* query)
         QueryParameter* param = *ptor;
         paramValues.setParameterValue(paramNumber, param);
     }
+}
+
+void PostgreSQLConnection::queryBindParameters(Query* query)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto* statement = (PostgreSQLStatement*) query->statement();
+    PostgreSQLParamValues& paramValues = statement->m_paramValues;
+    setParameterValues(paramValues);
 
     int resultFormat = 1;   // Results are presented in binary format
 
     if (statement->colCount() == 0)
         resultFormat = 0;   // VOID result or NO results, using text format
 
-    PGresult* stmt = PQexecPrepared(m_connect, statement->name().c_str(), (int) paramValues.size(),
-                                    paramValues.values(),
-                                    paramValues.lengths(), paramValues.formats(), resultFormat);
+    PGresult* stmt;
+    bool streaming = query->fetchSize() > 0 && statement->colCount() > 0;
+    if (streaming) {
+        if (PQsendQueryPrepared(m_connect, statement->name().c_str(), (int) paramValues.size(),
+                                paramValues.values(),
+                                paramValues.lengths(), paramValues.formats(), resultFormat) == 0)
+            THROW_QUERY_ERROR(query, "EXECUTE command failed: " << PQerrorMessage(m_connect));
+        stmt = startStreaming(query->fetchSize());
+    } else
+        stmt = PQexecPrepared(m_connect, statement->name().c_str(), (int) paramValues.size(),
+                              paramValues.values(),
+                              paramValues.lengths(), paramValues.formats(), resultFormat);
 
     ExecStatusType rc = PQresultStatus(stmt);
 
@@ -408,6 +579,14 @@ void PostgreSQLConnection::queryBindParameters(Query* query)
             statement->stmt(stmt, (unsigned) PQntuples(stmt));
             break;
 
+        case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        case PGRES_TUPLES_CHUNK:
+#endif
+            statement->stmt(stmt, (unsigned) PQntuples(stmt));
+            statement->streaming(true);
+            break;
+
         case PGRES_EMPTY_QUERY:
             error = "EXECUTE command failed: EMPTY QUERY";
             break;
@@ -418,6 +597,10 @@ void PostgreSQLConnection::queryBindParameters(Query* query)
             break;
     }
 
+    // Complete result, received in streaming mode, is followed by the end of results
+    if (streaming && !statement->streaming())
+        finishStreaming(false);
+
     if (!error.empty()) {
         PQclear(stmt);
         statement->clear();
@@ -431,18 +614,21 @@ void PostgreSQLConnection::queryExecDirect(Query* query)
 
     auto* statement = (PostgreSQLStatement*) query->statement();
     PostgreSQLParamValues& paramValues = statement->m_paramValues;
-    const CParamVector& params = paramValues.params();
-    uint32_t paramNumber = 0;
-
-    for (auto ptor = params.begin(); ptor != params.end(); ++ptor, paramNumber++) {
-        QueryParameter* param = *ptor;
-        paramValues.setParameterValue(paramNumber, param);
-    }
+    setParameterValues(paramValues);
 
     int resultFormat = 1;   // Results are presented in binary format
-    PGresult* stmt = PQexecParams(m_connect, query->sql().c_str(), (int) paramValues.size(), paramValues.types(),
-                                  paramValues.values(),
-                                  paramValues.lengths(), paramValues.formats(), resultFormat);
+    PGresult* stmt;
+    bool streaming = query->fetchSize() > 0;
+    if (streaming) {
+        if (PQsendQueryParams(m_connect, query->sql().c_str(), (int) paramValues.size(), paramValues.types(),
+                              paramValues.values(),
+                              paramValues.lengths(), paramValues.formats(), resultFormat) == 0)
+            THROW_QUERY_ERROR(query, "EXECUTE command failed: " << PQerrorMessage(m_connect));
+        stmt = startStreaming(query->fetchSize());
+    } else
+        stmt = PQexecParams(m_connect, query->sql().c_str(), (int) paramValues.size(), paramValues.types(),
+                            paramValues.values(),
+                            paramValues.lengths(), paramValues.formats(), resultFormat);
 
     ExecStatusType rc = PQresultStatus(stmt);
 
@@ -456,6 +642,14 @@ void PostgreSQLConnection::queryExecDirect(Query* query)
             statement->stmt(stmt, (unsigned) PQntuples(stmt), (unsigned) PQnfields(stmt));
             break;
 
+        case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        case PGRES_TUPLES_CHUNK:
+#endif
+            statement->stmt(stmt, (unsigned) PQntuples(stmt), (unsigned) PQnfields(stmt));
+            statement->streaming(true);
+            break;
+
         case PGRES_EMPTY_QUERY:
             error = "EXECUTE command failed: EMPTY QUERY";
             break;
@@ -466,6 +660,10 @@ void PostgreSQLConnection::queryExecDirect(Query* query)
             break;
     }
 
+    // Complete result, received in streaming mode, is followed by the end of results
+    if (streaming && !statement->streaming())
+        finishStreaming(false);
+
     if (!error.empty()) {
         PQclear(stmt);
         statement->clear();
@@ -473,6 +671,69 @@ void PostgreSQLConnection::queryExecDirect(Query* query)
     }
 }
 
+PGresult* PostgreSQLConnection::startStreaming(unsigned fetchSize)
+{
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    if (fetchSize > 1)
+        PQsetChunkedRowsMode(m_connect, (int) fetchSize);
+    else
+        PQsetSingleRowMode(m_connect);
+#else
+    PQsetSingleRowMode(m_connect);
+#endif
+    return PQgetResult(m_connect);
+}
+
+void PostgreSQLConnection::finishStreaming(bool cancel)
+{
+    if (cancel) {
+        PGcancel* cancelRequest = PQgetCancel(m_connect);
+        if (cancelRequest != nullptr) {
+            char errorBuffer[256];
+            PQcancel(cancelRequest, errorBuffer, sizeof(errorBuffer));
+            PQfreeCancel(cancelRequest);
+        }
+    }
+
+    PGresult* result;
+    while ((result = PQgetResult(m_connect)) != nullptr)
+        PQclear(result);
+}
+
+void PostgreSQLConnection::fetchStreamingRows(Query* query, PostgreSQLStatement* statement)
+{
+    PGresult* stmt = PQgetResult(m_connect);
+
+    switch (PQresultStatus(stmt)) {
+        case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        case PGRES_TUPLES_CHUNK:
+#endif
+            statement->stmt(stmt, (unsigned) PQntuples(stmt));
+            statement->fetch();
+            return;
+
+        case PGRES_TUPLES_OK:
+            // End of the result set: the last result has no rows
+            statement->stmt(stmt, 0);
+            statement->fetch();
+            statement->streaming(false);
+            finishStreaming(false);
+            return;
+
+        default:
+            break;
+    }
+
+    String error = "FETCH failed: ";
+    error += PQerrorMessage(m_connect);
+    PQclear(stmt);
+    statement->streaming(false);
+    finishStreaming(false);
+    statement->clearRows();
+    THROW_QUERY_ERROR(query, error);
+}
+
 void PostgreSQLConnection::PostgreTypeToCType(int postgreType, VariantType& dataType)
 {
     switch (postgreType) {
@@ -562,16 +823,23 @@ void PostgreSQLConnection::queryOpen(Query* query)
     if (query->active())
         return;
 
+    checkAsyncIdle();
+
     if (query->statement() == nullptr)
         queryAllocStmt(query);
 
     if (query->autoPrepare()) {
         if (!query->prepared())
-            queryPrepare(query);
+            prepareQuery(query);
         queryBindParameters(query);
     } else
         queryExecDirect(query);
 
+    openResult(query);
+}
+
+void PostgreSQLConnection::openResult(Query* query)
+{
     auto* statement = (PostgreSQLStatement*) query->statement();
 
     auto count = (short) queryColCount(query);
@@ -607,6 +875,254 @@ void PostgreSQLConnection::queryOpen(Query* query)
     queryFetch(query);
 }
 
+SocketEvents& PostgreSQLConnection::asyncEvents()
+{
+    static SocketEvents events("PostgreSQL async", asyncEvent);
+    return events;
+}
+
+// Async states of the connections, by the address used as socket events user data
+static mutex asyncStatesMutex;
+static map<void*, weak_ptr<void>> asyncStates;
+
+void PostgreSQLConnection::asyncEvent(void* userData, SocketEventType eventType)
+{
+    shared_ptr<AsyncState> state;
+    {
+        lock_guard<mutex> lock(asyncStatesMutex);
+        auto itor = asyncStates.find(userData);
+        if (itor == asyncStates.end())
+            return;
+        state = static_pointer_cast<AsyncState>(itor->second.lock());
+    }
+    if (!state)
+        return;
+
+    PostgreSQLConnection* connection;
+    {
+        lock_guard<mutex> lock(state->mutex);
+        connection = state->connection;
+        if (connection == nullptr)
+            return;
+        state->callbacks++;
+        state->callbackThread = this_thread::get_id();
+    }
+
+    connection->readAsyncResults(*state, eventType);
+
+    {
+        lock_guard<mutex> lock(state->mutex);
+        state->callbacks--;
+        state->callbackThread = thread::id();
+        state->completing = nullptr;
+    }
+    state->idle.notify_all();
+}
+
+void PostgreSQLConnection::closeAsync()
+{
+    shared_ptr<AsyncState> state = move(m_asyncState);
+    if (!state)
+        return;
+
+    {
+        lock_guard<mutex> lock(asyncStatesMutex);
+        asyncStates.erase(state.get());
+    }
+
+    unique_lock<mutex> lock(state->mutex);
+    state->connection = nullptr;
+
+    // Completion callback may close the connection, it can't wait for itself
+    if (state->callbackThread != this_thread::get_id())
+        state->idle.wait(lock, [&state]() { return state->callbacks == 0; });
+}
+
+void PostgreSQLConnection::queryOpenAsync(Query* query, const AsyncQueryCallback& callback)
+{
+    if (!active())
+        open();
+
+    if (query->active()) {
+        callback(nullptr);
+        return;
+    }
+
+    if (query->statement() == nullptr)
+        queryAllocStmt(query);
+
+    // Statement is prepared synchronously, when it isn't prepared or cached yet
+    if (query->autoPrepare() && !query->prepared())
+        prepareQuery(query);
+
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_async.query != nullptr)
+        THROW_QUERY_ERROR(query, "Connection is already executing asynchronous query");
+
+    auto* statement = (PostgreSQLStatement*) query->statement();
+    PostgreSQLParamValues& paramValues = statement->m_paramValues;
+    setParameterValues(paramValues);
+
+    int sent;
+    if (query->autoPrepare()) {
+        int resultFormat = statement->colCount() == 0 ? 0 : 1;
+        sent = PQsendQueryPrepared(m_connect, statement->name().c_str(), (int) paramValues.size(),
+                                   paramValues.values(), paramValues.lengths(), paramValues.formats(),
+                                   resultFormat);
+    } else
+        sent = PQsendQueryParams(m_connect, query->sql().c_str(), (int) paramValues.size(), paramValues.types(),
+                                 paramValues.values(), paramValues.lengths(), paramValues.formats(), 1);
+
+    if (sent == 0)
+        THROW_QUERY_ERROR(query, "EXECUTE command failed: " << PQerrorMessage(m_connect));
+
+    if (!m_asyncState) {
+        m_asyncState = make_shared<AsyncState>();
+        m_asyncState->connection = this;
+        lock_guard<mutex> statesLock(asyncStatesMutex);
+        asyncStates[m_asyncState.get()] = m_asyncState;
+    }
+
+    m_async.query = query;
+    m_async.callback = callback;
+    m_async.socket = make_shared<PostgreSQLSocket>(PQsocket(m_connect));
+    try {
+        asyncEvents().add(*m_async.socket, m_asyncState.get());
+    }
+    catch (const Exception& e) {
+        m_async = AsyncQuery();
+        finishStreaming(true);
+        THROW_QUERY_ERROR(query, e.what());
+    }
+}
+
+void PostgreSQLConnection::readAsyncResults(AsyncState& state, SocketEventType eventType)
+{
+    AsyncQuery async;
+    String error;
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        if (m_async.query == nullptr)
+            return;
+
+        if (eventType == ET_CONNECTION_CLOSED)
+            error = "Connection is closed by server";
+        else if (PQconsumeInput(m_connect) == 0)
+            error = PQerrorMessage(m_connect);
+        else {
+            bool completed = false;
+            while (PQisBusy(m_connect) == 0) {
+                PGresult* result = PQgetResult(m_connect);
+                if (result == nullptr) {
+                    completed = true;
+                    break;
+                }
+                if (m_async.result == nullptr)
+                    m_async.result = result;
+                else
+                    PQclear(result);
+            }
+            if (!completed)
+                return; // Waiting for the rest of the results
+        }
+
+        async = move(m_async);
+        m_async = AsyncQuery();
+
+        // Other thread that closes the query waits until its callback is complete
+        lock_guard<mutex> stateLock(state.mutex);
+        state.completing = async.query;
+    }
+
+    asyncEvents().remove(*async.socket);
+    completeAsync(async, error);
+}
+
+void PostgreSQLConnection::queryCancelAsync(Query* query)
+{
+    AsyncQuery async;
+    shared_ptr<AsyncState> state;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        state = m_asyncState;
+        if (m_async.query == query) {
+            async = move(m_async);
+            m_async = AsyncQuery();
+            if (async.result != nullptr) {
+                PQclear(async.result);
+                async.result = nullptr;
+            }
+            finishStreaming(true);
+        }
+    }
+
+    if (async.query != nullptr) {
+        asyncEvents().remove(*async.socket);
+        completeAsync(async, "Query is closed before it's complete");
+        return;
+    }
+
+    if (state) {
+        unique_lock<mutex> lock(state->mutex);
+        if (state->callbackThread != this_thread::get_id())
+            state->idle.wait(lock, [&state, query]() { return state->completing != query; });
+    }
+}
+
+void PostgreSQLConnection::checkAsyncIdle() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_async.query != nullptr)
+        throw DatabaseException("Connection is executing asynchronous query");
+}
+
+void PostgreSQLConnection::completeAsync(AsyncQuery& async, const String& error)
+{
+    Query* query = async.query;
+    PGresult* result = async.result;
+    exception_ptr executionError;
+
+    try {
+        if (!error.empty()) {
+            if (result != nullptr)
+                PQclear(result);
+            THROW_QUERY_ERROR(query, error);
+        }
+
+        auto* statement = (PostgreSQLStatement*) query->statement();
+        switch (PQresultStatus(result)) {
+            case PGRES_COMMAND_OK:
+                statement->stmt(result, 0, 0);
+                break;
+
+            case PGRES_TUPLES_OK:
+                if (query->autoPrepare())
+                    statement->stmt(result, (unsigned) PQntuples(result));
+                else
+                    statement->stmt(result, (unsigned) PQntuples(result), (unsigned) PQnfields(result));
+                break;
+
+            default: {
+                String text = "EXECUTE command failed: ";
+                text += result != nullptr ? PQresultErrorMessage(result) : "no result";
+                if (result != nullptr)
+                    PQclear(result);
+                statement->clear();
+                THROW_QUERY_ERROR(query, text);
+            }
+        }
+
+        openResult(query);
+    }
+    catch (const Exception&) {
+        executionError = current_exception();
+    }
+
+    async.callback(executionError);
+}
+
 static inline bool readBool(const char* data)
 {
     return *data != char(0);
@@ -722,7 +1238,8 @@ static inline MoneyData readNumericToScaledInteger(const char* v)
 }
 
 
-static void decodeArray(const char* data, DatabaseField* field)
+// Doesn't modify the data, so the same value may be decoded again
+static String decodeArray(const char* data)
 {
     struct PGArrayHeader
     {
@@ -737,29 +1254,29 @@ static void decodeArray(const char* data, DatabaseField* field)
         uint32_t lowerBound;
     };
 
-    auto* arrayHeader = (PGArrayHeader*) data;
-    arrayHeader->dimensionNumber = ntohl(arrayHeader->dimensionNumber);
-    arrayHeader->hasNull = ntohl(arrayHeader->hasNull);
-    arrayHeader->elementType = ntohl(arrayHeader->elementType);
+    PGArrayHeader arrayHeader = *(const PGArrayHeader*) data;
+    arrayHeader.dimensionNumber = ntohl(arrayHeader.dimensionNumber);
+    arrayHeader.hasNull = ntohl(arrayHeader.hasNull);
+    arrayHeader.elementType = ntohl(arrayHeader.elementType);
     data += sizeof(PGArrayHeader);
 
-    auto* dimensions = (PGArrayDimension*) data;
-    data += arrayHeader->dimensionNumber * sizeof(PGArrayDimension);
+    auto* dimensions = (const PGArrayDimension*) data;
+    data += arrayHeader.dimensionNumber * sizeof(PGArrayDimension);
 
     stringstream output;
-    for (size_t dim = 0; dim < arrayHeader->dimensionNumber; dim++) {
-        PGArrayDimension* dimension = dimensions + dim;
-        dimension->elementCount = htonl(dimension->elementCount);
-        dimension->lowerBound = htonl(dimension->lowerBound);
+    for (size_t dim = 0; dim < arrayHeader.dimensionNumber; dim++) {
+        PGArrayDimension dimension = dimensions[dim];
+        dimension.elementCount = ntohl(dimension.elementCount);
+        dimension.lowerBound = ntohl(dimension.lowerBound);
         output << "{";
-        for (size_t element = 0; element < dimension->elementCount; element++) {
+        for (size_t element = 0; element < dimension.elementCount; element++) {
             if (element != 0)
                 output << ",";
 
             uint32_t dataSize = ntohl(*(uint32_t*) data);
             data += sizeof(uint32_t);
 
-            switch (arrayHeader->elementType) {
+            switch (arrayHeader.elementType) {
                 case PG_INT2:
                     output << readInt2(data);
                     break;
@@ -802,7 +1319,7 @@ static void decodeArray(const char* data, DatabaseField* field)
         }
         output << "}";
     }
-    field->setString(output.str());
+    return output.str();
 }
 
 void PostgreSQLConnection::queryFetch(Query* query)
@@ -816,11 +1333,19 @@ void PostgreSQLConnection::queryFetch(Query* query)
 
     statement->fetch();
 
+    if (statement->eof() && statement->streaming())
+        fetchStreamingRows(query, statement);
+
     if (statement->eof()) {
         querySetEof(query, true);
         return;
     }
 
+    readResultRow(query, statement);
+}
+
+void PostgreSQLConnection::readResultRow(Query* query, PostgreSQLStatement* statement)
+{
     auto fieldCount = (int) query->fieldCount();
     int dataLength = 0;
 
@@ -905,7 +1430,7 @@ void PostgreSQLConnection::queryFetch(Query* query)
                     case PG_FLOAT8_ARRAY:
                     case PG_TIMESTAMP_ARRAY:
                     case PG_TIMESTAMPTZ_ARRAY:
-                        decodeArray(data, field);
+                        field->setString(decodeArray(data));
                         break;
 
                     default:
@@ -919,6 +1444,143 @@ void PostgreSQLConnection::queryFetch(Query* query)
     }
 }
 
+static void readBatchValue(RecordBatch::Column& column, Oid columnType, const PGresult* stmt, int row, int index)
+{
+    int dataLength = PQgetlength(stmt, row, index);
+    if (dataLength == 0) {
+        if (PQgetisnull(stmt, row, index) == 1)
+            column.appendNull();
+        else
+            column.appendString("", 0);
+        return;
+    }
+
+    const char* data = PQgetvalue(stmt, row, index);
+
+    switch (columnType) {
+        case PG_BOOL:
+            column.appendInteger(readBool(data) ? 1 : 0);
+            break;
+
+        case PG_INT2:
+            column.appendInteger(readInt2(data));
+            break;
+
+        case PG_OID:
+        case PG_INT4:
+            column.appendInteger(readInt4(data));
+            break;
+
+        case PG_INT8:
+            column.appendInteger(readInt8(data));
+            break;
+
+        case PG_FLOAT4:
+            column.appendFloat(readFloat4(data));
+            break;
+
+        case PG_FLOAT8:
+            column.appendFloat(readFloat8(data));
+            break;
+
+        case PG_NUMERIC:
+            column.appendFloat((double) readNumericToScaledInteger(data));
+            break;
+
+        case PG_DATE:
+            column.appendDateTime(microsecondsSinceEpoch + int64_t(readInt4(data)) * 86400000000LL);
+            break;
+
+        case PG_TIMESTAMPTZ:
+        case PG_TIMESTAMP:
+            if (timestampsFormat == PG_INT64_TIMESTAMPS)
+                column.appendDateTime(microsecondsSinceEpoch + readInt8(data));
+            else
+                column.appendDateTime(RecordBatch::Column::dateTimeToMicroseconds(readTimestamp(data, false)));
+            break;
+
+        case PG_CHAR_ARRAY:
+        case PG_INT2_VECTOR:
+        case PG_INT2_ARRAY:
+        case PG_INT4_ARRAY:
+        case PG_TEXT_ARRAY:
+        case PG_VARCHAR_ARRAY:
+        case PG_INT8_ARRAY:
+        case PG_FLOAT4_ARRAY:
+        case PG_FLOAT8_ARRAY:
+        case PG_TIMESTAMP_ARRAY:
+        case PG_TIMESTAMPTZ_ARRAY: {
+            String value = decodeArray(data);
+            column.appendString(value.c_str(), value.length());
+            break;
+        }
+
+        default:
+            column.appendString(data, size_t(dataLength));
+            break;
+    }
+}
+
+size_t PostgreSQLConnection::queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows)
+{
+    if (!query->active())
+        THROW_QUERY_ERROR(query, "Dataset isn't open");
+
+    lock_guard<mutex> lock(m_mutex);
+
+    auto* statement = (PostgreSQLStatement*) query->statement();
+    auto columnCount = (int) batch.columnCount();
+
+    vector<Oid> columnTypes((size_t) columnCount);
+    for (int column = 0; column < columnCount; column++) {
+        auto* field = (DatabaseField*) &(*query)[column];
+        columnTypes[column] = (Oid) field->fieldType();
+
+        RecordBatch::Column& batchColumn = batch[size_t(column)];
+        if (batchColumn.type() != VAR_NONE)
+            continue;
+
+        // Column types match the values, read by readBatchValue()
+        VariantType dataType;
+        switch (columnTypes[column]) {
+            case PG_TIMESTAMPTZ:
+                dataType = VAR_DATE_TIME;
+                break;
+            case PG_TIME:
+                dataType = VAR_STRING;
+                break;
+            default:
+                PostgreTypeToCType((int) columnTypes[column], dataType);
+                break;
+        }
+        batchColumn.type(dataType);
+    }
+
+    // The current row is already fetched, so the batch starts from it
+    size_t rows = 0;
+    while (rows < maxRows) {
+        const PGresult* stmt = statement->stmt();
+        auto currentRow = (int) statement->currentRow();
+        for (int column = 0; column < columnCount; column++)
+            readBatchValue(batch[size_t(column)], columnTypes[column], stmt, currentRow, column);
+        rows++;
+
+        statement->fetch();
+
+        if (statement->eof() && statement->streaming())
+            fetchStreamingRows(query, statement);
+
+        if (statement->eof()) {
+            querySetEof(query, true);
+            return rows;
+        }
+    }
+
+    readResultRow(query, statement);
+
+    return rows;
+}
+
 void PostgreSQLConnection::objectList(DatabaseObjectType objectType, Strings& objects)
 {
     string tablesSQL("SELECT table_schema || '.' || table_name "
@@ -984,6 +1646,8 @@ String PostgreSQLConnection::paramMark(unsigned paramIndex)
 void PostgreSQLConnection::_bulkInsert(const String& tableName, const Strings& columnNames, const Strings& data,
                                        const String& format)
 {
+    checkAsyncIdle();
+
     stringstream sql;
     sql << "COPY " << tableName << "(" << columnNames.join(",") << ") FROM STDIN " << format;
 
@@ -1015,12 +1679,249 @@ void PostgreSQLConnection::_bulkInsert(const String& tableName, const Strings& c
         error += PQerrorMessage(m_connect);
         throw DatabaseException(error);
     }
+
+    string error;
+    while ((res = PQgetResult(m_connect)) != nullptr) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK && error.empty())
+            error = string("COPY command failed: ") + PQresultErrorMessage(res);
+        PQclear(res);
+    }
+
+    if (!error.empty())
+        throw DatabaseException(error);
+}
+
+SBulkLoader PostgreSQLConnection::_bulkLoader(const String& tableName, const Strings& columnNames)
+{
+    checkAsyncIdle();
+    return make_shared<PostgreSQLBulkLoader>(this, tableName, columnNames);
+}
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+void PostgreSQLConnection::sendPipelined(QueryBatch::Entry& entry)
+{
+    Query* query = entry.query();
+    auto* statement = (PostgreSQLStatement*) query->statement();
+    PostgreSQLParamValues& paramValues = statement->m_paramValues;
+
+    if (!query->prepared())
+        paramValues.setParameters(query->params());
+
+    entry.bindParameters();
+
+    const CParamVector& params = paramValues.params();
+    uint32_t paramNumber = 0;
+    for (auto ptor = params.begin(); ptor != params.end(); ++ptor, paramNumber++)
+        paramValues.setParameterValue(paramNumber, *ptor);
+
+    int rc;
+    if (query->prepared())
+        rc = PQsendQueryPrepared(m_connect, statement->name().c_str(), (int) paramValues.size(),
+                                 paramValues.values(), paramValues.lengths(), paramValues.formats(), 0);
+    else
+        rc = PQsendQueryParams(m_connect, query->sql().c_str(), (int) paramValues.size(), paramValues.types(),
+                               paramValues.values(), paramValues.lengths(), paramValues.formats(), 0);
+
+    if (rc == 0)
+        THROW_QUERY_ERROR(query, "EXECUTE command failed: " << PQerrorMessage(m_connect));
+
+    // Every query has its own sync point, so the error only aborts the query that caused it
+    if (PQpipelineSync(m_connect) == 0)
+        THROW_QUERY_ERROR(query, "Pipeline sync failed: " << PQerrorMessage(m_connect));
+}
+
+bool PostgreSQLConnection::readPipelined(PipelinedResults& results)
+{
+    while (PQisBusy(m_connect) == 0) {
+        PGresult* result = PQgetResult(m_connect);
+        if (result == nullptr) {
+            // End of the query results is followed by the sync point result
+            if (results.resultsEnded || PQstatus(m_connect) == CONNECTION_BAD) {
+                results.entry->setResult(String("EXECUTE command failed: ") + PQerrorMessage(m_connect));
+                return true;
+            }
+            results.resultsEnded = true;
+            continue;
+        }
+        results.resultsEnded = false;
+
+        ExecStatusType rc = PQresultStatus(result);
+        if (rc == PGRES_PIPELINE_SYNC) {
+            PQclear(result);
+            if (results.error.empty())
+                results.entry->setResult("", results.rows);
+            else
+                results.entry->setResult(results.error);
+            return true;
+        }
+
+        if (results.error.empty()) {
+            if (rc == PGRES_FATAL_ERROR || rc == PGRES_BAD_RESPONSE)
+                results.error = String("EXECUTE command failed: ") + PQresultErrorMessage(result);
+            else if (rc == PGRES_PIPELINE_ABORTED)
+                results.error = "EXECUTE command failed: pipeline aborted";
+            else {
+                // Empty for the commands that don't report the number of rows
+                const char* rows = PQcmdTuples(result);
+                if (*rows != 0)
+                    results.rows = string2int64(rows, -1);
+            }
+        }
+
+        PQclear(result);
+    }
+
+    return false;
+}
+
+static bool flushPipeline(PGconn* connection)
+{
+    int rc = PQflush(connection);
+    if (rc < 0)
+        throw DatabaseException(String("Can't send query: ") + PQerrorMessage(connection));
+    return rc == 0;
+}
+
+/**
+ * Wait until server sends more results, or accepts more queries if not everything is sent
+ */
+static void waitPipeline(PGconn* connection, bool write)
+{
+#ifdef _WIN32
+    WSAPOLLFD pfd {};
+    pfd.fd = PQsocket(connection);
+    pfd.events = POLLRDNORM;
+    if (write)
+        pfd.events |= POLLWRNORM;
+    int rc = WSAPoll(&pfd, 1, -1);
+#else
+    struct pollfd pfd {};
+    pfd.fd = PQsocket(connection);
+    pfd.events = POLLIN;
+    if (write)
+        pfd.events |= POLLOUT;
+    int rc = poll(&pfd, 1, -1);
+    if (rc < 0 && errno == EINTR)
+        return;
+#endif
+    if (rc < 0)
+        throw DatabaseException("Can't wait for server: " + SystemException::osError());
+}
+
+#endif
+
+void PostgreSQLConnection::_executeBatch(QueryBatch& batch)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+    if (!active())
+        open();
+
+    checkAsyncIdle();
+
+    // Statements are prepared before entering pipeline mode: preparing waits for server reply
+    for (auto& entry: batch) {
+        Query* query = entry.query();
+        try {
+            if (query->active())
+                query->close();
+            if (query->statement() == nullptr)
+                queryAllocStmt(query);
+            if (query->autoPrepare() && !query->prepared())
+                prepareQuery(query);
+        }
+        catch (const Exception& e) {
+            entry.setResult(e.what());
+        }
+    }
+
+    lock_guard<mutex> lock(m_mutex);
+
+    // Queries are sent without blocking, while their results are read,
+    // so neither side is blocked by the full socket buffer, however large the results are
+    if (PQsetnonblocking(m_connect, 1) != 0)
+        throw DatabaseException(String("Can't enter non-blocking mode: ") + PQerrorMessage(m_connect));
+
+    if (PQenterPipelineMode(m_connect) == 0) {
+        PQsetnonblocking(m_connect, 0);
+        throw DatabaseException(String("Can't enter pipeline mode: ") + PQerrorMessage(m_connect));
+    }
+
+    deque<PipelinedResults> sent;
+    auto next = batch.begin();
+    bool flushed = true;
+    try {
+        for (;;) {
+            // Send the queries while server accepts them
+            while (flushed && next != batch.end()) {
+                auto& entry = *next;
+                ++next;
+                if (entry.executed())
+                    continue;
+                try {
+                    sendPipelined(entry);
+                    sent.emplace_back(&entry);
+                }
+                catch (const Exception& e) {
+                    entry.setResult(e.what());
+                }
+                flushed = flushPipeline(m_connect);
+            }
+
+            if (PQconsumeInput(m_connect) == 0)
+                throw DatabaseException(String("Can't read query results: ") + PQerrorMessage(m_connect));
+
+            while (!sent.empty() && readPipelined(sent.front()))
+                sent.pop_front();
+
+            if (sent.empty() && next == batch.end())
+                break;
+
+            waitPipeline(m_connect, !flushed);
+            if (!flushed)
+                flushed = flushPipeline(m_connect);
+        }
+    }
+    catch (const Exception& e) {
+        // Connection is lost, the results of the queries are unknown
+        for (auto& entry: batch) {
+            if (!entry.executed())
+                entry.setResult(e.what());
+        }
+    }
+
+    PQexitPipelineMode(m_connect);
+    PQsetnonblocking(m_connect, 0);
+#else
+    PoolDatabaseConnection::_executeBatch(batch);
+#endif
 }
 
 void PostgreSQLConnection::_executeBatchSQL(const Strings& sqlBatch, Strings* errors)
 {
     Strings statements = extractStatements(sqlBatch);
 
+#ifdef LIBPQ_HAS_PIPELINING
+    if (errors != nullptr) {
+        // Errors don't stop the batch, so the statements are sent in pipeline mode
+        vector<shared_ptr<Query>> queries;
+        QueryBatch batch(this);
+        for (auto& stmt : statements) {
+            auto query = make_shared<Query>(this, stmt, false);
+            batch.add(*query);
+            queries.push_back(query);
+        }
+
+        batch.execute();
+
+        for (auto& entry: batch) {
+            if (entry.failed())
+                errors->push_back(entry.error());
+        }
+        return;
+    }
+#endif
+
     for (auto& stmt : statements) {
         try {
             Query query(this, stmt);
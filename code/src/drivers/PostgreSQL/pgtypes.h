@@ -40,6 +40,7 @@ enum PG_DATA_TYPE {
     PG_INT4 = 23,               ///< 32-bit integer
     PG_TEXT = 25,               ///< Text string
     PG_OID = 26,                ///< Object id (32-bit integer)
+    PG_JSON = 114,              ///< JSON text
     PG_FLOAT4 = 700,            ///< 32-bit float
     PG_FLOAT8 = 701,            ///< 64-bit float (double)
     PG_CHAR_ARRAY = 1002,       ///< 16-bit integer vector
@@ -62,7 +63,8 @@ enum PG_DATA_TYPE {
     PG_INTERVAL = 1186,         ///< Time interval
     PG_TIMETZ = 1266,           ///< Time zone
     PG_VARBIT = 1562,           ///< Var bit
-    PG_NUMERIC = 1700           ///< Numeric (decimal)
+    PG_NUMERIC = 1700,          ///< Numeric (decimal)
+    PG_JSONB = 3802             ///< Binary JSON
 };
 
 // This is copied from the server headers. We assume that it wouldn't change in the future..
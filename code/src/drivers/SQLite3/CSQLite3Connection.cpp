@@ -31,9 +31,11 @@
 #if HAVE_SQLITE3
 
 #include <sptk5/cutils>
+#include <sptk5/RegularExpression.h>
 #include <sptk5/db/DatabaseField.h>
 #include <sptk5/db/Query.h>
 #include <sptk5/db/SQLite3Connection.h>
+#include "SQLite3BulkLoader.h"
 
 namespace sptk
 {
@@ -93,12 +95,52 @@ void SQLite3Connection::_openDatabase(const String& newConnectionString)
             m_connect = nullptr;
             throw DatabaseException(error);
         }
+
+        try {
+            setOptions();
+        }
+        catch (const Exception&) {
+            sqlite3_close(m_connect);
+            m_connect = nullptr;
+            throw;
+        }
+    }
+}
+
+void SQLite3Connection::setOptions()
+{
+    static const RegularExpression matchOptionValue("^-?\\w+$");
+    static const Strings pragmas("journal_mode,synchronous,cache_size,mmap_size", ",");
+
+    for (auto& pragma: pragmas) {
+        String value = connectionString().parameter(pragma);
+        if (value.empty())
+            continue;
+
+        if (!matchOptionValue.matches(value))
+            throw DatabaseException("Invalid value of SQLite3 option " + pragma + ": " + value);
+
+        String sql = "PRAGMA " + pragma + "=" + value;
+        char* errorMessage = nullptr;
+        if (sqlite3_exec(m_connect, sql.c_str(), nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+            String error = errorMessage != nullptr ? errorMessage : sqlite3_errmsg(m_connect);
+            sqlite3_free(errorMessage);
+            throw DatabaseException("Can't set SQLite3 option " + pragma + ": " + error);
+        }
+    }
+
+    String busyTimeout = connectionString().parameter("busy_timeout");
+    if (!busyTimeout.empty()) {
+        if (!matchOptionValue.matches(busyTimeout))
+            throw DatabaseException("Invalid value of SQLite3 option busy_timeout: " + busyTimeout);
+        sqlite3_busy_timeout(m_connect, string2int(busyTimeout));
     }
 }
 
 void SQLite3Connection::closeDatabase()
 {
     disconnectAllQueries();
+    clearStatementCache();
     sqlite3_close(m_connect);
     m_connect = nullptr;
 }
@@ -156,6 +198,20 @@ String SQLite3Connection::queryError(const Query*) const
     return sqlite3_errmsg(m_connect);
 }
 
+void SQLite3Connection::releaseStatement(SQLHSTMT stmt)
+{
+    // Statement is returned to the statement cache ready for the next execution
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (!cacheStatement(sqlite3_sql(stmt), stmt))
+        sqlite3_finalize(stmt);
+}
+
+void SQLite3Connection::releaseCachedStatement(void* statement)
+{
+    sqlite3_finalize((SQLHSTMT) statement);
+}
+
 // Doesn't actually allocate stmt, but makes sure
 // the previously allocated stmt is released
 void SQLite3Connection::queryAllocStmt(Query* query)
@@ -164,7 +220,7 @@ void SQLite3Connection::queryAllocStmt(Query* query)
 
     auto* stmt = (SQLHSTMT) query->statement();
     if (stmt != nullptr)
-        sqlite3_finalize(stmt);
+        releaseStatement(stmt);
 
     querySetStmt(query, nullptr);
 }
@@ -176,7 +232,7 @@ void SQLite3Connection::queryFreeStmt(Query* query)
     auto* stmt = (SQLHSTMT) query->statement();
 
     if (stmt != nullptr)
-        sqlite3_finalize(stmt);
+        releaseStatement(stmt);
 
     querySetStmt(query, nullptr);
     querySetPrepared(query, false);
@@ -188,7 +244,7 @@ void SQLite3Connection::queryCloseStmt(Query* query)
 
     auto* stmt = (SQLHSTMT) query->statement();
     if (stmt != nullptr)
-        sqlite3_finalize(stmt);
+        releaseStatement(stmt);
 
     querySetStmt(query, nullptr);
     querySetPrepared(query, false);
@@ -198,12 +254,20 @@ void SQLite3Connection::queryPrepare(Query* query)
 {
     lock_guard<mutex> lock(m_mutex);
 
-    SQLHSTMT stmt;
-    const char* pzTail;
-
-    if (sqlite3_prepare(m_connect, query->sql().c_str(), int(query->sql().length()), &stmt, &pzTail) != SQLITE_OK) {
-        const char* errorMsg = sqlite3_errmsg(m_connect);
-        throw DatabaseException(errorMsg, __FILE__, __LINE__, query->sql());
+    auto stmt = (SQLHSTMT) takeCachedStatement(query->sql());
+    if (stmt == nullptr) {
+        const char* pzTail;
+#if SQLITE_VERSION_NUMBER >= 3020000
+        // Statement is likely to be reused from the statement cache
+        int rc = sqlite3_prepare_v3(m_connect, query->sql().c_str(), int(query->sql().length()),
+                                    SQLITE_PREPARE_PERSISTENT, &stmt, &pzTail);
+#else
+        int rc = sqlite3_prepare_v2(m_connect, query->sql().c_str(), int(query->sql().length()), &stmt, &pzTail);
+#endif
+        if (rc != SQLITE_OK) {
+            const char* errorMsg = sqlite3_errmsg(m_connect);
+            throw DatabaseException(errorMsg, __FILE__, __LINE__, query->sql());
+        }
     }
 
     querySetStmt(query, stmt);
@@ -252,6 +316,9 @@ void SQLite3Connection::queryBindParameters(Query* query)
             else
                 switch (ptype) {
                     case VAR_BOOL:
+                        rc = sqlite3_bind_int(stmt, paramNumber, param->getBool() ? 1 : 0);
+                        break;
+
                     case VAR_INT:
                         rc = sqlite3_bind_int(stmt, paramNumber, param->getInteger());
                         break;
@@ -264,6 +331,7 @@ void SQLite3Connection::queryBindParameters(Query* query)
                         rc = sqlite3_bind_double(stmt, paramNumber, param->getFloat());
                         break;
 
+                    // Parameter values don't change until the statement is executed, so they aren't copied
                     case VAR_STRING:
                     case VAR_TEXT:
                         rc = sqlite3_bind_text(stmt, paramNumber, param->getString(), int(param->dataSize()),
@@ -334,7 +402,7 @@ void SQLite3Connection::queryOpen(Query* query)
         queryAllocStmt(query);
 
     if (!query->prepared())
-        queryPrepare(query);
+        prepareQuery(query);
 
     queryBindParameters(query);
     queryExecute(query);
@@ -394,6 +462,24 @@ static uint32_t trimField(char* s, uint32_t sz)
     return uint32_t(p - s);
 }
 
+// Column data is valid until the next row is fetched, so it is used by the field without copying.
+// Text with trailing spaces is copied, and trimmed.
+static void readTextField(DatabaseField* field, const char* text, uint32_t dataLength)
+{
+    if (dataLength == 0) {
+        field->setNull(VAR_NONE);
+        return;
+    }
+
+    if (text[dataLength - 1] != ' ') {
+        field->setBuffer(text, dataLength, VAR_STRING, true); // External string
+        return;
+    }
+
+    field->setBuffer(text, dataLength, VAR_STRING);
+    field->dataSize(trimField((char*) field->getString(), dataLength));
+}
+
 void SQLite3Connection::queryFetch(Query* query)
 {
     if (!query->active())
@@ -417,8 +503,13 @@ void SQLite3Connection::queryFetch(Query* query)
             throw DatabaseException(queryError(query), __FILE__, __LINE__, query->sql());
     }
 
+    readResultRow(query);
+}
+
+void SQLite3Connection::readResultRow(Query* query)
+{
+    auto* statement = (SQLHSTMT) query->statement();
     uint32_t fieldCount = query->fieldCount();
-    uint32_t dataLength = 0;
 
     if (fieldCount == 0)
         return;
@@ -429,51 +520,143 @@ void SQLite3Connection::queryFetch(Query* query)
         try {
             field = (CSQLite3Field*) &(*query)[(uint32_t) column];
 
+            int columnType = sqlite3_column_type(statement, int(column));
+            if (columnType == SQLITE_NULL) {
+                field->setNull(VAR_NONE);
+                continue;
+            }
+
+            // Field type is defined by the first not null value
             auto fieldType = (short) field->fieldType();
             if (fieldType == 0) {
-                fieldType = (short) sqlite3_column_type(statement, int(column));
+                fieldType = (short) columnType;
                 field->setFieldType(fieldType, 0, 0);
             }
 
-            dataLength = (uint32_t) sqlite3_column_bytes(statement, int(column));
+            switch (fieldType) {
+
+                case SQLITE_INTEGER:
+                    field->setInt64(sqlite3_column_int64(statement, int(column)));
+                    break;
+
+                case SQLITE_FLOAT:
+                    field->setFloat(sqlite3_column_double(statement, int(column)));
+                    break;
+
+                case SQLITE_TEXT:
+                    readTextField(field, (const char*) sqlite3_column_text(statement, int(column)),
+                                  (uint32_t) sqlite3_column_bytes(statement, int(column)));
+                    break;
+
+                case SQLITE_BLOB: {
+                    const void* data = sqlite3_column_blob(statement, int(column));
+                    auto dataLength = (uint32_t) sqlite3_column_bytes(statement, int(column));
+                    if (dataLength == 0)
+                        field->setNull(VAR_NONE);
+                    else
+                        field->setBuffer(data, dataLength, VAR_BUFFER, true); // External buffer
+                    break;
+                }
 
-            if (dataLength != 0) {
-                switch (fieldType) {
+                default:
+                    field->setNull(VAR_NONE);
+                    break;
+            }
+        } catch (const Exception& e) {
+            throw DatabaseException(
+                    "Can't read field " + field->fieldName() + "\n" + string(e.what()), __FILE__, __LINE__,
+                    query->sql());
+        }
+    }
+}
 
-                    case SQLITE_INTEGER:
-                        field->setInt64(sqlite3_column_int64(statement, int(column)));
-                        break;
+static void readBatchValue(RecordBatch::Column& column, sqlite3_stmt* statement, int index, int columnType)
+{
+    if (columnType == SQLITE_NULL) {
+        column.appendNull();
+        return;
+    }
 
-                    case SQLITE_FLOAT:
-                        field->setFloat(sqlite3_column_double(statement, int(column)));
-                        break;
+    switch (column.type()) {
+        case VAR_INT64:
+            column.appendInteger(sqlite3_column_int64(statement, index));
+            break;
 
-                    case SQLITE_TEXT:
-                        field->setBuffer((const char*) sqlite3_column_text(statement, int(column)), dataLength, VAR_STRING);
-                        dataLength = trimField((char*) field->getString(), dataLength);
-                        break;
+        case VAR_FLOAT:
+            column.appendFloat(sqlite3_column_double(statement, index));
+            break;
 
-                    case SQLITE_BLOB:
-                        field->setBuffer(sqlite3_column_blob(statement, int(column)), dataLength, VAR_BUFFER, false);
-                        break;
+        case VAR_BUFFER: {
+            const void* data = sqlite3_column_blob(statement, index);
+            auto dataLength = (size_t) sqlite3_column_bytes(statement, index);
+            if (dataLength == 0)
+                column.appendNull();
+            else
+                column.appendString((const char*) data, dataLength);
+            break;
+        }
 
-                    default:
-                        dataLength = 0;
-                        break;
-                }
+        default: {
+            // Same as field values: empty text is null, and trailing spaces are trimmed
+            auto* text = (const char*) sqlite3_column_text(statement, index);
+            auto dataLength = (size_t) sqlite3_column_bytes(statement, index);
+            if (dataLength == 0) {
+                column.appendNull();
+                break;
+            }
+            while (dataLength > 0 && text[dataLength - 1] == ' ')
+                dataLength--;
+            column.appendString(text, dataLength);
+            break;
+        }
+    }
+}
 
-                field->dataSize(dataLength);
+size_t SQLite3Connection::queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows)
+{
+    if (!query->active())
+        throw DatabaseException("Dataset isn't open", __FILE__, __LINE__, query->sql());
 
-            } else {
-                field->setString("");
-                field->setNull(VAR_NONE);
+    auto* statement = (SQLHSTMT) query->statement();
+    auto columnCount = (int) batch.columnCount();
+
+    lock_guard<mutex> lock(m_mutex);
+
+    // The current row is already fetched, so the statement is positioned on it
+    size_t rows = 0;
+    while (rows < maxRows) {
+        for (int column = 0; column < columnCount; column++) {
+            RecordBatch::Column& batchColumn = batch[size_t(column)];
+            int columnType = sqlite3_column_type(statement, column);
+
+            // Column type is defined by the first not null value
+            if (batchColumn.type() == VAR_NONE && columnType != SQLITE_NULL) {
+                VariantType dataType;
+                SQLITEtypeToCType(columnType, dataType);
+                batchColumn.type(dataType);
             }
-        } catch (const Exception& e) {
-            throw DatabaseException(
-                    "Can't read field " + field->fieldName() + "\n" + string(e.what()), __FILE__, __LINE__,
-                    query->sql());
+
+            readBatchValue(batchColumn, statement, column, columnType);
+        }
+        rows++;
+
+        int rc = sqlite3_step(statement);
+        if (rc == SQLITE_DONE) {
+            querySetEof(query, true);
+            return rows;
         }
+        if (rc != SQLITE_ROW)
+            throw DatabaseException(queryError(query), __FILE__, __LINE__, query->sql());
     }
+
+    readResultRow(query);
+
+    return rows;
+}
+
+SBulkLoader SQLite3Connection::_bulkLoader(const String& tableName, const Strings& columnNames)
+{
+    return make_shared<SQLite3BulkLoader>(this, tableName, columnNames);
 }
 
 void SQLite3Connection::objectList(DatabaseObjectType objectType, Strings& objects)
@@ -0,0 +1,170 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SQLite3BulkLoader.cpp - description                    ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include "SQLite3BulkLoader.h"
+
+using namespace std;
+using namespace sptk;
+
+extern "C" {
+typedef void (* sqlite3cb)(void*);
+}
+
+static size_t maxVariables(SQLite3Connection* db)
+{
+    if (!db->active())
+        db->open();
+    return (size_t) sqlite3_limit((sqlite3*) db->handle(), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+}
+
+SQLite3BulkLoader::SQLite3BulkLoader(SQLite3Connection* db, const String& tableName, const Strings& columnNames)
+: BulkLoader(db, tableName, columnNames, maxVariables(db)), m_connect((sqlite3*) db->handle())
+{
+}
+
+SQLite3BulkLoader::~SQLite3BulkLoader()
+{
+    if (m_insertStmt != nullptr)
+        sqlite3_finalize(m_insertStmt);
+}
+
+void SQLite3BulkLoader::throwError(const String& operation)
+{
+    throw DatabaseException("Bulk load into " + tableName() + ": " + operation + ": " + sqlite3_errmsg(m_connect));
+}
+
+sqlite3_stmt* SQLite3BulkLoader::prepare(size_t rowCount)
+{
+    String sql = insertSQL(rowCount, "?");
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_connect, sql.c_str(), int(sql.length()), &stmt, nullptr) != SQLITE_OK)
+        throwError("can't prepare insert statement");
+
+    return stmt;
+}
+
+void SQLite3BulkLoader::bindValue(sqlite3_stmt* stmt, int paramNumber, const Variant& value)
+{
+    int rc;
+    if (value.isNull())
+        rc = sqlite3_bind_null(stmt, paramNumber);
+    else
+        switch (value.dataType()) {
+            case VAR_BOOL:
+                rc = sqlite3_bind_int(stmt, paramNumber, value.getBool() ? 1 : 0);
+                break;
+
+            case VAR_INT:
+                rc = sqlite3_bind_int(stmt, paramNumber, value.getInteger());
+                break;
+
+            case VAR_INT64:
+                rc = sqlite3_bind_int64(stmt, paramNumber, value.getInt64());
+                break;
+
+            case VAR_FLOAT:
+                rc = sqlite3_bind_double(stmt, paramNumber, value.getFloat());
+                break;
+
+            case VAR_MONEY:
+                rc = sqlite3_bind_double(stmt, paramNumber, value.asFloat());
+                break;
+
+            // Values are kept in the loader until the statement is executed, so they aren't copied
+            case VAR_STRING:
+            case VAR_TEXT:
+                rc = sqlite3_bind_text(stmt, paramNumber, value.getString(), int(value.dataSize()),
+                                       (sqlite3cb) SQLITE_STATIC);
+                break;
+
+            case VAR_BUFFER:
+                rc = sqlite3_bind_blob(stmt, paramNumber, value.getBuffer(), int(value.dataSize()),
+                                       (sqlite3cb) SQLITE_STATIC);
+                break;
+
+            default: {
+                String text = value.asString();
+                rc = sqlite3_bind_text(stmt, paramNumber, text.c_str(), int(text.length()), SQLITE_TRANSIENT);
+                break;
+            }
+        }
+
+    if (rc != SQLITE_OK)
+        throwError("can't bind value of parameter " + int2string(paramNumber));
+}
+
+void SQLite3BulkLoader::insertValues(sqlite3_stmt* stmt)
+{
+    int paramNumber = 1;
+    for (auto& value: m_values)
+        bindValue(stmt, paramNumber++, value);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    m_values.clear();
+
+    if (rc != SQLITE_DONE)
+        throwError("insert failed");
+}
+
+void SQLite3BulkLoader::loadRow(const VariantVector& row)
+{
+    if (m_values.empty())
+        m_values.reserve(batchRows() * row.size());
+
+    for (auto& value: row)
+        m_values.push_back(value);
+
+    if (m_values.size() == batchRows() * row.size()) {
+        if (m_insertStmt == nullptr)
+            m_insertStmt = prepare(batchRows());
+        insertValues(m_insertStmt);
+    }
+}
+
+void SQLite3BulkLoader::finishLoad()
+{
+    if (!m_values.empty()) {
+        sqlite3_stmt* stmt = prepare(m_values.size() / columnNames().size());
+        try {
+            insertValues(stmt);
+        }
+        catch (const Exception&) {
+            sqlite3_finalize(stmt);
+            throw;
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    if (m_insertStmt != nullptr) {
+        sqlite3_finalize(m_insertStmt);
+        m_insertStmt = nullptr;
+    }
+}
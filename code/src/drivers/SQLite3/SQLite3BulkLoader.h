@@ -0,0 +1,78 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       SQLite3BulkLoader.h - description                      ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __SQLITE3_BULK_LOADER_H__
+#define __SQLITE3_BULK_LOADER_H__
+
+#include <sptk5/db/BulkLoader.h>
+#include <sptk5/db/SQLite3Connection.h>
+
+namespace sptk {
+
+    /**
+     * SQLite3 bulk loader.
+     *
+     * Rows are inserted with multi-row INSERT statement, prepared once and reused for every
+     * complete batch of rows. The values are bound directly to the statement, without query parameters.
+     * The batch size is limited by the max number of statement variables of the connection.
+     */
+    class SQLite3BulkLoader : public BulkLoader
+    {
+        sqlite3*            m_connect;
+        sqlite3_stmt*       m_insertStmt {nullptr};     ///< Insert statement for the complete batch of rows
+        VariantVector       m_values;                   ///< Values of the rows that are not inserted yet
+
+        sqlite3_stmt* prepare(size_t rowCount);
+        void bindValue(sqlite3_stmt* stmt, int paramNumber, const Variant& value);
+        void insertValues(sqlite3_stmt* stmt);
+        void throwError(const String& operation);
+
+    protected:
+
+        void loadRow(const VariantVector& row) override;
+        void finishLoad() override;
+
+    public:
+        /**
+         * Constructor
+         * @param db                Database connection
+         * @param tableName         Table name
+         * @param columnNames       Table columns to load
+         */
+        SQLite3BulkLoader(SQLite3Connection* db, const String& tableName, const Strings& columnNames);
+
+        /**
+         * Destructor.
+         * Releases the insert statement.
+         */
+        ~SQLite3BulkLoader() override;
+    };
+
+} // namespace sptk
+
+#endif
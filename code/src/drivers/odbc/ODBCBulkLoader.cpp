@@ -0,0 +1,307 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       ODBCBulkLoader.cpp - description                       ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include "ODBCBulkLoader.h"
+#include <cstring>
+
+using namespace std;
+using namespace sptk;
+
+static inline bool successful(int ret)
+{
+    return ret == SQL_SUCCESS || ret == SQL_SUCCESS_WITH_INFO;
+}
+
+static bool dateTimeToTimestamp(TIMESTAMP_STRUCT& t, const DateTime& dt, bool dateOnly)
+{
+    if (dt.zero())
+        return false;
+
+    short wday;
+    short yday;
+    short ms;
+    dt.decodeDate(&t.year, (short*) &t.month, (short*) &t.day, &wday, &yday);
+    if (dateOnly)
+        t.hour = t.minute = t.second = 0;
+    else
+        dt.decodeTime((short*) &t.hour, (short*) &t.minute, (short*) &t.second, &ms);
+    t.fraction = 0;
+    return true;
+}
+
+ODBCBulkLoader::ODBCBulkLoader(ODBCConnection* db, const String& tableName, const Strings& columnNames)
+: BulkLoader(db, tableName, columnNames, MaxBatchRows * columnNames.size()), m_db(db)
+{
+}
+
+ODBCBulkLoader::~ODBCBulkLoader()
+{
+    if (m_insertStmt != SQL_NULL_HSTMT)
+        SQLFreeHandle(SQL_HANDLE_STMT, m_insertStmt);
+}
+
+void ODBCBulkLoader::throwError(const String& operation)
+{
+    throw DatabaseException("Bulk load into " + tableName() + ": " + operation + ": " + m_db->queryError(m_insertStmt));
+}
+
+void ODBCBulkLoader::prepare()
+{
+    if (!m_db->active())
+        m_db->open();
+
+    if (!successful(SQLAllocHandle(SQL_HANDLE_STMT, (SQLHDBC) m_db->handle(), &m_insertStmt))) {
+        m_insertStmt = SQL_NULL_HSTMT;
+        throwError("can't allocate insert statement");
+    }
+
+    String sql = insertSQL(1, "?");
+    if (!successful(SQLPrepare(m_insertStmt, (SQLCHAR*) sql.c_str(), SQL_NTS)))
+        throwError("can't prepare insert statement");
+
+    m_paramStatus.resize(batchRows());
+    m_parameters.resize(columnNames().size());
+
+    if (!successful(SQLSetStmtAttr(m_insertStmt, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER) SQL_PARAM_BIND_BY_COLUMN, 0)) ||
+        !successful(SQLSetStmtAttr(m_insertStmt, SQL_ATTR_PARAM_STATUS_PTR, m_paramStatus.data(), 0)) ||
+        !successful(SQLSetStmtAttr(m_insertStmt, SQL_ATTR_PARAMS_PROCESSED_PTR, &m_paramsProcessed, 0)))
+    {
+        throwError("parameter arrays aren't supported");
+    }
+}
+
+void ODBCBulkLoader::fillParameter(ParameterArray& parameter, size_t column, size_t rowCount)
+{
+    size_t columnCount = columnNames().size();
+
+    // Parameter type is defined by the first not null value
+    VariantType dataType = VAR_NONE;
+    for (size_t row = 0; row < rowCount; row++) {
+        const Variant& value = m_values[row * columnCount + column];
+        if (!value.isNull()) {
+            dataType = value.dataType();
+            break;
+        }
+    }
+
+    switch (dataType) {
+        case VAR_BOOL:
+            parameter.cType = SQL_C_BIT;
+            parameter.sqlType = SQL_BIT;
+            parameter.width = 1;
+            break;
+
+        case VAR_INT:
+            parameter.cType = SQL_C_SLONG;
+            parameter.sqlType = SQL_INTEGER;
+            parameter.width = sizeof(int32_t);
+            break;
+
+        case VAR_INT64:
+            parameter.cType = SQL_C_SBIGINT;
+            parameter.sqlType = SQL_BIGINT;
+            parameter.width = sizeof(int64_t);
+            break;
+
+        case VAR_FLOAT:
+        case VAR_MONEY:
+            parameter.cType = SQL_C_DOUBLE;
+            parameter.sqlType = SQL_DOUBLE;
+            parameter.width = sizeof(double);
+            break;
+
+        case VAR_DATE:
+        case VAR_DATE_TIME:
+            parameter.cType = SQL_C_TIMESTAMP;
+            parameter.sqlType = SQL_TIMESTAMP;
+            parameter.width = sizeof(TIMESTAMP_STRUCT);
+            break;
+
+        case VAR_BUFFER:
+            parameter.cType = SQL_C_BINARY;
+            parameter.sqlType = SQL_LONGVARBINARY;
+            parameter.width = 1;
+            break;
+
+        default:
+            parameter.cType = SQL_C_CHAR;
+            parameter.sqlType = SQL_WVARCHAR;
+            parameter.width = 1;
+            break;
+    }
+
+    // Variable length values are converted to strings once, and the buffer is sized for the longest value
+    Strings strings;
+    if (parameter.cType == SQL_C_CHAR || parameter.cType == SQL_C_BINARY) {
+        strings.resize(rowCount);
+        for (size_t row = 0; row < rowCount; row++) {
+            const Variant& value = m_values[row * columnCount + column];
+            if (value.isNull())
+                continue;
+            String& text = strings[row];
+            switch (value.dataType()) {
+                case VAR_STRING:
+                case VAR_TEXT:
+                case VAR_BUFFER:
+                    text.assign(value.getBuffer(), value.dataSize());
+                    break;
+                default:
+                    text = value.asString();
+                    break;
+            }
+            if (SQLLEN(text.length() + 1) > parameter.width)
+                parameter.width = SQLLEN(text.length() + 1);
+        }
+    }
+
+    parameter.data.resize(size_t(parameter.width) * rowCount);
+    parameter.lengths.resize(rowCount);
+
+    for (size_t row = 0; row < rowCount; row++) {
+        const Variant& value = m_values[row * columnCount + column];
+        char* buffer = parameter.data.data() + row * parameter.width;
+        SQLLEN& length = parameter.lengths[row];
+
+        if (value.isNull()) {
+            length = SQL_NULL_DATA;
+            continue;
+        }
+
+        switch (parameter.cType) {
+            case SQL_C_BIT:
+                *buffer = char(value.asBool() ? 1 : 0);
+                length = 1;
+                break;
+
+            case SQL_C_SLONG: {
+                auto number = int32_t(value.asInteger());
+                memcpy(buffer, &number, sizeof(number));
+                length = sizeof(number);
+                break;
+            }
+
+            case SQL_C_SBIGINT: {
+                int64_t number = value.asInt64();
+                memcpy(buffer, &number, sizeof(number));
+                length = sizeof(number);
+                break;
+            }
+
+            case SQL_C_DOUBLE: {
+                double number = value.asFloat();
+                memcpy(buffer, &number, sizeof(number));
+                length = sizeof(number);
+                break;
+            }
+
+            case SQL_C_TIMESTAMP: {
+                TIMESTAMP_STRUCT timestamp = {};
+                if (dateTimeToTimestamp(timestamp, value.asDateTime(), value.dataType() == VAR_DATE)) {
+                    memcpy(buffer, &timestamp, sizeof(timestamp));
+                    length = sizeof(timestamp);
+                } else
+                    length = SQL_NULL_DATA;
+                break;
+            }
+
+            default: {
+                const String& text = strings[row];
+                memcpy(buffer, text.c_str(), text.length());
+                buffer[text.length()] = 0;
+                length = SQLLEN(text.length());
+                break;
+            }
+        }
+    }
+}
+
+void ODBCBulkLoader::insertValues()
+{
+    size_t columnCount = columnNames().size();
+    size_t rowCount = m_values.size() / columnCount;
+
+    if (m_insertStmt == SQL_NULL_HSTMT)
+        prepare();
+
+    SQLFreeStmt(m_insertStmt, SQL_RESET_PARAMS);
+
+    for (size_t column = 0; column < columnCount; column++) {
+        ParameterArray& parameter = m_parameters[column];
+        fillParameter(parameter, column, rowCount);
+
+        SQLULEN columnSize = 0;
+        if (parameter.cType == SQL_C_CHAR)
+            columnSize = SQLULEN(parameter.width - 1);
+        else if (parameter.cType == SQL_C_BINARY || parameter.cType == SQL_C_TIMESTAMP)
+            columnSize = SQLULEN(parameter.width);
+
+        int rc = SQLBindParameter(m_insertStmt, SQLUSMALLINT(column + 1), SQL_PARAM_INPUT,
+                                  parameter.cType, parameter.sqlType, columnSize, 0,
+                                  parameter.data.data(), parameter.width, parameter.lengths.data());
+        if (!successful(rc))
+            throwError("can't bind parameter array of column " + columnNames()[column]);
+    }
+
+    if (!successful(SQLSetStmtAttr(m_insertStmt, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER) SQLULEN(rowCount), 0)))
+        throwError("can't set parameter array size");
+
+    m_paramsProcessed = 0;
+    int rc = SQLExecute(m_insertStmt);
+    m_values.clear();
+
+    if (!successful(rc))
+        throwError("insert failed");
+
+    for (size_t row = 0; row < m_paramsProcessed && row < rowCount; row++) {
+        if (m_paramStatus[row] == SQL_PARAM_ERROR)
+            throwError("insert of row " + int2string(uint32_t(row + 1)) + " of the batch failed");
+    }
+}
+
+void ODBCBulkLoader::loadRow(const VariantVector& row)
+{
+    if (m_values.empty())
+        m_values.reserve(batchRows() * row.size());
+
+    for (auto& value: row)
+        m_values.push_back(value);
+
+    if (m_values.size() == batchRows() * row.size())
+        insertValues();
+}
+
+void ODBCBulkLoader::finishLoad()
+{
+    if (!m_values.empty())
+        insertValues();
+
+    if (m_insertStmt != SQL_NULL_HSTMT) {
+        SQLFreeHandle(SQL_HANDLE_STMT, m_insertStmt);
+        m_insertStmt = SQL_NULL_HSTMT;
+    }
+}
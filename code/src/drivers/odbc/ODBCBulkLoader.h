@@ -0,0 +1,94 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       ODBCBulkLoader.h - description                         ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#ifndef __ODBC_BULK_LOADER_H__
+#define __ODBC_BULK_LOADER_H__
+
+#include <sptk5/db/BulkLoader.h>
+#include <sptk5/db/ODBCConnection.h>
+
+namespace sptk {
+
+    /**
+     * ODBC bulk loader.
+     *
+     * Rows are inserted with single-row INSERT statement, prepared once, and executed once for
+     * every batch of rows with column-wise parameter arrays (SQL_ATTR_PARAMSET_SIZE).
+     * Since the batch doesn't depend on the number of statement parameters, it is limited
+     * by BulkLoader::MaxBatchRows only.
+     */
+    class ODBCBulkLoader : public BulkLoader
+    {
+        /**
+         * Values of one statement parameter, for all the rows of the batch
+         */
+        struct ParameterArray
+        {
+            SQLSMALLINT             cType {SQL_C_CHAR};     ///< C data type
+            SQLSMALLINT             sqlType {SQL_VARCHAR};  ///< SQL data type
+            SQLLEN                  width {1};              ///< Size of the single value buffer
+            std::vector<char>       data;                   ///< Value buffers of all the rows
+            std::vector<SQLLEN>     lengths;                ///< Lengths or null indicators of all the rows
+        };
+
+        ODBCConnection*             m_db;
+        SQLHSTMT                    m_insertStmt {SQL_NULL_HSTMT};  ///< Single-row insert statement
+        VariantVector               m_values;               ///< Values of the rows that are not inserted yet
+        std::vector<ParameterArray> m_parameters;           ///< Parameter arrays of the batch
+        std::vector<SQLUSMALLINT>   m_paramStatus;          ///< Status of every row of the batch
+        SQLULEN                     m_paramsProcessed {0};  ///< Number of processed rows of the batch
+
+        void prepare();
+        void fillParameter(ParameterArray& parameter, size_t column, size_t rowCount);
+        void insertValues();
+        void throwError(const String& operation);
+
+    protected:
+
+        void loadRow(const VariantVector& row) override;
+        void finishLoad() override;
+
+    public:
+        /**
+         * Constructor
+         * @param db                Database connection
+         * @param tableName         Table name
+         * @param columnNames       Table columns to load
+         */
+        ODBCBulkLoader(ODBCConnection* db, const String& tableName, const Strings& columnNames);
+
+        /**
+         * Destructor.
+         * Releases the insert statement.
+         */
+        ~ODBCBulkLoader() override;
+    };
+
+} // namespace sptk
+
+#endif
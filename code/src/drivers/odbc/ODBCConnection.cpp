@@ -28,10 +28,12 @@
 
 #include <sptk5/cutils>
 #include <iomanip>
+#include <cstring>
 #include <sptk5/RegularExpression.h>
 #include <sptk5/db/DatabaseField.h>
 #include <sptk5/db/ODBCConnection.h>
 #include <sptk5/db/Query.h>
+#include "ODBCBulkLoader.h"
 
 #define MAX_BUF 1024
 
@@ -57,6 +59,38 @@ public:
     {
     }
 };
+
+/**
+ * Bound column buffers of block cursor.
+ * Buffers are column-wise: every column has values and length indicators of all the rows of the rowset.
+ */
+class ODBCRowset
+{
+public:
+    /**
+     * Max size of the single value buffer. Columns with longer values are read with SQLGetData.
+     */
+    static constexpr SQLLEN MaxValueSize = 65536;
+
+    /**
+     * Max size of all the buffers of the rowset
+     */
+    static constexpr size_t MaxBufferSize = 16 * 1024 * 1024;
+
+    struct Column
+    {
+        SQLSMALLINT             cType {SQL_C_CHAR};     ///< C data type
+        SQLLEN                  width {0};              ///< Size of the single value buffer
+        std::vector<char>       data;                   ///< Value buffers of all the rows
+        std::vector<SQLLEN>     lengths;                ///< Lengths or null indicators of all the rows
+    };
+
+    SQLULEN                     fetchSize {0};          ///< Query fetch size, the rowset is created for
+    SQLULEN                     rowsFetched {0};        ///< Number of rows in the current rowset
+    SQLULEN                     currentRow {0};         ///< Current row in the current rowset
+    std::vector<SQLUSMALLINT>   rowStatus;              ///< Status of every row in the current rowset
+    std::vector<Column>         columns;                ///< Bound columns
+};
 } // namespace sptk
 
 ODBCConnection::ODBCConnection(const String& connectionString)
@@ -194,8 +228,10 @@ void ODBCConnection::queryAllocStmt(Query* query)
     lock_guard<mutex> lock(m_connect->m_mutex);
 
     auto* stmt = (SQLHSTMT) query->statement();
-    if (stmt != SQL_NULL_HSTMT)
+    if (stmt != SQL_NULL_HSTMT) {
+        m_rowsets.erase(stmt);
         SQLFreeStmt(stmt, SQL_DROP);
+    }
 
     auto* hdb = (SQLHDBC) handle();
     int rc = SQLAllocStmt(hdb, &stmt);
@@ -213,6 +249,7 @@ void ODBCConnection::queryFreeStmt(Query* query)
 {
     lock_guard<mutex> lock(m_connect->m_mutex);
 
+    m_rowsets.erase((SQLHSTMT) query->statement());
     SQLFreeStmt(query->statement(), SQL_DROP);
     querySetStmt(query, SQL_NULL_HSTMT);
     querySetPrepared(query, false);
@@ -230,6 +267,7 @@ void ODBCConnection::queryPrepare(Query* query)
     lock_guard<mutex> lock(m_connect->m_mutex);
 
     query->fields().clear();
+    releaseRowset((SQLHSTMT) query->statement());
 
     if (!successful(SQLPrepare(query->statement(), (SQLCHAR*) query->sql().c_str(), SQL_NTS)))
         THROW_QUERY_ERROR(query, queryError(query));
@@ -544,7 +582,7 @@ void ODBCConnection::queryOpen(Query* query)
     }
 
     if (query->autoPrepare() && !query->prepared()) {
-        queryPrepare(query);
+        prepareQuery(query);
         querySetPrepared(query, true);
     }
 
@@ -562,8 +600,13 @@ void ODBCConnection::queryOpen(Query* query)
     if (query->fieldCount() == 0) {
         parseColumns(query, count);
 
+        // Buffers, bound for the previous statement, don't match the new columns
+        lock_guard<mutex> lock(m_connect->m_mutex);
+        releaseRowset((SQLHSTMT) query->statement());
     }
 
+    bindRowset(query);
+
     querySetEof(query, false);
     queryFetch(query);
 }
@@ -626,6 +669,12 @@ void ODBCConnection::queryFetch(Query* query)
 
     lock_guard<mutex> lock(m_connect->m_mutex);
 
+    auto itor = m_rowsets.find(statement);
+    if (itor != m_rowsets.end()) {
+        fetchRowsetRow(query, *itor->second);
+        return;
+    }
+
     int rc = SQLFetch(statement);
 
     if (!successful(rc)) {
@@ -695,6 +744,188 @@ void ODBCConnection::queryFetch(Query* query)
         }
 }
 
+void ODBCConnection::releaseRowset(SQLHSTMT statement)
+{
+    if (m_rowsets.erase(statement) == 0)
+        return;
+
+    SQLFreeStmt(statement, SQL_UNBIND);
+    SQLSetStmtAttr(statement, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER) 1, 0);
+    SQLSetStmtAttr(statement, SQL_ATTR_ROW_STATUS_PTR, nullptr, 0);
+    SQLSetStmtAttr(statement, SQL_ATTR_ROWS_FETCHED_PTR, nullptr, 0);
+}
+
+void ODBCConnection::bindRowset(Query* query)
+{
+    auto* statement = (SQLHSTMT) query->statement();
+    auto fieldCount = query->fieldCount();
+    SQLULEN fetchSize = query->fetchSize();
+
+    {
+        lock_guard<mutex> lock(m_connect->m_mutex);
+
+        auto itor = m_rowsets.find(statement);
+        if (itor != m_rowsets.end()) {
+            ODBCRowset& rowset = *itor->second;
+            if (rowset.fetchSize == fetchSize && rowset.columns.size() == fieldCount) {
+                // Columns stay bound to the same buffers when prepared statement is executed again
+                rowset.rowsFetched = 0;
+                rowset.currentRow = 0;
+                return;
+            }
+            releaseRowset(statement);
+        }
+    }
+
+    if (fetchSize < 2)
+        return;
+
+    auto rowset = make_shared<ODBCRowset>();
+    rowset->fetchSize = fetchSize;
+    rowset->columns.resize(fieldCount);
+
+    size_t rowSize = 0;
+    for (uint32_t column = 0; column < fieldCount; column++) {
+        auto* field = (CODBCField*) &(*query)[column];
+        ODBCRowset::Column& rowsetColumn = rowset->columns[column];
+        rowsetColumn.cType = (SQLSMALLINT) field->fieldType();
+
+        switch (rowsetColumn.cType) {
+            case SQL_C_SLONG:
+                rowsetColumn.width = sizeof(int32_t);
+                break;
+            case SQL_C_DOUBLE:
+                rowsetColumn.width = sizeof(double);
+                break;
+            case SQL_C_BIT:
+                rowsetColumn.width = 1;
+                break;
+            case SQL_C_TIMESTAMP:
+                rowsetColumn.width = sizeof(TIMESTAMP_STRUCT);
+                break;
+            default: {
+                // Field size is limited to fetch buffer size, so the actual column length is requested
+                int32_t columnLength = 0;
+                queryColAttributes(query, int16_t(column + 1), SQL_COLUMN_LENGTH, columnLength);
+                if (columnLength <= 0)
+                    return;
+                if (rowsetColumn.cType == SQL_C_BINARY)
+                    rowsetColumn.width = columnLength;
+                else
+                    rowsetColumn.width = SQLLEN(columnLength) * 4 + 1; // Up to 4 bytes per UTF-8 character
+                break;
+            }
+        }
+
+        if (rowsetColumn.width > ODBCRowset::MaxValueSize)
+            return;
+
+        rowSize += size_t(rowsetColumn.width) + sizeof(SQLLEN);
+    }
+
+    SQLULEN rowsetSize = fetchSize;
+    if (rowsetSize > ODBCRowset::MaxBufferSize / rowSize)
+        rowsetSize = ODBCRowset::MaxBufferSize / rowSize;
+    if (rowsetSize < 2)
+        return;
+
+    lock_guard<mutex> lock(m_connect->m_mutex);
+
+    rowset->rowStatus.resize(rowsetSize);
+    bool bound = true;
+    for (uint32_t column = 0; column < fieldCount && bound; column++) {
+        ODBCRowset::Column& rowsetColumn = rowset->columns[column];
+        rowsetColumn.data.resize(size_t(rowsetColumn.width) * rowsetSize);
+        rowsetColumn.lengths.resize(rowsetSize);
+        bound = successful(SQLBindCol(statement, SQLUSMALLINT(column + 1), rowsetColumn.cType,
+                                      rowsetColumn.data.data(), rowsetColumn.width, rowsetColumn.lengths.data()));
+    }
+
+    bound = bound &&
+        successful(SQLSetStmtAttr(statement, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER) SQL_BIND_BY_COLUMN, 0)) &&
+        successful(SQLSetStmtAttr(statement, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER) rowsetSize, 0)) &&
+        successful(SQLSetStmtAttr(statement, SQL_ATTR_ROW_STATUS_PTR, rowset->rowStatus.data(), 0)) &&
+        successful(SQLSetStmtAttr(statement, SQL_ATTR_ROWS_FETCHED_PTR, &rowset->rowsFetched, 0));
+
+    m_rowsets[statement] = rowset;
+    if (!bound) {
+        // Driver doesn't support block cursors: fetch rows one by one
+        releaseRowset(statement);
+    }
+}
+
+void ODBCConnection::fetchRowsetRow(Query* query, ODBCRowset& rowset)
+{
+    auto* statement = (SQLHSTMT) query->statement();
+
+    rowset.currentRow++;
+    if (rowset.currentRow >= rowset.rowsFetched) {
+        rowset.currentRow = 0;
+        rowset.rowsFetched = 0;
+
+        int rc = SQLFetch(statement);
+        if (rc == SQL_NO_DATA || (successful(rc) && rowset.rowsFetched == 0)) {
+            querySetEof(query, true);
+            return;
+        }
+        if (!successful(rc))
+            THROW_QUERY_ERROR(query, queryError(query));
+    }
+
+    SQLULEN row = rowset.currentRow;
+    if (rowset.rowStatus[row] == SQL_ROW_ERROR)
+        THROW_QUERY_ERROR(query, "Can't fetch row: " << queryError(query));
+
+    uint32_t fieldCount = query->fieldCount();
+    for (uint32_t column = 0; column < fieldCount; column++) {
+        auto* field = (CODBCField*) &(*query)[column];
+        ODBCRowset::Column& rowsetColumn = rowset.columns[column];
+        SQLLEN dataLength = rowsetColumn.lengths[row];
+        char* data = rowsetColumn.data.data() + row * rowsetColumn.width;
+
+        if (dataLength == SQL_NULL_DATA) {
+            field->setNull(VAR_NONE);
+            continue;
+        }
+
+        switch (rowsetColumn.cType) {
+            case SQL_C_SLONG:
+            case SQL_C_DOUBLE:
+            case SQL_C_BIT:
+                memcpy(field->getData(), data, size_t(rowsetColumn.width));
+                dataLength = rowsetColumn.width;
+                break;
+
+            case SQL_C_TIMESTAMP: {
+                auto* t = (TIMESTAMP_STRUCT*) data;
+                DateTime dt(t->year, t->month, t->day, t->hour, t->minute, t->second);
+                field->setDateTime(dt, field->dataType() == VAR_DATE);
+                continue;
+            }
+
+            default: {
+                SQLLEN maxLength = rowsetColumn.cType == SQL_C_CHAR ? rowsetColumn.width - 1 : rowsetColumn.width;
+                if (dataLength == SQL_NO_TOTAL || dataLength > maxLength)
+                    THROW_QUERY_ERROR(query, "Can't read field " << field->fieldName() << ": value is truncated");
+                if (rowsetColumn.cType == SQL_C_CHAR && dataLength > 0)
+                    dataLength = (SQLLEN) trimField(data, (uint32_t) dataLength);
+                if (dataLength > 0) {
+                    field->checkSize(size_t(dataLength) + 1);
+                    auto* buffer = (char*) field->getBuffer();
+                    memcpy(buffer, data, size_t(dataLength));
+                    buffer[dataLength] = 0;
+                }
+                break;
+            }
+        }
+
+        if (dataLength <= 0)
+            field->setNull(VAR_NONE);
+        else
+            field->dataSize((size_t) dataLength);
+    }
+}
+
 String ODBCConnection::driverDescription() const
 {
     if (m_connect != nullptr)
@@ -806,6 +1037,11 @@ void ODBCConnection::objectList(DatabaseObjectType objectType, Strings& objects)
     }
 }
 
+SBulkLoader ODBCConnection::_bulkLoader(const String& tableName, const Strings& columnNames)
+{
+    return make_shared<ODBCBulkLoader>(this, tableName, columnNames);
+}
+
 void ODBCConnection::_executeBatchSQL(const Strings& sqlBatch, Strings* errors)
 {
     RegularExpression   matchStatementEnd("(;\\s*)$");
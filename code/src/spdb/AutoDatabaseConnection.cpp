@@ -39,10 +39,9 @@ AutoDatabaseConnection::AutoDatabaseConnection(DatabaseConnectionPool& connectio
 
 AutoDatabaseConnection::~AutoDatabaseConnection()
 {
-    if (m_connection != nullptr) {
-        m_connection->close();
+    // Connection stays opened, to be reused by the next user of the pool
+    if (m_connection != nullptr)
         m_connectionPool.releaseConnection(m_connection);
-    }
 }
 
 PoolDatabaseConnection* AutoDatabaseConnection::connection()
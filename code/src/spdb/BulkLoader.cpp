@@ -0,0 +1,162 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       BulkLoader.cpp - description                           ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <sptk5/db/BulkLoader.h>
+#include <sptk5/db/Query.h>
+
+using namespace std;
+using namespace sptk;
+
+BulkLoader::BulkLoader(PoolDatabaseConnection* db, const String& tableName, const Strings& columnNames,
+                       size_t maxParameters)
+: m_db(db), m_tableName(tableName), m_columnNames(columnNames)
+{
+    if (columnNames.empty())
+        throw DatabaseException("Bulk load into " + tableName + ": no columns are defined");
+
+    m_batchRows = maxParameters / columnNames.size();
+    if (m_batchRows > MaxBatchRows)
+        m_batchRows = MaxBatchRows;
+    if (m_batchRows == 0)
+        m_batchRows = 1;
+
+    if (!m_db->inTransaction()) {
+        m_db->beginTransaction();
+        m_ownTransaction = true;
+    }
+}
+
+BulkLoader::~BulkLoader()
+{
+    if (m_ownTransaction && m_db->inTransaction()) {
+        try {
+            m_db->rollbackTransaction();
+        }
+        catch (const Exception&) {
+            // Destructor can't report the error, and the transaction is abandoned anyway
+        }
+    }
+}
+
+void BulkLoader::addRow(const VariantVector& row)
+{
+    if (m_finished)
+        throw DatabaseException("Bulk load into " + m_tableName + " is already finished");
+
+    if (row.size() != m_columnNames.size())
+        throw DatabaseException("Bulk load into " + m_tableName + ": row " + int2string(uint64_t(m_rows + 1)) +
+                                " has " + int2string(uint64_t(row.size())) + " values, expected " +
+                                int2string(uint64_t(m_columnNames.size())));
+
+    loadRow(row);
+    m_rows++;
+}
+
+void BulkLoader::addRow(const FieldList& row)
+{
+    VariantVector values;
+    values.reserve(row.size());
+    for (uint32_t i = 0; i < row.size(); i++)
+        values.push_back(row[i]);
+    addRow(values);
+}
+
+size_t BulkLoader::finish()
+{
+    if (!m_finished) {
+        m_finished = true;
+        finishLoad();
+        if (m_ownTransaction) {
+            m_ownTransaction = false;
+            m_db->commitTransaction();
+        }
+    }
+    return m_rows;
+}
+
+String BulkLoader::insertSQL(size_t rowCount, const String& paramMark) const
+{
+    stringstream sql;
+    sql << "INSERT INTO " << m_tableName << "(" << m_columnNames.join(",") << ") VALUES ";
+
+    size_t paramIndex = 0;
+    for (size_t row = 0; row < rowCount; row++) {
+        sql << (row == 0 ? "(" : ",(");
+        for (size_t column = 0; column < m_columnNames.size(); column++, paramIndex++) {
+            if (column > 0)
+                sql << ",";
+            if (paramMark.empty())
+                sql << ":p" << paramIndex;
+            else
+                sql << paramMark;
+        }
+        sql << ")";
+    }
+
+    return sql.str();
+}
+
+void BulkLoader::loadRow(const VariantVector& row)
+{
+    if (m_batch.empty())
+        m_batch.reserve(m_batchRows * m_columnNames.size());
+
+    for (auto& value: row)
+        m_batch.push_back(value);
+
+    if (m_batch.size() == m_batchRows * m_columnNames.size())
+        insertBatch();
+}
+
+void BulkLoader::insertBatch()
+{
+    size_t rowCount = m_batch.size() / m_columnNames.size();
+
+    shared_ptr<Query> insertQuery;
+    if (rowCount == m_batchRows) {
+        // Complete batches reuse the same prepared statement
+        if (!m_insertQuery)
+            m_insertQuery = make_shared<Query>(m_db, insertSQL(rowCount));
+        insertQuery = m_insertQuery;
+    } else
+        insertQuery = make_shared<Query>(m_db, insertSQL(rowCount));
+
+    for (uint32_t i = 0; i < m_batch.size(); i++)
+        insertQuery->param(i) = m_batch[i];
+
+    insertQuery->exec();
+
+    m_batch.clear();
+}
+
+void BulkLoader::finishLoad()
+{
+    if (!m_batch.empty())
+        insertBatch();
+    m_insertQuery.reset();
+}
@@ -39,6 +39,7 @@
 
 using namespace std;
 using namespace sptk;
+using namespace chrono;
 
 class DriverLoaders
 {
@@ -72,30 +73,41 @@ static DriverLoaders m_loadedDrivers;
 
 DatabaseConnectionPool::DatabaseConnectionPool(const String& connectionString, unsigned maxConnections) :
     DatabaseConnectionString(connectionString),
-    m_driver(nullptr),
-    m_createConnection(nullptr),
-    m_destroyConnection(nullptr),
-    m_maxConnections(maxConnections)
+    m_maxConnections(maxConnections),
+    m_resultCache(std::make_shared<QueryResultCache>()),
+    m_statistics(std::make_shared<DatabaseStatistics>())
 {
 }
 
-bool DatabaseConnectionPool::closeConnectionCB(PoolDatabaseConnection*& item, void* data)
-{
-    PoolDatabaseConnection* connection = item;
-    auto* connectionPool = (DatabaseConnectionPool*)data;
-    connectionPool->destroyConnection(connection, false);
-    return true;
-}
-
 DatabaseConnectionPool::~DatabaseConnectionPool()
 {
-    m_connections.each(closeConnectionCB,this);
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        m_maintenanceStopped = true;
+    }
+    m_maintenanceCondition.notify_all();
+    if (m_maintenanceThread.joinable())
+        m_maintenanceThread.join();
+
+    map<PoolDatabaseConnection*, TimePoint> connections;
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        connections.swap(m_connections);
+        m_idle.clear();
+        m_connectionCount = 0;
+    }
+
+    for (auto& itor: connections)
+        destroyConnection(itor.first, false);
 }
 
 void DatabaseConnectionPool::load()
 {
     lock_guard<mutex> lock(*this);
 
+    if (m_driver != nullptr)
+        return;
+
     String driverNameLC = lowerCase(driverName());
     if (driverNameLC == "mssql")
         driverNameLC = "odbc";
@@ -168,6 +180,7 @@ void DatabaseConnectionPool::load()
     driver->m_createConnection = createConnection;
     driver->m_destroyConnection = destroyConnection;
 
+    m_driver = driver;
     m_createConnection = createConnection;
     m_destroyConnection = destroyConnection;
 
@@ -182,38 +195,497 @@ DatabaseConnection DatabaseConnectionPool::getConnection()
 
 PoolDatabaseConnection* DatabaseConnectionPool::createConnection()
 {
-    if (m_driver == nullptr)
-        load();
+    vector<PoolDatabaseConnection*> expiredConnections;
     PoolDatabaseConnection* connection = nullptr;
-    if (m_connections.size() < m_maxConnections && m_pool.empty()) {
-        connection = m_createConnection(toString().c_str());
-        m_connections.push_back(connection);
-        return connection;
+    bool create = false;
+    auto started = steady_clock::now();
+
+    {
+        unique_lock<mutex> lock(m_poolMutex);
+
+        takeExpired(started, expiredConnections);
+
+        if (m_waiters.empty() && !m_idle.empty()) {
+            // The most recently used connection is the least likely to be broken
+            connection = m_idle.back().first;
+            m_idle.pop_back();
+        }
+        else if (m_waiters.empty() && m_connectionCount < m_maxConnections) {
+            ++m_connectionCount;
+            create = true;
+        }
+        else {
+            Waiter waiter;
+            m_waiters.push_back(&waiter);
+            bool served = m_poolCondition.wait_for(lock, m_waitTimeout,
+                [&waiter]() { return waiter.connection != nullptr || waiter.createAllowed; });
+            if (!served) {
+                m_waiters.erase(find(m_waiters.begin(), m_waiters.end(), &waiter));
+                m_statistics->poolTimeout();
+                throw TimeoutException("Timeout waiting for database connection: all " +
+                                       int2string(m_maxConnections) + " connections are in use");
+            }
+            connection = waiter.connection;
+            create = waiter.createAllowed;
+        }
     }
-    m_pool.pop(connection, std::chrono::seconds(10));
+
+    auto waited = duration_cast<microseconds>(steady_clock::now() - started);
+    m_statistics->poolWait().record(uint64_t(waited.count()));
+
+    for (auto* expiredConnection: expiredConnections)
+        destroyConnection(expiredConnection, false);
+
+    if (create)
+        return newConnection();
+
+    validate(connection);
+
     return connection;
 }
 
+PoolDatabaseConnection* DatabaseConnectionPool::newConnection()
+{
+    try {
+        load();
+        auto* connection = m_createConnection(toString().c_str());
+        connection->setResultCache(m_resultCache);
+        connection->setStatistics(m_statistics);
+        lock_guard<mutex> lock(m_poolMutex);
+        m_connections[connection] = steady_clock::now();
+        return connection;
+    }
+    catch (...) {
+        lock_guard<mutex> lock(m_poolMutex);
+        --m_connectionCount;
+        handOver(nullptr);
+        throw;
+    }
+}
+
+void DatabaseConnectionPool::validate(PoolDatabaseConnection* connection)
+{
+    // Connection that isn't opened is opened by the user
+    if (!connection->active() || connection->validate())
+        return;
+
+    try {
+        connection->close();
+        connection->open();
+    }
+    catch (...) {
+        destroyConnection(connection);
+        throw;
+    }
+}
+
 void DatabaseConnectionPool::releaseConnection(PoolDatabaseConnection* connection)
 {
-    m_pool.push(connection);
+    bool reusable = true;
+    try {
+        connection->resetSession();
+    }
+    catch (const Exception& e) {
+        logError("Can't reset database session: " + String(e.what()));
+        reusable = false;
+    }
+
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        if (reusable && !expired(connection, steady_clock::now())) {
+            handOver(connection);
+            return;
+        }
+    }
+
+    destroyConnection(connection);
+}
+
+void DatabaseConnectionPool::handOver(PoolDatabaseConnection* connection)
+{
+    if (m_waiters.empty()) {
+        if (connection != nullptr)
+            m_idle.emplace_back(connection, steady_clock::now());
+        return;
+    }
+
+    auto* waiter = m_waiters.front();
+    m_waiters.pop_front();
+    if (connection != nullptr)
+        waiter->connection = connection;
+    else {
+        ++m_connectionCount;
+        waiter->createAllowed = true;
+    }
+    m_poolCondition.notify_all();
+}
+
+bool DatabaseConnectionPool::expired(PoolDatabaseConnection* connection, const TimePoint& now) const
+{
+    if (m_maxLifetime.count() == 0)
+        return false;
+    auto itor = m_connections.find(connection);
+    return itor != m_connections.end() && now - itor->second >= m_maxLifetime;
+}
+
+void DatabaseConnectionPool::takeExpired(const TimePoint& now, vector<PoolDatabaseConnection*>& expiredConnections)
+{
+    // Idle list starts from the least recently used connections
+    for (auto itor = m_idle.begin(); itor != m_idle.end();) {
+        auto* connection = itor->first;
+        bool idleExpired = m_idleTimeout.count() > 0 && now - itor->second >= m_idleTimeout &&
+                           m_idle.size() > m_minIdle;
+        if (idleExpired || expired(connection, now)) {
+            itor = m_idle.erase(itor);
+            m_connections.erase(connection);
+            --m_connectionCount;
+            expiredConnections.push_back(connection);
+        }
+        else
+            ++itor;
+    }
+}
+
+void DatabaseConnectionPool::warmUp()
+{
+    for (;;) {
+        {
+            lock_guard<mutex> lock(m_poolMutex);
+            if (m_idle.size() >= m_minIdle || m_connectionCount >= m_maxConnections || !m_waiters.empty())
+                return;
+            ++m_connectionCount;
+        }
+
+        auto* connection = newConnection();
+        try {
+            connection->open();
+        }
+        catch (...) {
+            destroyConnection(connection);
+            throw;
+        }
+
+        lock_guard<mutex> lock(m_poolMutex);
+        handOver(connection);
+    }
+}
+
+void DatabaseConnectionPool::evictIdle()
+{
+    vector<PoolDatabaseConnection*> expiredConnections;
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        takeExpired(steady_clock::now(), expiredConnections);
+    }
+
+    for (auto* connection: expiredConnections)
+        destroyConnection(connection, false);
+
+    warmUp();
+}
+
+void DatabaseConnectionPool::maintenanceThreadFunction()
+{
+    unique_lock<mutex> lock(m_poolMutex);
+    while (!m_maintenanceStopped) {
+        if (m_maintenanceInterval.count() == 0) {
+            m_maintenanceCondition.wait(lock);
+            continue;
+        }
+
+        // Changed interval wakes the thread up, and the wait starts again with the new interval
+        if (m_maintenanceCondition.wait_for(lock, m_maintenanceInterval) != cv_status::timeout)
+            continue;
+
+        lock.unlock();
+        try {
+            evictIdle();
+        }
+        catch (const Exception& e) {
+            logError("Connection pool maintenance failed: " + String(e.what()));
+        }
+        lock.lock();
+    }
+}
+
+void DatabaseConnectionPool::scheduleEviction()
+{
+    milliseconds interval = seconds(30);
+    for (auto timeout: {m_idleTimeout, m_maxLifetime}) {
+        if (timeout.count() > 0 && timeout / 2 < interval)
+            interval = timeout / 2;
+    }
+    interval = max(interval, milliseconds(100));
+
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        if (m_minIdle > 0 || m_idleTimeout.count() > 0 || m_maxLifetime.count() > 0)
+            m_maintenanceInterval = interval;
+        else
+            m_maintenanceInterval = milliseconds(0);
+
+        if (m_maintenanceInterval.count() > 0 && !m_maintenanceThread.joinable())
+            m_maintenanceThread = thread(&DatabaseConnectionPool::maintenanceThreadFunction, this);
+    }
+    m_maintenanceCondition.notify_all();
+}
+
+void DatabaseConnectionPool::setLogEngine(LogEngine* logEngine)
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    if (logEngine == nullptr)
+        m_logger.reset();
+    else
+        m_logger = make_shared<Logger>(*logEngine, "Connection pool: ");
+}
+
+void DatabaseConnectionPool::logError(const String& error)
+{
+    shared_ptr<Logger> logger;
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        logger = m_logger;
+    }
+    if (logger)
+        logger->error(error);
+}
+
+void DatabaseConnectionPool::setMinIdle(unsigned minIdle)
+{
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        m_minIdle = minIdle;
+    }
+    warmUp();
+    scheduleEviction();
+}
+
+void DatabaseConnectionPool::setMaxLifetime(milliseconds maxLifetime)
+{
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        m_maxLifetime = maxLifetime;
+    }
+    scheduleEviction();
+}
+
+void DatabaseConnectionPool::setIdleTimeout(milliseconds idleTimeout)
+{
+    {
+        lock_guard<mutex> lock(m_poolMutex);
+        m_idleTimeout = idleTimeout;
+    }
+    scheduleEviction();
+}
+
+void DatabaseConnectionPool::setWaitTimeout(milliseconds waitTimeout)
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    m_waitTimeout = waitTimeout;
+}
+
+size_t DatabaseConnectionPool::size() const
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    return m_connectionCount;
+}
+
+size_t DatabaseConnectionPool::idleSize() const
+{
+    lock_guard<mutex> lock(m_poolMutex);
+    return m_idle.size();
 }
 
 void DatabaseConnectionPool::destroyConnection(PoolDatabaseConnection* connection, bool unlink)
 {
-    if (unlink)
-        m_connections.remove(connection);
+    if (unlink) {
+        lock_guard<mutex> lock(m_poolMutex);
+        m_connections.erase(connection);
+        --m_connectionCount;
+        handOver(nullptr);
+    }
     try {
         connection->close();
     }
     catch (const Exception& e) {
-        CERR(e.what() << endl);
+        logError("Can't close database connection: " + String(e.what()));
     }
     m_destroyConnection(connection);
 }
 
 #if USE_GTEST
 
+//───────────────────────────────── SQLite3 ──────────────────────────────────────────────
+
+TEST(SPTK_SQLite3Connection, connectionPool)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testConnectionPool(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, checkoutPerformance)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testCheckoutPerformance(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, streamingSelect)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testStreamingSelect(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, bulkInsert)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testBulkInsert(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, bulkLoader)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testBulkLoader(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, bulkLoaderPerformance)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testBulkLoaderPerformance(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, queryBatch)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testQueryBatch(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, statementCache)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testStatementCache(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, options)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testSQLite3Options(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, fetchBatch)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testFetchBatch(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, asyncQuery)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testAsyncQuery(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, queryResultCache)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testQueryResultCache(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_SQLite3Connection, databaseStatistics)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("sqlite3");
+    if (connectionString.empty())
+        FAIL() << "SQLite3 connection is not defined";
+    try {
+        databaseTests.testDatabaseStatistics(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
 //───────────────────────────────── PostgreSQL ───────────────────────────────────────────
 
 TEST(SPTK_PostgreSQLConnection, connect)
@@ -294,6 +766,149 @@ TEST(SPTK_PostgreSQLConnection, select)
     }
 }
 
+TEST(SPTK_PostgreSQLConnection, connectionPool)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testConnectionPool(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, checkoutPerformance)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testCheckoutPerformance(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, streamingSelect)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testStreamingSelect(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, bulkLoader)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testBulkLoader(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, bulkLoaderPerformance)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testBulkLoaderPerformance(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, queryBatch)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testQueryBatch(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, statementCache)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testStatementCache(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, fetchBatch)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testFetchBatch(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, asyncQuery)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testAsyncQuery(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, queryResultCache)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testQueryResultCache(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_PostgreSQLConnection, databaseStatistics)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("postgresql");
+    if (connectionString.empty())
+        FAIL() << "PostgreSQL connection is not defined";
+    try {
+        databaseTests.testDatabaseStatistics(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
 //───────────────────────────────── MySQL ────────────────────────────────────────────────
 
 TEST(SPTK_MySQLConnection, connect)
@@ -374,6 +989,32 @@ TEST(SPTK_MySQLConnection, select)
     }
 }
 
+TEST(SPTK_MySQLConnection, fetchBatch)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("mysql");
+    if (connectionString.empty())
+        FAIL() << "MySQL connection is not defined";
+    try {
+        databaseTests.testFetchBatch(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_MySQLConnection, streamingSelect)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("mysql");
+    if (connectionString.empty())
+        FAIL() << "MySQL connection is not defined";
+    try {
+        databaseTests.testStreamingSelect(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
 //───────────────────────────────── Oracle ─────────────────────────────────────────────
 
 TEST(SPTK_OracleConnection, connect)
@@ -534,4 +1175,30 @@ TEST(SPTK_MSSQLConnection, select)
     }
 }
 
+TEST(SPTK_MSSQLConnection, streamingSelect)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("mssql");
+    if (connectionString.empty())
+        FAIL() << "MSSQL connection is not defined";
+    try {
+        databaseTests.testStreamingSelect(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
+TEST(SPTK_MSSQLConnection, bulkLoader)
+{
+    DatabaseConnectionString connectionString = databaseTests.connectionString("mssql");
+    if (connectionString.empty())
+        FAIL() << "MSSQL connection is not defined";
+    try {
+        databaseTests.testBulkLoader(connectionString);
+    }
+    catch (const Exception& e) {
+        FAIL() << connectionString.toString() << ": " << e.what();
+    }
+}
+
 #endif
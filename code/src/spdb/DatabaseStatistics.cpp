@@ -0,0 +1,185 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       DatabaseStatistics.cpp - description                   ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <sptk5/db/DatabaseStatistics.h>
+#include <sptk5/LogEngine.h>
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+const char* const DatabaseStatistics::OtherStatements = "<other statements>";
+
+DatabaseStatistics::DatabaseStatistics(size_t maxStatements)
+: m_otherStatements(make_shared<StatementStatistics>(OtherStatements)),
+  m_maxStatements(maxStatements)
+{
+}
+
+String DatabaseStatistics::normalize(const String& sql)
+{
+    String normalized;
+    normalized.reserve(sql.length());
+
+    const char* ptr = sql.c_str();
+    while (*ptr != 0) {
+        auto ch = (unsigned char) *ptr;
+
+        if (isspace(ch) != 0) {
+            while (isspace((unsigned char) *ptr) != 0)
+                ptr++;
+            if (!normalized.empty() && *ptr != 0)
+                normalized += ' ';
+            continue;
+        }
+
+        if (ch == '\'') {
+            // Literal string, quotes inside are doubled
+            for (ptr++; *ptr != 0; ptr++) {
+                if (*ptr == '\'') {
+                    if (ptr[1] != '\'')
+                        break;
+                    ptr++;
+                }
+            }
+            if (*ptr != 0)
+                ptr++;
+            normalized += '?';
+            continue;
+        }
+
+        if (isdigit(ch) != 0) {
+            // Digits that are a part of identifier or parameter mark are kept
+            char previous = normalized.empty() ? ' ' : normalized.back();
+            if (isalnum((unsigned char) previous) == 0 && strchr("_$:@", previous) == nullptr) {
+                while (isalnum((unsigned char) *ptr) != 0 || *ptr == '.')
+                    ptr++;
+                normalized += '?';
+                continue;
+            }
+        }
+
+        normalized += *ptr;
+        ptr++;
+    }
+
+    return normalized;
+}
+
+SStatementStatistics DatabaseStatistics::statement(const String& sql)
+{
+    String normalized = normalize(sql);
+
+    lock_guard<mutex> lock(m_mutex);
+
+    auto itor = m_statements.find(normalized);
+    if (itor != m_statements.end())
+        return itor->second;
+
+    if (m_statements.size() >= m_maxStatements)
+        return m_otherStatements;
+
+    auto statement = make_shared<StatementStatistics>(normalized);
+    m_statements[normalized] = statement;
+    return statement;
+}
+
+vector<SStatementStatistics> DatabaseStatistics::statements() const
+{
+    vector<SStatementStatistics> statements;
+
+    lock_guard<mutex> lock(m_mutex);
+    statements.reserve(m_statements.size() + 1);
+    for (auto& itor: m_statements)
+        statements.push_back(itor.second);
+    if (m_otherStatements->execute.count() != 0 || m_otherStatements->errors != 0)
+        statements.push_back(m_otherStatements);
+
+    return statements;
+}
+
+void DatabaseStatistics::setSlowQueryLog(LogEngine* logEngine, microseconds threshold)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (logEngine == nullptr || threshold.count() <= 0) {
+        m_slowQueryThreshold = 0;
+        m_slowQueryLogger.reset();
+        return;
+    }
+
+    m_slowQueryLogger = make_shared<Logger>(*logEngine);
+    m_slowQueryThreshold = threshold.count();
+}
+
+void DatabaseStatistics::writeSlowQuery(const StatementStatistics& statement, microseconds duration)
+{
+    ++m_slowQueries;
+
+    char elapsed[32];
+    snprintf(elapsed, sizeof(elapsed), "%.3f", double(duration.count()) / 1000);
+
+    lock_guard<mutex> lock(m_mutex);
+    if (m_slowQueryLogger)
+        m_slowQueryLogger->warning("Slow query, " + String(elapsed) + " ms: " + statement.sql);
+}
+
+void DatabaseStatistics::reset()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_statements.clear();
+        m_otherStatements = make_shared<StatementStatistics>(OtherStatements);
+        ++m_generation;
+    }
+    m_poolWait.reset();
+    m_poolTimeouts = 0;
+    m_slowQueries = 0;
+}
+
+#if USE_GTEST
+
+TEST(SPTK_DatabaseStatistics, normalize)
+{
+    EXPECT_STREQ("SELECT * FROM t1 WHERE id = ? AND name IN (?, ?) AND x = $1",
+                 DatabaseStatistics::normalize("SELECT *\n  FROM t1 WHERE id = 10 AND name IN ('it''s', 'a') AND x = $1 ").c_str());
+    EXPECT_STREQ("UPDATE t SET v = ? WHERE id = :id1",
+                 DatabaseStatistics::normalize("UPDATE t SET v = 1.5e3 WHERE id = :id1").c_str());
+
+    DatabaseStatistics statistics(1);
+    auto statement = statistics.statement("SELECT 1");
+    EXPECT_EQ(statement, statistics.statement("SELECT  2"));
+    EXPECT_STREQ(DatabaseStatistics::OtherStatements, statistics.statement("SELECT 3 FROM t").get()->sql.c_str());
+
+    uint64_t generation = statistics.generation();
+    statistics.reset();
+    EXPECT_EQ(generation + 1, statistics.generation());
+    EXPECT_NE(statement, statistics.statement("SELECT 1"));
+}
+
+#endif
@@ -31,10 +31,14 @@
 #include <sptk5/db/DatabaseConnectionPool.h>
 #include <sptk5/db/Query.h>
 #include <sptk5/db/Transaction.h>
+#include <sptk5/db/BulkLoader.h>
+#include <sptk5/db/QueryBatch.h>
+#include <sptk5/LogEngine.h>
 #include <cmath>
 
 using namespace std;
 using namespace sptk;
+using namespace chrono;
 
 DatabaseTests sptk::databaseTests;
 
@@ -108,7 +112,8 @@ static const map<String, String> dateTimeFieldTypes = {
         {"mysql",      "TIMESTAMP"},
         {"postgresql", "TIMESTAMP"},
         {"mssql",      "DATETIME"},
-        {"oracle",     "TIMESTAMP"}
+        {"oracle",     "TIMESTAMP"},
+        {"sqlite3",    "TEXT"}
 };
 
 void DatabaseTests::testQueryParameters(const DatabaseConnectionString& connectionString)
@@ -255,7 +260,7 @@ void DatabaseTests::testBulkInsert(const DatabaseConnectionString& connectionStr
         dropTable.exec();
     }
     catch (const Exception& e) {
-        RegularExpression matchTableNotExists("not exist|unknown table", "i");
+        RegularExpression matchTableNotExists("not exist|unknown table|no such table", "i");
         if (!matchTableNotExists.matches(e.what()))
             CERR(e.what() << endl);
     }
@@ -383,3 +388,962 @@ size_t DatabaseTests::countRowsInTable(DatabaseConnection& db, const String& tab
 
     return count;
 }
+
+static void recreateTable(DatabaseConnection& db, const String& tableName, const String& columns)
+{
+    Query dropTable(db, "DROP TABLE " + tableName);
+    try {
+        dropTable.exec();
+    }
+    catch (const Exception& e) {
+        RegularExpression matchTableNotExists("not exist|unknown table|no such table", "i");
+        if (!matchTableNotExists.matches(e.what()))
+            CERR(e.what() << endl);
+    }
+
+    Query createTable(db, "CREATE TABLE " + tableName + "(" + columns + ")");
+    createTable.exec();
+}
+
+void DatabaseTests::testBulkLoader(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40), salary FLOAT");
+
+    Strings columnNames("id,name,salary", ",");
+    vector<VariantVector> data = {
+        { Variant(1), Variant("Alex"), Variant(1000.5) },
+        { Variant(2), Variant("David\twith tab"), Variant() },
+        { Variant(3), Variant(), Variant(3000.25) }
+    };
+
+    auto bulkLoader = db->bulkLoader("gtest_temp_table", columnNames);
+    for (auto& row: data)
+        bulkLoader->addRow(row);
+    size_t loadedRows = bulkLoader->finish();
+    if (loadedRows != data.size())
+        throw Exception("Loaded " + to_string(loadedRows) + " rows, expected " + to_string(data.size()));
+
+    Query selectData(db, "SELECT id, name, salary FROM gtest_temp_table ORDER BY id");
+    selectData.open();
+    size_t rowIndex = 0;
+    while (!selectData.eof()) {
+        if (rowIndex >= data.size())
+            throw Exception("Table has more rows than loaded");
+        auto& row = data[rowIndex];
+        for (unsigned column = 0; column < columnNames.size(); column++) {
+            auto& field = selectData[column];
+            auto& value = row[column];
+            bool matches;
+            if (value.isNull())
+                matches = field.isNull();
+            else if (column == 2)
+                matches = !field.isNull() && fabs(field.asFloat() - value.asFloat()) < 0.001;
+            else
+                matches = !field.isNull() && field.asString().trim() == value.asString();
+            if (!matches)
+                throw Exception("Row " + to_string(rowIndex + 1) + ", column " + columnNames[column] + ": [" +
+                                field.asString() + "] doesn't match loaded value [" + value.asString() + "]");
+        }
+        rowIndex++;
+        selectData.next();
+    }
+    selectData.close();
+
+    if (rowIndex != data.size())
+        throw Exception("Table has " + to_string(rowIndex) + " rows, expected " + to_string(data.size()));
+
+    // Number of values must match number of columns
+    auto invalidLoader = db->bulkLoader("gtest_temp_table", columnNames);
+    bool rejected = false;
+    try {
+        invalidLoader->addRow(VariantVector{Variant(4)});
+    }
+    catch (const DatabaseException&) {
+        rejected = true;
+    }
+    if (!rejected)
+        throw Exception("Row with wrong number of values isn't rejected");
+    invalidLoader.reset();
+
+    // Default loader: two complete batches of two rows, and the last batch of one row
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40), salary FLOAT");
+    BulkLoader defaultLoader(db->connection(), "gtest_temp_table", columnNames, 2 * columnNames.size());
+    for (int id = 1; id <= 5; id++)
+        defaultLoader.addRow(VariantVector{Variant(id), Variant("Name " + to_string(id)), Variant(id * 1.5)});
+    defaultLoader.finish();
+
+    Query countRows(db, "SELECT count(*), sum(id) FROM gtest_temp_table");
+    countRows.open();
+    if (countRows[uint32_t(0)].asInteger() != 5 || countRows[uint32_t(1)].asInteger() != 15)
+        throw Exception("Default bulk loader didn't insert all the rows");
+    countRows.close();
+
+    // Unfinished load is rolled back
+    {
+        BulkLoader unfinishedLoader(db->connection(), "gtest_temp_table", columnNames, 2 * columnNames.size());
+        for (int id = 6; id <= 10; id++)
+            unfinishedLoader.addRow(VariantVector{Variant(id), Variant(), Variant()});
+    }
+    countRows.open();
+    if (countRows[uint32_t(0)].asInteger() != 5)
+        throw Exception("Unfinished bulk load isn't rolled back");
+    countRows.close();
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
+
+void DatabaseTests::testBulkLoaderPerformance(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40), position_name VARCHAR(20), salary FLOAT");
+
+    size_t count = 100000;
+    Strings columnNames("id,name,position_name,salary", ",");
+
+    Strings textRows;
+    for (size_t i = 0; i < count; i++)
+        textRows.push_back(to_string(i) + "\tName " + to_string(i) + "\tProgrammer\t" + to_string(i * 1.5));
+
+    DateTime started("now");
+    db->beginTransaction();
+    db->bulkInsert("gtest_temp_table", columnNames, textRows);
+    db->commitTransaction();
+    DateTime ended("now");
+    double textDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40), position_name VARCHAR(20), salary FLOAT");
+
+    started = DateTime("now");
+    db->beginTransaction();
+    auto bulkLoader = db->bulkLoader("gtest_temp_table", columnNames);
+    VariantVector row(4);
+    for (size_t i = 0; i < count; i++) {
+        row[0] = (int32_t) i;
+        row[1] = "Name " + to_string(i);
+        row[2] = "Programmer";
+        row[3] = i * 1.5;
+        bulkLoader->addRow(row);
+    }
+    bulkLoader->finish();
+    db->commitTransaction();
+    ended = DateTime("now");
+    double loaderDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    COUT(connectionString.driverName() << " bulk insert: " << size_t(count / 1E3 / max(textDurationSec, 0.001))
+         << "K rows/sec, bulk loader: " << size_t(count / 1E3 / max(loaderDurationSec, 0.001)) << "K rows/sec" << endl);
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
+
+void DatabaseTests::testStreamingSelect(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    Query insertData(db, "INSERT INTO gtest_temp_table VALUES (:id, :name)");
+    Query selectData(db, "SELECT id, name FROM gtest_temp_table ORDER BY id");
+    Query directSelectData(db, "SELECT id, name FROM gtest_temp_table ORDER BY id", false);
+
+    recreateTable(db, "gtest_temp_table", "id INT, name VARCHAR(20)");
+
+    size_t maxRecords = 1000;
+    db->beginTransaction();
+    for (size_t id = 1; id <= maxRecords; id++) {
+        insertData.param("id") = (int) id;
+        insertData.param("name") = "Name " + to_string(id);
+        insertData.exec();
+    }
+    db->commitTransaction();
+
+    // Both prepared and not prepared queries stream the result set
+    for (Query* query: {&selectData, &directSelectData}) {
+        query->setFetchSize(64);
+
+        // Read the entire result set
+        size_t count = 0;
+        query->open();
+        while (!query->eof()) {
+            count++;
+            if ((*query)["id"].asInteger() != (int) count)
+                throw Exception("row.id " + (*query)["id"].asString() + " != " + to_string(count));
+            if ((*query)["name"].asString() != "Name " + to_string(count))
+                throw Exception("row.name != table data");
+            query->next();
+        }
+        query->close();
+
+        if (count != maxRecords)
+            throw Exception("count " + to_string(count) + " != " + to_string(maxRecords));
+
+        // Close the query in the middle of the result set, the connection should remain usable
+        query->open();
+        for (unsigned i = 0; i < 10; i++)
+            query->next();
+        query->close();
+    }
+
+    dropTable.exec();
+}
+
+void DatabaseTests::testConnectionPool(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString(), 2);
+    connectionPool.setWaitTimeout(milliseconds(100));
+
+    PoolDatabaseConnection* firstConnection;
+    {
+        DatabaseConnection db = connectionPool.getConnection();
+        db->open();
+        db->beginTransaction();
+        firstConnection = db->connection();
+    }
+
+    // Connection is reused, stays opened, and the transaction is rolled back
+    {
+        DatabaseConnection db = connectionPool.getConnection();
+        if (db->connection() != firstConnection || !db->active())
+            throw Exception("Connection isn't reused");
+        if (db->inTransaction())
+            throw Exception("Transaction isn't rolled back when connection is released");
+
+        DatabaseConnection db2 = connectionPool.getConnection();
+        if (connectionPool.size() != 2)
+            throw Exception("pool size " + to_string(connectionPool.size()) + " != 2");
+
+        bool timedOut = false;
+        try {
+            connectionPool.getConnection();
+        }
+        catch (const TimeoutException&) {
+            timedOut = true;
+        }
+        if (!timedOut)
+            throw Exception("Expected timeout waiting for connection");
+
+        // Waiter gets connection as soon as it's released
+        PoolDatabaseConnection* waiterConnection = nullptr;
+        thread waiter([&connectionPool, &waiterConnection]() {
+            DatabaseConnection db3 = connectionPool.getConnection();
+            waiterConnection = db3->connection();
+        });
+        this_thread::sleep_for(milliseconds(20));
+        PoolDatabaseConnection* secondConnection = db2->connection();
+        db2.reset();
+        waiter.join();
+        if (waiterConnection != secondConnection)
+            throw Exception("Waiter didn't get released connection");
+    }
+    if (connectionPool.idleSize() != 2)
+        throw Exception("idle connections " + to_string(connectionPool.idleSize()) + " != 2");
+
+    // Idle connections above min idle are closed
+    connectionPool.setMinIdle(1);
+    connectionPool.setIdleTimeout(milliseconds(100));
+    this_thread::sleep_for(milliseconds(400));
+    if (connectionPool.idleSize() != 1 || connectionPool.size() != 1)
+        throw Exception("Idle connections aren't closed after idle timeout");
+
+    // Connection that lived too long is closed when released
+    connectionPool.setMinIdle(0);
+    connectionPool.setIdleTimeout(milliseconds(0));
+    connectionPool.setMaxLifetime(milliseconds(50));
+    {
+        DatabaseConnection db = connectionPool.getConnection();
+        db->open();
+        this_thread::sleep_for(milliseconds(60));
+    }
+    if (connectionPool.size() != 0)
+        throw Exception("Connection isn't closed after max lifetime");
+}
+
+void DatabaseTests::testCheckoutPerformance(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    connectionPool.setMinIdle(1);
+
+    size_t count = 10000;
+    DateTime started("now");
+    for (size_t i = 0; i < count; i++) {
+        DatabaseConnection db = connectionPool.getConnection();
+        db->open();
+    }
+    DateTime ended("now");
+    double reuseUS = duration_cast<microseconds>(ended - started).count() / double(count);
+
+    count = 100;
+    started = DateTime("now");
+    for (size_t i = 0; i < count; i++) {
+        DatabaseConnection db = connectionPool.getConnection();
+        db->open();
+        db->close();
+    }
+    ended = DateTime("now");
+    double reconnectUS = duration_cast<microseconds>(ended - started).count() / double(count);
+
+    COUT(connectionString.driverName() << " checkout: " << fixed << setprecision(1) << reuseUS
+         << " us with connection reuse, " << reconnectUS << " us with reconnect" << endl);
+}
+
+void DatabaseTests::testQueryBatch(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40)");
+
+    size_t count = 1000;
+    Query insertData(db, "INSERT INTO gtest_temp_table VALUES(:id, :name)");
+    Query invalidInsert(db, "INSERT INTO gtest_missing_table VALUES(1)", false);
+
+    QueryBatch batch(db);
+    for (size_t i = 0; i < count; i++) {
+        insertData.param("id") = (int32_t) i;
+        insertData.param("name") = "Name " + to_string(i);
+        batch.add(insertData);
+        if (i == count / 2)
+            batch.add(invalidInsert);
+    }
+
+    DateTime started("now");
+    db->beginTransaction();
+    size_t failed = batch.execute();
+    db->commitTransaction();
+    DateTime ended("now");
+    double batchDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    // Failed execution doesn't affect the others
+    if (failed != 1 || !batch[count / 2 + 1].failed())
+        throw Exception("Batch has " + to_string(failed) + " failed executions, expected 1");
+
+    // Drivers that report the number of rows, report every inserted row
+    if (batch[0].rows() != -1 && batch[0].rows() != 1)
+        throw Exception("Batch execution affected " + to_string(batch[0].rows()) + " rows, expected 1");
+
+    Query selectData(db, "SELECT count(*), sum(id), min(name) FROM gtest_temp_table");
+    selectData.open();
+    if (selectData[uint32_t(0)].asInteger() != (int) count ||
+        selectData[uint32_t(1)].asInt64() != int64_t(count * (count - 1) / 2) ||
+        selectData[uint32_t(2)].asString() != "Name 0")
+        throw Exception("Table has unexpected content after batch execution");
+    selectData.close();
+
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40)");
+
+    started = DateTime("now");
+    db->beginTransaction();
+    for (size_t i = 0; i < count; i++) {
+        insertData.param("id") = (int32_t) i;
+        insertData.param("name") = "Name " + to_string(i);
+        insertData.exec();
+    }
+    db->commitTransaction();
+    ended = DateTime("now");
+    double sequentialDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    COUT(connectionString.driverName() << " sequential: " << size_t(count / 1E3 / max(sequentialDurationSec, 0.001))
+         << "K queries/sec, batch: " << size_t(count / 1E3 / max(batchDurationSec, 0.001)) << "K queries/sec" << endl);
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
+
+void DatabaseTests::testStatementCache(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40)");
+
+    PoolDatabaseConnection* connection = db->connection();
+    connection->setStatementCacheSize(0);
+    connection->setStatementCacheSize(2);
+
+    // Every query object borrows the statement, prepared by the previous one
+    size_t count = 1000;
+    StatementCacheStatistics before = connection->statementCacheStatistics();
+    DateTime started("now");
+    db->beginTransaction();
+    for (size_t i = 0; i < count; i++) {
+        Query insertData(db, "INSERT INTO gtest_temp_table VALUES(:id, :name)");
+        insertData.param("id") = (int32_t) i;
+        insertData.param("name") = "Name " + to_string(i);
+        insertData.exec();
+    }
+    db->commitTransaction();
+    DateTime ended("now");
+    double cachedDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+    StatementCacheStatistics after = connection->statementCacheStatistics();
+
+    if (after.misses - before.misses != 1 || after.hits - before.hits != count - 1)
+        throw Exception("Statement cache: " + to_string(after.hits - before.hits) + " hits and " +
+                        to_string(after.misses - before.misses) + " misses, expected " + to_string(count - 1) +
+                        " hits and 1 miss");
+
+    // Least recently used statements are evicted
+    before = after;
+    for (int i = 0; i < 3; i++) {
+        Query selectData(db, "SELECT count(*) FROM gtest_temp_table WHERE id >= " + to_string(i));
+        selectData.open();
+        selectData.close();
+    }
+    after = connection->statementCacheStatistics();
+    if (connection->cachedStatements() != 2 || after.evictions - before.evictions != 2)
+        throw Exception("Statement cache has " + to_string(connection->cachedStatements()) + " statements, after " +
+                        to_string(after.evictions - before.evictions) + " evictions");
+
+    Query countRows(db, "SELECT count(*) FROM gtest_temp_table");
+    countRows.open();
+    if (countRows[uint32_t(0)].asInteger() != (int) count)
+        throw Exception("Table has unexpected number of rows");
+    countRows.close();
+
+    // Disabled cache releases all the statements
+    connection->setStatementCacheSize(0);
+    if (connection->cachedStatements() != 0)
+        throw Exception("Disabled statement cache isn't empty");
+
+    started = DateTime("now");
+    db->beginTransaction();
+    for (size_t i = 0; i < count; i++) {
+        Query insertData(db, "INSERT INTO gtest_temp_table VALUES(:id, :name)");
+        insertData.param("id") = (int32_t) i;
+        insertData.param("name") = "Name " + to_string(i);
+        insertData.exec();
+    }
+    db->commitTransaction();
+    ended = DateTime("now");
+    double uncachedDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    COUT(connectionString.driverName() << " query per execution: " << size_t(count / 1E3 / max(uncachedDurationSec, 0.001))
+         << "K queries/sec, with statement cache: " << size_t(count / 1E3 / max(cachedDurationSec, 0.001))
+         << "K queries/sec" << endl);
+
+    connection->setStatementCacheSize(PoolDatabaseConnection::DefaultStatementCacheSize);
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
+
+void DatabaseTests::testSQLite3Options(const DatabaseConnectionString& connectionString)
+{
+    String options = "journal_mode=wal&synchronous=normal&busy_timeout=2000&cache_size=-8000&mmap_size=1048576";
+    DatabaseConnectionPool connectionPool(connectionString.toString() + "?" + options);
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+
+    map<String, String> expectedPragmas = {
+        {"journal_mode", "wal"},
+        {"synchronous", "1"},
+        {"cache_size", "-8000"},
+        {"busy_timeout", "2000"}
+    };
+    for (auto& itor: expectedPragmas) {
+        Query pragma(db, "PRAGMA " + itor.first);
+        pragma.open();
+        String value = pragma[uint32_t(0)].asString();
+        pragma.close();
+        if (value != itor.second)
+            throw Exception("PRAGMA " + itor.first + " is " + value + ", expected " + itor.second);
+    }
+
+    // Data is read correctly from the tables in WAL mode
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40), data BLOB");
+    Query insertData(db, "INSERT INTO gtest_temp_table VALUES(:id, :name, :data)");
+    insertData.param("id") = 1;
+    insertData.param("name") = "Name ";
+    insertData.param("data").setBuffer("\x01\x02\x03", 3, VAR_BUFFER);
+    insertData.exec();
+    insertData.param("id") = 2;
+    insertData.param("name") = "Second";
+    insertData.param("data").setNull(VAR_BUFFER);
+    insertData.exec();
+
+    Query selectData(db, "SELECT id, name, data FROM gtest_temp_table ORDER BY id");
+    selectData.open();
+    if (selectData["name"].asString() != "Name" || selectData["data"].dataSize() != 3 ||
+        memcmp(selectData["data"].getBuffer(), "\x01\x02\x03", 3) != 0)
+        throw Exception("First row doesn't match inserted data");
+    selectData.next();
+    if (selectData["name"].asString() != "Second" || !selectData["data"].isNull())
+        throw Exception("Second row doesn't match inserted data");
+    selectData.close();
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+
+    Query restoreJournalMode(db, "PRAGMA journal_mode=delete");
+    restoreJournalMode.open();
+    restoreJournalMode.close();
+    db->close();
+
+    // Option values are checked before they are used
+    DatabaseConnectionPool invalidConnectionPool(connectionString.toString() + "?journal_mode=wal;DROP");
+    DatabaseConnection invalidDb = invalidConnectionPool.getConnection();
+    bool rejected = false;
+    try {
+        invalidDb->open();
+    }
+    catch (const DatabaseException&) {
+        rejected = true;
+    }
+    if (!rejected)
+        throw Exception("Invalid option value isn't rejected");
+}
+
+void DatabaseTests::testFetchBatch(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INTEGER, name VARCHAR(40), amount DOUBLE PRECISION");
+
+    // Every tenth name is null
+    const size_t count = 10000;
+    auto bulkLoader = db->bulkLoader("gtest_temp_table", Strings("id,name,amount", ","));
+    for (size_t i = 0; i < count; i++) {
+        Variant name;
+        if (i == 1)
+            name = "Name, \"one\"";
+        else if (i % 10 != 0)
+            name = "Name " + to_string(i);
+        bulkLoader->addRow(VariantVector{Variant((int32_t) i), name, Variant(double(i) * 1.5)});
+    }
+    bulkLoader->finish();
+
+    Query selectData(db, "SELECT id, name, amount FROM gtest_temp_table ORDER BY id");
+
+    // Batch starts from the current row, and the row after the batch becomes the current row
+    selectData.open();
+    selectData.next();
+    RecordBatch batch;
+    size_t rows = selectData.fetchBatch(batch, 10);
+    if (rows != 10 || batch.rows() != 10 || batch.columnCount() != 3 || batch[0].integer(0) != 1 ||
+        selectData["id"].asInteger() != 11)
+        throw Exception("Batch doesn't start from the current row");
+
+    // Small batch is exported to JSON and CSV
+    selectData.close();
+    selectData.open();
+    selectData.fetchBatch(batch, 3);
+
+    Buffer json;
+    batch.exportJSON(json);
+    String expectedJSON = R"([{"id":0,"name":null,"amount":0},{"id":1,"name":"Name, \"one\"","amount":1.5},)"
+                          R"({"id":2,"name":"Name 2","amount":3}])";
+    if (String(json.c_str(), json.bytes()) != expectedJSON)
+        throw Exception("Exported JSON " + String(json.c_str(), json.bytes()) + " doesn't match expected");
+
+    Buffer csv;
+    batch.exportCSV(csv);
+    String expectedCSV = "id,name,amount\n0,,0\n1,\"Name, \"\"one\"\"\",1.5\n2,Name 2,3\n";
+    if (String(csv.c_str(), csv.bytes()) != expectedCSV)
+        throw Exception("Exported CSV " + String(csv.c_str(), csv.bytes()) + " doesn't match expected");
+
+    // The rest of the rows are fetched in batches
+    size_t batchSize = 3000;
+    size_t expectedId = 3;
+    while ((rows = selectData.fetchBatch(batch, batchSize)) != 0) {
+        size_t expectedRows = min(batchSize, count - expectedId);
+        if (rows != expectedRows)
+            throw Exception("Fetched " + to_string(rows) + " rows, expected " + to_string(expectedRows));
+        const auto& id = batch["id"];
+        const auto& name = batch["name"];
+        const auto& amount = batch["amount"];
+        for (size_t row = 0; row < rows; row++, expectedId++) {
+            if (id.integer(row) != (int64_t) expectedId || fabs(amount.number(row) - double(expectedId) * 1.5) > 0.001)
+                throw Exception("Row " + to_string(expectedId) + " doesn't match inserted data");
+            if (expectedId % 10 == 0) {
+                if (!name.isNull(row))
+                    throw Exception("Row " + to_string(expectedId) + " name isn't null");
+            } else if (name.asString(row) != "Name " + to_string(expectedId))
+                throw Exception("Row " + to_string(expectedId) + " name doesn't match inserted data");
+        }
+    }
+    if (expectedId != count || !selectData.eof())
+        throw Exception("Fetched " + to_string(expectedId) + " rows, expected " + to_string(count));
+    selectData.close();
+
+    // Row by row fetch, compared to batch fetch
+    DateTime started("now");
+    int64_t rowTotal = 0;
+    selectData.open();
+    while (!selectData.eof()) {
+        rowTotal += selectData["id"].asInteger();
+        selectData.next();
+    }
+    selectData.close();
+    DateTime ended("now");
+    double rowDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    started = DateTime("now");
+    int64_t batchTotal = 0;
+    selectData.open();
+    while ((rows = selectData.fetchBatch(batch, 1024)) != 0) {
+        const auto& id = batch[0];
+        for (size_t row = 0; row < rows; row++)
+            batchTotal += id.integer(row);
+    }
+    selectData.close();
+    ended = DateTime("now");
+    double batchDurationSec = duration_cast<milliseconds>(ended - started).count() / 1000.0;
+
+    if (rowTotal != batchTotal)
+        throw Exception("Batch fetch result doesn't match row by row fetch");
+
+    COUT(connectionString.driverName() << " row fetch: " << size_t(count / 1E3 / max(rowDurationSec, 0.001))
+         << "K rows/sec, batch fetch: " << size_t(count / 1E3 / max(batchDurationSec, 0.001)) << "K rows/sec" << endl);
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
+
+void DatabaseTests::testAsyncQuery(const DatabaseConnectionString& connectionString)
+{
+    size_t queryCount = 4;
+    DatabaseConnectionPool connectionPool(connectionString.toString(), unsigned(queryCount + 1));
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INT, name VARCHAR(20)");
+
+    int rowCount = 100;
+    auto bulkLoader = db->bulkLoader("gtest_temp_table", Strings("id,name", ","));
+    for (int id = 1; id <= rowCount; id++)
+        bulkLoader->addRow(VariantVector{Variant(id), Variant("Name " + to_string(id))});
+    bulkLoader->finish();
+
+    // Every connection executes its own query, and the results are received concurrently
+    vector<DatabaseConnection> connections;
+    vector<shared_ptr<Query>> queries;
+    vector<future<void>> results;
+    for (size_t i = 0; i < queryCount; i++) {
+        connections.push_back(connectionPool.getConnection());
+        auto query = make_shared<Query>(connections.back(), "SELECT count(*) FROM gtest_temp_table WHERE id > :id");
+        query->param("id") = int(i * 10);
+        results.push_back(query->openAsync());
+        queries.push_back(query);
+    }
+
+    for (size_t i = 0; i < queryCount; i++) {
+        results[i].get();
+        int count = (*queries[i])[uint32_t(0)].asInteger();
+        if (count != rowCount - int(i * 10))
+            throw Exception("Query " + to_string(i) + " returned " + to_string(count) + " rows");
+        queries[i]->close();
+    }
+
+    // Completion callback is executed when the query is opened, the rows are fetched as usual
+    Query selectData(db, "SELECT id, name FROM gtest_temp_table ORDER BY id", false);
+    promise<void> opened;
+    selectData.openAsync([&opened](const exception_ptr& error) {
+        if (error)
+            opened.set_exception(error);
+        else
+            opened.set_value();
+    });
+
+    future<void> openedFuture = opened.get_future();
+    if (openedFuture.wait_for(seconds(10)) != future_status::ready)
+        throw Exception("Asynchronous query isn't complete");
+    openedFuture.get();
+
+    int id = 0;
+    while (!selectData.eof()) {
+        id++;
+        if (selectData["id"].asInteger() != id)
+            throw Exception("row.id " + selectData["id"].asString() + " != " + to_string(id));
+        selectData.next();
+    }
+    selectData.close();
+    if (id != rowCount)
+        throw Exception("Asynchronous query returned " + to_string(id) + " rows");
+
+    // Execution error is delivered by the future
+    Query invalidQuery(db, "SELECT * FROM gtest_no_such_table", false);
+    bool failed = false;
+    try {
+        invalidQuery.openAsync().get();
+    }
+    catch (const Exception&) {
+        failed = true;
+    }
+    if (!failed)
+        throw Exception("Invalid asynchronous query didn't fail");
+
+    if (connectionString.driverName() == "postgresql") {
+        // Query, destroyed before the results are received, is cancelled, and its callback gets an error
+        promise<void> cancelled;
+        {
+            Query slowQuery(db, "SELECT pg_sleep(10)", false);
+            slowQuery.openAsync([&cancelled](const exception_ptr& error) {
+                if (error)
+                    cancelled.set_value();
+                else
+                    cancelled.set_exception(make_exception_ptr(Exception("Destroyed query isn't cancelled")));
+            });
+
+            // Synchronous query can't be executed until asynchronous query is complete
+            Query otherQuery(db, "SELECT 1", false);
+            failed = false;
+            try {
+                otherQuery.open();
+            }
+            catch (const Exception&) {
+                failed = true;
+            }
+            if (!failed)
+                throw Exception("Synchronous query isn't rejected during asynchronous query");
+        }
+
+        future<void> cancelledFuture = cancelled.get_future();
+        if (cancelledFuture.wait_for(seconds(1)) != future_status::ready)
+            throw Exception("Destroyed asynchronous query isn't complete");
+        cancelledFuture.get();
+    }
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.execAsync().get();
+}
+
+static int selectCachedRows(Query& query, int minId)
+{
+    query.param("id") = minId;
+    query.open();
+    int rows = 0;
+    while (!query.eof()) {
+        rows++;
+        query.fetch();
+    }
+    query.close();
+    return rows;
+}
+
+void DatabaseTests::testQueryResultCache(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseConnection db = connectionPool.getConnection();
+
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INT, name VARCHAR(20)");
+
+    Query insertData(db, "INSERT INTO gtest_temp_table VALUES(:id, :name)");
+    for (int id = 1; id <= 10; id++) {
+        insertData.param("id") = id;
+        insertData.param("name") = "Name " + to_string(id);
+        insertData.exec();
+    }
+
+    QueryResultCache& cache = connectionPool.resultCache();
+    cache.clear();
+
+    Query selectData(db, "SELECT id, name FROM gtest_temp_table WHERE id > :id ORDER BY id");
+    selectData.cacheResults(seconds(60), Strings("gtest_temp_table", ","));
+
+    if (selectCachedRows(selectData, 0) != 10)
+        throw Exception("Expected 10 rows");
+
+    // Changes aren't visible until the cached result is invalidated
+    insertData.param("id") = 11;
+    insertData.param("name") = "Name 11";
+    insertData.exec();
+
+    if (selectCachedRows(selectData, 0) != 10)
+        throw Exception("Cached result isn't used");
+
+    // Different parameter value is a different result
+    if (selectCachedRows(selectData, 5) != 6)
+        throw Exception("Expected 6 rows");
+
+    // Cached result is shared with other queries, and its values are restored with their types
+    Query sameQuery(db, "SELECT id, name FROM gtest_temp_table WHERE id > :id ORDER BY id");
+    sameQuery.cacheResults(seconds(60));
+    sameQuery.param("id") = 5;
+    sameQuery.open();
+    if (sameQuery["id"].asInteger() != 6 || sameQuery["name"].asString() != "Name 6")
+        throw Exception("Invalid cached row: " + sameQuery["id"].asString() + ", " + sameQuery["name"].asString());
+    sameQuery.close();
+
+    QueryResultCacheStatistics statistics = cache.statistics();
+    if (statistics.hits != 2 || statistics.misses != 2 || statistics.entries != 2)
+        throw Exception("Expected 2 hits, 2 misses and 2 entries");
+
+    if (cache.invalidate("GTEST_TEMP_TABLE") != 2)
+        throw Exception("Expected 2 invalidated results");
+
+    if (selectCachedRows(selectData, 0) != 11)
+        throw Exception("Invalidated result is used");
+
+    // Expired result is read from the database again
+    Query expiringQuery(db, "SELECT count(*) FROM gtest_temp_table");
+    expiringQuery.cacheResults(milliseconds(50));
+    expiringQuery.open();
+    expiringQuery.close();
+
+    insertData.param("id") = 12;
+    insertData.param("name") = "Name 12";
+    insertData.exec();
+
+    this_thread::sleep_for(milliseconds(100));
+    expiringQuery.open();
+    int count = expiringQuery[uint32_t(0)].asInteger();
+    expiringQuery.close();
+    if (count != 12)
+        throw Exception("Expired result is used");
+
+    statistics = cache.statistics();
+    if (statistics.invalidations != 2 || statistics.hitRate() <= 0 || statistics.memorySize == 0)
+        throw Exception("Invalid cache statistics");
+
+    // Result that exceeds cache max size isn't cached, all its rows are returned
+    auto bulkLoader = db->bulkLoader("gtest_temp_table", Strings("id,name", ","));
+    for (int id = 100; id < 3100; id++)
+        bulkLoader->addRow(VariantVector{Variant(id), Variant("Name " + to_string(id))});
+    bulkLoader->finish();
+
+    cache.setMaxSize(16 * 1024);
+    size_t entries = cache.statistics().entries;
+
+    Query largeQuery(db, "SELECT id, name FROM gtest_temp_table ORDER BY id");
+    largeQuery.cacheResults(seconds(60));
+    largeQuery.open();
+    int rows = 0;
+    int lastId = 0;
+    while (!largeQuery.eof()) {
+        int id = largeQuery["id"].asInteger();
+        if (id <= lastId)
+            throw Exception("Invalid row order: " + to_string(id) + " after " + to_string(lastId));
+        lastId = id;
+        rows++;
+        largeQuery.fetch();
+    }
+    largeQuery.close();
+    if (rows != 3012 || cache.statistics().entries != entries)
+        throw Exception("Expected 3012 not cached rows, got " + to_string(rows));
+    cache.setMaxSize(QueryResultCache::DefaultMaxSize);
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
+
+namespace {
+
+/**
+ * Log engine that keeps messages in memory
+ */
+class MemoryLogEngine : public LogEngine
+{
+    mutable mutex   m_mutex;
+    Strings         m_messages;
+
+public:
+    MemoryLogEngine() : LogEngine("MemoryLogEngine") {}
+
+    ~MemoryLogEngine() override
+    {
+        terminate();
+        join();
+    }
+
+    void saveMessage(const Logger::Message* message) override
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_messages.push_back(message->message);
+    }
+
+    Strings messages() const
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_messages;
+    }
+};
+
+}
+
+void DatabaseTests::testDatabaseStatistics(const DatabaseConnectionString& connectionString)
+{
+    DatabaseConnectionPool connectionPool(connectionString.toString());
+    DatabaseStatistics& statistics = connectionPool.statistics();
+    statistics.reset();
+
+    MemoryLogEngine slowQueryLog;
+    statistics.setSlowQueryLog(&slowQueryLog, microseconds(1));
+
+    DatabaseConnection db = connectionPool.getConnection();
+    db->open();
+    recreateTable(db, "gtest_temp_table", "id INT, name VARCHAR(20)");
+
+    Query insertData(db, "INSERT INTO gtest_temp_table VALUES(:id, :name)");
+    for (int id = 1; id <= 10; id++) {
+        insertData.param("id") = id;
+        insertData.param("name") = "Name " + to_string(id);
+        insertData.exec();
+    }
+
+    Query selectData(db, "SELECT id, name FROM gtest_temp_table WHERE id > :id ORDER BY id");
+    for (int minId = 0; minId < 3; minId++) {
+        selectData.param("id") = minId;
+        selectData.open();
+        while (!selectData.eof())
+            selectData.fetch();
+        selectData.close();
+    }
+
+    RecordBatch batch;
+    selectData.param("id") = 5;
+    selectData.open();
+    selectData.fetchBatch(batch, 100);
+    selectData.close();
+
+    SStatementStatistics insertStatistics = statistics.statement(insertData.sql());
+    if (insertStatistics->execute.count() != 10 || insertStatistics->rows != 0)
+        throw Exception("Expected 10 insert executions, without rows");
+
+    SStatementStatistics selectStatistics = statistics.statement(selectData.sql());
+    if (selectStatistics->execute.count() != 4)
+        throw Exception("Expected 4 select executions, got " + to_string(selectStatistics->execute.count()));
+    if (selectStatistics->rows != 10 + 9 + 8 + 5)
+        throw Exception("Expected 32 rows, got " + to_string(selectStatistics->rows));
+    if (selectStatistics->prepare.count() == 0 || selectStatistics->fetch.count() == 0)
+        throw Exception("Prepare and fetch times aren't recorded");
+
+    Query invalidQuery(db, "SELECT * FROM gtest_no_such_table", false);
+    try {
+        invalidQuery.open();
+    }
+    catch (const Exception&) {
+        // Expected
+    }
+    if (statistics.statement(invalidQuery.sql())->errors != 1)
+        throw Exception("Failed execution isn't counted");
+
+    if (statistics.poolWait().count() == 0)
+        throw Exception("Pool wait time isn't recorded");
+
+    if (statistics.slowQueries() == 0)
+        throw Exception("Slow queries aren't counted");
+
+    for (int i = 0; i < 100 && slowQueryLog.messages().empty(); i++)
+        this_thread::sleep_for(milliseconds(20));
+    if (slowQueryLog.messages().empty() || slowQueryLog.messages()[0].find("Slow query") == string::npos)
+        throw Exception("Slow query isn't logged");
+
+    statistics.setSlowQueryLog(nullptr, microseconds(0));
+
+    Query dropTable(db, "DROP TABLE gtest_temp_table");
+    dropTable.exec();
+}
@@ -29,12 +29,14 @@
 #include <sptk5/cutils>
 #include <sptk5/db/PoolDatabaseConnection.h>
 #include <sptk5/db/Query.h>
+#include <sptk5/db/BulkLoader.h>
+#include <sptk5/db/QueryBatch.h>
 
 using namespace std;
 using namespace sptk;
 
 PoolDatabaseConnection::PoolDatabaseConnection(const String& connectionString, DatabaseConnectionType connectionType)
-: m_connString(connectionString), m_connType(connectionType)
+: m_connString(connectionString), m_connType(connectionType), m_statementCacheSize(DefaultStatementCacheSize)
 {
     m_inTransaction = false;
 }
@@ -44,6 +46,12 @@ PoolDatabaseConnection::~PoolDatabaseConnection()
     disconnectAllQueries();
 }
 
+void PoolDatabaseConnection::releaseQueryStatements()
+{
+    for (auto* query: m_queryList)
+        query->closeQuery(true);
+}
+
 void PoolDatabaseConnection::disconnectAllQueries()
 {
     for (auto* query: m_queryList) {
@@ -57,6 +65,155 @@ void PoolDatabaseConnection::disconnectAllQueries()
     m_queryList.clear();
 }
 
+void* PoolDatabaseConnection::takeCachedStatement(const String& cacheKey)
+{
+    lock_guard<mutex> lock(m_statementCacheMutex);
+
+    if (m_statementCacheSize == 0)
+        return nullptr;
+
+    auto itor = m_statementCacheIndex.find(cacheKey);
+    if (itor == m_statementCacheIndex.end()) {
+        m_statementCacheStatistics.misses++;
+        return nullptr;
+    }
+
+    void* statement = itor->second->second;
+    m_statementCache.erase(itor->second);
+    m_statementCacheIndex.erase(itor);
+    m_statementCacheStatistics.hits++;
+
+    return statement;
+}
+
+bool PoolDatabaseConnection::cacheStatement(const String& cacheKey, void* statement)
+{
+    vector<void*> released;
+    {
+        lock_guard<mutex> lock(m_statementCacheMutex);
+
+        if (m_statementCacheSize == 0)
+            return false;
+
+        m_statementCache.emplace_front(cacheKey, statement);
+        m_statementCacheIndex.emplace(cacheKey, m_statementCache.begin());
+        trimStatementCache(released);
+    }
+
+    for (auto* releasedStatement: released)
+        releaseCachedStatement(releasedStatement);
+
+    return true;
+}
+
+void PoolDatabaseConnection::trimStatementCache(vector<void*>& released)
+{
+    while (m_statementCache.size() > m_statementCacheSize) {
+        auto last = prev(m_statementCache.end());
+        auto range = m_statementCacheIndex.equal_range(last->first);
+        for (auto itor = range.first; itor != range.second; ++itor) {
+            if (itor->second == last) {
+                m_statementCacheIndex.erase(itor);
+                break;
+            }
+        }
+        released.push_back(last->second);
+        m_statementCache.erase(last);
+        m_statementCacheStatistics.evictions++;
+    }
+}
+
+void PoolDatabaseConnection::releaseCachedStatement(void* /*statement*/)
+{
+    notImplemented("releaseCachedStatement");
+}
+
+void PoolDatabaseConnection::clearStatementCache()
+{
+    CachedStatementList statements;
+    {
+        lock_guard<mutex> lock(m_statementCacheMutex);
+        m_statementCacheIndex.clear();
+        statements.swap(m_statementCache);
+    }
+
+    for (auto& statement: statements)
+        releaseCachedStatement(statement.second);
+}
+
+void PoolDatabaseConnection::setStatementCacheSize(size_t size)
+{
+    vector<void*> released;
+    {
+        lock_guard<mutex> lock(m_statementCacheMutex);
+        m_statementCacheSize = size;
+        trimStatementCache(released);
+    }
+
+    for (auto* releasedStatement: released)
+        releaseCachedStatement(releasedStatement);
+}
+
+size_t PoolDatabaseConnection::statementCacheSize() const
+{
+    lock_guard<mutex> lock(m_statementCacheMutex);
+    return m_statementCacheSize;
+}
+
+size_t PoolDatabaseConnection::cachedStatements() const
+{
+    lock_guard<mutex> lock(m_statementCacheMutex);
+    return m_statementCache.size();
+}
+
+StatementCacheStatistics PoolDatabaseConnection::statementCacheStatistics() const
+{
+    lock_guard<mutex> lock(m_statementCacheMutex);
+    return m_statementCacheStatistics;
+}
+
+void PoolDatabaseConnection::setResultCache(const SQueryResultCache& cache)
+{
+    m_resultCache = cache;
+}
+
+SQueryResultCache PoolDatabaseConnection::resultCache() const
+{
+    return m_resultCache;
+}
+
+void PoolDatabaseConnection::setStatistics(const SDatabaseStatistics& statistics)
+{
+    lock_guard<mutex> lock(m_statementCacheMutex);
+    m_statistics = statistics;
+    m_statementStatistics.clear();
+}
+
+SStatementStatistics PoolDatabaseConnection::statementStatistics(const String& sql)
+{
+    lock_guard<mutex> lock(m_statementCacheMutex);
+
+    if (!m_statistics)
+        return nullptr;
+
+    uint64_t generation = m_statistics->generation();
+    if (m_statementStatisticsGeneration != generation) {
+        m_statementStatistics.clear();
+        m_statementStatisticsGeneration = generation;
+    }
+
+    auto itor = m_statementStatistics.find(sql);
+    if (itor != m_statementStatistics.end())
+        return itor->second;
+
+    auto statement = m_statistics->statement(sql);
+    // SQL with literal values may be different for every query, so the cache is limited
+    if (m_statementStatistics.size() < DatabaseStatistics::DefaultMaxStatements)
+        m_statementStatistics[sql] = statement;
+
+    return statement;
+}
+
 bool PoolDatabaseConnection::getInTransaction() const
 {
     return m_inTransaction;
@@ -75,6 +232,7 @@ bool PoolDatabaseConnection::linkQuery(Query *q)
 
 bool PoolDatabaseConnection::unlinkQuery(Query *q)
 {
+    queryCancelAsync(q);
     m_queryList.erase(q);
     return true;
 }
@@ -115,6 +273,18 @@ bool PoolDatabaseConnection::active() const
     return true;
 }
 
+bool PoolDatabaseConnection::validate() const
+{
+    return active();
+}
+
+void PoolDatabaseConnection::resetSession()
+{
+    if (m_inTransaction && active())
+        rollbackTransaction();
+    m_inTransaction = false;
+}
+
 void PoolDatabaseConnection::beginTransaction()
 {
     driverBeginTransaction();
@@ -151,14 +321,45 @@ void PoolDatabaseConnection::driverEndTransaction(bool /*commit*/)
 void PoolDatabaseConnection::_bulkInsert(
         const String& tableName, const Strings& columnNames, const Strings& data, const String& /*format*/)
 {
-    Query insertQuery(this,
-                      "INSERT INTO " + tableName + "(" + columnNames.join(",") +
-                      ") VALUES (:" + columnNames.join(",:") + ")");
+    auto bulkLoader = _bulkLoader(tableName, columnNames);
+
+    VariantVector rowData(columnNames.size());
     for (auto& row: data) {
-        Strings rowData(row,"\t");
-        for (unsigned i = 0; i < columnNames.size(); i++)
-            insertQuery.param(i).setString(rowData[i]);
-        insertQuery.exec();
+        size_t column = 0;
+        size_t start = 0;
+        for (; column < rowData.size(); column++) {
+            size_t end = row.find('\t', start);
+            if (end == string::npos)
+                end = row.length();
+            if (start < row.length())
+                rowData[column] = row.substr(start, end - start);
+            else
+                rowData[column] = "";
+            start = end + 1;
+        }
+        bulkLoader->addRow(rowData);
+    }
+
+    bulkLoader->finish();
+}
+
+SBulkLoader PoolDatabaseConnection::_bulkLoader(const String& tableName, const Strings& columnNames)
+{
+    return make_shared<BulkLoader>(this, tableName, columnNames);
+}
+
+void PoolDatabaseConnection::_executeBatch(QueryBatch& batch)
+{
+    for (auto& entry: batch) {
+        try {
+            entry.bindParameters();
+            entry.query()->exec();
+            entry.query()->close();
+            entry.setResult();
+        }
+        catch (const Exception& e) {
+            entry.setResult(e.what());
+        }
     }
 }
 
@@ -220,6 +421,21 @@ void PoolDatabaseConnection_QueryMethods::queryPrepare(Query*)
     notImplemented("queryPrepare");
 }
 
+void PoolDatabaseConnection_QueryMethods::prepareQuery(Query* query)
+{
+    StatementStatistics* statistics = query->statementStatistics();
+    if (statistics == nullptr) {
+        queryPrepare(query);
+        return;
+    }
+
+    auto started = chrono::steady_clock::now();
+    queryPrepare(query);
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started);
+    statistics->prepare.record(uint64_t(elapsed.count()));
+    query->m_prepareTime += elapsed;
+}
+
 void PoolDatabaseConnection_QueryMethods::queryUnprepare(Query *query)
 {
     queryFreeStmt(query);
@@ -266,6 +482,33 @@ void PoolDatabaseConnection_QueryMethods::queryFetch(Query*)
     notImplemented("queryFetch");
 }
 
+void PoolDatabaseConnection_QueryMethods::queryOpenAsync(Query* query, const AsyncQueryCallback& callback)
+{
+    query->openDatabaseQuery();
+    callback(nullptr);
+}
+
+void PoolDatabaseConnection_QueryMethods::queryCancelAsync(Query*)
+{
+    // Default queryOpenAsync() is synchronous
+}
+
+size_t PoolDatabaseConnection_QueryMethods::queryFetchBatch(Query* query, RecordBatch& batch, size_t maxRows)
+{
+    FieldList& fields = query->fields();
+    uint32_t columnCount = fields.size();
+
+    size_t rows = 0;
+    while (rows < maxRows && !query->eof()) {
+        for (uint32_t column = 0; column < columnCount; column++)
+            batch[column].append(fields[column]);
+        rows++;
+        queryFetch(query);
+    }
+
+    return rows;
+}
+
 void PoolDatabaseConnection_QueryMethods::notImplemented(const String& methodName) const
 {
     throw DatabaseException("Method '" + methodName + "' is not supported by this database driver.");
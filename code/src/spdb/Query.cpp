@@ -27,6 +27,7 @@
 */
 
 #include <sptk5/cutils>
+#include <sptk5/db/DatabaseField.h>
 #include <sptk5/db/PoolDatabaseConnection.h>
 #include <sptk5/db/Query.h>
 
@@ -62,6 +63,8 @@ void Query_StatementManagement::closeStmt()
 
 void Query_StatementManagement::closeQuery(bool releaseStatement)
 {
+    if (database() != nullptr)
+        database()->queryCancelAsync((Query*)this);
     setActive(false);
     setEof(true);
     if (statement() !=nullptr) {
@@ -79,7 +82,7 @@ void Query_StatementManagement::prepare()
     if (prepared())
         return;
     if (database() != nullptr && statement() !=nullptr) {
-        database()->queryPrepare((Query*)this);
+        database()->prepareQuery((Query*)this);
         setPrepared(true);
     }
 }
@@ -286,11 +289,14 @@ void Query::sql(const String& _sql)
             m_params.remove(uint32_t(i));
 
     if (getSQL() != sql) {
+        database()->queryCancelAsync(this);
         setSQL(sql);
         if (active())
             close();
         setPrepared(false);
         m_fields.clear();
+        m_fieldsFromCache = false;
+        m_statementStatistics.reset();
     }
 }
 
@@ -299,6 +305,89 @@ bool Query::open()
     if (database() == nullptr)
         throw DatabaseException("Query is not connected to the database", __FILE__, __LINE__, sql());
 
+    QueryResultCache* cache = resultCache();
+    if (cache == nullptr) {
+        openStatement();
+        return true;
+    }
+
+    if (active())
+        return true;
+
+    String key = resultCacheKey();
+    SRecordBatch result = cache->find(key);
+    if (result) {
+        openCachedResult(result);
+        return true;
+    }
+
+    if (m_fieldsFromCache) {
+        m_fields.clear();
+        m_fieldsFromCache = false;
+    }
+
+    openStatement();
+    if (active())
+        cacheResult(*cache, key);
+
+    return true;
+}
+
+void Query::openStatement()
+{
+    StatementStatistics* statistics = statementStatistics();
+    if (statistics == nullptr) {
+        openDatabaseQuery();
+        return;
+    }
+
+    executionStarted();
+    try {
+        openDatabaseQuery();
+    }
+    catch (const Exception&) {
+        executionCompleted(*statistics, true);
+        throw;
+    }
+    executionCompleted(*statistics, false);
+}
+
+StatementStatistics* Query::statementStatistics()
+{
+    const SDatabaseStatistics& statistics = database()->statistics();
+    if (!statistics)
+        return nullptr;
+
+    if (m_databaseStatistics != statistics || !m_statementStatistics) {
+        m_databaseStatistics = statistics;
+        m_statementStatistics = database()->statementStatistics(sql());
+    }
+
+    return m_statementStatistics.get();
+}
+
+void Query::executionStarted()
+{
+    m_prepareTime = chrono::microseconds(0);
+    m_executeStarted = chrono::steady_clock::now();
+}
+
+void Query::executionCompleted(StatementStatistics& statistics, bool failed)
+{
+    if (failed) {
+        ++statistics.errors;
+        return;
+    }
+
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_executeStarted);
+    statistics.execute.record(uint64_t((elapsed - m_prepareTime).count()));
+    if (active() && !eof())
+        ++statistics.rows;
+    m_databaseStatistics->logSlowQuery(statistics, elapsed);
+}
+
+void Query::openDatabaseQuery()
+{
     try {
         database()->queryOpen(this);
     }
@@ -309,8 +398,237 @@ bool Query::open()
         database()->open();
         database()->queryOpen(this);
     }
+}
 
-    return true;
+void Query::cacheResults(std::chrono::milliseconds ttl, const Strings& tables)
+{
+    m_cacheTTL = ttl;
+    m_cacheTables = tables;
+}
+
+QueryResultCache* Query::resultCache() const
+{
+    if (m_cacheTTL.count() <= 0 || database() == nullptr)
+        return nullptr;
+    return database()->resultCache().get();
+}
+
+String Query::resultCacheKey() const
+{
+    // Values are serialized exactly, with their types and sizes, so different parameters never produce the same key
+    String key(sql());
+    for (uint32_t i = 0; i < m_params.size(); i++) {
+        const QueryParameter& parameter = param(i);
+        key += '\0';
+        key += parameter.name() + ":" + int2string(parameter.dataType()) + "=";
+        if (parameter.isNull()) {
+            key += "null";
+            continue;
+        }
+        switch (parameter.dataType()) {
+            case VAR_BOOL:
+            case VAR_INT:
+                key += int2string(parameter.getInteger());
+                break;
+            case VAR_INT64:
+                key += int2string(parameter.getInt64());
+                break;
+            case VAR_FLOAT: {
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "%.17g", parameter.getFloat());
+                key += buffer;
+                break;
+            }
+            case VAR_DATE:
+            case VAR_DATE_TIME:
+                key += int2string(
+                    (int64_t) chrono::duration_cast<chrono::microseconds>(
+                        parameter.getDateTime().timePoint().time_since_epoch()).count());
+                break;
+            case VAR_STRING:
+            case VAR_TEXT:
+            case VAR_BUFFER:
+                key += int2string((uint64_t) parameter.dataSize()) + ":";
+                key.append(parameter.getBuffer(), parameter.dataSize());
+                break;
+            default:
+                key += parameter.asString();
+                break;
+        }
+    }
+    return key;
+}
+
+void Query::cacheResult(QueryResultCache& cache, const String& key)
+{
+    auto result = make_shared<RecordBatch>();
+    fetchBatch(*result, 0);
+
+    size_t maxSize = cache.maxSize();
+    while (!eof()) {
+        fetchRows(*result, CacheFetchRows);
+        if (result->memorySize() > maxSize) {
+            // Result is too large to cache: return the rows that are already fetched,
+            // including the current row, and then continue reading from the database
+            if (!eof()) {
+                for (uint32_t column = 0; column < m_fields.size(); column++)
+                    (*result)[column].append(m_fields[column]);
+            }
+            bool moreRows = !eof();
+            openCachedResult(result);
+            m_continueAfterCachedResult = moreRows;
+            return;
+        }
+    }
+
+    result->shrinkToFit();
+    closeQuery();
+    cache.insert(key, result, m_cacheTTL, m_cacheTables);
+    openCachedResult(result);
+}
+
+void Query::openCachedResult(const SRecordBatch& result)
+{
+    m_cachedResult = result;
+    m_cachedRow = 0;
+    m_continueAfterCachedResult = false;
+
+    bool sameColumns = result->columnCount() == m_fields.size();
+    for (uint32_t column = 0; sameColumns && column < m_fields.size(); column++)
+        sameColumns = (*result)[column].name() == m_fields[column].fieldName();
+
+    if (!sameColumns) {
+        m_fields.clear();
+        for (uint32_t column = 0; column < result->columnCount(); column++) {
+            const RecordBatch::Column& values = (*result)[column];
+            VariantType type = values.type() == VAR_NONE ? VAR_STRING : values.type();
+            m_fields.push_back(new DatabaseField(values.name(), int(column), 0, type, 0));
+        }
+        m_fieldsFromCache = true;
+    }
+
+    setActive(true);
+    setEof(result->rows() == 0);
+    if (!eof())
+        readCachedRow();
+}
+
+void Query::readCachedRow()
+{
+    const RecordBatch& result = *m_cachedResult;
+    for (uint32_t column = 0; column < m_fields.size(); column++) {
+        Field& field = m_fields[column];
+        const RecordBatch::Column& values = result[column];
+        if (values.isNull(m_cachedRow)) {
+            field.setNull(VAR_NONE);
+            continue;
+        }
+        switch (values.type()) {
+            case VAR_BOOL:
+                field.setBool(values.integer(m_cachedRow) != 0);
+                break;
+            case VAR_INT:
+                field.setInteger(int32_t(values.integer(m_cachedRow)));
+                break;
+            case VAR_INT64:
+                field.setInt64(values.integer(m_cachedRow));
+                break;
+            case VAR_FLOAT:
+            case VAR_MONEY:
+                field.setFloat(values.number(m_cachedRow));
+                break;
+            case VAR_DATE:
+                field.setDateTime(values.dateTime(m_cachedRow), true);
+                break;
+            case VAR_DATE_TIME:
+                field.setDateTime(values.dateTime(m_cachedRow), false);
+                break;
+            default:
+                field.setBuffer(values.string(m_cachedRow), values.length(m_cachedRow),
+                                values.type() == VAR_NONE ? VAR_STRING : values.type());
+                break;
+        }
+    }
+}
+
+future<void> Query::openAsync()
+{
+    auto completed = make_shared<promise<void>>();
+    try {
+        openAsync([completed](const exception_ptr& error) {
+            if (error)
+                completed->set_exception(error);
+            else
+                completed->set_value();
+        });
+    }
+    catch (const Exception&) {
+        completed->set_exception(current_exception());
+    }
+    return completed->get_future();
+}
+
+void Query::openAsync(const AsyncQueryCallback& callback)
+{
+    if (database() == nullptr)
+        throw DatabaseException("Query is not connected to the database", __FILE__, __LINE__, sql());
+
+    QueryResultCache* cache = resultCache();
+    String key;
+    if (cache != nullptr) {
+        if (active()) {
+            callback(nullptr);
+            return;
+        }
+
+        // Cached results are served without sending the query, the rows of executed query are cached on completion
+        key = resultCacheKey();
+        SRecordBatch result = cache->find(key);
+        if (result) {
+            openCachedResult(result);
+            callback(nullptr);
+            return;
+        }
+
+        if (m_fieldsFromCache) {
+            m_fields.clear();
+            m_fieldsFromCache = false;
+        }
+    }
+
+    StatementStatistics* statistics = statementStatistics();
+    if (cache == nullptr && statistics == nullptr) {
+        database()->queryOpenAsync(this, callback);
+        return;
+    }
+
+    SStatementStatistics statementStatistics = m_statementStatistics;
+    if (statistics != nullptr)
+        executionStarted();
+
+    try {
+        database()->queryOpenAsync(this, [this, cache, key, statementStatistics, callback](const exception_ptr& error) {
+            if (statementStatistics)
+                executionCompleted(*statementStatistics, error != nullptr);
+            if (error || cache == nullptr || !active()) {
+                callback(error);
+                return;
+            }
+            try {
+                cacheResult(*cache, key);
+            }
+            catch (const Exception&) {
+                callback(current_exception());
+                return;
+            }
+            callback(nullptr);
+        });
+    }
+    catch (const Exception&) {
+        if (statistics != nullptr)
+            ++statistics->errors;
+        throw;
+    }
 }
 
 void Query::fetch()
@@ -318,7 +636,84 @@ void Query::fetch()
     if (database() == nullptr || !active())
         throw DatabaseException("Dataset isn't open", __FILE__, __LINE__, sql());
 
+    if (m_cachedResult) {
+        m_cachedRow++;
+        if (m_cachedRow < m_cachedResult->rows()) {
+            readCachedRow();
+            return;
+        }
+        if (!m_continueAfterCachedResult) {
+            setEof(true);
+            return;
+        }
+        // The rest of the rows are read from the database
+        m_cachedResult.reset();
+        m_continueAfterCachedResult = false;
+    }
+
+    StatementStatistics* statistics = statementStatistics();
+    if (statistics == nullptr) {
+        database()->queryFetch(this);
+        return;
+    }
+
+    auto started = chrono::steady_clock::now();
     database()->queryFetch(this);
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started);
+    statistics->fetch.record(uint64_t(elapsed.count()));
+    if (!eof())
+        ++statistics->rows;
+}
+
+size_t Query::fetchBatch(RecordBatch& batch, size_t maxRows)
+{
+    if (database() == nullptr || !active())
+        throw DatabaseException("Dataset isn't open", __FILE__, __LINE__, sql());
+
+    bool sameColumns = batch.columnCount() == m_fields.size();
+    for (uint32_t column = 0; sameColumns && column < m_fields.size(); column++)
+        sameColumns = batch[column].name() == m_fields[column].fieldName();
+
+    if (sameColumns)
+        batch.clear();
+    else {
+        batch.reset();
+        for (uint32_t column = 0; column < m_fields.size(); column++)
+            batch.addColumn(m_fields[column].fieldName());
+    }
+
+    if (maxRows == 0 || eof() || m_fields.size() == 0)
+        return 0;
+
+    if (m_cachedResult) {
+        size_t rows = 0;
+        while (rows < maxRows && !eof()) {
+            for (uint32_t column = 0; column < m_fields.size(); column++)
+                batch[column].append(m_fields[column]);
+            rows++;
+            fetch();
+        }
+        return rows;
+    }
+
+    return fetchRows(batch, maxRows);
+}
+
+size_t Query::fetchRows(RecordBatch& batch, size_t maxRows)
+{
+    StatementStatistics* statistics = statementStatistics();
+    if (statistics == nullptr)
+        return database()->queryFetchBatch(this, batch, maxRows);
+
+    // The first row of the batch is already counted, when it became the current row
+    auto started = chrono::steady_clock::now();
+    size_t rows = database()->queryFetchBatch(this, batch, maxRows);
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started);
+    statistics->fetch.record(uint64_t(elapsed.count()));
+    if (rows > 0)
+        statistics->rows += rows - 1 + (eof() ? 0 : 1);
+
+    return rows;
 }
 
 bool Query::readField(const char*, Variant&)
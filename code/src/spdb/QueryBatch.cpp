@@ -0,0 +1,68 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       QueryBatch.cpp - description                           ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <sptk5/db/QueryBatch.h>
+#include <sptk5/db/Query.h>
+
+using namespace std;
+using namespace sptk;
+
+void QueryBatch::Entry::bindParameters() const
+{
+    for (uint32_t i = 0; i < m_params.size(); i++)
+        m_query->param(i) = m_params[i];
+}
+
+void QueryBatch::add(Query& query)
+{
+    if (query.database() != m_db)
+        throw DatabaseException("Query isn't connected to the batch database connection", __FILE__, __LINE__,
+                                query.sql());
+
+    VariantVector params;
+    params.reserve(query.params().size());
+    for (uint32_t i = 0; i < query.params().size(); i++)
+        params.push_back(query.param(i));
+
+    m_entries.emplace_back(&query, move(params));
+}
+
+size_t QueryBatch::execute()
+{
+    for (auto& entry: m_entries)
+        entry.resetResult();
+
+    m_db->executeBatch(*this);
+
+    size_t failed = 0;
+    for (auto& entry: m_entries) {
+        if (entry.failed())
+            failed++;
+    }
+    return failed;
+}
@@ -0,0 +1,162 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       QueryResultCache.cpp - description                     ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <sptk5/db/QueryResultCache.h>
+
+using namespace std;
+using namespace sptk;
+using namespace chrono;
+
+QueryResultCache::QueryResultCache(size_t maxSize)
+: m_maxSize(maxSize)
+{
+}
+
+void QueryResultCache::erase(EntryList::iterator itor)
+{
+    for (auto& table: itor->tables) {
+        auto ttor = m_tableKeys.find(table);
+        if (ttor == m_tableKeys.end())
+            continue;
+        ttor->second.erase(itor->key);
+        if (ttor->second.empty())
+            m_tableKeys.erase(ttor);
+    }
+
+    m_statistics.memorySize -= itor->size;
+    m_statistics.entries--;
+    m_index.erase(itor->key);
+    m_entries.erase(itor);
+}
+
+void QueryResultCache::trim()
+{
+    while (m_statistics.memorySize > m_maxSize && !m_entries.empty()) {
+        erase(prev(m_entries.end()));
+        m_statistics.evictions++;
+    }
+}
+
+SRecordBatch QueryResultCache::find(const String& key)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto itor = m_index.find(key);
+    if (itor == m_index.end()) {
+        m_statistics.misses++;
+        return nullptr;
+    }
+
+    auto entry = itor->second;
+    if (entry->expires <= steady_clock::now()) {
+        erase(entry);
+        m_statistics.misses++;
+        return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    m_statistics.hits++;
+
+    return entry->result;
+}
+
+void QueryResultCache::insert(const String& key, const SRecordBatch& result, milliseconds ttl, const Strings& tables)
+{
+    size_t size = result->memorySize() + key.capacity();
+
+    lock_guard<mutex> lock(m_mutex);
+
+    auto itor = m_index.find(key);
+    if (itor != m_index.end())
+        erase(itor->second);
+
+    if (size > m_maxSize || ttl.count() <= 0)
+        return;
+
+    m_entries.push_front(Entry{key, result, steady_clock::now() + ttl, tables, size});
+    m_index[key] = m_entries.begin();
+    for (auto& table: tables)
+        m_tableKeys[table].insert(key);
+
+    m_statistics.memorySize += size;
+    m_statistics.entries++;
+
+    trim();
+}
+
+size_t QueryResultCache::invalidate(const String& tableName)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto ttor = m_tableKeys.find(tableName);
+    if (ttor == m_tableKeys.end())
+        return 0;
+
+    // Erasing an entry modifies the table keys, so the keys are copied
+    set<String> keys = ttor->second;
+    for (auto& key: keys) {
+        auto itor = m_index.find(key);
+        if (itor != m_index.end())
+            erase(itor->second);
+    }
+
+    m_statistics.invalidations += keys.size();
+
+    return keys.size();
+}
+
+void QueryResultCache::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_entries.clear();
+    m_index.clear();
+    m_tableKeys.clear();
+    m_statistics.entries = 0;
+    m_statistics.memorySize = 0;
+}
+
+void QueryResultCache::setMaxSize(size_t maxSize)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    m_maxSize = maxSize;
+    trim();
+}
+
+size_t QueryResultCache::maxSize() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_maxSize;
+}
+
+QueryResultCacheStatistics QueryResultCache::statistics() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_statistics;
+}
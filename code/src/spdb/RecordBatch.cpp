@@ -0,0 +1,559 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       RecordBatch.cpp - description                          ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <sptk5/db/RecordBatch.h>
+#include <sptk5/Base64.h>
+#include <sptk5/Exception.h>
+#include <charconv>
+#include <cmath>
+
+using namespace std;
+using namespace sptk;
+
+RecordBatch::Column::Column(const String& name, VariantType type)
+: m_name(name)
+{
+    if (type != VAR_NONE)
+        this->type(type);
+}
+
+void RecordBatch::Column::type(VariantType type)
+{
+    m_integers.clear();
+    m_floats.clear();
+    m_offsets.clear();
+
+    switch (type) {
+        case VAR_NONE:
+            m_storage = NO_STORAGE;
+            break;
+
+        case VAR_INT:
+        case VAR_INT64:
+        case VAR_BOOL:
+        case VAR_DATE:
+        case VAR_DATE_TIME:
+            m_storage = INTEGER_STORAGE;
+            m_integers.resize(m_size);
+            break;
+
+        case VAR_FLOAT:
+        case VAR_MONEY:
+            m_storage = FLOAT_STORAGE;
+            m_floats.resize(m_size);
+            break;
+
+        case VAR_STRING:
+        case VAR_TEXT:
+        case VAR_BUFFER:
+            m_storage = STRING_STORAGE;
+            break;
+
+        default:
+            // Not supported types are stored as strings
+            type = VAR_STRING;
+            m_storage = STRING_STORAGE;
+            break;
+    }
+
+    m_type = type;
+    if (m_storage == STRING_STORAGE)
+        m_offsets.resize(m_size + 1, m_arena.bytes());
+    else
+        m_offsets.resize(1, 0);
+}
+
+void RecordBatch::Column::append(const Variant& value)
+{
+    if (value.isNull()) {
+        appendNull();
+        return;
+    }
+
+    if (m_storage == NO_STORAGE)
+        type(value.dataType());
+
+    appendConverted(value);
+}
+
+void RecordBatch::Column::appendConverted(const Variant& value)
+{
+    switch (m_storage) {
+        case INTEGER_STORAGE:
+            if (m_type == VAR_DATE || m_type == VAR_DATE_TIME)
+                m_integers.push_back(dateTimeToMicroseconds(value.asDateTime()));
+            else if (m_type == VAR_BOOL)
+                m_integers.push_back(value.asBool() ? 1 : 0);
+            else
+                m_integers.push_back(value.asInt64());
+            break;
+
+        case FLOAT_STORAGE:
+            m_floats.push_back(value.asFloat());
+            break;
+
+        default:
+            if ((value.dataType() & (VAR_STRING | VAR_TEXT | VAR_BUFFER)) != 0) {
+                if (value.dataSize() != 0)
+                    m_arena.append(value.getBuffer(), value.dataSize());
+            } else {
+                String text = value.asString();
+                if (!text.empty())
+                    m_arena.append(text);
+            }
+            m_offsets.push_back(m_arena.bytes());
+            break;
+    }
+
+    addNullBit(false);
+}
+
+void RecordBatch::Column::clear()
+{
+    m_size = 0;
+    m_nulls.clear();
+    m_integers.clear();
+    m_floats.clear();
+    m_offsets.resize(1);
+    m_offsets[0] = 0;
+    m_arena.reset();
+}
+
+void RecordBatch::Column::reserve(size_t rows)
+{
+    m_nulls.reserve(rows / 8 + 1);
+    switch (m_storage) {
+        case INTEGER_STORAGE:
+            m_integers.reserve(rows);
+            break;
+        case FLOAT_STORAGE:
+            m_floats.reserve(rows);
+            break;
+        case STRING_STORAGE:
+            m_offsets.reserve(rows + 1);
+            break;
+        default:
+            break;
+    }
+}
+
+void RecordBatch::Column::shrinkToFit()
+{
+    m_nulls.shrink_to_fit();
+    m_integers.shrink_to_fit();
+    m_floats.shrink_to_fit();
+    m_offsets.shrink_to_fit();
+    if (m_arena.capacity() > m_arena.bytes() + 1)
+        m_arena = Buffer(m_arena.data(), m_arena.bytes());
+}
+
+size_t RecordBatch::Column::memorySize() const
+{
+    return sizeof(Column) + m_name.capacity() + m_nulls.capacity() + m_integers.capacity() * sizeof(int64_t) +
+           m_floats.capacity() * sizeof(double) + m_offsets.capacity() * sizeof(size_t) + m_arena.capacity();
+}
+
+DateTime RecordBatch::Column::microsecondsToDateTime(int64_t microseconds)
+{
+    return DateTime(DateTime::time_point(chrono::duration_cast<DateTime::duration>(chrono::microseconds(microseconds))));
+}
+
+int64_t RecordBatch::Column::dateTimeToMicroseconds(const DateTime& dateTime)
+{
+    return chrono::duration_cast<chrono::microseconds>(dateTime.timePoint().time_since_epoch()).count();
+}
+
+DateTime RecordBatch::Column::dateTime(size_t row) const
+{
+    return microsecondsToDateTime(m_integers[row]);
+}
+
+static void appendNumber(Buffer& output, int64_t value)
+{
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, size_t(result.ptr - buffer));
+}
+
+static void appendNumber(Buffer& output, double value)
+{
+    // Shortest of the formats that keep the exact value
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (strtod(buffer, nullptr) != value)
+        length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+    output.append(buffer, size_t(length));
+}
+
+String RecordBatch::Column::asString(size_t row) const
+{
+    if (isNull(row))
+        return String();
+
+    switch (m_type) {
+        case VAR_BOOL:
+            return m_integers[row] != 0 ? "true" : "false";
+
+        case VAR_INT:
+        case VAR_INT64:
+            return to_string(m_integers[row]);
+
+        case VAR_DATE:
+            return dateTime(row).dateString(DateTime::PF_RFC_DATE);
+
+        case VAR_DATE_TIME:
+            return dateTime(row).isoDateTimeString(DateTime::PA_MILLISECONDS);
+
+        case VAR_FLOAT:
+        case VAR_MONEY: {
+            Buffer output;
+            appendNumber(output, m_floats[row]);
+            return String(output.c_str(), output.bytes());
+        }
+
+        default:
+            return String(string(row), length(row));
+    }
+}
+
+RecordBatch::Column& RecordBatch::addColumn(const String& name, VariantType type)
+{
+    m_columns.emplace_back(name, type);
+    return m_columns.back();
+}
+
+void RecordBatch::clear()
+{
+    for (auto& column: m_columns)
+        column.clear();
+}
+
+void RecordBatch::shrinkToFit()
+{
+    for (auto& column: m_columns)
+        column.shrinkToFit();
+}
+
+size_t RecordBatch::memorySize() const
+{
+    size_t size = sizeof(RecordBatch);
+    for (auto& column: m_columns)
+        size += column.memorySize();
+    return size;
+}
+
+const RecordBatch::Column& RecordBatch::operator [](const String& columnName) const
+{
+    for (auto& column: m_columns) {
+        if (column.name() == columnName)
+            return column;
+    }
+    throw Exception("Column '" + columnName + "' not found");
+}
+
+static void appendJSONString(Buffer& output, const char* data, size_t length)
+{
+    output.append('"');
+
+    const char* start = data;
+    const char* end = data + length;
+    for (const char* ptr = data; ptr < end; ++ptr) {
+        auto ch = (unsigned char) *ptr;
+        if (ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+
+        if (ptr > start)
+            output.append(start, size_t(ptr - start));
+        start = ptr + 1;
+
+        switch (ch) {
+            case '"':
+                output.append("\\\"", 2);
+                break;
+            case '\\':
+                output.append("\\\\", 2);
+                break;
+            case '\n':
+                output.append("\\n", 2);
+                break;
+            case '\r':
+                output.append("\\r", 2);
+                break;
+            case '\t':
+                output.append("\\t", 2);
+                break;
+            case '\b':
+                output.append("\\b", 2);
+                break;
+            case '\f':
+                output.append("\\f", 2);
+                break;
+            default: {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                output.append(escaped, 6);
+                break;
+            }
+        }
+    }
+
+    if (end > start)
+        output.append(start, size_t(end - start));
+
+    output.append('"');
+}
+
+static void appendCSVString(Buffer& output, const char* data, size_t length, char delimiter)
+{
+    const char* end = data + length;
+
+    bool quoted = false;
+    for (const char* ptr = data; ptr < end; ++ptr) {
+        char ch = *ptr;
+        if (ch == delimiter || ch == '"' || ch == '\n' || ch == '\r') {
+            quoted = true;
+            break;
+        }
+    }
+
+    if (!quoted) {
+        if (length != 0)
+            output.append(data, length);
+        return;
+    }
+
+    output.append('"');
+    const char* start = data;
+    for (const char* ptr = data; ptr < end; ++ptr) {
+        if (*ptr == '"') {
+            // Double quote is written twice
+            output.append(start, size_t(ptr - start + 1));
+            start = ptr;
+        }
+    }
+    if (end > start)
+        output.append(start, size_t(end - start));
+    output.append('"');
+}
+
+static void appendBase64(Buffer& output, const char* data, size_t length)
+{
+    if (length == 0)
+        return;
+    Buffer encoded;
+    Base64::encode(encoded, data, length);
+    output.append(encoded);
+}
+
+void RecordBatch::exportJSON(Buffer& output) const
+{
+    vector<Buffer> keys(m_columns.size());
+    for (size_t columnIndex = 0; columnIndex < m_columns.size(); columnIndex++) {
+        const String& name = m_columns[columnIndex].name();
+        appendJSONString(keys[columnIndex], name.c_str(), name.length());
+        keys[columnIndex].append(':');
+    }
+
+    size_t rowCount = rows();
+
+    output.append('[');
+    for (size_t row = 0; row < rowCount; row++) {
+        if (row != 0)
+            output.append(',');
+        output.append('{');
+        for (size_t columnIndex = 0; columnIndex < m_columns.size(); columnIndex++) {
+            const Column& column = m_columns[columnIndex];
+            if (columnIndex != 0)
+                output.append(',');
+            output.append(keys[columnIndex]);
+
+            if (column.isNull(row)) {
+                output.append("null", 4);
+                continue;
+            }
+
+            switch (column.type()) {
+                case VAR_BOOL:
+                    if (column.integer(row) != 0)
+                        output.append("true", 4);
+                    else
+                        output.append("false", 5);
+                    break;
+
+                case VAR_INT:
+                case VAR_INT64:
+                    appendNumber(output, column.integer(row));
+                    break;
+
+                case VAR_FLOAT:
+                case VAR_MONEY:
+                    if (isfinite(column.number(row)))
+                        appendNumber(output, column.number(row));
+                    else
+                        output.append("null", 4);
+                    break;
+
+                case VAR_DATE:
+                case VAR_DATE_TIME: {
+                    String value = column.asString(row);
+                    appendJSONString(output, value.c_str(), value.length());
+                    break;
+                }
+
+                case VAR_BUFFER:
+                    output.append('"');
+                    appendBase64(output, column.string(row), column.length(row));
+                    output.append('"');
+                    break;
+
+                default:
+                    appendJSONString(output, column.string(row), column.length(row));
+                    break;
+            }
+        }
+        output.append('}');
+    }
+    output.append(']');
+}
+
+void RecordBatch::exportCSV(Buffer& output, char delimiter, bool header) const
+{
+    if (header) {
+        for (size_t columnIndex = 0; columnIndex < m_columns.size(); columnIndex++) {
+            if (columnIndex != 0)
+                output.append(delimiter);
+            const String& name = m_columns[columnIndex].name();
+            appendCSVString(output, name.c_str(), name.length(), delimiter);
+        }
+        output.append('\n');
+    }
+
+    size_t rowCount = rows();
+
+    for (size_t row = 0; row < rowCount; row++) {
+        for (size_t columnIndex = 0; columnIndex < m_columns.size(); columnIndex++) {
+            const Column& column = m_columns[columnIndex];
+            if (columnIndex != 0)
+                output.append(delimiter);
+
+            if (column.isNull(row))
+                continue;
+
+            switch (column.type()) {
+                case VAR_BOOL:
+                    if (column.integer(row) != 0)
+                        output.append("true", 4);
+                    else
+                        output.append("false", 5);
+                    break;
+
+                case VAR_INT:
+                case VAR_INT64:
+                    appendNumber(output, column.integer(row));
+                    break;
+
+                case VAR_FLOAT:
+                case VAR_MONEY:
+                    appendNumber(output, column.number(row));
+                    break;
+
+                case VAR_DATE:
+                case VAR_DATE_TIME:
+                    output.append(column.asString(row));
+                    break;
+
+                case VAR_BUFFER:
+                    appendBase64(output, column.string(row), column.length(row));
+                    break;
+
+                default:
+                    appendCSVString(output, column.string(row), column.length(row), delimiter);
+                    break;
+            }
+        }
+        output.append('\n');
+    }
+}
+
+#if USE_GTEST
+
+TEST(SPTK_RecordBatch, append)
+{
+    RecordBatch batch;
+    auto& id = batch.addColumn("id");
+    auto& name = batch.addColumn("name");
+
+    // Column type is defined by the first not null value
+    id.appendNull();
+    id.append(Variant(2));
+    id.appendInteger(3);
+    name.appendString("first", 5);
+    name.appendNull();
+    name.append(Variant(3.5));
+
+    EXPECT_EQ(size_t(3), batch.rows());
+    EXPECT_EQ(VAR_INT, id.type());
+    EXPECT_TRUE(id.isNull(0));
+    EXPECT_FALSE(id.isNull(1));
+    EXPECT_EQ(2, id.integer(1));
+    EXPECT_EQ(3, id.integer(2));
+    EXPECT_EQ(VAR_STRING, name.type());
+    EXPECT_TRUE(name.isNull(1));
+    EXPECT_STREQ("first", name.asString(0).c_str());
+    EXPECT_STREQ("3.5", name.asString(2).c_str());
+
+    batch.clear();
+    EXPECT_EQ(size_t(0), batch.rows());
+    EXPECT_EQ(VAR_INT, batch["id"].type());
+}
+
+TEST(SPTK_RecordBatch, export)
+{
+    RecordBatch batch;
+    auto& flag = batch.addColumn("flag", VAR_BOOL);
+    auto& text = batch.addColumn("text", VAR_STRING);
+    auto& data = batch.addColumn("data", VAR_BUFFER);
+
+    flag.appendInteger(1);
+    text.appendString("tab\tquote\"", 10);
+    data.appendString("abc", 3);
+    flag.appendNull();
+    text.appendString("a;b", 3);
+    data.appendNull();
+
+    Buffer json;
+    batch.exportJSON(json);
+    EXPECT_STREQ(R"([{"flag":true,"text":"tab\tquote\"","data":"YWJj"},{"flag":null,"text":"a;b","data":null}])",
+                 json.c_str());
+
+    Buffer csv;
+    batch.exportCSV(csv, ';', false);
+    EXPECT_STREQ("true;\"tab\tquote\"\"\";YWJj\n;\"a;b\";\n", csv.c_str());
+}
+
+#endif
@@ -0,0 +1,223 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════════╗
+║                       SIMPLY POWERFUL TOOLKIT (SPTK)                         ║
+║                       LatencyHistogram.cpp - description                     ║
+╟──────────────────────────────────────────────────────────────────────────────╢
+║  begin                Sunday October 18 2026                                 ║
+║  copyright            © 1999-2019 by Alexey Parshin. All rights reserved.    ║
+║  email                alexeyp@gmail.com                                      ║
+╚══════════════════════════════════════════════════════════════════════════════╝
+┌──────────────────────────────────────────────────────────────────────────────┐
+│   This library is free software; you can redistribute it and/or modify it    │
+│   under the terms of the GNU Library General Public License as published by  │
+│   the Free Software Foundation; either version 2 of the License, or (at your │
+│   option) any later version.                                                 │
+│                                                                              │
+│   This library is distributed in the hope that it will be useful, but        │
+│   WITHOUT ANY WARRANTY; without even the implied warranty of                 │
+│   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Library   │
+│   General Public License for more details.                                   │
+│                                                                              │
+│   You should have received a copy of the GNU Library General Public License  │
+│   along with this library; if not, write to the Free Software Foundation,    │
+│   Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.               │
+│                                                                              │
+│   Please report all bugs and problems to alexeyp@gmail.com.                  │
+└──────────────────────────────────────────────────────────────────────────────┘
+*/
+
+#include <sptk5/LatencyHistogram.h>
+#include <cmath>
+
+using namespace std;
+using namespace sptk;
+
+// Values below 2^ExactBits are counted exactly, larger ones use 2^(ExactBits-1) sub-buckets per power of two
+static constexpr unsigned ExactBits = 7;
+static constexpr size_t ExactValues = size_t(1) << ExactBits;
+static constexpr size_t SubBuckets = ExactValues / 2;
+static constexpr size_t BucketCount = ExactValues + (64 - ExactBits) * SubBuckets;
+
+LatencyHistogram::LatencyHistogram()
+: m_counts(BucketCount)
+{
+    reset();
+}
+
+static unsigned mostSignificantBit(uint64_t value)
+{
+    unsigned bit = 0;
+    while (value >>= 1)
+        bit++;
+    return bit;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < ExactValues)
+        return size_t(value);
+
+    // Keep ExactBits - 1 significant bits below the most significant one
+    unsigned shift = mostSignificantBit(value) - (ExactBits - 1);
+    return ExactValues + (shift - 1) * SubBuckets + size_t((value >> shift) - SubBuckets);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index)
+{
+    if (index < ExactValues)
+        return uint64_t(index);
+
+    unsigned shift = unsigned((index - ExactValues) / SubBuckets) + 1;
+    uint64_t subBucket = (index - ExactValues) % SubBuckets + SubBuckets;
+    return (subBucket << shift) + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    m_counts[bucketIndex(value)].fetch_add(1, memory_order_relaxed);
+    m_count.fetch_add(1, memory_order_relaxed);
+    m_sum.fetch_add(value, memory_order_relaxed);
+
+    uint64_t current = m_min.load(memory_order_relaxed);
+    while (value < current && !m_min.compare_exchange_weak(current, value, memory_order_relaxed));
+
+    current = m_max.load(memory_order_relaxed);
+    while (value > current && !m_max.compare_exchange_weak(current, value, memory_order_relaxed));
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (size_t i = 0; i < BucketCount; i++) {
+        uint64_t count = other.m_counts[i].load(memory_order_relaxed);
+        if (count != 0)
+            m_counts[i].fetch_add(count, memory_order_relaxed);
+    }
+    m_count.fetch_add(other.m_count, memory_order_relaxed);
+    m_sum.fetch_add(other.m_sum, memory_order_relaxed);
+
+    uint64_t value = other.m_min.load(memory_order_relaxed);
+    uint64_t current = m_min.load(memory_order_relaxed);
+    while (value < current && !m_min.compare_exchange_weak(current, value, memory_order_relaxed));
+
+    value = other.m_max.load(memory_order_relaxed);
+    current = m_max.load(memory_order_relaxed);
+    while (value > current && !m_max.compare_exchange_weak(current, value, memory_order_relaxed));
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& count: m_counts)
+        count = 0;
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+uint64_t LatencyHistogram::min() const
+{
+    return m_count == 0 ? 0 : m_min.load();
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+double LatencyHistogram::mean() const
+{
+    uint64_t count = m_count;
+    return count == 0 ? 0 : double(m_sum) / count;
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const
+{
+    uint64_t count = m_count;
+    if (count == 0)
+        return 0;
+
+    if (percentile > 100)
+        percentile = 100;
+    auto target = uint64_t(ceil(percentile / 100 * count));
+    if (target == 0)
+        target = 1;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < BucketCount; i++) {
+        total += m_counts[i].load(memory_order_relaxed);
+        if (total >= target) {
+            // Bucket bound may exceed the actual max value
+            uint64_t value = bucketValue(i);
+            return value < m_max ? value : m_max.load();
+        }
+    }
+
+    return m_max;
+}
+
+#if USE_GTEST
+#include <gtest/gtest.h>
+
+TEST(SPTK_LatencyHistogram, percentiles)
+{
+    LatencyHistogram histogram;
+
+    EXPECT_EQ(uint64_t(0), histogram.valueAtPercentile(50));
+
+    for (uint64_t value = 1; value <= 100000; value++)
+        histogram.record(value);
+
+    EXPECT_EQ(uint64_t(100000), histogram.count());
+    EXPECT_EQ(uint64_t(1), histogram.min());
+    EXPECT_EQ(uint64_t(100000), histogram.max());
+    EXPECT_DOUBLE_EQ(50000.5, histogram.mean());
+
+    // Relative error is below 1/64
+    EXPECT_NEAR(50000, histogram.valueAtPercentile(50), 50000 / 64);
+    EXPECT_NEAR(99000, histogram.valueAtPercentile(99), 99000 / 64);
+    EXPECT_NEAR(99900, histogram.valueAtPercentile(99.9), 99900 / 64);
+    EXPECT_EQ(uint64_t(100000), histogram.valueAtPercentile(100));
+
+    // Small values are exact
+    LatencyHistogram small;
+    for (uint64_t value = 0; value < 100; value++)
+        small.record(value);
+    EXPECT_EQ(uint64_t(49), small.valueAtPercentile(50));
+    EXPECT_EQ(uint64_t(0), small.valueAtPercentile(0));
+}
+
+TEST(SPTK_LatencyHistogram, largeValues)
+{
+    LatencyHistogram histogram;
+    histogram.record(UINT64_MAX);
+    histogram.record(uint64_t(1) << 40);
+    EXPECT_EQ(UINT64_MAX, histogram.valueAtPercentile(100));
+    EXPECT_NEAR(double(uint64_t(1) << 40), double(histogram.valueAtPercentile(50)), double(uint64_t(1) << 40) / 64);
+}
+
+TEST(SPTK_LatencyHistogram, merge)
+{
+    LatencyHistogram first;
+    LatencyHistogram second;
+    for (uint64_t value = 1; value <= 1000; value++) {
+        first.record(value);
+        second.record(value + 1000);
+    }
+
+    first.merge(second);
+    EXPECT_EQ(uint64_t(2000), first.count());
+    EXPECT_EQ(uint64_t(1), first.min());
+    EXPECT_EQ(uint64_t(2000), first.max());
+    EXPECT_NEAR(1000, first.valueAtPercentile(50), 1000 / 64);
+
+    first.reset();
+    EXPECT_EQ(uint64_t(0), first.count());
+    EXPECT_EQ(uint64_t(0), first.min());
+}
+
+#endif
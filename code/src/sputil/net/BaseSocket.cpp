@@ -32,6 +32,7 @@
 
 #ifndef _WIN32
 #include <sys/poll.h>
+#include <sys/stat.h>
 #endif
 
 using namespace std;
@@ -141,7 +142,12 @@ size_t BaseSocket::recv(void* buffer, size_t len)
 
 size_t BaseSocket::send(const void* buffer, size_t len)
 {
+#ifdef MSG_NOSIGNAL
+    // Writing to a connection closed by peer should fail with EPIPE, rather than kill the process with SIGPIPE
+    return (size_t) ::send(m_sockfd, (char*) buffer, (int32_t) len, MSG_NOSIGNAL);
+#else
     return (size_t) ::send(m_sockfd, (char*) buffer, (int32_t) len, 0);
+#endif
 }
 
 int32_t BaseSocket::control(int flag, const uint32_t* check)
@@ -160,6 +166,51 @@ void BaseSocket::host(const Host& host)
 
 // Connect & disconnect
 void BaseSocket::open_addr(CSocketOpenMode openMode, const sockaddr_in* addr, std::chrono::milliseconds timeout)
+{
+    openAddress(openMode, (const sockaddr*) addr, sizeof(sockaddr_in), timeout, m_host.toString(false));
+}
+
+#ifndef _WIN32
+/**
+ * Remove Unix domain socket file, left by the process that has exited without removing it.
+ * Any other file, or the socket that accepts connections, is never removed.
+ * @param addr                  Socket address
+ * @param socketType            Socket type, SOCK_STREAM or SOCK_DGRAM
+ */
+static void removeStaleSocketFile(const sockaddr_un* addr, int socketType)
+{
+    struct stat fileStat = {};
+    if (::lstat(addr->sun_path, &fileStat) != 0)
+        return; // Nothing to remove
+
+    if (!S_ISSOCK(fileStat.st_mode))
+        throw Exception("Can't bind to " + String(addr->sun_path) + ": address in use by a file that isn't a socket");
+
+    // Only the socket without a listener refuses connection
+    int testSocket = socket(AF_UNIX, socketType, 0);
+    if (testSocket == INVALID_SOCKET)
+        THROW_SOCKET_ERROR("Can't create socket");
+    int rc = connect(testSocket, (const sockaddr*) addr, sizeof(sockaddr_un));
+    int connectError = errno;
+    ::close(testSocket);
+
+    if (rc == 0 || connectError != ECONNREFUSED)
+        throw Exception("Can't bind to " + String(addr->sun_path) + ": address in use");
+
+    ::unlink(addr->sun_path);
+}
+
+void BaseSocket::open_addr(CSocketOpenMode openMode, const sockaddr_un* addr, std::chrono::milliseconds timeout)
+{
+    m_domain = AF_UNIX;
+    if (openMode == SOM_BIND)
+        removeStaleSocketFile(addr, m_type);
+    openAddress(openMode, (const sockaddr*) addr, sizeof(sockaddr_un), timeout, addr->sun_path);
+}
+#endif
+
+void BaseSocket::openAddress(CSocketOpenMode openMode, const sockaddr* addr, socklen_t addrLength,
+                             std::chrono::milliseconds timeout, const String& addressName)
 {
     auto timeoutMS = (int) timeout.count();
 
@@ -179,7 +230,7 @@ void BaseSocket::open_addr(CSocketOpenMode openMode, const sockaddr_in* addr, st
             currentOperation = "connect";
             if (timeoutMS != 0) {
                 blockingMode(false);
-                rc = connect(m_sockfd, (sockaddr*) addr, sizeof(sockaddr_in));
+                rc = connect(m_sockfd, addr, addrLength);
                 switch (rc) {
                     case ENETUNREACH:
                         throw Exception("Network unreachable");
@@ -199,11 +250,11 @@ void BaseSocket::open_addr(CSocketOpenMode openMode, const sockaddr_in* addr, st
                 rc = 0;
                 blockingMode(true);
             } else
-                rc = connect(m_sockfd, (sockaddr*) addr, sizeof(sockaddr_in));
+                rc = connect(m_sockfd, addr, addrLength);
             break;
 
         case SOM_BIND:
-            if (m_type != SOCK_DGRAM) {
+            if (m_type != SOCK_DGRAM && m_domain != AF_UNIX) {
 #ifndef _WIN32
                 setOption(SOL_SOCKET, SO_REUSEPORT, 1);
 #else
@@ -211,7 +262,7 @@ void BaseSocket::open_addr(CSocketOpenMode openMode, const sockaddr_in* addr, st
 #endif
             }
             currentOperation = "bind";
-            rc = ::bind(m_sockfd, (sockaddr*) addr, sizeof(sockaddr_in));
+            rc = ::bind(m_sockfd, addr, addrLength);
             if (rc == 0 && m_type != SOCK_DGRAM) {
                 rc = ::listen(m_sockfd, SOMAXCONN);
                 currentOperation = "listen";
@@ -224,7 +275,7 @@ void BaseSocket::open_addr(CSocketOpenMode openMode, const sockaddr_in* addr, st
 
     if (rc != 0) {
         stringstream error;
-        error << "Can't " << currentOperation << " to " << m_host.toString(false) << ". " << SystemException::osError()
+        error << "Can't " << currentOperation << " to " << addressName << ". " << SystemException::osError()
               << ".";
         close();
         throw Exception(error.str());
@@ -339,9 +390,9 @@ size_t BaseSocket::write(const char* buffer, size_t size, const sockaddr_in* pee
     auto remaining = (int) size;
     while (remaining > 0) {
         if (peer != nullptr)
-            bytes = (int) sendto(m_sockfd, p, (int32_t) size, 0, (sockaddr*) peer, sizeof(sockaddr_in));
+            bytes = (int) sendto(m_sockfd, p, (int32_t) remaining, 0, (sockaddr*) peer, sizeof(sockaddr_in));
         else
-            bytes = (int) send(p, (int32_t) size);
+            bytes = (int) send(p, (int32_t) remaining);
         if (bytes == -1)
             THROW_SOCKET_ERROR("Can't write to socket");
         remaining -= bytes;
@@ -81,10 +81,51 @@ void TCPServer::listen(uint16_t port)
     }
 
     m_listenerThread = new TCPServerListener(this, port);
-    m_listenerThread->listen();
+    try {
+        m_listenerThread->listen();
+    }
+    catch (const Exception&) {
+        delete m_listenerThread;
+        m_listenerThread = nullptr;
+        throw;
+    }
     m_listenerThread->run();
 }
 
+#ifndef _WIN32
+void TCPServer::listen(const String& socketPath)
+{
+    if (!running())
+        run();
+
+    UniqueLock(m_mutex);
+    if (m_listenerThread != nullptr) {
+        m_listenerThread->terminate();
+        m_listenerThread->join();
+        delete m_listenerThread;
+    }
+
+    m_listenerThread = new TCPServerListener(this, socketPath);
+    try {
+        m_listenerThread->listen();
+    }
+    catch (const Exception&) {
+        delete m_listenerThread;
+        m_listenerThread = nullptr;
+        throw;
+    }
+    m_listenerThread->run();
+}
+
+String TCPServer::socketPath() const
+{
+    SharedLock(m_mutex);
+    if (!m_listenerThread)
+        return String();
+    return m_listenerThread->socketPath();
+}
+#endif
+
 bool TCPServer::allowConnection(sockaddr_in*)
 {
     return true;
@@ -93,14 +134,16 @@ bool TCPServer::allowConnection(sockaddr_in*)
 void TCPServer::stop()
 {
     UniqueLock(m_mutex);
-    ThreadPool::stop();
 
+    // Listener is stopped first: connection, accepted while the thread pool is stopping, would never be completed
     if (m_listenerThread != nullptr) {
         m_listenerThread->terminate();
         m_listenerThread->join();
         delete m_listenerThread;
         m_listenerThread = nullptr;
     }
+
+    ThreadPool::stop();
 }
 
 void TCPServer::setSSLKeys(shared_ptr<SSLKeys> sslKeys)
@@ -143,7 +186,8 @@ public:
     void run() override
     {
         Buffer data;
-        while (!terminated()) {
+        // Socket, closed by terminate() before the connection has started, is never ready to read
+        while (!terminated() && socket().active()) {
             try {
                 if (socket().readyToRead(chrono::seconds(30))) {
                     if (socket().readLine(data) == 0)
@@ -155,7 +199,9 @@ public:
                     break;
             }
             catch (const Exception& e) {
+                // Peer has closed the connection, or the socket is broken
                 CERR(e.what() << endl);
+                break;
             }
         }
         socket().close();
@@ -206,4 +252,68 @@ TEST(SPTK_TCPServer, minimal)
     socket.close();
 }
 
+#ifndef _WIN32
+TEST(SPTK_TCPServer, unixSocket)
+{
+    Buffer buffer;
+    String socketPath("/tmp/sptk_echo_server.sock");
+
+    EchoServer echoServer;
+    ASSERT_NO_THROW(echoServer.listen(socketPath));
+    EXPECT_STREQ(socketPath.c_str(), echoServer.socketPath().c_str());
+
+    TCPSocket socket;
+    ASSERT_NO_THROW(socket.openUnix(socketPath));
+
+    Strings rows("Hello, World!\n"
+                 "This is a test of Unix domain socket listener.", "\n");
+
+    for (auto& row: rows) {
+        socket.write(row + "\n");
+        buffer.bytes(0);
+        if (socket.readyToRead(chrono::seconds(3)))
+            socket.readLine(buffer);
+        EXPECT_STREQ(row.c_str(), buffer.c_str());
+    }
+
+    socket.close();
+    echoServer.stop();
+    EXPECT_NE(0, access(socketPath.c_str(), F_OK));
+}
+
+TEST(SPTK_TCPServer, unixSocketAddressInUse)
+{
+    String socketPath("/tmp/sptk_echo_server_in_use.sock");
+
+    // Regular file with the socket name is never removed
+    Buffer("data").saveToFile(socketPath);
+    EchoServer fileOwner;
+    EXPECT_THROW(fileOwner.listen(socketPath), Exception);
+    EXPECT_EQ(0, access(socketPath.c_str(), F_OK));
+    unlink(socketPath.c_str());
+
+    // Socket with active listener is never removed
+    EchoServer echoServer;
+    ASSERT_NO_THROW(echoServer.listen(socketPath));
+    EchoServer secondServer;
+    EXPECT_THROW(secondServer.listen(socketPath), Exception);
+
+    TCPSocket socket;
+    ASSERT_NO_THROW(socket.openUnix(socketPath));
+    socket.close();
+    echoServer.stop();
+
+    // Stale socket file, left without listener, is replaced
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int staleSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_EQ(0, ::bind(staleSocket, (const sockaddr*) &address, sizeof(address)));
+    ::close(staleSocket);
+    EchoServer nextServer;
+    ASSERT_NO_THROW(nextServer.listen(socketPath));
+    nextServer.stop();
+}
+#endif
+
 #endif
@@ -38,6 +38,23 @@ TCPServerListener::TCPServerListener(TCPServer* server, uint16_t port)
     m_listenerSocket.host(Host("localhost", port));
 }
 
+TCPServerListener::TCPServerListener(TCPServer* server, const String& socketPath)
+: Thread("CTCPServer::Listener"), m_server(server), m_socketPath(socketPath)
+{
+}
+
+void TCPServerListener::listen()
+{
+#ifndef _WIN32
+    if (!m_socketPath.empty()) {
+        m_listenerSocket.openUnix(m_socketPath, TCPSocket::SOM_BIND);
+        m_socketBound = true;
+        return;
+    }
+#endif
+    m_listenerSocket.listen();
+}
+
 void TCPServerListener::acceptConnection()
 {
     try {
@@ -83,4 +100,11 @@ void TCPServerListener::terminate()
     Thread::terminate();
 	lock_guard<mutex> lock(*this);
 	m_listenerSocket.close();
+#ifndef _WIN32
+    // Socket file that failed to bind belongs to other server, or isn't a socket
+    if (m_socketBound) {
+        ::unlink(m_socketPath.c_str());
+        m_socketBound = false;
+    }
+#endif
 }
@@ -264,6 +264,25 @@ void TCPSocket::_open(const struct sockaddr_in& address, CSocketOpenMode openMod
         blockingMode(false);
 }
 
+#ifndef _WIN32
+void TCPSocket::openUnix(const String& socketPath, CSocketOpenMode openMode, bool _blockingMode,
+                         chrono::milliseconds timeout)
+{
+    sockaddr_un address = {};
+    if (socketPath.empty() || socketPath.length() >= sizeof(address.sun_path))
+        throw Exception("Invalid Unix socket path '" + socketPath + "'", __FILE__, __LINE__);
+
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    open_addr(openMode, &address, timeout);
+    m_reader.open();
+
+    if (!_blockingMode)
+        blockingMode(false);
+}
+#endif
+
 void TCPSocket::close() noexcept
 {
     m_reader.close();